@@ -0,0 +1,311 @@
+// Binary toolpath benchmark: size and decode speed against text G-code.
+//
+//   bench_binarytoolpath [--lines N] [--keep]
+//
+// Writes a synthetic 3D finishing job (short XYZ moves over a surface, with
+// rapids and feed changes) as text, converts it with and without block
+// checksums, then times text parsing against binary decoding. Every decoded
+// move must equal the parsed move quantized to the file resolution, random
+// seeks must land on the right move, a flipped payload byte must be caught
+// by the checksum, and a tampered footer or index must be refused by open()
+// without allocating from it. Exits non-zero on any mismatch.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "binarytoolpath.h"
+#include "gcodeparser.h"
+
+namespace {
+
+double seconds(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool writeJob(const std::string &path, long lines)
+{
+    std::FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    std::fprintf(f, "G21 G90\n");
+    long written = 1;
+    for (int row = 0; written < lines; ++row) {
+        const double y = row * 0.25;
+        std::fprintf(f, "G0 X0 Y%.4f Z5\nG1 Z%.4f F%d\n", y, -std::sin(y * 0.1), 600 + 300 * (row % 3));
+        written += 2;
+        for (int k = 1; k <= 2000 && written < lines; ++k, ++written) {
+            const double x = k * 0.05;
+            std::fprintf(f, "X%.4f Z%.4f\n", x, -std::sin(y * 0.1) - 0.5 * std::sin(x * 0.2) * std::cos(y * 0.07));
+        }
+    }
+    return std::fclose(f) == 0;
+}
+
+bool convert(const std::string &in, const std::string &out, const BinaryToolpathOptions &options)
+{
+    GCodeReader reader;
+    BinaryToolpathWriter writer;
+    if (!reader.open(in) || !writer.open(out, options))
+        return false;
+    std::vector<MotionSegment> batch;
+    while (reader.nextBatch(batch))
+        writer.write(batch);
+    return reader.error().empty() && writer.close();
+}
+
+bool sameMove(const MotionSegment &ref, const MotionSegment &got, double scale)
+{
+    for (int a = 0; a < kAxisCount; ++a) {
+        if (got.start[a] != std::llround(ref.start[a] * scale) / scale
+            || got.end[a] != std::llround(ref.end[a] * scale) / scale)
+            return false;
+    }
+    return got.rapid == ref.rapid && got.line == ref.line
+        && got.feed == std::llround(ref.feed * 1000.0) / 1000.0;
+}
+
+long fileSize(const std::string &path)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return -1;
+    std::fseek(f, 0, SEEK_END);
+    const long size = std::ftell(f);
+    std::fclose(f);
+    return size;
+}
+
+std::vector<unsigned char> readFile(const std::string &path)
+{
+    std::vector<unsigned char> bytes(static_cast<std::size_t>(fileSize(path)));
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (f) {
+        bytes.resize(std::fread(bytes.data(), 1, bytes.size(), f));
+        std::fclose(f);
+    }
+    return bytes;
+}
+
+void putU64(std::vector<unsigned char> &bytes, std::size_t at, std::uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+        bytes[at + i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+std::uint64_t getU64(const std::vector<unsigned char> &bytes, std::size_t at)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v |= static_cast<std::uint64_t>(bytes[at + i]) << (8 * i);
+    return v;
+}
+
+// Writes a tampered copy of a file and checks that open() refuses it.
+bool refused(const std::vector<unsigned char> &bytes, const std::string &path)
+{
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    std::fwrite(bytes.data(), 1, bytes.size(), f);
+    std::fclose(f);
+    BinaryToolpathReader in;
+    std::vector<MotionSegment> batch;
+    const bool opened = in.open(path);
+    const bool refusedOpen = !opened && !in.error().empty();
+    // Whatever open() said, reading and seeking must fail cleanly.
+    if (!opened) {
+        in.seekMove(1);
+        in.nextBatch(batch);
+    }
+    std::remove(path.c_str());
+    return refusedOpen && batch.empty();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    long lines = 5000000;
+    bool keep = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--lines") && i + 1 < argc)
+            lines = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--keep"))
+            keep = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--lines N] [--keep]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::string text = "toolpath_bench.nc", plain = "toolpath_bench.cnb", checked = "toolpath_bench_crc.cnb";
+    if (!writeJob(text, lines)) {
+        std::fprintf(stderr, "cannot write %s\n", text.c_str());
+        return 1;
+    }
+
+    // Text parse: the baseline time, then the reference moves.
+    std::vector<MotionSegment> reference, batch;
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        GCodeReader reader;
+        reader.open(text);
+        while (reader.nextBatch(batch)) {
+        }
+    }
+    const double parseSeconds = seconds(t0);
+    {
+        GCodeReader reader;
+        reader.open(text);
+        while (reader.nextBatch(batch))
+            reference.insert(reference.end(), batch.begin(), batch.end());
+    }
+
+    BinaryToolpathOptions options;
+    t0 = std::chrono::steady_clock::now();
+    const bool converted = convert(text, plain, options);
+    const double convertSeconds = seconds(t0);
+    options.checksums = true;
+    if (!converted || !convert(text, checked, options)) {
+        std::fprintf(stderr, "conversion failed\n");
+        return 1;
+    }
+    const double scale = options.unitsPerMm;
+
+    int failures = 0;
+    double decodeSeconds[2] = {};
+    const std::string files[2] = {plain, checked};
+    for (int v = 0; v < 2; ++v) {
+        BinaryToolpathReader in;
+        if (!in.open(files[v])) {
+            std::fprintf(stderr, "%s\n", in.error().c_str());
+            return 1;
+        }
+        // Decode only, best of three; verification runs as a separate pass.
+        decodeSeconds[v] = 1e300;
+        for (int rep = 0; rep < 3; ++rep) {
+            in.seekMove(0);
+            t0 = std::chrono::steady_clock::now();
+            while (in.nextBatch(batch)) {
+            }
+            decodeSeconds[v] = std::min(decodeSeconds[v], seconds(t0));
+        }
+
+        in.seekMove(0);
+        std::size_t k = 0;
+        bool match = true;
+        while (in.nextBatch(batch)) {
+            for (std::size_t i = 0; i < batch.size() && match; ++i)
+                match = k + i < reference.size() && sameMove(reference[k + i], batch[i], scale);
+            k += batch.size();
+        }
+        if (!in.error().empty() || !match || k != reference.size()) {
+            std::fprintf(stderr, "FAIL: %s does not decode to the parsed moves\n", files[v].c_str());
+            ++failures;
+        }
+
+        // Random access through the block index.
+        std::mt19937_64 rng(7);
+        for (int trial = 0; trial < 200; ++trial) {
+            const std::uint64_t m = rng() % reference.size();
+            if (!in.seekMove(m) || !in.nextBatch(batch, 1) || !sameMove(reference[m], batch[0], scale)) {
+                std::fprintf(stderr, "FAIL: seek to move %llu\n", static_cast<unsigned long long>(m));
+                ++failures;
+                break;
+            }
+        }
+    }
+
+    // Corrupt one payload byte in the middle of the checksummed file.
+    {
+        std::FILE *f = std::fopen(checked.c_str(), "r+b");
+        std::fseek(f, fileSize(checked) / 2, SEEK_SET);
+        const int c = std::fgetc(f);
+        std::fseek(f, -1, SEEK_CUR);
+        std::fputc(c ^ 0x10, f);
+        std::fclose(f);
+        BinaryToolpathReader in;
+        in.open(checked);
+        while (in.nextBatch(batch)) {
+        }
+        if (in.error().find("checksum") == std::string::npos) {
+            std::fprintf(stderr, "FAIL: corrupted block was not detected\n");
+            ++failures;
+        } else {
+            std::printf("corruption:   detected (%s)\n", in.error().c_str());
+        }
+    }
+
+    // Tampered footer and index, each on a fresh copy of the plain file.
+    {
+        const std::vector<unsigned char> good = readFile(plain);
+        const std::size_t footer = good.size() - 32;
+        const std::uint64_t indexOffset = getU64(good, footer), blocks = getU64(good, footer + 8);
+        struct Tamper
+        {
+            const char *what;
+            std::size_t at;
+            std::uint64_t value;
+        };
+        const Tamper tampers[] = {
+            {"huge block count", footer + 8, std::uint64_t(1) << 60},
+            {"block count that wraps", footer + 8, ~std::uint64_t(0) / 24 + 2},
+            {"no blocks", footer + 8, 0},
+            {"index offset past the end", footer, good.size()},
+            {"index offset short by one entry", footer, indexOffset - 24},
+            {"first block not at move 0", indexOffset + 8, 5},
+            {"block offsets out of order", indexOffset + 24, getU64(good, indexOffset)},
+            {"block offset inside the index", indexOffset, indexOffset},
+            {"empty block", indexOffset + 24 + 8, 0},
+            {"move past the end", indexOffset + 24 * (blocks - 1) + 8, getU64(good, footer + 16)},
+        };
+        int caught = 0;
+        for (const Tamper &t : tampers) {
+            std::vector<unsigned char> bad = good;
+            putU64(bad, t.at, t.value);
+            if (blocks >= 2 && refused(bad, "toolpath_bench_bad.cnb")) {
+                ++caught;
+            } else {
+                std::fprintf(stderr, "FAIL: tampered file accepted: %s\n", t.what);
+                ++failures;
+            }
+        }
+        std::printf("tampering:    %d of %zu damaged indexes refused\n", caught, sizeof tampers / sizeof tampers[0]);
+    }
+
+    const double moves = static_cast<double>(reference.size());
+    const long textBytes = fileSize(text), plainBytes = fileSize(plain), checkedBytes = fileSize(checked);
+    const double outBytes = moves * sizeof(MotionSegment);
+
+    // Memory bandwidth reference: copying the decoded segments once.
+    std::vector<MotionSegment> copy(reference.size());
+    t0 = std::chrono::steady_clock::now();
+    std::memcpy(copy.data(), reference.data(), static_cast<std::size_t>(outBytes));
+    const double copySeconds = seconds(t0);
+
+    std::printf("moves:        %.0f (%ld lines)\n", moves, lines);
+    std::printf("text:         %8.2f MB  parse  %6.3f s  %7.1f M moves/s\n", textBytes / 1e6, parseSeconds,
+                moves / parseSeconds / 1e6);
+    std::printf("binary:       %8.2f MB  decode %6.3f s  %7.1f M moves/s  (%.1fx smaller, %.2f bytes/move)\n",
+                plainBytes / 1e6, decodeSeconds[0], moves / decodeSeconds[0] / 1e6, double(textBytes) / plainBytes,
+                plainBytes / moves);
+    std::printf("binary+crc:   %8.2f MB  decode %6.3f s  %7.1f M moves/s\n", checkedBytes / 1e6, decodeSeconds[1],
+                moves / decodeSeconds[1] / 1e6);
+    std::printf("output:       %.2f GB/s of segments decoded, memcpy of the same %.2f GB/s\n",
+                outBytes / decodeSeconds[0] / 1e9, outBytes / copySeconds / 1e9);
+    std::printf("convert:      %.3f s\n", convertSeconds);
+
+    if (!keep) {
+        std::remove(text.c_str());
+        std::remove(plain.c_str());
+        std::remove(checked.c_str());
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+// Rapid-move optimizer on a generated laser-cutting job.
+//
+//   bench_contourorder [--parts N] [--budget S] [--threads T]
+//
+// Nests N parts on a 3000 x 1500 sheet: each an outline with one to three
+// holes (closed contours, entered at a random vertex) and an engraved mark
+// (open), all in random order, as a job merged from separate designs comes
+// out. Reports the G0 travel as programmed, after seeding and after
+// refinement within S seconds, and checks that:
+//
+// 1. the output cuts exactly the input's moves (count and length), with
+//    every move starting where the last ended
+// 2. seeding and refinement each shorten the travel, and the budget holds
+// 3. with direction and entry fixed (gcodeorder --no-reverse --no-rotate)
+//    the output cuts exactly the input's moves as written
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "contourorder.h"
+#include "workstealingpool.h"
+
+namespace {
+
+constexpr double kSheetX = 3000.0;
+constexpr double kSheetY = 1500.0;
+constexpr double kSafeZ = 5.0;
+constexpr double kCutZ = -1.0;
+
+struct Shape
+{
+    std::vector<std::array<double, 2>> points;
+    bool closed;
+};
+
+std::vector<Shape> nestParts(int parts, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const int cols = std::max(1, static_cast<int>(std::sqrt(parts * kSheetX / kSheetY)));
+    const int rows = (parts + cols - 1) / cols;
+    const double w = kSheetX / cols, h = kSheetY / rows;
+    std::vector<Shape> shapes;
+    auto ring = [&](double cx, double cy, double r, int n) {
+        Shape s;
+        s.closed = true;
+        const int startAt = static_cast<int>(unit(rng) * n);
+        for (int k = 0; k <= n; ++k) {
+            const double a = 2 * M_PI * ((k + startAt) % n) / n;
+            s.points.push_back({cx + r * std::cos(a), cy + r * std::sin(a)});
+        }
+        s.points.back() = s.points.front();
+        shapes.push_back(s);
+    };
+    for (int p = 0; p < parts; ++p) {
+        const double cx = (p % cols + 0.5) * w, cy = (p / cols + 0.5) * h;
+        const double r = 0.4 * std::min(w, h);
+        ring(cx, cy, r, 48);
+        const int holes = 1 + p % 3;
+        for (int k = 0; k < holes; ++k)
+            ring(cx + r * 0.5 * std::cos(2 * M_PI * k / holes), cy + r * 0.5 * std::sin(2 * M_PI * k / holes),
+                 r * 0.15, 16);
+        Shape mark;
+        mark.closed = false;
+        for (int k = 0; k < 6; ++k)
+            mark.points.push_back({cx - r * 0.2 + r * 0.08 * k, cy + r * 0.1 * (k % 2)});
+        if (unit(rng) < 0.5)
+            std::reverse(mark.points.begin(), mark.points.end());
+        shapes.push_back(mark);
+    }
+    std::shuffle(shapes.begin(), shapes.end(), rng);
+    return shapes;
+}
+
+std::vector<MotionSegment> writeJob(const std::vector<Shape> &shapes)
+{
+    std::vector<MotionSegment> job;
+    AxisPoint pos{};
+    pos[AxisZ] = kSafeZ;
+    auto move = [&](double x, double y, double z, bool rapid) {
+        MotionSegment m;
+        m.start = pos;
+        pos[AxisX] = x;
+        pos[AxisY] = y;
+        pos[AxisZ] = z;
+        m.end = pos;
+        m.rapid = rapid;
+        m.feed = rapid ? 0.0 : (z == kCutZ && m.start[AxisZ] == kCutZ ? 6000.0 : 600.0);
+        m.line = static_cast<std::int64_t>(job.size()) + 1;
+        job.push_back(m);
+    };
+    for (const Shape &s : shapes) {
+        move(s.points[0][0], s.points[0][1], kSafeZ, true);
+        move(s.points[0][0], s.points[0][1], kCutZ, false);
+        for (std::size_t k = 1; k < s.points.size(); ++k)
+            move(s.points[k][0], s.points[k][1], kCutZ, false);
+        move(pos[AxisX], pos[AxisY], kSafeZ, true);
+    }
+    move(0.0, 0.0, kSafeZ, true);
+    return job;
+}
+
+struct CutSummary
+{
+    std::size_t moves = 0;
+    double length = 0.0;
+    bool continuous = true;
+};
+
+CutSummary summarize(const std::vector<MotionSegment> &job)
+{
+    CutSummary s;
+    for (std::size_t i = 0; i < job.size(); ++i) {
+        if (i > 0 && job[i].start != job[i - 1].end)
+            s.continuous = false;
+        if (job[i].rapid)
+            continue;
+        ++s.moves;
+        s.length += std::hypot(std::hypot(job[i].end[AxisX] - job[i].start[AxisX],
+                                          job[i].end[AxisY] - job[i].start[AxisY]),
+                               job[i].end[AxisZ] - job[i].start[AxisZ]);
+    }
+    return s;
+}
+
+void printReport(const char *title, const OrderingReport &r, int threads)
+{
+    std::printf("%s: %zu contours (%zu closed)\n", title, r.contours, r.closedContours);
+    std::printf("  as programmed  %12.1f mm\n", r.originalTravel);
+    std::printf("  seeded         %12.1f mm  %6.1f%% saved  %.3f s\n", r.seededTravel,
+                100.0 * (1.0 - r.seededTravel / r.originalTravel), r.seedSeconds);
+    std::printf("  refined        %12.1f mm  %6.1f%% saved  %.3f s, %ld rounds, %ld moves, %d threads\n",
+                r.optimizedTravel, 100.0 * r.savings(), r.refineSeconds, r.rounds, r.improvements, threads);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int parts = 2000;
+    double budget = 1.0;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--parts") && i + 1 < argc)
+            parts = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--budget") && i + 1 < argc)
+            budget = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--parts N] [--budget S] [--threads T]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (parts < 10 || budget <= 0.0) {
+        std::fprintf(stderr, "need at least 10 parts and a positive budget\n");
+        return 2;
+    }
+
+    std::mt19937 rng(7);
+    const std::vector<MotionSegment> job = writeJob(nestParts(parts, rng));
+    const CutSummary in = summarize(job);
+    WorkStealingPool pool(threads);
+    bool ok = true;
+
+    OrderingOptions options;
+    options.timeBudget = budget;
+    std::vector<MotionSegment> out;
+    const OrderingReport r = optimizeContourOrder(job, out, options, &pool);
+    printReport("free direction and entry", r, pool.size());
+    const CutSummary cut = summarize(out);
+    const bool same = cut.moves == in.moves && std::fabs(cut.length - in.length) <= 1e-9 * in.length;
+    std::printf("  output: %zu cutting moves, %.3f mm cut (input %zu, %.3f mm), %s\n", cut.moves, cut.length,
+                in.moves, in.length, cut.continuous ? "continuous" : "NOT continuous");
+    ok = ok && same && cut.continuous && r.seededTravel < r.originalTravel && r.optimizedTravel < r.seededTravel
+         && r.refineSeconds <= budget + 0.25;
+
+    // Fixed direction and entry: every output cutting move must then be
+    // an input move as written (compared as a sorted multiset of ends).
+    options.reverseOpen = false;
+    options.rotateClosed = false;
+    const OrderingReport fixed = optimizeContourOrder(job, out, options, &pool);
+    printReport("fixed direction and entry", fixed, pool.size());
+    auto cuts = [](const std::vector<MotionSegment> &moves) {
+        std::vector<std::array<double, 4>> v;
+        for (const MotionSegment &m : moves)
+            if (!m.rapid)
+                v.push_back({m.start[AxisX], m.start[AxisY], m.end[AxisX], m.end[AxisY]});
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+    const bool kept = cuts(out) == cuts(job);
+    std::printf("  output moves %s the input's\n", kept ? "match" : "DO NOT match");
+    ok = ok && kept && fixed.optimizedTravel < fixed.seededTravel;
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
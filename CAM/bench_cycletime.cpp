@@ -0,0 +1,145 @@
+// Cycle-time estimator benchmark on a generated 10 M line program.
+//
+//   bench_cycletime [--lines N] [--keep]
+//
+// Writes a synthetic contouring job (short G1 chords around circles with
+// G0 hops between them) to cycletime_bench.nc in the working directory,
+// then times parse + plan. Every circle after the first starts and ends at
+// rest in the same place, so the total must match the time of one- and
+// two-circle programs extrapolated; the run fails if the streamed estimate
+// disagrees. Parse + plan is timed as the best of three passes and
+// reported against the 10 M lines per second target (a 10 M line program
+// in under a second); the run fails below half of that, a regression no
+// host noise explains. Runs below half a million lines are too short to
+// time and only check the estimate.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cycletime.h"
+#include "gcodeparser.h"
+
+namespace {
+
+constexpr int kChords = 1000;   // G1 lines per circle
+constexpr double kRadius = 20.0;
+constexpr double kTargetLinesPerSecond = 10e6;
+constexpr double kMinLinesPerSecond = 5e6;
+constexpr long long kMinTimedLines = 500000;
+constexpr int kTimedPasses = 3;
+
+// One circle: rapid to the start, plunge, chords, retract.
+void writeCircle(std::FILE *f, double cx, double cy)
+{
+    std::fprintf(f, "G0 X%.4f Y%.4f Z2\nG1 Z-1 F300\nF1800\n", cx + kRadius, cy);
+    for (int k = 1; k <= kChords; ++k) {
+        const double a = 2 * M_PI * k / kChords;
+        std::fprintf(f, "X%.4f Y%.4f\n", cx + kRadius * std::cos(a), cy + kRadius * std::sin(a));
+    }
+    std::fprintf(f, "G0 Z2\n");
+}
+
+constexpr int kLinesPerCircle = kChords + 4;
+
+bool writeProgram(const std::string &path, long circles)
+{
+    std::FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    std::fprintf(f, "G21 G90\n");
+    for (long c = 0; c < circles; ++c)
+        writeCircle(f, 0.0, 0.0);
+    return std::fclose(f) == 0;
+}
+
+CycleTimeReport estimate(const std::string &path, double &seconds, long long &lines)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    GCodeReader reader;
+    reader.open(path);
+    CycleTimeEstimator estimator;
+    std::vector<MotionSegment> batch;
+    while (reader.nextBatch(batch, CycleTimeEstimator::kBatchMoves))
+        estimator.add(batch);
+    CycleTimeReport r = estimator.finish();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    lines = reader.linesRead();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    long long targetLines = 10000000;
+    bool keep = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--lines") && i + 1 < argc)
+            targetLines = std::atoll(argv[++i]);
+        else if (!std::strcmp(argv[i], "--keep"))
+            keep = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--lines N] [--keep]\n", argv[0]);
+            return 2;
+        }
+    }
+    const long circles = std::max(1LL, targetLines / kLinesPerCircle);
+
+    const std::string path = "cycletime_bench.nc", refPath = "cycletime_ref.nc";
+    if (!writeProgram(refPath, 1) || !writeProgram(path, circles)) {
+        std::fprintf(stderr, "cannot write the benchmark program\n");
+        return 1;
+    }
+
+    double oneSeconds = 0.0, seconds = 0.0;
+    long long oneLines = 0, lines = 0;
+    const CycleTimeReport one = estimate(refPath, oneSeconds, oneLines);
+    writeProgram(refPath, 2);
+    const CycleTimeReport two = estimate(refPath, oneSeconds, oneLines);
+    // The best of a few passes: the first also pays for faulting in the
+    // buffers, and any one pass can lose its core to the host.
+    CycleTimeReport all;
+    for (int pass = 0; pass < kTimedPasses; ++pass) {
+        double passSeconds = 0.0;
+        all = estimate(path, passSeconds, lines);
+        seconds = pass ? std::min(seconds, passSeconds) : passSeconds;
+    }
+    const double perCircle = two.totalSeconds - one.totalSeconds;
+    const double expected = one.totalSeconds + perCircle * (circles - 1);
+    const double relError = std::fabs(all.totalSeconds - expected) / expected;
+
+    std::printf("program:      %lld lines, %zu moves\n", lines, all.segments);
+    std::printf("cycle time:   %.3f s (feed %.3f, rapid %.3f)\n", all.totalSeconds, all.feedSeconds,
+                all.rapidSeconds);
+    std::printf("reference:    %.3f s  (%ld circles of %.6f s), rel. error %.2e\n", expected, circles,
+                perCircle, relError);
+    std::printf("peak v:       X %.2f  Y %.2f  Z %.2f mm/s\n", all.peakVelocity[AxisX], all.peakVelocity[AxisY],
+                all.peakVelocity[AxisZ]);
+    std::printf("estimated in: %.3f s  (%.1f M lines/s)\n", seconds, lines / seconds / 1e6);
+
+    if (!keep) {
+        std::remove(path.c_str());
+        std::remove(refPath.c_str());
+    }
+    if (relError > 1e-6) {
+        std::fprintf(stderr, "FAIL: streamed estimate does not match the per-circle reference\n");
+        return 1;
+    }
+    if (lines >= kMinTimedLines) {
+        const double rate = lines / seconds;
+        if (rate < kMinLinesPerSecond) {
+            std::fprintf(stderr, "FAIL: %.1f M lines/s, below the %.0f M lines/s floor\n", rate / 1e6,
+                         kMinLinesPerSecond / 1e6);
+            return 1;
+        }
+        std::printf("target:       %.0f M lines/s %s\n", kTargetLinesPerSecond / 1e6,
+                    rate >= kTargetLinesPerSecond ? "met" : "not met on this host");
+    }
+    std::printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,249 @@
+// Kinematics benchmark: cost of joint-space conversion relative to planning.
+//
+//   bench_kinematics [--moves N]
+//
+// For each machine a synthetic job (gantry contours, a hot-wire wing panel,
+// a helix wrapped on a rotary part) is planned by CycleTimeEstimator twice:
+// on the raw moves and through KinematicsStream. The difference is the
+// kinematics overhead, split moves included, and must stay within 5% of
+// the planning time; runs below a million moves are too short to time and
+// skip that check. Also checks forward(inverse(p)) == p on random points,
+// that the displacements the planner uses match the joint segments and
+// that split rotary moves stay within the chord tolerance of the program
+// line. Exits non-zero on a failed check.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "cycletime.h"
+#include "kinematics.h"
+
+namespace {
+
+constexpr std::size_t kBatch = 65536;
+constexpr double kTolerance = 0.01;
+constexpr double kOverheadBudget = 5.0; // percent of the planning time
+constexpr std::size_t kMinTimedMoves = 1000000;
+constexpr int kTimedPasses = 5;
+
+void addMove(std::vector<MotionSegment> &moves, AxisPoint &pos, const AxisPoint &to, double feed)
+{
+    MotionSegment s;
+    s.start = pos;
+    s.end = to;
+    s.feed = feed;
+    s.line = static_cast<std::int64_t>(moves.size()) + 1;
+    moves.push_back(s);
+    pos = to;
+}
+
+std::vector<MotionSegment> gantryJob(std::size_t count)
+{
+    std::vector<MotionSegment> moves;
+    AxisPoint pos{};
+    for (std::size_t k = 0; moves.size() < count; ++k) {
+        AxisPoint p = pos;
+        const double a = 2 * M_PI * (k % 1000) / 1000.0;
+        p[AxisX] = 50 + 20 * std::cos(a) + (k / 1000) % 5;
+        p[AxisY] = 50 + 20 * std::sin(a);
+        addMove(moves, pos, p, 1800);
+    }
+    return moves;
+}
+
+// NACA 00xx thickness at chord fraction x.
+double naca(double x, double thickness)
+{
+    return 5 * thickness
+        * (0.2969 * std::sqrt(x) - 0.1260 * x - 0.3516 * x * x + 0.2843 * x * x * x - 0.1015 * x * x * x * x);
+}
+
+std::vector<MotionSegment> hotWireJob(std::size_t count)
+{
+    // Tapered wing panel: 250 mm root chord, 150 mm tip chord, swept tip.
+    std::vector<MotionSegment> moves;
+    AxisPoint pos{};
+    for (std::size_t k = 0; moves.size() < count; ++k) {
+        const double t = (k % 2000) / 1000.0; // 0..2: upper surface then lower
+        const double x = t < 1 ? 1 - t : t - 1;
+        const double side = t < 1 ? 1 : -1;
+        AxisPoint p = pos;
+        p[AxisX] = 20 + 250 * x;
+        p[AxisY] = 40 + side * 250 * naca(x, 0.12);
+        p[AxisU] = 60 + 150 * x;
+        p[AxisV] = 40 + side * 150 * naca(x, 0.10);
+        addMove(moves, pos, p, 300);
+    }
+    return moves;
+}
+
+std::vector<MotionSegment> rotaryJob(std::size_t count)
+{
+    // Helix engraved on a 25 mm radius part, with a long cross move every
+    // 500 moves that needs splitting.
+    std::vector<MotionSegment> moves;
+    AxisPoint pos{};
+    pos[AxisZ] = 25;
+    for (std::size_t k = 0; moves.size() < count; ++k) {
+        AxisPoint p = pos;
+        const double a = k * 0.02;
+        const double r = k % 500 == 499 ? 30.0 : 24.5;
+        p[AxisX] = std::fmod(k * 0.01, 100.0);
+        p[AxisY] = r * std::sin(a + (k % 500 == 499 ? 1.5 : 0.0));
+        p[AxisZ] = r * std::cos(a + (k % 500 == 499 ? 1.5 : 0.0));
+        addMove(moves, pos, p, 900);
+    }
+    return moves;
+}
+
+double planSeconds(const std::vector<MotionSegment> &moves, const Kinematics *kin, std::size_t &planned)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    CycleTimeEstimator estimator(MachineLimits::leadScrewGantry(), kin);
+    std::vector<MotionSegment> batch;
+    for (std::size_t first = 0; first < moves.size(); first += kBatch) {
+        batch.assign(moves.begin() + first, moves.begin() + std::min(moves.size(), first + kBatch));
+        estimator.add(batch);
+    }
+    planned = estimator.finish().segments;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool roundTrip(const Kinematics &kin, std::mt19937_64 &rng)
+{
+    std::uniform_real_distribution<double> coord(-100.0, 100.0);
+    PointBatch program, joints, back;
+    program.resize(4096);
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        for (int a = 0; a < kAxisCount; ++a)
+            program.axis[a][i] = a == AxisA ? 0.0 : coord(rng); // rotary part frame has A = 0
+    }
+    kin.inverse(program, joints);
+    kin.forward(joints, back);
+    double worst = 0.0;
+    for (int a = 0; a < kAxisCount; ++a) {
+        for (std::size_t i = 0; i < program.size(); ++i)
+            worst = std::max(worst, std::fabs(back.axis[a][i] - program.axis[a][i]));
+    }
+    std::printf("  round trip:   max error %.2e mm\n", worst);
+    return worst < 1e-9;
+}
+
+// Largest distance from a split rotary move's joint-chord midpoints,
+// mapped back to the part, to the program line.
+double chordError(const Kinematics &kin, const std::vector<MotionSegment> &program)
+{
+    KinematicsStream stream(kin, kTolerance);
+    std::vector<MotionSegment> batch(program.begin(), program.begin() + std::min<std::size_t>(program.size(), 20000));
+    const std::vector<MotionSegment> &joints = stream.apply(batch);
+    PointBatch mid, back;
+    mid.resize(joints.size());
+    for (std::size_t i = 0; i < joints.size(); ++i) {
+        AxisPoint m;
+        for (int a = 0; a < kAxisCount; ++a)
+            m[a] = 0.5 * (joints[i].start[a] + joints[i].end[a]);
+        mid.set(i, m);
+    }
+    kin.forward(mid, back);
+    double worst = 0.0;
+    for (std::size_t i = 0; i < joints.size(); ++i) {
+        const MotionSegment &s = batch[joints[i].line - 1];
+        double d[3], q[3], dd = 0.0, dq = 0.0;
+        for (int a = 0; a < 3; ++a) {
+            d[a] = s.end[a] - s.start[a];
+            q[a] = back.axis[a][i] - s.start[a];
+            dd += d[a] * d[a];
+            dq += d[a] * q[a];
+        }
+        const double t = dd > 0 ? std::clamp(dq / dd, 0.0, 1.0) : 0.0;
+        double e = 0.0;
+        for (int a = 0; a < 3; ++a)
+            e += (q[a] - t * d[a]) * (q[a] - t * d[a]);
+        worst = std::max(worst, std::sqrt(e));
+    }
+    return worst;
+}
+
+// Largest difference between the displacements the planner gets from
+// applyDeltas() and the segments apply() makes of the same moves.
+double deltaMismatch(const Kinematics &kin, const std::vector<MotionSegment> &program)
+{
+    KinematicsStream segments(kin, kTolerance), displacements(kin, kTolerance);
+    std::vector<MotionSegment> batch(program.begin(), program.begin() + std::min<std::size_t>(program.size(), 20000));
+    const std::vector<MotionSegment> &joints = segments.apply(batch);
+    const PointBatch &deltas = displacements.applyDeltas(batch.data(), batch.size());
+    if (deltas.size() != joints.size())
+        return 1e300;
+    double worst = 0.0;
+    for (std::size_t i = 0; i < joints.size(); ++i) {
+        for (int a = 0; a < kAxisCount; ++a)
+            worst = std::max(worst, std::fabs(deltas.axis[a][i] - (joints[i].end[a] - joints[i].start[a])));
+        worst = std::max(worst, std::fabs(double(batch[displacements.sources()[i]].line - joints[i].line)));
+    }
+    return worst;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t count = 4000000;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--moves") && i + 1 < argc)
+            count = static_cast<std::size_t>(std::atol(argv[++i]));
+        else {
+            std::fprintf(stderr, "usage: %s [--moves N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct Machine
+    {
+        std::unique_ptr<Kinematics> kin;
+        std::vector<MotionSegment> (*job)(std::size_t);
+    } machines[] = {
+        {makeKinematics("cartesian"), gantryJob},
+        {makeKinematics("hotwire"), hotWireJob},
+        {makeKinematics("rotary"), rotaryJob},
+    };
+
+    int failures = 0;
+    std::mt19937_64 rng(11);
+    for (Machine &m : machines) {
+        const std::vector<MotionSegment> moves = m.job(count);
+        std::size_t rawSegments = 0, jointSegments = 0;
+        double raw = 1e300, withKin = 1e300;
+        for (int rep = 0; rep < kTimedPasses; ++rep) {
+            raw = std::min(raw, planSeconds(moves, nullptr, rawSegments));
+            withKin = std::min(withKin, planSeconds(moves, m.kin.get(), jointSegments));
+        }
+        std::printf("%s:\n", m.kin->name());
+        std::printf("  plan:         %.3f s  (%.1f M moves/s)\n", raw, moves.size() / raw / 1e6);
+        const double overhead = 100.0 * (withKin - raw) / raw;
+        std::printf("  kin + plan:   %.3f s  (%zu joint moves, overhead %+.1f%%)\n", withKin, jointSegments,
+                    overhead);
+        if (count >= kMinTimedMoves) {
+            std::printf("  budget:       %+.0f%%, %s\n", kOverheadBudget,
+                        overhead <= kOverheadBudget ? "met" : "exceeded");
+            failures += overhead > kOverheadBudget;
+        }
+        if (!roundTrip(*m.kin, rng))
+            ++failures;
+        const double mismatch = deltaMismatch(*m.kin, moves);
+        std::printf("  deltas:       max difference from segments %.2e mm\n", mismatch);
+        failures += mismatch != 0.0;
+        if (!m.kin->linear()) {
+            const double err = chordError(*m.kin, moves);
+            std::printf("  chord error:  %.4f mm (tolerance %.4f)\n", err, kTolerance);
+            failures += err > kTolerance;
+        }
+    }
+    if (failures)
+        std::fprintf(stderr, "FAIL: %d kinematics check(s)\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+// Material-removal simulation benchmark on a synthetic 3D job.
+//
+//   bench_materialremoval [--cell C] [--max-threads W]
+//
+// Job: flat-end roughing levels plus a ball-end raster finish over a dome,
+// about 0.5 M short moves as CAM output for a 3D surface. The serial run is
+// the reference; every threaded run must reproduce its surface and per-move
+// volumes exactly. Exits non-zero on a mismatch.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "materialremoval.h"
+#include "workstealingpool.h"
+
+namespace {
+
+constexpr double kSize = 100.0;
+
+double domeZ(double x, double y)
+{
+    const double dx = x - kSize / 2, dy = y - kSize / 2;
+    return -20.0 + 18.0 * std::exp(-(dx * dx + dy * dy) / 900.0);
+}
+
+void addMove(std::vector<MotionSegment> &out, AxisPoint &pos, double x, double y, double z, bool rapid)
+{
+    MotionSegment s;
+    s.start = pos;
+    pos[AxisX] = x;
+    pos[AxisY] = y;
+    pos[AxisZ] = z;
+    s.end = pos;
+    s.rapid = rapid;
+    s.feed = rapid ? 0.0 : 1500.0;
+    s.line = static_cast<std::int64_t>(out.size()) + 1;
+    out.push_back(s);
+}
+
+std::vector<MotionSegment> roughing()
+{
+    std::vector<MotionSegment> moves;
+    AxisPoint pos{};
+    pos[AxisZ] = 5.0;
+    for (double z = -2.0; z >= -18.0; z -= 2.0) {
+        for (double y = 0; y <= kSize; y += 4.0) {
+            addMove(moves, pos, 0, y, 5.0, true);
+            addMove(moves, pos, 0, y, z, false);
+            for (double x = 0; x <= kSize; x += 1.0)
+                addMove(moves, pos, x, y, std::max(z, domeZ(x, y) + 1.0), false);
+            addMove(moves, pos, kSize, y, 5.0, true);
+        }
+    }
+    return moves;
+}
+
+std::vector<MotionSegment> finishing()
+{
+    std::vector<MotionSegment> moves;
+    AxisPoint pos{};
+    pos[AxisZ] = 5.0;
+    bool forward = true;
+    for (double y = 0; y <= kSize; y += 0.5) {
+        addMove(moves, pos, forward ? 0 : kSize, y, 5.0, true);
+        for (int k = 0; k <= 500; ++k) {
+            const double x = forward ? k * 0.2 : kSize - k * 0.2;
+            addMove(moves, pos, x, y, domeZ(x, y), false);
+        }
+        addMove(moves, pos, pos[AxisX], y, 5.0, true);
+        forward = !forward;
+    }
+    return moves;
+}
+
+struct Run
+{
+    double seconds = 0.0;
+    double volume = 0.0;
+    std::vector<double> volumes;
+    std::vector<float> surface;
+};
+
+Run simulate(const std::vector<MotionSegment> &rough, const std::vector<MotionSegment> &finish,
+             double cell, int threads)
+{
+    HeightMap stock(0, 0, kSize, kSize, cell, 0.0f, -25.0f);
+    WorkStealingPool pool(threads);
+    Run r;
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        CutterTool flat{CutterTool::FlatEnd, 6.0};
+        MaterialRemovalSim sim(stock, flat, threads > 1 ? &pool : nullptr);
+        sim.run(rough, r.volumes);
+        r.volume += sim.totalVolume();
+    }
+    {
+        CutterTool ball{CutterTool::BallEnd, 3.0};
+        MaterialRemovalSim sim(stock, ball, threads > 1 ? &pool : nullptr);
+        sim.run(finish, r.volumes);
+        r.volume += sim.totalVolume();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    for (int iy = 0; iy < stock.cellsY(); ++iy)
+        for (int ix = 0; ix < stock.cellsX(); ++ix)
+            r.surface.push_back(stock.height(ix, iy));
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    double cell = 0.1;
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--cell") && i + 1 < argc)
+            cell = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--max-threads") && i + 1 < argc)
+            maxThreads = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--cell C] [--max-threads W]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::vector<MotionSegment> rough = roughing();
+    const std::vector<MotionSegment> finish = finishing();
+    const double moves = double(rough.size() + finish.size());
+
+    // Finishing moves at 1500 mm/min: the job's machine time.
+    double machineMinutes = 0.0;
+    for (const MotionSegment &s : finish)
+        machineMinutes += std::hypot(s.end[AxisX] - s.start[AxisX], s.end[AxisY] - s.start[AxisY]) / 1500.0;
+    for (const MotionSegment &s : rough)
+        machineMinutes += std::hypot(s.end[AxisX] - s.start[AxisX], s.end[AxisY] - s.start[AxisY]) / 1500.0;
+
+    std::printf("job: %zu roughing + %zu finishing moves (~%.0f min of cutting), cell %.3f mm\n",
+                rough.size(), finish.size(), machineMinutes, cell);
+    std::printf("%8s %10s %14s %16s\n", "threads", "seconds", "Mmoves/s", "removed mm^3");
+
+    Run reference;
+    bool ok = true;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        Run r = simulate(rough, finish, cell, threads);
+        if (threads == 1)
+            reference = r;
+        else
+            ok = ok && r.volumes == reference.volumes && r.surface == reference.surface;
+        std::printf("%8d %10.3f %14.3f %16.1f\n", threads, r.seconds, moves / r.seconds / 1e6, r.volume);
+        if (threads < maxThreads && threads * 2 > maxThreads)
+            threads = maxThreads / 2;
+    }
+    std::printf("threaded runs %s the serial surface and per-move volumes\n", ok ? "match" : "DIFFER FROM");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+// Compression and accuracy of the G1 -> spline smoothing stage.
+//
+//   bench_pathsmoothing [--moves N] [--tol MM] [--gcode FILE]
+//
+// Generates the finishing pass of a 3D surface as surface CAM writes it:
+// serpentine rows of 0.05 mm G1 chords, coordinates printed to 1 um, with
+// a stepover at each row end and a retract and feed change every 40 rows
+// (or reads FILE). The moves are streamed through PathSmoother at 0.5, 1
+// and 2 times the tolerance and the output is checked against the input
+// independently of the fitter: every input vertex against the sampled
+// curve and every curve sample against the input polyline. Reports the
+// segment reduction, the largest deviation and how many times faster than
+// the machine (which runs 0.05 mm chords at 2000 mm/min) input is
+// smoothed. Then plans the pass with CycleTimeEstimator as lines and as
+// curves, and plans circles of 2 mm radius as Bezier quarters to check the
+// curvature limit: the time must come out between the bounds v = sqrt(a r)
+// gives for the axis and the diagonal path acceleration. Fails unless, at
+// the given tolerance, the deviation is within tolerance, the reduction is
+// at least 10x and the circle time is within those bounds.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cycletime.h"
+#include "gcodeparser.h"
+#include "pathsmoothing.h"
+
+namespace {
+
+constexpr double kChord = 0.05;   // mm
+constexpr double kRowLength = 100.0;
+constexpr double kStepover = 0.25;
+constexpr double kMachineFeed = 2000.0; // mm/min
+
+double roundUm(double v)
+{
+    return std::round(v * 1000.0) / 1000.0;
+}
+
+double surface(double x, double y)
+{
+    return 3.0 * std::sin(x / 11.0) * std::cos(y / 7.0) + 0.4 * std::sin(x / 1.7 + y / 3.0);
+}
+
+std::vector<MotionSegment> surfacePass(long moves)
+{
+    std::vector<MotionSegment> out;
+    out.reserve(moves);
+    const int chords = static_cast<int>(kRowLength / kChord);
+    AxisPoint pos{};
+    auto moveTo = [&](double x, double y, double z, double feed, bool rapid) {
+        MotionSegment m;
+        m.start = pos;
+        pos[AxisX] = roundUm(x);
+        pos[AxisY] = roundUm(y);
+        pos[AxisZ] = roundUm(z);
+        m.end = pos;
+        m.feed = feed;
+        m.rapid = rapid;
+        m.line = static_cast<std::int64_t>(out.size()) + 1;
+        out.push_back(m);
+    };
+    for (int row = 0; static_cast<long>(out.size()) < moves; ++row) {
+        const double y = row * kStepover;
+        const double feed = row / 40 % 2 ? 1500.0 : 2000.0;
+        const bool forward = row % 2 == 0;
+        if (row % 40 == 0) {
+            moveTo(pos[AxisX], pos[AxisY], 10.0, 0.0, true);
+            moveTo(forward ? 0.0 : kRowLength, y, 10.0, 0.0, true);
+            moveTo(pos[AxisX], y, surface(pos[AxisX], y), 300.0, false);
+        } else {
+            moveTo(pos[AxisX], y, surface(pos[AxisX], y), feed, false); // stepover
+        }
+        for (int c = 1; c <= chords && static_cast<long>(out.size()) < moves; ++c) {
+            const double x = forward ? c * kChord : kRowLength - c * kChord;
+            moveTo(x, y, surface(x, y), feed, false);
+        }
+    }
+    return out;
+}
+
+double distance(const AxisPoint &a, const AxisPoint &b)
+{
+    double d2 = 0.0;
+    for (int k = 0; k < kAxisCount; ++k)
+        d2 += (a[k] - b[k]) * (a[k] - b[k]);
+    return std::sqrt(d2);
+}
+
+double segmentDistance(const AxisPoint &p, const AxisPoint &a, const AxisPoint &b)
+{
+    double len2 = 0.0, along = 0.0;
+    for (int k = 0; k < kAxisCount; ++k) {
+        len2 += (b[k] - a[k]) * (b[k] - a[k]);
+        along += (p[k] - a[k]) * (b[k] - a[k]);
+    }
+    const double t = len2 > 0.0 ? std::clamp(along / len2, 0.0, 1.0) : 0.0;
+    AxisPoint q;
+    for (int k = 0; k < kAxisCount; ++k)
+        q[k] = a[k] + (b[k] - a[k]) * t;
+    return distance(p, q);
+}
+
+// Largest distance between each output segment and the input moves it
+// replaces, both ways, from dense samples of the curve. Each point is
+// compared with the stretch of the other path around the same fraction of
+// arc length. Returns -1 if the output does not account for every move.
+double maxDeviation(const std::vector<MotionSegment> &in, const std::vector<SmoothSegment> &out)
+{
+    double worst = 0.0;
+    std::size_t next = 0;
+    std::vector<AxisPoint> vertices, samples;
+    std::vector<double> arc;
+    for (const SmoothSegment &s : out) {
+        if (next + s.sources > in.size())
+            return -1.0;
+        vertices.assign(1, in[next].start);
+        for (int k = 0; k < s.sources; ++k)
+            vertices.push_back(in[next + k].end);
+        next += s.sources;
+        if (distance(vertices.front(), s.start) > 1e-9 || distance(vertices.back(), s.end) > 1e-9)
+            return -1.0;
+        if (!s.curve)
+            continue;
+
+        const std::size_t n = vertices.size() - 1;
+        arc.assign(1, 0.0);
+        for (std::size_t i = 1; i <= n; ++i)
+            arc.push_back(arc.back() + distance(vertices[i - 1], vertices[i]));
+        const std::size_t perMove = 8;
+        const std::size_t count = perMove * n + 1;
+        samples.resize(count);
+        for (std::size_t j = 0; j < count; ++j)
+            samples[j] = s.at(static_cast<double>(j) / (count - 1));
+
+        for (std::size_t i = 0; i <= n; ++i) {
+            const std::size_t centre = static_cast<std::size_t>(arc[i] / arc[n] * (count - 1));
+            const std::size_t lo = centre > 2 * perMove ? centre - 2 * perMove : 0;
+            const std::size_t hi = std::min(count - 1, centre + 2 * perMove);
+            double best = 1e300;
+            for (std::size_t j = lo; j < hi; ++j)
+                best = std::min(best, segmentDistance(vertices[i], samples[j], samples[j + 1]));
+            worst = std::max(worst, best);
+        }
+        std::size_t i = 0;
+        for (std::size_t j = 0; j < count; ++j) {
+            const double at = static_cast<double>(j) / (count - 1) * arc[n];
+            while (i + 1 < n && arc[i + 1] < at)
+                ++i;
+            const std::size_t lo = i > 4 ? i - 4 : 0;
+            const std::size_t hi = std::min(n, i + 5);
+            double best = 1e300;
+            for (std::size_t k = lo; k < hi; ++k)
+                best = std::min(best, segmentDistance(samples[j], vertices[k], vertices[k + 1]));
+            worst = std::max(worst, best);
+        }
+    }
+    return next == in.size() ? worst : -1.0;
+}
+
+// Planned time of turns full circles of radius r at a feed the curvature
+// limit keeps it well below.
+double circleSeconds(const MachineLimits &limits, double r, int turns)
+{
+    const double k = 0.5522847498307936 * r; // Bezier quarter circle
+    std::vector<SmoothSegment> curves;
+    for (int q = 0; q < 4 * turns; ++q) {
+        const double a0 = q * M_PI / 2, a1 = a0 + M_PI / 2;
+        SmoothSegment s;
+        s.start[AxisX] = r * std::cos(a0);
+        s.start[AxisY] = r * std::sin(a0);
+        s.end[AxisX] = r * std::cos(a1);
+        s.end[AxisY] = r * std::sin(a1);
+        s.control1 = s.start;
+        s.control1[AxisX] -= k * std::sin(a0);
+        s.control1[AxisY] += k * std::cos(a0);
+        s.control2 = s.end;
+        s.control2[AxisX] += k * std::sin(a1);
+        s.control2[AxisY] -= k * std::cos(a1);
+        s.feed = 6000.0;
+        s.curve = true;
+        s.line = q + 1;
+        curves.push_back(s);
+    }
+    CycleTimeEstimator estimator(limits);
+    estimator.add(curves);
+    return estimator.finish().totalSeconds;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    long moves = 1000000;
+    double tolerance = 0.01;
+    std::string gcode;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--moves") && i + 1 < argc)
+            moves = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--tol") && i + 1 < argc)
+            tolerance = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--gcode") && i + 1 < argc)
+            gcode = argv[++i];
+        else {
+            std::fprintf(stderr, "usage: %s [--moves N] [--tol MM] [--gcode FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (moves < 1000 || tolerance <= 0.0) {
+        std::fprintf(stderr, "need at least 1000 moves and a positive tolerance\n");
+        return 2;
+    }
+
+    std::vector<MotionSegment> input;
+    if (gcode.empty()) {
+        input = surfacePass(moves);
+        std::printf("surface finishing pass: %zu moves of %.2f mm\n", input.size(), kChord);
+    } else {
+        GCodeReader reader;
+        std::vector<MotionSegment> batch;
+        if (!reader.open(gcode)) {
+            std::fprintf(stderr, "%s\n", reader.error().c_str());
+            return 1;
+        }
+        while (reader.nextBatch(batch))
+            input.insert(input.end(), batch.begin(), batch.end());
+        if (!reader.error().empty()) {
+            std::fprintf(stderr, "%s\n", reader.error().c_str());
+            return 1;
+        }
+        std::printf("%s: %zu moves\n", gcode.c_str(), input.size());
+    }
+    const double machineRate = kMachineFeed / 60.0 / kChord; // moves/s
+
+    bool ok = true;
+    std::vector<SmoothSegment> smoothed, scratch;
+    std::printf("%-10s %10s %10s %12s %14s %14s\n", "tol mm", "out", "reduction", "max dev mm", "Mmoves/s",
+                "x machine");
+    for (double scale : {0.5, 1.0, 2.0}) {
+        SmoothingOptions options;
+        options.tolerance = tolerance * scale;
+        std::vector<SmoothSegment> &output = scale == 1.0 ? smoothed : scratch;
+        output.reserve(input.size() / 4);
+        std::vector<MotionSegment> batch;
+        double best = 1e300;
+        for (int rep = 0; rep < 3; ++rep) {
+            output.clear();
+            PathSmoother smoother(options);
+            auto t0 = std::chrono::steady_clock::now();
+            for (std::size_t b = 0; b < input.size(); b += 65536) {
+                batch.assign(input.begin() + b, input.begin() + std::min(input.size(), b + 65536));
+                smoother.add(batch, output);
+            }
+            smoother.finish(output);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        }
+        const double deviation = maxDeviation(input, output);
+        const double reduction = static_cast<double>(input.size()) / output.size();
+        const double rate = input.size() / best;
+        std::printf("%-10.4f %10zu %9.1fx %12.5f %14.2f %14.0f\n", options.tolerance, output.size(), reduction,
+                    deviation, rate / 1e6, rate / machineRate);
+        // Sampling the curve between the fitter's check points may find a
+        // little more than it did.
+        const bool within = deviation >= 0.0 && deviation <= options.tolerance * 1.05;
+        ok = ok && within && (scale != 1.0 || !gcode.empty() || reduction >= 10.0);
+    }
+
+    const MachineLimits limits = MachineLimits::leadScrewGantry();
+    CycleTimeEstimator asLines(limits), asCurves(limits);
+    asLines.add(input);
+    asCurves.add(smoothed);
+    const CycleTimeReport lines = asLines.finish(), curves = asCurves.finish();
+    std::printf("cycle time:  %.1f s as %zu lines, %.1f s as curves (%zu chords)\n", lines.totalSeconds,
+                lines.segments, curves.totalSeconds, curves.segments);
+
+    // Between the X/Y axis acceleration and the diagonal one, sqrt(2) more.
+    const double r = 2.0;
+    const int turns = 100;
+    const double circle = circleSeconds(limits, r, turns);
+    const double accel = limits.maxAccel[AxisX];
+    const double slowest = turns * 2 * M_PI * r / std::sqrt(accel * r);
+    const double fastest = turns * 2 * M_PI * r / std::sqrt(std::sqrt(2.0) * accel * r);
+    const bool circleOk = circle >= 0.98 * fastest && circle <= 1.02 * slowest;
+    std::printf("circles:     %.2f s for %d turns of r %.0f mm, sqrt(a r) gives %.2f..%.2f s\n", circle, turns, r,
+                fastest, slowest);
+    ok = ok && circleOk;
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+// Raster engraving of a generated grayscale image.
+//
+//   bench_rasterengrave [--size N] [--threads T]
+//
+// Streams an N x N image (default 20000, 400 MB of pixels never held at
+// once) through the engraver as laser G-code: a smooth photo-like field
+// with blank margins and a blank stripe down the middle. Reports the
+// throughput and output size, and checks that:
+//
+// 1. peak memory stays within a small multiple of the band window (two
+//    bands of rows per worker), whatever the image height, and blank rows
+//    emit nothing
+// 2. the output does not depend on the thread count
+// 3. bidirectional scanning travels less than unidirectional
+// 4. on a small image, rasterizing the output back (laser power from the
+//    G-code, spindle depth from the segments) gives exactly the quantized
+//    levels of every pixel
+// 5. ordered and Floyd-Steinberg dithering keep the image's mean darkness
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rasterengrave.h"
+#include "workstealingpool.h"
+
+namespace {
+
+// Photo-like field: 128 + 110 sin(x) cos(y) inside the margins, white
+// outside them and in a stripe down the middle.
+class GeneratedImage : public RasterSource
+{
+public:
+    explicit GeneratedImage(int size) : n(size), column(size)
+    {
+        for (int x = 0; x < n; ++x) {
+            const bool blank = x < n / 12 || x >= n - n / 12 || std::abs(x - n / 2) < n / 16;
+            column[x] = blank ? 0.0f : static_cast<float>(110.0 * std::sin(x * 80.0 / n));
+        }
+    }
+
+    int width() const override { return n; }
+    int height() const override { return n; }
+
+    int readRows(std::uint8_t *out, int count) override
+    {
+        count = std::min(count, n - row);
+        for (int k = 0; k < count; ++k, ++row, out += n) {
+            if (blankRow(row)) {
+                std::memset(out, 255, n);
+                continue;
+            }
+            const float c = static_cast<float>(std::cos(row * 60.0 / n));
+            for (int x = 0; x < n; ++x)
+                out[x] = column[x] == 0.0f ? 255 : static_cast<std::uint8_t>(128.0f + column[x] * c);
+        }
+        return count;
+    }
+
+    const std::string &error() const override { return err; }
+
+    bool blankRow(int r) const { return r < n / 10 || r >= n - n / 10; }
+
+private:
+    int n;
+    int row = 0;
+    std::vector<float> column;
+    std::string err;
+};
+
+// Small image held in memory, for exact round trips.
+class MemoryImage : public RasterSource
+{
+public:
+    MemoryImage(int w, int h, const std::vector<std::uint8_t> &pixels) : w(w), h(h), pixels(pixels) {}
+
+    int width() const override { return w; }
+    int height() const override { return h; }
+
+    int readRows(std::uint8_t *out, int count) override
+    {
+        count = std::min(count, h - row);
+        std::memcpy(out, pixels.data() + static_cast<std::size_t>(row) * w, static_cast<std::size_t>(count) * w);
+        row += count;
+        return count;
+    }
+
+    const std::string &error() const override { return err; }
+
+private:
+    int w, h;
+    std::vector<std::uint8_t> pixels;
+    int row = 0;
+    std::string err;
+};
+
+std::vector<std::uint8_t> testPattern(int w, int h)
+{
+    std::vector<std::uint8_t> img(static_cast<std::size_t>(w) * h, 255);
+    for (int y = h / 8; y < h - h / 8; ++y)
+        for (int x = 0; x < w; ++x) {
+            if (x % 97 > 80 || (x / 7 + y / 5) % 11 == 0)
+                continue; // blank gaps of both kinds: crossed with G0 and burned through
+            img[static_cast<std::size_t>(y) * w + x] = static_cast<std::uint8_t>((x * 5 + y * 3) % 256);
+        }
+    return img;
+}
+
+// Paints the moves at constant Y and Z back onto a level image; a pixel is
+// covered when its centre lies inside the move.
+void paint(std::vector<int> &levels, int w, int h, double pixel, double y, double x0, double x1, int level)
+{
+    const int r = static_cast<int>(std::lround(h - y / pixel - 0.5));
+    if (r < 0 || r >= h)
+        return;
+    const int c0 = std::max(0, static_cast<int>(std::lround(std::min(x0, x1) / pixel)));
+    const int c1 = std::min(w, static_cast<int>(std::lround(std::max(x0, x1) / pixel)));
+    for (int c = c0; c < c1; ++c)
+        levels[static_cast<std::size_t>(r) * w + c] = level;
+}
+
+// Parses the modal G-code the engraver writes: G0/G1 with X Y S words.
+std::vector<int> rasterizeGCode(const std::string &gcode, int w, int h, const EngraveOptions &o)
+{
+    std::vector<int> levels(static_cast<std::size_t>(w) * h, 0);
+    double x = 0, y = 0, s = 0;
+    int g = 0;
+    for (std::size_t at = 0; at < gcode.size();) {
+        std::size_t end = gcode.find('\n', at);
+        const std::string line = gcode.substr(at, end - at);
+        at = end + 1;
+        double nx = x, ny = y;
+        for (std::size_t k = 0; k < line.size(); ++k) {
+            const char letter = line[k];
+            if (!std::strchr("GXYS", letter))
+                continue;
+            const double v = std::strtod(line.c_str() + k + 1, nullptr);
+            if (letter == 'G')
+                g = static_cast<int>(v);
+            else if (letter == 'X')
+                nx = v;
+            else if (letter == 'Y')
+                ny = v;
+            else
+                s = v;
+        }
+        if (g == 1 && ny == y && s > 0)
+            paint(levels, w, h, o.pixelSize, y, x, nx,
+                  static_cast<int>(std::lround((s - o.minPower) / (o.maxPower - o.minPower) * (o.levels - 1))));
+        x = nx;
+        y = ny;
+    }
+    return levels;
+}
+
+std::vector<int> rasterizeSegments(const std::vector<MotionSegment> &moves, int w, int h, const EngraveOptions &o)
+{
+    std::vector<int> levels(static_cast<std::size_t>(w) * h, 0);
+    for (const MotionSegment &m : moves)
+        if (!m.rapid && m.start[AxisZ] == m.end[AxisZ] && m.end[AxisZ] < 0 && m.start[AxisY] == m.end[AxisY])
+            paint(levels, w, h, o.pixelSize, m.end[AxisY], m.start[AxisX], m.end[AxisX],
+                  static_cast<int>(std::lround(-m.end[AxisZ] / o.maxDepth * (o.levels - 1))));
+    return levels;
+}
+
+struct Output
+{
+    std::string gcode;
+    std::vector<MotionSegment> moves;
+    bool continuous = true;
+};
+
+bool engrave(RasterSource &image, const EngraveOptions &o, EngraveFormat format, WorkStealingPool *pool,
+             Output &out, EngraveReport &report)
+{
+    RasterEngraver engraver(o, format, pool);
+    const bool ok = engraver.run(image, [&](EngraveBand &band) {
+        out.gcode += band.gcode;
+        for (const MotionSegment &m : band.moves) {
+            if (!out.moves.empty() && m.start != out.moves.back().end)
+                out.continuous = false;
+            out.moves.push_back(m);
+        }
+        return true;
+    });
+    if (!ok)
+        std::printf("  engrave failed: %s\n", engraver.error().c_str());
+    report = engraver.report();
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int size = 20000;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--size") && i + 1 < argc)
+            size = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--size N] [--threads T]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (size < 200) {
+        std::fprintf(stderr, "need a size of at least 200\n");
+        return 2;
+    }
+
+    WorkStealingPool pool(threads);
+    bool ok = true;
+
+    // 1. The large image, output counted but not kept.
+    {
+        GeneratedImage image(size);
+        EngraveOptions o;
+        RasterEngraver engraver(o, EngraveFormat::GCode, &pool);
+        std::size_t bytes = 0;
+        const bool ran = engraver.run(image, [&](EngraveBand &band) {
+            bytes += band.gcode.size();
+            return true;
+        });
+        const EngraveReport &r = engraver.report();
+        const double imageBytes = static_cast<double>(size) * size;
+        long blankRows = 0;
+        for (int row = 0; row < size; ++row)
+            blankRows += image.blankRow(row);
+        std::printf("%d x %d px (%.0f MB), %d threads: %.2f s, %.1f Mpx/s\n", size, size, imageBytes / 1e6,
+                    pool.size(), r.seconds, imageBytes / r.seconds / 1e6);
+        std::printf("  %ld rows engraved, %ld blank; %ld G1, %ld G0; %.1f MB G-code\n", r.rowsEngraved, r.rowsBlank,
+                    r.moves, r.rapids, bytes / 1e6);
+        std::printf("  burn %.0f mm, travel %.0f mm, peak memory %.2f MB (%.2f%% of the image)\n", r.burnLength,
+                    r.travel, r.peakBytes / 1e6, 100.0 * r.peakBytes / imageBytes);
+        const double windowBytes = 2.0 * pool.size() * o.bandRows * size;
+        ok = ok && ran && r.rowsBlank == blankRows && r.outputBytes == bytes && r.peakBytes < 16 * windowBytes;
+    }
+
+    // 2-3. A mid-size image: thread count and scan direction.
+    {
+        const int n = std::min(size, 2000);
+        EngraveOptions o;
+        Output serial, parallel, uni;
+        EngraveReport rs, rp, ru;
+        GeneratedImage a(n), b(n), c(n);
+        ok = engrave(a, o, EngraveFormat::GCode, nullptr, serial, rs) && ok;
+        ok = engrave(b, o, EngraveFormat::GCode, &pool, parallel, rp) && ok;
+        o.bidirectional = false;
+        ok = engrave(c, o, EngraveFormat::GCode, &pool, uni, ru) && ok;
+        const bool same = serial.gcode == parallel.gcode;
+        std::printf("%d x %d px: serial and %d-thread output %s\n", n, n, pool.size(),
+                    same ? "identical" : "DIFFER");
+        std::printf("  travel %.0f mm bidirectional, %.0f mm unidirectional\n", rp.travel, ru.travel);
+        ok = ok && same && rp.travel < 0.6 * ru.travel;
+    }
+
+    // 4. Exact round trips.
+    {
+        const int w = 300, h = 200;
+        const std::vector<std::uint8_t> pixels = testPattern(w, h);
+        EngraveOptions o;
+        o.levels = 16;
+        o.bandRows = 7;
+        std::vector<int> expect(pixels.size());
+        for (std::size_t k = 0; k < pixels.size(); ++k)
+            expect[k] = ((255 - pixels[k]) * (o.levels - 1) + 127) / 255;
+
+        MemoryImage laserImage(w, h, pixels);
+        Output laser;
+        EngraveReport r;
+        ok = engrave(laserImage, o, EngraveFormat::GCode, &pool, laser, r) && ok;
+        const bool laserExact = rasterizeGCode(laser.gcode, w, h, o) == expect;
+
+        o.spindle = true;
+        MemoryImage spindleImage(w, h, pixels);
+        Output spindle;
+        ok = engrave(spindleImage, o, EngraveFormat::Segments, &pool, spindle, r) && ok;
+        const bool spindleExact = rasterizeSegments(spindle.moves, w, h, o) == expect;
+
+        o.spindle = false;
+        MemoryImage refused(w, h, pixels);
+        Output none;
+        RasterEngraver laserSegments(o, EngraveFormat::Segments);
+        const bool refusedOk = !laserSegments.run(refused, [](EngraveBand &) { return true; });
+
+        std::printf("%d x %d px round trip: laser G-code %s, spindle segments %s (%s), laser segments %s\n", w, h,
+                    laserExact ? "exact" : "WRONG", spindleExact ? "exact" : "WRONG",
+                    spindle.continuous ? "continuous" : "NOT continuous", refusedOk ? "refused" : "NOT refused");
+        ok = ok && laserExact && spindleExact && spindle.continuous && refusedOk;
+    }
+
+    // 5. Dithering keeps the mean darkness.
+    {
+        const int n = 400;
+        std::vector<std::uint8_t> pixels(static_cast<std::size_t>(n) * n);
+        double darkness = 0.0;
+        for (int y = 0; y < n; ++y)
+            for (int x = 0; x < n; ++x) {
+                pixels[static_cast<std::size_t>(y) * n + x] = static_cast<std::uint8_t>(x * 255 / (n - 1));
+                darkness += (255 - x * 255 / (n - 1)) / 255.0;
+            }
+        darkness /= static_cast<double>(n) * n;
+        for (EngraveMode mode : {EngraveMode::Ordered, EngraveMode::FloydSteinberg}) {
+            EngraveOptions o;
+            o.mode = mode;
+            MemoryImage image(n, n, pixels);
+            Output out;
+            EngraveReport r;
+            ok = engrave(image, o, EngraveFormat::GCode, &pool, out, r) && ok;
+            o.levels = 2;
+            double on = 0.0;
+            for (int level : rasterizeGCode(out.gcode, n, n, o))
+                on += level;
+            on /= static_cast<double>(n) * n;
+            std::printf("%s dither: %.4f of pixels burned, image darkness %.4f\n",
+                        mode == EngraveMode::Ordered ? "ordered" : "Floyd-Steinberg", on, darkness);
+            ok = ok && std::fabs(on - darkness) < 0.01;
+        }
+    }
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,506 @@
+#include "binarytoolpath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'N', 'C', 'B', 'T', 'P', '1', '\n'};
+constexpr char kEndMagic[8] = {'C', 'N', 'C', 'B', 'E', 'N', 'D', '\n'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kFlagChecksums = 1;
+
+constexpr std::size_t kHeaderBytes = 24;
+constexpr std::size_t kBlockHeaderBytes = 32 + 8 * kAxisCount;
+constexpr std::size_t kIndexEntryBytes = 24;
+constexpr std::size_t kFooterBytes = 32;
+constexpr std::uint32_t kMaxPayload = 1u << 28;
+
+// Move tag byte: bits 0-5 axes that move, bit 6 rapid, bit 7 a meta byte
+// follows. The meta byte flags the rarer fields that precede the deltas.
+constexpr unsigned kTagRapid = 0x40;
+constexpr unsigned kTagMeta = 0x80;
+constexpr unsigned kMetaJump = 1; // start differs from the previous end (G92)
+constexpr unsigned kMetaFeed = 2;
+constexpr unsigned kMetaLine = 4; // line number does not advance by one
+
+// Longest encoded move: tag, meta, 2 * kAxisCount + 2 ten-byte varints.
+// Decode buffers are zero-padded by this much so the varint reader never
+// needs a bounds check inside a move.
+constexpr std::size_t kMaxMoveBytes = 2 + 10 * (2 * kAxisCount + 2);
+
+void putLE(unsigned char *dst, std::uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        dst[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+std::uint64_t getLE(const unsigned char *src, int bytes)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i)
+        v |= static_cast<std::uint64_t>(src[i]) << (8 * i);
+    return v;
+}
+
+inline std::uint64_t zigzag(std::int64_t v)
+{
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t u)
+{
+    return static_cast<std::int64_t>((u >> 1) ^ (~(u & 1) + 1));
+}
+
+inline unsigned char *putVarint(unsigned char *p, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = static_cast<unsigned char>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<unsigned char>(v);
+    return p;
+}
+
+inline std::uint64_t getVarint(const unsigned char *&p)
+{
+    std::uint64_t b = *p++;
+    if (b < 0x80)
+        return b; // most deltas fit in one byte
+    std::uint64_t v = b & 0x7f;
+    for (int shift = 7; shift < 64; shift += 7) {
+        b = *p++;
+        v |= (b & 0x7f) << shift;
+        if (b < 0x80)
+            break;
+    }
+    return v;
+}
+
+struct CrcTables
+{
+    std::uint32_t t[8][256];
+
+    CrcTables()
+    {
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int i = 0; i < 256; ++i)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+        }
+    }
+};
+
+} // namespace
+
+std::uint32_t crc32(const void *data, std::size_t size, std::uint32_t crc)
+{
+    // Slicing-by-8: eight table lookups per 8 input bytes.
+    static const CrcTables tables;
+    const auto &t = tables.t;
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        const std::uint32_t one = static_cast<std::uint32_t>(getLE(p, 4)) ^ crc;
+        const std::uint32_t two = static_cast<std::uint32_t>(getLE(p + 4, 4));
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24]
+            ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+    }
+    for (; size > 0; --size)
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+bool isBinaryToolpath(const std::string &path)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    char magic[sizeof kMagic];
+    const bool match = std::fread(magic, 1, sizeof magic, f) == sizeof magic
+        && std::memcmp(magic, kMagic, sizeof magic) == 0;
+    std::fclose(f);
+    return match;
+}
+
+// ---------------------------------------------------------------------------
+
+BinaryToolpathWriter::~BinaryToolpathWriter()
+{
+    if (file)
+        std::fclose(file);
+}
+
+bool BinaryToolpathWriter::open(const std::string &path, const BinaryToolpathOptions &options)
+{
+    if (file)
+        std::fclose(file);
+    err.clear();
+    if (options.unitsPerMm == 0 || options.blockMoves == 0) {
+        err = "resolution and block size must be positive";
+        return false;
+    }
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        err = "cannot create " + path;
+        return false;
+    }
+    opts = options;
+    scale = opts.unitsPerMm;
+    std::fill(pos, pos + kAxisCount, 0);
+    feed = line = 0;
+    blockCount = 0;
+    payload.clear();
+    index.clear();
+    moves = bytes = 0;
+
+    unsigned char header[kHeaderBytes];
+    std::memcpy(header, kMagic, sizeof kMagic);
+    putLE(header + 8, kVersion, 4);
+    putLE(header + 12, opts.checksums ? kFlagChecksums : 0, 4);
+    putLE(header + 16, opts.unitsPerMm, 4);
+    putLE(header + 20, opts.blockMoves, 4);
+    return put(header, sizeof header);
+}
+
+bool BinaryToolpathWriter::put(const void *data, std::size_t size)
+{
+    if (std::fwrite(data, 1, size, file) != size) {
+        err = "write failed";
+        return false;
+    }
+    bytes += size;
+    return true;
+}
+
+bool BinaryToolpathWriter::write(const std::vector<MotionSegment> &segments)
+{
+    if (!file || !err.empty())
+        return false;
+
+    unsigned char buf[kMaxMoveBytes];
+    for (const MotionSegment &s : segments) {
+        if (blockCount == 0) {
+            std::copy(pos, pos + kAxisCount, blockPos);
+            blockFeed = feed;
+            blockLine = line;
+        }
+
+        // Quantize absolute positions, then delta them, so rounding never
+        // accumulates along the program.
+        std::int64_t start[kAxisCount], end[kAxisCount];
+        unsigned tag = s.rapid ? kTagRapid : 0, meta = 0;
+        for (int a = 0; a < kAxisCount; ++a) {
+            start[a] = std::llround(s.start[a] * scale);
+            end[a] = std::llround(s.end[a] * scale);
+            meta |= start[a] != pos[a] ? kMetaJump : 0;
+            tag |= end[a] != start[a] ? 1u << a : 0;
+        }
+        const std::int64_t f = std::llround(s.feed * 1000.0);
+        meta |= f != feed ? kMetaFeed : 0;
+        meta |= s.line != line + 1 ? kMetaLine : 0;
+        tag |= meta ? kTagMeta : 0;
+
+        unsigned char *p = buf;
+        *p++ = static_cast<unsigned char>(tag);
+        if (meta) {
+            *p++ = static_cast<unsigned char>(meta);
+            if (meta & kMetaJump) {
+                for (int a = 0; a < kAxisCount; ++a)
+                    p = putVarint(p, zigzag(start[a] - pos[a]));
+            }
+            if (meta & kMetaFeed)
+                p = putVarint(p, zigzag(f - feed));
+            if (meta & kMetaLine)
+                p = putVarint(p, zigzag(s.line - line - 1));
+        }
+        for (int a = 0; a < kAxisCount; ++a) {
+            if (tag & (1u << a))
+                p = putVarint(p, zigzag(end[a] - start[a]));
+        }
+        payload.insert(payload.end(), buf, p);
+
+        std::copy(end, end + kAxisCount, pos);
+        feed = f;
+        line = s.line;
+        ++moves;
+        if (++blockCount == opts.blockMoves && !flushBlock())
+            return false;
+    }
+    return true;
+}
+
+bool BinaryToolpathWriter::flushBlock()
+{
+    if (blockCount == 0)
+        return true;
+    if (payload.size() > kMaxPayload) {
+        err = "block too large; use a smaller block size";
+        return false;
+    }
+    index.push_back({bytes, moves - blockCount, blockLine});
+
+    unsigned char header[kBlockHeaderBytes];
+    putLE(header, payload.size(), 4);
+    putLE(header + 4, blockCount, 4);
+    putLE(header + 8, opts.checksums ? crc32(payload.data(), payload.size()) : 0, 4);
+    putLE(header + 12, 0, 4);
+    putLE(header + 16, static_cast<std::uint64_t>(blockLine), 8);
+    putLE(header + 24, static_cast<std::uint64_t>(blockFeed), 8);
+    for (int a = 0; a < kAxisCount; ++a)
+        putLE(header + 32 + 8 * a, static_cast<std::uint64_t>(blockPos[a]), 8);
+    if (!put(header, sizeof header) || !put(payload.data(), payload.size()))
+        return false;
+    payload.clear();
+    blockCount = 0;
+    return true;
+}
+
+bool BinaryToolpathWriter::close()
+{
+    if (!file)
+        return false;
+    bool ok = err.empty() && flushBlock();
+
+    const std::uint64_t indexOffset = bytes;
+    unsigned char entry[kIndexEntryBytes];
+    for (std::size_t k = 0; ok && k < index.size(); ++k) {
+        putLE(entry, index[k].offset, 8);
+        putLE(entry + 8, index[k].firstMove, 8);
+        putLE(entry + 16, static_cast<std::uint64_t>(index[k].firstLine), 8);
+        ok = put(entry, sizeof entry);
+    }
+    unsigned char footer[kFooterBytes];
+    putLE(footer, indexOffset, 8);
+    putLE(footer + 8, index.size(), 8);
+    putLE(footer + 16, moves, 8);
+    std::memcpy(footer + 24, kEndMagic, sizeof kEndMagic);
+    ok = ok && put(footer, sizeof footer);
+
+    if (std::fclose(file) != 0 && ok) {
+        err = "write failed";
+        ok = false;
+    }
+    file = nullptr;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+
+BinaryToolpathReader::~BinaryToolpathReader()
+{
+    if (file)
+        std::fclose(file);
+}
+
+bool BinaryToolpathReader::open(const std::string &path)
+{
+    if (file)
+        std::fclose(file);
+    err.clear();
+    index.clear();
+    nextBlock = 0;
+    skipMoves = 0;
+    line = 0;
+    totalBytes = 0;
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        err = "cannot open " + path;
+        return false;
+    }
+
+    unsigned char header[kHeaderBytes];
+    unsigned char footer[kFooterBytes];
+    if (std::fread(header, 1, sizeof header, file) != sizeof header
+        || std::memcmp(header, kMagic, sizeof kMagic) != 0) {
+        err = path + ": not a binary toolpath";
+        return false;
+    }
+    if (getLE(header + 8, 4) != kVersion) {
+        err = path + ": unsupported version";
+        return false;
+    }
+    checksums = getLE(header + 12, 4) & kFlagChecksums;
+    units = static_cast<std::uint32_t>(getLE(header + 16, 4));
+    if (units == 0 || std::fseek(file, -static_cast<long>(kFooterBytes), SEEK_END) != 0
+        || std::fread(footer, 1, sizeof footer, file) != sizeof footer
+        || std::memcmp(footer + 24, kEndMagic, sizeof kEndMagic) != 0) {
+        err = path + ": truncated file (missing index)";
+        return false;
+    }
+
+    // The footer is checked against the file size before anything is
+    // allocated from it: the index must sit exactly between the blocks and
+    // the footer, and a file with moves has at least one block.
+    const long endOffset = std::ftell(file);
+    const std::uint64_t fileBytes = endOffset < 0 ? 0 : static_cast<std::uint64_t>(endOffset);
+    const std::uint64_t indexOffset = getLE(footer, 8);
+    const std::uint64_t blocks = getLE(footer + 8, 8);
+    totalMoves = getLE(footer + 16, 8);
+    const bool indexFits = fileBytes >= kHeaderBytes + kFooterBytes && indexOffset >= kHeaderBytes
+                           && indexOffset <= fileBytes - kFooterBytes
+                           && blocks == (fileBytes - kFooterBytes - indexOffset) / kIndexEntryBytes
+                           && indexOffset + blocks * kIndexEntryBytes + kFooterBytes == fileBytes;
+    if (!indexFits || (totalMoves > 0) != (blocks > 0)) {
+        totalMoves = 0;
+        err = path + ": corrupt index";
+        return false;
+    }
+    std::vector<unsigned char> raw(blocks * kIndexEntryBytes);
+    if (std::fseek(file, static_cast<long>(indexOffset), SEEK_SET) != 0
+        || std::fread(raw.data(), 1, raw.size(), file) != raw.size()) {
+        err = path + ": cannot read block index";
+        return false;
+    }
+    // Blocks follow each other from the header to the index, the first one
+    // starts at move 0 and, as no block is empty, first moves increase.
+    index.resize(blocks);
+    for (std::size_t k = 0; k < blocks; ++k) {
+        index[k].offset = getLE(&raw[k * kIndexEntryBytes], 8);
+        index[k].firstMove = getLE(&raw[k * kIndexEntryBytes + 8], 8);
+        const std::uint64_t minOffset = k == 0 ? kHeaderBytes : index[k - 1].offset + kBlockHeaderBytes;
+        const std::uint64_t minMove = k == 0 ? 0 : index[k - 1].firstMove + 1;
+        const bool ordered = index[k].offset >= minOffset && index[k].firstMove >= minMove
+                             && (k > 0 || index[k].firstMove == 0);
+        if (!ordered || index[k].offset + kBlockHeaderBytes > indexOffset || index[k].firstMove >= totalMoves) {
+            index.clear();
+            totalMoves = 0;
+            err = path + ": corrupt index";
+            return false;
+        }
+    }
+    return std::fseek(file, static_cast<long>(kHeaderBytes), SEEK_SET) == 0;
+}
+
+bool BinaryToolpathReader::seekMove(std::uint64_t move)
+{
+    if (!file)
+        return false;
+    err.clear();
+    if (move >= totalMoves) {
+        nextBlock = index.size();
+        skipMoves = 0;
+        return move == totalMoves;
+    }
+    auto it = std::upper_bound(index.begin(), index.end(), move,
+                               [](std::uint64_t m, const IndexEntry &e) { return m < e.firstMove; });
+    if (it == index.begin()) {
+        err = "corrupt index";
+        return false;
+    }
+    nextBlock = static_cast<std::size_t>(it - index.begin()) - 1;
+    skipMoves = move - index[nextBlock].firstMove;
+    if (std::fseek(file, static_cast<long>(index[nextBlock].offset), SEEK_SET) != 0) {
+        err = "seek failed";
+        return false;
+    }
+    return true;
+}
+
+bool BinaryToolpathReader::nextBatch(std::vector<MotionSegment> &out, std::size_t maxSegments)
+{
+    out.clear();
+    if (!file || !err.empty())
+        return false;
+    while (out.size() < maxSegments && nextBlock < index.size()) {
+        if (!decodeBlock(out))
+            return false;
+    }
+    return !out.empty();
+}
+
+bool BinaryToolpathReader::decodeBlock(std::vector<MotionSegment> &out)
+{
+    const std::string where = "block " + std::to_string(nextBlock);
+    unsigned char header[kBlockHeaderBytes];
+    if (std::fread(header, 1, sizeof header, file) != sizeof header) {
+        err = where + ": truncated";
+        return false;
+    }
+    const std::uint32_t bytes = static_cast<std::uint32_t>(getLE(header, 4));
+    const std::uint32_t count = static_cast<std::uint32_t>(getLE(header + 4, 4));
+    if (bytes > kMaxPayload || count > bytes) {
+        err = where + ": corrupt header";
+        return false;
+    }
+    payload.resize(bytes + kMaxMoveBytes);
+    std::fill(payload.begin() + bytes, payload.end(), 0);
+    if (std::fread(payload.data(), 1, bytes, file) != bytes) {
+        err = where + ": truncated";
+        return false;
+    }
+    totalBytes += sizeof header + bytes;
+    if (checksums && crc32(payload.data(), bytes) != getLE(header + 8, 4)) {
+        err = where + ": checksum mismatch";
+        return false;
+    }
+
+    const double scale = units;
+    std::int64_t lineNo = static_cast<std::int64_t>(getLE(header + 16, 8));
+    std::int64_t feed = static_cast<std::int64_t>(getLE(header + 24, 8));
+    std::int64_t pos[kAxisCount];
+    AxisPoint cur;
+    for (int a = 0; a < kAxisCount; ++a) {
+        pos[a] = static_cast<std::int64_t>(getLE(header + 32 + 8 * a, 8));
+        cur[a] = pos[a] / scale;
+    }
+    double feedMm = feed / 1000.0;
+
+    const std::size_t base = out.size();
+    out.resize(base + count);
+    MotionSegment *seg = out.data() + base;
+    const unsigned char *p = payload.data();
+    const unsigned char *end = p + bytes;
+    for (std::uint32_t k = 0; k < count; ++k, ++seg) {
+        const unsigned tag = *p++;
+        if (tag & kTagMeta) {
+            const unsigned meta = *p++;
+            if (meta & kMetaJump) {
+                for (int a = 0; a < kAxisCount; ++a) {
+                    pos[a] += unzigzag(getVarint(p));
+                    cur[a] = pos[a] / scale;
+                }
+            }
+            if (meta & kMetaFeed) {
+                feed += unzigzag(getVarint(p));
+                feedMm = feed / 1000.0;
+            }
+            if (meta & kMetaLine)
+                lineNo += unzigzag(getVarint(p));
+        }
+        seg->start = cur;
+        for (int a = 0; a < kAxisCount; ++a) {
+            if (tag & (1u << a)) {
+                pos[a] += unzigzag(getVarint(p));
+                cur[a] = pos[a] / scale;
+            }
+        }
+        seg->end = cur;
+        seg->feed = feedMm;
+        seg->rapid = tag & kTagRapid;
+        seg->line = ++lineNo;
+        if (p > end)
+            break;
+    }
+    if (p != end) {
+        out.resize(base);
+        err = where + ": corrupt payload";
+        return false;
+    }
+    line = lineNo;
+    ++nextBlock;
+
+    if (skipMoves > 0) {
+        out.erase(out.begin() + static_cast<std::ptrdiff_t>(base),
+                  out.begin() + static_cast<std::ptrdiff_t>(base + std::min<std::uint64_t>(skipMoves, count)));
+        skipMoves = 0;
+    }
+    return true;
+}
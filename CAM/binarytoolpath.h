@@ -0,0 +1,142 @@
+#ifndef BINARYTOOLPATH_H
+#define BINARYTOOLPATH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "toolpath.h"
+
+// Compact binary toolpath (.cnb).
+//
+// Coordinates are stored as fixed-point integers (unitsPerMm per mm, or per
+// degree for A), delta-encoded against the previous move and packed as
+// zigzag varints; only the axes that move are written. Moves are grouped
+// into blocks that each start from an absolute state, so any block can be
+// decoded on its own, and an index at the end of the file maps move numbers
+// to blocks. Each block can carry a CRC-32 of its payload.
+//
+//   header   "CNCBTP1\n", u32 version, u32 flags, u32 unitsPerMm, u32 blockMoves
+//   block    u32 payloadBytes, u32 moves, u32 crc, u32 reserved,
+//            i64 line, i64 feed (0.001 mm/min), i64 position[kAxisCount], payload
+//   index    per block: u64 offset, u64 firstMove, i64 firstLine
+//   footer   u64 indexOffset, u64 blocks, u64 moves, "CNCBEND\n"
+//
+// All integers are little-endian.
+struct BinaryToolpathOptions
+{
+    std::uint32_t unitsPerMm = 10000; // 0.1 um resolution
+    std::uint32_t blockMoves = 4096;
+    bool checksums = false;
+};
+
+class BinaryToolpathWriter
+{
+public:
+    BinaryToolpathWriter() = default;
+    ~BinaryToolpathWriter();
+
+    BinaryToolpathWriter(const BinaryToolpathWriter &) = delete;
+    BinaryToolpathWriter &operator=(const BinaryToolpathWriter &) = delete;
+
+    bool open(const std::string &path, const BinaryToolpathOptions &options = BinaryToolpathOptions());
+    bool write(const std::vector<MotionSegment> &moves);
+
+    // Flushes the last block and writes the index; the file is incomplete
+    // until this returns true.
+    bool close();
+
+    std::uint64_t movesWritten() const { return moves; }
+    std::uint64_t bytesWritten() const { return bytes; }
+    const std::string &error() const { return err; }
+
+private:
+    bool flushBlock();
+    bool put(const void *data, std::size_t size);
+
+    struct IndexEntry
+    {
+        std::uint64_t offset;
+        std::uint64_t firstMove;
+        std::int64_t firstLine;
+    };
+
+    std::FILE *file = nullptr;
+    BinaryToolpathOptions opts;
+    double scale = 1.0;
+
+    // Encoder state after the last move, and at the start of the open block.
+    std::int64_t pos[kAxisCount] = {};
+    std::int64_t feed = 0;
+    std::int64_t line = 0;
+    std::int64_t blockPos[kAxisCount] = {};
+    std::int64_t blockFeed = 0;
+    std::int64_t blockLine = 0;
+
+    std::vector<unsigned char> payload;
+    std::uint32_t blockCount = 0; // moves in the open block
+    std::vector<IndexEntry> index;
+    std::uint64_t moves = 0;
+    std::uint64_t bytes = 0;
+    std::string err;
+};
+
+// Streaming decoder; also supports seeking to any move through the index.
+class BinaryToolpathReader
+{
+public:
+    BinaryToolpathReader() = default;
+    ~BinaryToolpathReader();
+
+    BinaryToolpathReader(const BinaryToolpathReader &) = delete;
+    BinaryToolpathReader &operator=(const BinaryToolpathReader &) = delete;
+
+    bool open(const std::string &path);
+
+    // Replaces out with the next whole blocks, at least maxSegments moves
+    // unless the file ends. Returns false at end of file or on error.
+    bool nextBatch(std::vector<MotionSegment> &out, std::size_t maxSegments = 65536);
+
+    // Positions the reader so that the next batch starts at move number
+    // `move` (0-based).
+    bool seekMove(std::uint64_t move);
+
+    std::uint64_t moveCount() const { return totalMoves; }
+    std::size_t blockCount() const { return index.size(); }
+    std::uint32_t unitsPerMm() const { return units; }
+    bool hasChecksums() const { return checksums; }
+    std::int64_t linesRead() const { return line; }
+    std::size_t bytesRead() const { return totalBytes; }
+    const std::string &error() const { return err; }
+
+private:
+    bool decodeBlock(std::vector<MotionSegment> &out);
+
+    struct IndexEntry
+    {
+        std::uint64_t offset;
+        std::uint64_t firstMove;
+    };
+
+    std::FILE *file = nullptr;
+    std::uint32_t units = 0;
+    bool checksums = false;
+    std::vector<IndexEntry> index;
+    std::uint64_t totalMoves = 0;
+    std::size_t nextBlock = 0;
+    std::uint64_t skipMoves = 0; // dropped from the next block after a seek
+    std::vector<unsigned char> payload;
+    std::int64_t line = 0;
+    std::size_t totalBytes = 0;
+    std::string err;
+};
+
+// CRC-32 (IEEE, as zlib) of size bytes.
+std::uint32_t crc32(const void *data, std::size_t size, std::uint32_t crc = 0);
+
+// True if path starts with the .cnb magic.
+bool isBinaryToolpath(const std::string &path);
+
+#endif // BINARYTOOLPATH_H
@@ -0,0 +1,690 @@
+#include "contourorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "workstealingpool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Tour positions per refinement window. Small enough that a window's
+// arrays stay in L1/L2, large enough that most neighbours fall inside it.
+constexpr std::size_t kWindow = 1024;
+constexpr int kMaxChain = 3; // Or-opt chain length
+constexpr double kGain = 1e-9; // mm; smaller gains are rounding noise
+
+struct Point2
+{
+    double x, y;
+};
+
+inline double dist(const Point2 &a, const Point2 &b)
+{
+    return std::hypot(a.x - b.x, a.y - b.y);
+}
+
+inline Point2 xy(const AxisPoint &p) { return {p[AxisX], p[AxisY]}; }
+
+inline bool sameXy(const AxisPoint &a, const AxisPoint &b)
+{
+    return a[AxisX] == b[AxisX] && a[AxisY] == b[AxisY];
+}
+
+inline bool onlyZ(const MotionSegment &m)
+{
+    return sameXy(m.start, m.end);
+}
+
+struct Contour
+{
+    std::size_t first = 0;     // program index of the first move
+    std::size_t lead = 0;      // Z-only moves before the body
+    std::size_t body = 0;      // moves that travel in XY
+    std::size_t tail = 0;      // Z-only moves after it
+    bool closed = false;
+};
+
+// Uniform grid over points, stored CSR: cell c holds items[start[c] ..
+// start[c] + live[c]). Items may be removed (swapped behind live).
+class PointGrid
+{
+public:
+    struct Item
+    {
+        Point2 p;
+        int contour;
+        int choice;
+    };
+
+    void build(std::vector<Item> all)
+    {
+        double x0 = 1e300, y0 = 1e300, x1 = -1e300, y1 = -1e300;
+        for (const Item &it : all) {
+            x0 = std::min(x0, it.p.x);
+            y0 = std::min(y0, it.p.y);
+            x1 = std::max(x1, it.p.x);
+            y1 = std::max(y1, it.p.y);
+        }
+        if (all.empty())
+            x0 = y0 = x1 = y1 = 0.0;
+        // About two points per cell.
+        const double area = std::max((x1 - x0) * (y1 - y0), 1e-12);
+        cell = std::max(std::sqrt(area / std::max<std::size_t>(1, all.size() / 2)), 1e-6);
+        originX = x0;
+        originY = y0;
+        nx = std::min(4096, static_cast<int>((x1 - x0) / cell) + 1);
+        ny = std::min(4096, static_cast<int>((y1 - y0) / cell) + 1);
+        cell = std::max((x1 - x0) / nx, (y1 - y0) / ny) * (1 + 1e-9) + 1e-9;
+        start.assign(static_cast<std::size_t>(nx) * ny + 1, 0);
+        for (const Item &it : all)
+            ++start[cellOf(it.p) + 1];
+        for (std::size_t c = 1; c < start.size(); ++c)
+            start[c] += start[c - 1];
+        live.assign(start.size() - 1, 0);
+        items.resize(all.size());
+        for (const Item &it : all) {
+            const std::size_t c = cellOf(it.p);
+            items[start[c] + live[c]++] = it;
+        }
+    }
+
+    // Nearest item whose contour passes keep(); items that fail are
+    // removed for good when prune is set. Returns false if none is left.
+    template <typename Keep>
+    bool nearest(const Point2 &p, bool prune, Keep keep, Item &best) const
+    {
+        const int cx = std::clamp(static_cast<int>((p.x - originX) / cell), 0, nx - 1);
+        const int cy = std::clamp(static_cast<int>((p.y - originY) / cell), 0, ny - 1);
+        double bestDist = 1e300;
+        bool found = false;
+        for (int r = 0; r <= std::max(nx, ny); ++r) {
+            for (int y = cy - r; y <= cy + r; ++y) {
+                if (y < 0 || y >= ny)
+                    continue;
+                const bool edge = y == cy - r || y == cy + r;
+                for (int x = cx - r; x <= cx + r; x += edge ? 1 : 2 * r) {
+                    if (x >= 0 && x < nx)
+                        scanCell(static_cast<std::size_t>(y) * nx + x, p, prune, keep, best, bestDist, found);
+                    if (r == 0)
+                        break;
+                }
+            }
+            if (found && bestDist <= r * cell)
+                break;
+        }
+        return found;
+    }
+
+private:
+    std::size_t cellOf(const Point2 &p) const
+    {
+        const int x = std::clamp(static_cast<int>((p.x - originX) / cell), 0, nx - 1);
+        const int y = std::clamp(static_cast<int>((p.y - originY) / cell), 0, ny - 1);
+        return static_cast<std::size_t>(y) * nx + x;
+    }
+
+    template <typename Keep>
+    void scanCell(std::size_t c, const Point2 &p, bool prune, Keep &keep, Item &best, double &bestDist,
+                  bool &found) const
+    {
+        Item *cellItems = &items[start[c]];
+        int &n = live[c];
+        for (int k = 0; k < n;) {
+            if (!keep(cellItems[k].contour)) {
+                if (prune) {
+                    std::swap(cellItems[k], cellItems[--n]);
+                    continue;
+                }
+                ++k;
+                continue;
+            }
+            const double d = dist(p, cellItems[k].p);
+            if (d < bestDist) {
+                bestDist = d;
+                best = cellItems[k];
+                found = true;
+            }
+            ++k;
+        }
+    }
+
+    double cell = 1.0, originX = 0.0, originY = 0.0;
+    int nx = 1, ny = 1;
+    std::vector<std::size_t> start;
+    mutable std::vector<int> live;
+    mutable std::vector<Item> items;
+};
+
+class Optimizer
+{
+public:
+    Optimizer(const std::vector<MotionSegment> &program, const OrderingOptions &options, WorkStealingPool *pool)
+        : prog(program), opts(options), pool(pool)
+    {
+    }
+
+    OrderingReport run(std::vector<MotionSegment> &out);
+
+private:
+    void extract();
+    Point2 vertex(int c, int v) const
+    {
+        const Contour &k = contours[c];
+        return xy(prog[k.first + k.lead + v].start);
+    }
+    // A contour without XY travel (a drill hole) starts and ends above
+    // its first move.
+    Point2 bodyStart(int c) const
+    {
+        const Contour &k = contours[c];
+        return xy(prog[k.body ? k.first + k.lead : k.first].start);
+    }
+    Point2 bodyEnd(int c) const
+    {
+        const Contour &k = contours[c];
+        return k.body ? xy(prog[k.first + k.lead + k.body - 1].end) : xy(prog[k.first].start);
+    }
+    bool flippable(int c) const { return c >= real || contours[c].closed || opts.reverseOpen; }
+    void place(int c);
+    double link(int a, int b) const { return b == endNode ? 0.0 : dist(exitP[a], entryP[b]); }
+    double tourLength() const;
+
+    void seed();
+    void buildNeighbours();
+    bool refineWindow(std::size_t first, std::size_t last, int window, Clock::time_point deadline, long &applied);
+    bool rotateClosed();
+    void write(std::vector<MotionSegment> &out) const;
+
+    const std::vector<MotionSegment> &prog;
+    OrderingOptions opts;
+    WorkStealingPool *pool;
+
+    std::vector<Contour> contours; // real ones, then the start and end nodes
+    int real = 0;
+    int startNode = 0;
+    int endNode = 0;
+    AxisPoint origin{};
+
+    // Tour: contour ids, and per contour its direction / entry vertex and
+    // the resulting entry and exit points.
+    std::vector<int> order;
+    std::vector<unsigned char> reversed;
+    std::vector<int> entryVertex;
+    std::vector<Point2> entryP, exitP;
+
+    std::vector<int> neighbours; // opts.neighbours * 2 per contour, -1 padded
+    std::vector<int> windowOf;   // window of a contour in this round
+    std::vector<int> where;      // tour position of a contour
+};
+
+void Optimizer::extract()
+{
+    std::size_t i = 0;
+    const std::size_t n = prog.size();
+    while (i < n) {
+        if (prog[i].rapid) {
+            ++i;
+            continue;
+        }
+        Contour c;
+        c.first = i;
+        std::size_t end = i;
+        while (end < n && !prog[end].rapid && (end == i || prog[end].start == prog[end - 1].end))
+            ++end;
+        std::size_t a = i, b = end;
+        while (a < b && onlyZ(prog[a]))
+            ++a;
+        while (b > a && onlyZ(prog[b - 1]))
+            --b;
+        c.lead = a - i;
+        c.body = b - a;
+        c.tail = end - b;
+        c.closed = c.body > 1 && prog[a].start == prog[b - 1].end;
+        contours.push_back(c);
+        i = end;
+    }
+    real = static_cast<int>(contours.size());
+    // Start node: the job's start point; end node: a free end (links to it
+    // cost nothing). Both sit at the ends of the tour and never move.
+    startNode = real;
+    endNode = real + 1;
+    contours.resize(real + 2);
+    origin = n ? prog[0].start : AxisPoint{};
+}
+
+void Optimizer::place(int c)
+{
+    if (c == startNode) {
+        entryP[c] = exitP[c] = xy(origin);
+        return;
+    }
+    if (c == endNode) {
+        entryP[c] = exitP[c] = {0.0, 0.0};
+        return;
+    }
+    if (contours[c].closed) {
+        entryP[c] = exitP[c] = vertex(c, entryVertex[c]);
+        return;
+    }
+    entryP[c] = reversed[c] ? bodyEnd(c) : bodyStart(c);
+    exitP[c] = reversed[c] ? bodyStart(c) : bodyEnd(c);
+}
+
+double Optimizer::tourLength() const
+{
+    double sum = 0.0;
+    for (std::size_t k = 0; k + 1 < order.size(); ++k)
+        sum += link(order[k], order[k + 1]);
+    return sum;
+}
+
+void Optimizer::seed()
+{
+    std::vector<PointGrid::Item> items;
+    for (int c = 0; c < real; ++c) {
+        const Contour &k = contours[c];
+        if (k.closed && opts.rotateClosed) {
+            for (std::size_t v = 0; v < k.body; ++v)
+                items.push_back({vertex(c, static_cast<int>(v)), c, static_cast<int>(v)});
+        } else {
+            items.push_back({bodyStart(c), c, 0});
+            if (!k.closed && opts.reverseOpen)
+                items.push_back({bodyEnd(c), c, 1});
+        }
+    }
+    PointGrid grid;
+    grid.build(std::move(items));
+
+    std::vector<unsigned char> visited(real, 0);
+    order.assign(1, startNode);
+    Point2 at = xy(origin);
+    PointGrid::Item best{};
+    auto keep = [&](int c) { return !visited[c]; };
+    while (grid.nearest(at, true, keep, best)) {
+        const int c = best.contour;
+        visited[c] = 1;
+        if (contours[c].closed)
+            entryVertex[c] = best.choice;
+        else
+            reversed[c] = static_cast<unsigned char>(best.choice);
+        place(c);
+        order.push_back(c);
+        at = exitP[c];
+    }
+    order.push_back(endNode);
+}
+
+void Optimizer::buildNeighbours()
+{
+    const int k = std::max(1, opts.neighbours);
+    std::vector<PointGrid::Item> items;
+    for (int c = 0; c < real; ++c) {
+        items.push_back({entryP[c], c, 0});
+        if (!contours[c].closed)
+            items.push_back({exitP[c], c, 1});
+    }
+    PointGrid grid;
+    grid.build(std::move(items));
+    neighbours.assign(static_cast<std::size_t>(real) * 2 * k, -1);
+
+    // Read-only queries; k rounds of "nearest not yet taken" per end.
+    auto work = [&](std::size_t chunk, int) {
+        const int c0 = static_cast<int>(chunk * 256);
+        const int c1 = std::min(real, c0 + 256);
+        std::vector<int> taken;
+        for (int c = c0; c < c1; ++c) {
+            int *list = &neighbours[static_cast<std::size_t>(c) * 2 * k];
+            int count = 0;
+            for (int end = 0; end < 2; ++end) {
+                const Point2 p = end ? exitP[c] : entryP[c];
+                if (end && contours[c].closed)
+                    break;
+                taken.assign(1, c);
+                PointGrid::Item best{};
+                for (int j = 0; j < k; ++j) {
+                    auto keep = [&](int other) { return std::find(taken.begin(), taken.end(), other) == taken.end(); };
+                    if (!grid.nearest(p, false, keep, best))
+                        break;
+                    taken.push_back(best.contour);
+                    if (std::find(list, list + count, best.contour) == list + count)
+                        list[count++] = best.contour;
+                }
+            }
+        }
+    };
+    const std::size_t chunks = (static_cast<std::size_t>(real) + 255) / 256;
+    if (pool)
+        pool->parallelFor(chunks, work);
+    else
+        for (std::size_t c = 0; c < chunks; ++c)
+            work(c, 0);
+}
+
+// 2-opt and Or-opt inside tour positions [first, last]; the contours at
+// first and last stay put, so windows never touch each other's contours.
+bool Optimizer::refineWindow(std::size_t first, std::size_t last, int window, Clock::time_point deadline,
+                             long &applied)
+{
+    const int k2 = 2 * std::max(1, opts.neighbours);
+    auto flip = [&](std::size_t a, std::size_t b) { // reverse positions a..b
+        std::reverse(order.begin() + a, order.begin() + b + 1);
+        for (std::size_t p = a; p <= b; ++p) {
+            const int c = order[p];
+            where[c] = static_cast<int>(p);
+            if (!contours[c].closed)
+                reversed[c] ^= 1;
+            std::swap(entryP[c], exitP[c]);
+        }
+    };
+    auto canFlip = [&](std::size_t a, std::size_t b) {
+        if (opts.reverseOpen)
+            return true;
+        for (std::size_t p = a; p <= b; ++p)
+            if (!flippable(order[p]))
+                return false;
+        return true;
+    };
+
+    bool improved = false;
+    long tries = 0;
+    for (bool again = true; again;) {
+        again = false;
+        for (std::size_t i = first + 1; i < last; ++i) {
+            if ((++tries & 63) == 0 && Clock::now() > deadline)
+                return improved;
+            const int c = order[i];
+            const int *list = &neighbours[static_cast<std::size_t>(c) * k2];
+            bool moved = false;
+            for (int t = 0; t < k2 && list[t] >= 0 && !moved; ++t) {
+                const int n = list[t];
+                if (windowOf[n] != window)
+                    continue;
+                const std::size_t j = static_cast<std::size_t>(where[n]);
+                const std::size_t p = std::min(i, j), q = std::max(i, j);
+
+                // 2-opt: reversing p+1..q puts the exits of the contours at
+                // p and q side by side, reversing p..q-1 their entries.
+                for (int variant = 0; variant < 2 && !moved; ++variant) {
+                    const std::size_t a = variant ? p : p + 1;
+                    const std::size_t b = variant ? q - 1 : q;
+                    if (a > b || a <= first || b >= last || !canFlip(a, b))
+                        continue;
+                    const int before = order[a - 1], s = order[a], e = order[b], after = order[b + 1];
+                    const double old = link(before, s) + link(e, after);
+                    const double now = dist(exitP[before], exitP[e])
+                                       + (after == endNode ? 0.0 : dist(entryP[s], entryP[after]));
+                    if (now < old - kGain) {
+                        flip(a, b);
+                        ++applied;
+                        improved = again = moved = true;
+                    }
+                }
+            }
+            if (moved)
+                continue;
+
+            // Or-opt: the chain starting at i, next to one of its
+            // neighbours, either way round.
+            for (int len = 1; len <= kMaxChain; ++len) {
+                const std::size_t e = i + len - 1;
+                if (e >= last)
+                    break;
+                const int s0 = order[i], s1 = order[e];
+                const int prev = order[i - 1], next = order[e + 1];
+                const double removed = link(prev, s0) + link(s1, next) - link(prev, next);
+                if (removed <= kGain)
+                    continue;
+                double bestGain = kGain;
+                std::size_t bestAt = 0;
+                bool bestFlip = false;
+                for (int t = 0; t < k2 && list[t] >= 0; ++t) {
+                    const int n = list[t];
+                    if (windowOf[n] != window)
+                        continue;
+                    const std::size_t j = static_cast<std::size_t>(where[n]);
+                    for (std::size_t at : {j - 1, j}) { // insert between at and at + 1
+                        if (at < first || at >= last || (at + 1 >= i && at <= e))
+                            continue;
+                        const int u = order[at], w = order[at + 1];
+                        const double base = link(u, w);
+                        const double plain = dist(exitP[u], entryP[s0]) + link(s1, w) - base;
+                        if (removed - plain > bestGain) {
+                            bestGain = removed - plain;
+                            bestAt = at;
+                            bestFlip = false;
+                        }
+                        if (canFlip(i, e)) {
+                            const double turned = dist(exitP[u], exitP[s1])
+                                                  + (w == endNode ? 0.0 : dist(entryP[s0], entryP[w])) - base;
+                            if (removed - turned > bestGain) {
+                                bestGain = removed - turned;
+                                bestAt = at;
+                                bestFlip = true;
+                            }
+                        }
+                    }
+                }
+                if (bestGain <= kGain)
+                    continue;
+                if (bestFlip)
+                    flip(i, e);
+                std::size_t lo, hi;
+                if (bestAt < i) {
+                    std::rotate(order.begin() + bestAt + 1, order.begin() + i, order.begin() + e + 1);
+                    lo = bestAt + 1;
+                    hi = e;
+                } else {
+                    std::rotate(order.begin() + i, order.begin() + e + 1, order.begin() + bestAt + 1);
+                    lo = i;
+                    hi = bestAt;
+                }
+                for (std::size_t p = lo; p <= hi; ++p)
+                    where[order[p]] = static_cast<int>(p);
+                ++applied;
+                improved = again = true;
+                break;
+            }
+        }
+    }
+    return improved;
+}
+
+// Moves each closed contour's entry to the vertex nearest its neighbours
+// in the tour. Returns true if anything moved.
+bool Optimizer::rotateClosed()
+{
+    if (!opts.rotateClosed)
+        return false;
+    bool moved = false;
+    for (std::size_t p = 1; p + 1 < order.size(); ++p) {
+        const int c = order[p];
+        if (!contours[c].closed)
+            continue;
+        const Point2 from = exitP[order[p - 1]];
+        const int next = order[p + 1];
+        const Point2 to = entryP[next];
+        int best = entryVertex[c];
+        double bestCost = 1e300;
+        for (std::size_t v = 0; v < contours[c].body; ++v) {
+            const Point2 q = vertex(c, static_cast<int>(v));
+            const double cost = dist(from, q) + (next == endNode ? 0.0 : dist(q, to));
+            if (cost < bestCost - kGain) {
+                bestCost = cost;
+                best = static_cast<int>(v);
+            }
+        }
+        if (best != entryVertex[c]) {
+            entryVertex[c] = best;
+            place(c);
+            moved = true;
+        }
+    }
+    return moved;
+}
+
+void Optimizer::write(std::vector<MotionSegment> &out) const
+{
+    out.clear();
+    double safeZ = -1e300;
+    for (const MotionSegment &m : prog)
+        if (m.rapid)
+            safeZ = std::max(safeZ, m.end[AxisZ]);
+    if (safeZ == -1e300)
+        for (const MotionSegment &m : prog)
+            safeZ = std::max(safeZ, std::max(m.start[AxisZ], m.end[AxisZ]));
+
+    AxisPoint pos = origin;
+    auto rapidTo = [&](const AxisPoint &to, std::int64_t line) {
+        if (to == pos)
+            return;
+        MotionSegment m;
+        m.start = pos;
+        m.end = to;
+        m.rapid = true;
+        m.line = line;
+        out.push_back(m);
+        pos = to;
+    };
+    auto feed = [&](MotionSegment m, bool backwards, const Point2 *at) {
+        if (backwards)
+            std::swap(m.start, m.end);
+        if (at) {
+            m.end[AxisX] = at->x;
+            m.end[AxisY] = at->y;
+        }
+        m.start = pos;
+        out.push_back(m);
+        pos = m.end;
+    };
+    // Rise, cross and drop to p; skips the parts that are not needed.
+    auto travel = [&](const AxisPoint &p, std::int64_t line) {
+        if (!sameXy(pos, p)) {
+            AxisPoint up = pos;
+            up[AxisZ] = std::max(pos[AxisZ], safeZ);
+            rapidTo(up, line);
+            AxisPoint over = p;
+            over[AxisZ] = up[AxisZ];
+            rapidTo(over, line);
+        }
+        rapidTo(p, line);
+    };
+
+    for (std::size_t k = 1; k + 1 < order.size(); ++k) {
+        const int c = order[k];
+        const Contour &ct = contours[c];
+        const Point2 in = entryP[c], outP = exitP[c];
+        AxisPoint approach = prog[ct.first].start;
+        approach[AxisX] = in.x;
+        approach[AxisY] = in.y;
+        travel(approach, prog[ct.first].line);
+
+        for (std::size_t m = 0; m < ct.lead; ++m)
+            feed(prog[ct.first + m], false, &in);
+        const std::size_t b0 = ct.first + ct.lead;
+        if (ct.closed) {
+            for (std::size_t m = 0; m < ct.body; ++m)
+                feed(prog[b0 + (entryVertex[c] + m) % ct.body], false, nullptr);
+        } else if (reversed[c]) {
+            for (std::size_t m = ct.body; m-- > 0;)
+                feed(prog[b0 + m], true, nullptr);
+        } else {
+            for (std::size_t m = 0; m < ct.body; ++m)
+                feed(prog[b0 + m], false, nullptr);
+        }
+        for (std::size_t m = 0; m < ct.tail; ++m)
+            feed(prog[b0 + ct.body + m], false, &outP);
+    }
+    // Finish where the job did if it ended with rapids (park, home).
+    if (!prog.empty() && prog.back().rapid)
+        travel(prog.back().end, prog.back().line);
+}
+
+OrderingReport Optimizer::run(std::vector<MotionSegment> &out)
+{
+    OrderingReport report;
+    extract();
+    const int total = real + 2;
+    reversed.assign(total, 0);
+    entryVertex.assign(total, 0);
+    entryP.assign(total, {0.0, 0.0});
+    exitP.assign(total, {0.0, 0.0});
+    report.contours = static_cast<std::size_t>(real);
+    for (int c = 0; c < real; ++c)
+        report.closedContours += contours[c].closed;
+
+    // As programmed.
+    order.assign(1, startNode);
+    for (int c = 0; c < real; ++c)
+        order.push_back(c);
+    order.push_back(endNode);
+    for (int c = 0; c < total; ++c)
+        place(c);
+    report.originalTravel = tourLength();
+
+    auto t0 = Clock::now();
+    seed();
+    report.seededTravel = tourLength();
+    auto t1 = Clock::now();
+    report.seedSeconds = std::chrono::duration<double>(t1 - t0).count();
+
+    buildNeighbours();
+    where.assign(total, 0);
+    windowOf.assign(total, -1);
+    for (std::size_t p = 0; p < order.size(); ++p)
+        where[order[p]] = static_cast<int>(p);
+
+    // Windows overlap by one position (the shared, fixed boundary contour);
+    // the cuts move by a third of a window each round.
+    const Clock::time_point deadline = t1 + std::chrono::duration_cast<Clock::duration>(
+                                                 std::chrono::duration<double>(std::max(0.0, opts.timeBudget)));
+    const std::size_t n = order.size();
+    int quiet = 0;
+    while (n > 3 && Clock::now() < deadline && quiet < 3) {
+        const std::size_t offset = (report.rounds % 3) * kWindow / 3;
+        std::vector<std::size_t> cuts(1, 0);
+        for (std::size_t p = offset ? offset : kWindow; p < n - 1; p += kWindow)
+            cuts.push_back(p);
+        cuts.push_back(n - 1);
+        const std::size_t windows = cuts.size() - 1;
+        for (std::size_t w = 0; w < windows; ++w)
+            for (std::size_t p = cuts[w] + 1; p < cuts[w + 1]; ++p)
+                windowOf[order[p]] = static_cast<int>(w);
+        for (std::size_t w = 0; w <= windows; ++w)
+            windowOf[order[cuts[w]]] = -1;
+
+        std::vector<long> applied(windows, 0);
+        std::atomic<bool> any{false};
+        auto work = [&](std::size_t w, int) {
+            if (refineWindow(cuts[w], cuts[w + 1], static_cast<int>(w), deadline, applied[w]))
+                any.store(true, std::memory_order_relaxed);
+        };
+        if (pool)
+            pool->parallelFor(windows, work);
+        else
+            for (std::size_t w = 0; w < windows; ++w)
+                work(w, 0);
+        for (long a : applied)
+            report.improvements += a;
+        const bool rotated = rotateClosed();
+        quiet = any.load() || rotated ? 0 : quiet + 1;
+        ++report.rounds;
+    }
+    report.optimizedTravel = tourLength();
+    report.refineSeconds = std::chrono::duration<double>(Clock::now() - t1).count();
+
+    write(out);
+    return report;
+}
+
+} // namespace
+
+OrderingReport optimizeContourOrder(const std::vector<MotionSegment> &program, std::vector<MotionSegment> &out,
+                                    const OrderingOptions &options, WorkStealingPool *pool)
+{
+    Optimizer optimizer(program, options, pool);
+    return optimizer.run(out);
+}
@@ -0,0 +1,59 @@
+#ifndef CONTOURORDER_H
+#define CONTOURORDER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "toolpath.h"
+
+class WorkStealingPool;
+
+struct OrderingOptions
+{
+    double timeBudget = 1.0;   // s for the refinement after seeding
+    bool reverseOpen = true;   // open contours may be cut end to start
+    bool rotateClosed = true;  // closed contours may be entered at any vertex
+    int neighbours = 8;        // candidate moves per contour end
+};
+
+struct OrderingReport
+{
+    std::size_t contours = 0;
+    std::size_t closedContours = 0;
+    double originalTravel = 0.0;  // mm of XY rapid travel as programmed
+    double seededTravel = 0.0;    // after nearest-neighbour seeding
+    double optimizedTravel = 0.0; // after 2-opt / Or-opt refinement
+    double seedSeconds = 0.0;
+    double refineSeconds = 0.0;
+    long rounds = 0;              // refinement rounds run
+    long improvements = 0;        // moves applied
+
+    double savings() const { return originalTravel > 0 ? 1.0 - optimizedTravel / originalTravel : 0.0; }
+};
+
+// Rapid-move optimizer for 2D jobs (laser, plasma, profile milling).
+//
+// A contour is a run of feed moves between rapids; moves at its start and
+// end that only change Z (plunge, retract) stay with it. The optimizer
+// reorders contours, runs open ones in either direction and enters closed
+// ones (start == end) at whichever vertex is best, to shorten the XY rapid
+// travel from the job's start point through all contours.
+//
+// 1. Nearest-neighbour seeding over a uniform grid of every candidate
+//    entry point (both ends of open contours, every vertex of closed ones).
+// 2. Refinement within the time budget: 2-opt (reversing a stretch of the
+//    tour flips its open contours) and Or-opt (moving a chain of up to
+//    three contours elsewhere, either way round), tried only towards each
+//    end's nearest neighbours. The tour is cut into windows refined in
+//    parallel on the pool; each worker only touches its window's interior,
+//    and the cuts shift every round. Between rounds closed contours move
+//    their entry to the vertex closest to their neighbours.
+//
+// The output program has the contours in the new order, joined by G0 moves
+// that rise to the highest rapid Z of the input, cross in XY and drop back
+// to each contour's approach height.
+OrderingReport optimizeContourOrder(const std::vector<MotionSegment> &program, std::vector<MotionSegment> &out,
+                                    const OrderingOptions &options = OrderingOptions(),
+                                    WorkStealingPool *pool = nullptr);
+
+#endif // CONTOURORDER_H
@@ -0,0 +1,487 @@
+#include "cycletime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "wavekernel.h"
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// Moves are taken in blocks small enough that all pending arrays stay in
+// cache; streaming whole reader batches through a dozen arrays per pass is
+// memory bound. Plan once kPlanBlock moves are pending; force a commit at
+// the upper bound (only reachable with a million-move deceleration ramp).
+constexpr std::size_t kGeometryBlock = 1024;
+constexpr std::size_t kPlanBlock = 4096;
+constexpr std::size_t kMaxPending = 1 << 20;
+
+template <typename T>
+void eraseFront(std::vector<T> &v, std::size_t n)
+{
+    v.erase(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(n));
+}
+
+// min(cap, sqrt(reach2)). The passes are serial chains, so the sqrt is
+// kept off the chain whenever the cap wins (cruising moves).
+inline double limitedSpeed(double cap, double reach2)
+{
+    return cap * cap <= reach2 ? cap : std::sqrt(reach2);
+}
+
+// Radius of curvature of a Bezier in XYZ at t, |B'|^3 / |B' x B''|.
+double radiusOfCurvature(const SmoothSegment &s, double t)
+{
+    const double u = 1.0 - t;
+    double d1[3], d2[3];
+    for (int a = 0; a < 3; ++a) {
+        const double e0 = s.control1[a] - s.start[a];
+        const double e1 = s.control2[a] - s.control1[a];
+        const double e2 = s.end[a] - s.control2[a];
+        d1[a] = 3 * (u * u * e0 + 2 * u * t * e1 + t * t * e2);
+        d2[a] = 6 * (u * (e1 - e0) + t * (e2 - e1));
+    }
+    const double cx = d1[1] * d2[2] - d1[2] * d2[1];
+    const double cy = d1[2] * d2[0] - d1[0] * d2[2];
+    const double cz = d1[0] * d2[1] - d1[1] * d2[0];
+    const double cross = std::sqrt(cx * cx + cy * cy + cz * cz);
+    const double speed = std::sqrt(d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2]);
+    return cross > 0.0 ? speed * speed * speed / cross : kInf;
+}
+
+// Chords a curve needs so none strays more than flatness from it: a chord
+// over dt deviates by at most |B''| dt^2 / 8, and |B''| <= 6 times the
+// larger second difference of the control points.
+int curvePieces(const SmoothSegment &s, double flatness)
+{
+    double m0 = 0.0, m1 = 0.0;
+    for (int a = 0; a < 3; ++a) {
+        const double s0 = s.start[a] - 2 * s.control1[a] + s.control2[a];
+        const double s1 = s.control1[a] - 2 * s.control2[a] + s.end[a];
+        m0 += s0 * s0;
+        m1 += s1 * s1;
+    }
+    const double bound = 0.75 * std::sqrt(std::max(m0, m1)) / flatness;
+    return static_cast<int>(std::min(1000.0, std::max(1.0, std::ceil(std::sqrt(bound)))));
+}
+
+} // namespace
+
+MachineLimits MachineLimits::leadScrewGantry()
+{
+    MachineLimits m;
+    m.maxVelocity = {100.0, 100.0, 100.0, 180.0, 100.0, 100.0};
+    m.maxAccel = {500.0, 500.0, 500.0, 720.0, 500.0, 500.0};
+    return m;
+}
+
+double trapezoidTime(double len, double vi, double vo, double vmax, double a, double &peak)
+{
+    // Branch-free: the peak is either the cruise speed or the triangle apex.
+    const double apex = std::sqrt((2 * a * len + vi * vi + vo * vo) / 2);
+    const double vp = std::min(vmax, apex);
+    const double rampDistance = (2 * vp * vp - vi * vi - vo * vo) / (2 * a);
+    const double cruise = std::max(0.0, len - rampDistance);
+    peak = vp;
+    return (2 * vp - vi - vo) / a + cruise / vp;
+}
+
+namespace {
+
+// trapezoidTime() over n moves. The arrays are distinct, which lets the
+// compiler vectorize the square root and divisions.
+void trapezoidTimes(const double *__restrict len, const double *__restrict vi, const double *__restrict vo,
+                    const double *__restrict vmax, const double *__restrict a, double *__restrict times,
+                    double *__restrict peaks, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        times[i] = trapezoidTime(len[i], vi[i], vo[i], vmax[i], a[i], peaks[i]);
+}
+
+} // namespace
+
+CycleTimeEstimator::CycleTimeEstimator(const MachineLimits &limits, const Kinematics *kinematics)
+    : limits(limits),
+      kin(kinematics && !kinematics->identity() ? kinematics : nullptr)
+{
+    if (kin && !kin->linear())
+        stream = std::make_unique<KinematicsStream>(*kin);
+    for (int a = 0; a < kAxisCount; ++a) {
+        invVelocity[a] = 1.0 / limits.maxVelocity[a];
+        invAccel[a] = 1.0 / limits.maxAccel[a];
+    }
+}
+
+void CycleTimeEstimator::appendGeometry(const MotionSegment *moves, std::size_t count)
+{
+    // Drop zero-length moves while transposing into struct of arrays.
+    delta.resize(count);
+    feedScratch.resize(count);
+    std::size_t n = 0;
+    const std::size_t base = length.size();
+    rapid.resize(base + count);
+    for (std::size_t k = 0; k < count; ++k) {
+        const MotionSegment &s = moves[k];
+        bool moving = false;
+        for (int a = 0; a < kAxisCount; ++a) {
+            delta.axis[a][n] = s.end[a] - s.start[a];
+            moving = moving || delta.axis[a][n] != 0.0;
+        }
+        feedScratch[n] = s.rapid || s.feed <= 0 ? kInf : s.feed / 60.0;
+        rapid[base + n] = s.rapid;
+        n += moving;
+    }
+    if (kin && !stream) {
+        // Linear machine: the displacements transform like points, in one
+        // vectorized batch per block.
+        delta.resize(n);
+        kin->inverse(delta, jointDelta);
+        std::swap(delta, jointDelta);
+    }
+    addGeometry(n);
+}
+
+void CycleTimeEstimator::appendJointDeltas(const PointBatch &joints, const std::size_t *source,
+                                           const MotionSegment *moves, std::size_t first, std::size_t count)
+{
+    // As appendGeometry(), from the displacements of a KinematicsStream;
+    // feed and rapid come from the program move each one belongs to.
+    delta.resize(count);
+    feedScratch.resize(count);
+    std::size_t n = 0;
+    const std::size_t base = length.size();
+    rapid.resize(base + count);
+    for (std::size_t k = first; k < first + count; ++k) {
+        const MotionSegment &s = moves[source[k]];
+        bool moving = false;
+        for (int a = 0; a < kAxisCount; ++a) {
+            delta.axis[a][n] = joints.axis[a][k];
+            moving = moving || delta.axis[a][n] != 0.0;
+        }
+        feedScratch[n] = s.rapid || s.feed <= 0 ? kInf : s.feed / 60.0;
+        rapid[base + n] = s.rapid;
+        n += moving;
+    }
+    addGeometry(n);
+}
+
+void CycleTimeEstimator::addGeometry(std::size_t n)
+{
+    // delta and feedScratch hold n moves, already in rapid.
+    const std::size_t base = length.size();
+    rapid.resize(base + n);
+    if (n == 0)
+        return;
+
+    invLength.resize(n);
+    length.resize(base + n);
+    nominal.resize(base + n);
+    accel.resize(base + n);
+    junctionCap.resize(base + n);
+    entry.resize(base + n);
+    exitV.resize(base + n);
+    for (int a = 0; a < kAxisCount; ++a)
+        unit[a].resize(base + n);
+
+    double *len = length.data() + base;
+    double *vNom = nominal.data() + base;
+    double *acc = accel.data() + base;
+    double *cap = junctionCap.data() + base;
+
+    // Axes that have not moved yet are skipped below: their deltas and
+    // direction cosines are zero, which adds nothing to any sum or maximum,
+    // so the results are the same as over all axes. Most jobs never move
+    // A, U or V.
+    for (int a = 0; a < kAxisCount; ++a) {
+        if (axisMoved[a])
+            continue;
+        const double *d = delta.axis[a].data();
+        int any = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            any |= d[i] != 0.0;
+        axisMoved[a] = any;
+    }
+    int axes[kAxisCount];
+    int axisCount = 0;
+    for (int a = 0; a < kAxisCount; ++a) {
+        if (axisMoved[a])
+            axes[axisCount++] = a;
+    }
+
+    // Every loop below streams one axis over all moves, so each one is a
+    // plain vector loop. Length, then the slowest axis sets the path speed
+    // and acceleration: v = len / max_a(|d_a| / vmax_a).
+    std::fill(len, len + n, 0.0);
+    std::fill(vNom, vNom + n, 0.0);
+    std::fill(acc, acc + n, 0.0);
+    for (int k = 0; k < axisCount; ++k) {
+        const int a = axes[k];
+        const double *d = delta.axis[a].data();
+        const double iv = invVelocity[a], ia = invAccel[a];
+        for (std::size_t i = 0; i < n; ++i) {
+            len[i] += d[i] * d[i];
+            vNom[i] = std::max(vNom[i], std::fabs(d[i]) * iv);
+            acc[i] = std::max(acc[i], std::fabs(d[i]) * ia);
+        }
+    }
+    const double *feed = feedScratch.data();
+    for (std::size_t i = 0; i < n; ++i) {
+        len[i] = std::sqrt(len[i]);
+        vNom[i] = std::min(feed[i], len[i] / vNom[i]);
+        acc[i] = len[i] / acc[i];
+    }
+    if (curveRadius) {
+        // Chords of a curve: v^2 / r within the path acceleration.
+        const double *r = curveRadius;
+        for (std::size_t i = 0; i < n; ++i)
+            vNom[i] = std::min(vNom[i], std::sqrt(acc[i] * r[i]));
+    }
+    double *invLen = invLength.data();
+    for (std::size_t i = 0; i < n; ++i)
+        invLen[i] = 1.0 / len[i];
+    for (int k = 0; k < axisCount; ++k) {
+        const int a = axes[k];
+        const double *d = delta.axis[a].data();
+        double *u = unit[a].data() + base;
+        for (std::size_t i = 0; i < n; ++i)
+            u[i] = d[i] * invLen[i];
+    }
+
+    // Junction speed caps (grbl junction deviation): the corner is treated
+    // as a circle tangent to both moves that deviates by at most delta.
+    // Junction i joins move i-1 to move i; the first one joins the previous
+    // batch, or starts the program at rest. cap[] first holds cos(theta).
+    std::fill(cap, cap + n, 0.0);
+    for (int k = 0; k < axisCount; ++k) {
+        const int a = axes[k];
+        const double *u = unit[a].data() + base;
+        cap[0] -= lastUnit[a] * u[0];
+        for (std::size_t i = 1; i < n; ++i)
+            cap[i] -= u[i - 1] * u[i];
+    }
+    const double deviation = limits.junctionDeviation;
+    auto junction = [deviation](double cosTheta, double a, double vPrev, double vNext) {
+        const double sinHalf = std::sqrt(std::max(0.0, 0.5 * (1.0 - cosTheta)));
+        const double vj = std::sqrt(a * deviation * sinHalf / std::max(1e-18, 1.0 - sinHalf));
+        const double v = sinHalf > 1.0 - 1e-9 ? kInf : vj; // straight through
+        return std::min(std::min(v, vNext), vPrev);
+    };
+    const double first = junction(cap[0], std::min(acc[0], lastAccel), lastNominal, vNom[0]);
+    for (std::size_t i = n - 1; i > 0; --i)
+        cap[i] = junction(cap[i], std::min(acc[i], acc[i - 1]), vNom[i - 1], vNom[i]);
+    cap[0] = haveLast ? first : 0.0;
+
+    for (int a = 0; a < kAxisCount; ++a)
+        lastUnit[a] = unit[a][base + n - 1];
+    lastNominal = vNom[n - 1];
+    lastAccel = acc[n - 1];
+    haveLast = true;
+}
+
+void CycleTimeEstimator::add(const std::vector<MotionSegment> &moves)
+{
+    if (!stream) {
+        for (std::size_t first = 0; first < moves.size(); first += kGeometryBlock) {
+            appendGeometry(moves.data() + first, std::min(kGeometryBlock, moves.size() - first));
+            if (length.size() >= kPlanBlock)
+                plan(false);
+        }
+        return;
+    }
+    // Non-linear machine: a geometry block of program moves at a time
+    // through the stream, whose joint displacements (split moves give more
+    // than a block) go straight into the arrays.
+    for (std::size_t first = 0; first < moves.size(); first += kGeometryBlock) {
+        const MotionSegment *block = moves.data() + first;
+        const PointBatch &joints = stream->applyDeltas(block, std::min(kGeometryBlock, moves.size() - first));
+        const std::size_t *source = stream->sources().data();
+        for (std::size_t k = 0; k < joints.size(); k += kGeometryBlock) {
+            appendJointDeltas(joints, source, block, k, std::min(kGeometryBlock, joints.size() - k));
+            if (length.size() >= kPlanBlock)
+                plan(false);
+        }
+    }
+}
+
+void CycleTimeEstimator::add(const std::vector<SmoothSegment> &moves)
+{
+    // Chords with the smallest radius of curvature at their ends and middle;
+    // lines get an infinite one. Zero-length chords are left out here, so
+    // appendGeometry() keeps every move and the radii stay aligned.
+    chords.clear();
+    chordRadius.clear();
+    for (const SmoothSegment &s : moves) {
+        MotionSegment chord;
+        chord.feed = s.feed;
+        chord.rapid = s.rapid;
+        chord.line = s.line;
+        const int pieces = s.curve ? curvePieces(s, kCurveFlatness) : 1;
+        chord.start = s.start;
+        for (int j = 1; j <= pieces; ++j) {
+            const double t0 = double(j - 1) / pieces, t1 = double(j) / pieces;
+            chord.end = j == pieces ? s.end : s.at(t1);
+            if (chord.end != chord.start) {
+                chords.push_back(chord);
+                chordRadius.push_back(!s.curve ? kInf
+                                               : std::min(std::min(radiusOfCurvature(s, t0), radiusOfCurvature(s, t1)),
+                                                          radiusOfCurvature(s, 0.5 * (t0 + t1))));
+            }
+            chord.start = chord.end;
+        }
+    }
+    if (kin) {
+        add(chords);
+        return;
+    }
+    for (std::size_t first = 0; first < chords.size(); first += kGeometryBlock) {
+        curveRadius = chordRadius.data() + first;
+        appendGeometry(chords.data() + first, std::min(kGeometryBlock, chords.size() - first));
+        curveRadius = nullptr;
+        if (length.size() >= kPlanBlock)
+            plan(false);
+    }
+}
+
+void CycleTimeEstimator::plan(bool final)
+{
+    const std::size_t n = length.size();
+    if (n == 0)
+        return;
+
+    // Backward pass assuming a stop after the last pending move.
+    double exitSpeed = 0.0;
+    for (std::size_t i = n; i-- > 0;) {
+        exitV[i] = exitSpeed;
+        entry[i] = limitedSpeed(junctionCap[i], exitSpeed * exitSpeed + 2 * accel[i] * length[i]);
+        exitSpeed = entry[i];
+    }
+
+    // Moves before the last junction that already runs at its cap can no
+    // longer be affected by moves still to come.
+    std::size_t count = n;
+    if (!final) {
+        count = 0;
+        for (std::size_t j = n - 1; j > 0; --j) {
+            if (entry[j] == junctionCap[j]) {
+                count = j;
+                break;
+            }
+        }
+        if (count == 0 && n >= kMaxPending)
+            count = n / 2;
+    }
+    if (count > 0)
+        commit(count);
+}
+
+void CycleTimeEstimator::commit(std::size_t count)
+{
+    // Forward pass: entry speeds limited by acceleration from the left.
+    vIn.resize(count);
+    vOut.resize(count);
+    times.resize(count);
+    peaks.resize(count);
+    double v = startVelocity;
+    for (std::size_t i = 0; i < count; ++i) {
+        vIn[i] = v;
+        v = limitedSpeed(i + 1 < length.size() ? entry[i + 1] : exitV[i], v * v + 2 * accel[i] * length[i]);
+        vOut[i] = v;
+    }
+    startVelocity = v;
+
+    trapezoidTimes(length.data(), vIn.data(), vOut.data(), nominal.data(), accel.data(), times.data(),
+                   peaks.data(), count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        report.totalSeconds += times[i];
+        (rapid[i] ? report.rapidSeconds : report.feedSeconds) += times[i];
+    }
+    // Axes innermost: independent accumulator chains per move, for the
+    // axes that have moved (the others would add zeros).
+    const double *u[kAxisCount];
+    double peak[kAxisCount], moving[kAxisCount] = {}, travel[kAxisCount] = {};
+    int axes[kAxisCount];
+    int axisCount = 0;
+    for (int a = 0; a < kAxisCount; ++a) {
+        if (!axisMoved[a])
+            continue;
+        u[axisCount] = unit[a].data();
+        peak[axisCount] = report.peakVelocity[a];
+        axes[axisCount++] = a;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        for (int k = 0; k < axisCount; ++k) {
+            const double au = std::fabs(u[k][i]);
+            peak[k] = std::max(peak[k], peaks[i] * au);
+            moving[k] += au > 1e-12 ? times[i] : 0.0;
+            travel[k] += length[i] * au;
+        }
+    }
+    for (int k = 0; k < axisCount; ++k) {
+        report.peakVelocity[axes[k]] = peak[k];
+        report.movingSeconds[axes[k]] += moving[k];
+        report.travel[axes[k]] += travel[k];
+    }
+    report.segments += count;
+
+    eraseFront(length, count);
+    eraseFront(nominal, count);
+    eraseFront(accel, count);
+    eraseFront(junctionCap, count);
+    eraseFront(entry, count);
+    eraseFront(exitV, count);
+    eraseFront(rapid, count);
+    for (int a = 0; a < kAxisCount; ++a)
+        eraseFront(unit[a], count);
+}
+
+CycleTimeReport CycleTimeEstimator::finish()
+{
+    plan(true);
+    return report;
+}
+
+WaveTimingReport estimateWaveProgram(const WaveParams &params, long ticks, double tickSeconds,
+                                     double maxVelocity, double maxAccel)
+{
+    WaveTimingReport r;
+    const int n = params.numMotors;
+    r.peakVelocity.assign(n, 0.0);
+    r.peakAccel.assign(n, 0.0);
+    r.duty.assign(n, 0.0);
+    r.nominalSeconds = ticks * tickSeconds;
+    if (ticks < 1 || n < 1)
+        return r;
+
+    WaveGenerator wave(params);
+    std::vector<double> prev = wave.tick();
+    std::vector<double> prevVel(n, 0.0);
+    std::vector<long> movingTicks(n, 0);
+    const double inv = 1.0 / tickSeconds;
+    for (long k = 1; k < ticks; ++k) {
+        const std::vector<double> &pos = wave.tick();
+        for (int i = 0; i < n; ++i) {
+            const double v = (pos[i] - prev[i]) * inv;
+            const double acc = (v - prevVel[i]) * inv;
+            r.peakVelocity[i] = std::max(r.peakVelocity[i], std::fabs(v));
+            if (k > 1)
+                r.peakAccel[i] = std::max(r.peakAccel[i], std::fabs(acc));
+            movingTicks[i] += pos[i] != prev[i];
+            prevVel[i] = v;
+            prev[i] = pos[i];
+        }
+    }
+
+    double worstV = 0.0, worstA = 0.0;
+    for (int i = 0; i < n; ++i) {
+        worstV = std::max(worstV, r.peakVelocity[i]);
+        worstA = std::max(worstA, r.peakAccel[i]);
+        r.duty[i] = double(movingTicks[i]) / std::max(1L, ticks - 1);
+    }
+    // Slowing time by s divides velocity by s and acceleration by s^2.
+    r.timeScale = std::max({1.0, worstV / maxVelocity, std::sqrt(worstA / maxAccel)});
+    r.requiredSeconds = r.nominalSeconds * r.timeScale;
+    return r;
+}
@@ -0,0 +1,133 @@
+#ifndef CYCLETIME_H
+#define CYCLETIME_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "kinematics.h"
+#include "pathsmoothing.h"
+#include "toolpath.h"
+
+struct WaveParams;
+
+// Axis limits of the machine, per axis in mm/s and mm/s^2 (deg for A).
+struct MachineLimits
+{
+    std::array<double, kAxisCount> maxVelocity;
+    std::array<double, kAxisCount> maxAccel;
+    double junctionDeviation = 0.01; // mm, grbl-style cornering tolerance
+
+    // Parts-list gantry: 8 mm lead (4 start, 2 mm pitch) lead screws, steppers
+    // usable to ~750 rpm -> 100 mm/s, 500 mm/s^2; A axis 180 deg/s.
+    static MachineLimits leadScrewGantry();
+};
+
+struct CycleTimeReport
+{
+    double totalSeconds = 0.0;
+    double feedSeconds = 0.0;
+    double rapidSeconds = 0.0;
+    std::size_t segments = 0;
+    std::array<double, kAxisCount> peakVelocity{}; // highest speed reached per axis
+    std::array<double, kAxisCount> movingSeconds{}; // time each axis is in motion
+    std::array<double, kAxisCount> travel{};        // distance per axis
+
+    double duty(int axis) const { return totalSeconds > 0 ? movingSeconds[axis] / totalSeconds : 0.0; }
+};
+
+// Replays a program through acceleration-limited kinematics (trapezoidal
+// profiles, junction-deviation cornering, full look-ahead) and sums the
+// exact time without generating steps.
+//
+// Moves are streamed in with add(). Look-ahead is exact: a move is only
+// committed once some later junction is known to run at its cap, which no
+// future move can change. Segment geometry, limits and profile times are
+// evaluated in branch-free struct-of-arrays loops the compiler vectorizes.
+//
+// With kinematics, moves are in program coordinates and the limits apply to
+// the joints. Linear kinematics transform the struct-of-arrays move deltas
+// in place of the endpoints; non-linear ones go through a KinematicsStream,
+// whose joint displacements fill the same arrays without joint segments.
+class CycleTimeEstimator
+{
+public:
+    explicit CycleTimeEstimator(const MachineLimits &limits = MachineLimits::leadScrewGantry(),
+                                const Kinematics *kinematics = nullptr);
+
+    // Batch size for feeding add() from a reader: small enough that the
+    // parsed batch is still in cache when it is transposed.
+    static constexpr std::size_t kBatchMoves = 4096;
+
+    void add(const std::vector<MotionSegment> &moves);
+
+    // Smoothed moves (pathsmoothing.h). Each curve is planned as chords
+    // within kCurveFlatness of it, and on each chord the speed is also held
+    // to sqrt(a * r): centripetal acceleration within the chord's path
+    // acceleration a at the smallest radius of curvature r along it. With
+    // kinematics the chords are planned as plain moves, without that limit.
+    void add(const std::vector<SmoothSegment> &moves);
+
+    static constexpr double kCurveFlatness = 0.001; // mm
+
+    // Plans the remaining moves to a full stop and returns the totals.
+    CycleTimeReport finish();
+
+private:
+    void appendGeometry(const MotionSegment *moves, std::size_t count);
+    void appendJointDeltas(const PointBatch &joints, const std::size_t *source, const MotionSegment *moves,
+                           std::size_t first, std::size_t count);
+    void addGeometry(std::size_t n);
+    void plan(bool final);
+    void commit(std::size_t count);
+
+    MachineLimits limits;
+    const Kinematics *kin;
+    std::unique_ptr<KinematicsStream> stream; // non-linear kinematics only
+    std::array<double, kAxisCount> invVelocity;
+    std::array<double, kAxisCount> invAccel;
+
+    // Pending moves, struct of arrays.
+    std::array<std::vector<double>, kAxisCount> unit; // direction cosines
+    std::vector<double> length, nominal, accel, junctionCap, entry, exitV;
+    std::vector<char> rapid;
+
+    // Geometry scratch for the incoming batch.
+    PointBatch delta, jointDelta;
+    std::vector<MotionSegment> chords; // curves of a smoothed batch
+    std::vector<double> chordRadius;   // and their radius of curvature
+    const double *curveRadius = nullptr; // per move of the block, if curved
+    std::vector<double> feedScratch, invLength;
+    std::vector<double> vIn, vOut, times, peaks; // commit scratch
+
+    double startVelocity = 0.0; // fixed entry speed of the first pending move
+    bool haveLast = false;
+    std::array<int, kAxisCount> axisMoved{}; // set once an axis moves
+    std::array<double, kAxisCount> lastUnit{};
+    double lastNominal = 0.0;
+    double lastAccel = 0.0;
+    CycleTimeReport report;
+};
+
+// Trapezoid time for a move of length len entered at vi and left at vo
+// with cruise speed vmax and acceleration a; peak receives the top speed.
+double trapezoidTime(double len, double vi, double vo, double vmax, double a, double &peak);
+
+// Per-motor timing of a wave program: the required peak velocity and
+// acceleration of each motor, and the time scale (>= 1) by which the
+// program must be slowed for the given limits.
+struct WaveTimingReport
+{
+    double nominalSeconds = 0.0;
+    double requiredSeconds = 0.0;
+    double timeScale = 1.0;
+    std::vector<double> peakVelocity;
+    std::vector<double> peakAccel;
+    std::vector<double> duty;
+};
+
+WaveTimingReport estimateWaveProgram(const WaveParams &params, long ticks, double tickSeconds,
+                                     double maxVelocity, double maxAccel);
+
+#endif // CYCLETIME_H
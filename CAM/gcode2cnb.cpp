@@ -0,0 +1,88 @@
+// Converts a text G-code job into the compact binary toolpath format.
+//
+//   gcode2cnb <job.nc> <job.cnb> [--resolution UNITS_PER_MM] [--block MOVES]
+//             [--crc] [--arc-tolerance MM]
+//
+// Arcs are flattened with the parser's chord tolerance, so the binary file
+// holds exactly the moves every other tool sees.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "binarytoolpath.h"
+#include "gcodeparser.h"
+
+namespace {
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s <job.nc> <job.cnb> [--resolution UNITS_PER_MM] [--block MOVES]\n"
+                 "       [--crc] [--arc-tolerance MM]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    BinaryToolpathOptions options;
+    double arcTolerance = 0.01;
+    for (int i = 3; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--resolution") && i + 1 < argc)
+            options.unitsPerMm = static_cast<std::uint32_t>(std::atol(argv[++i]));
+        else if (!std::strcmp(argv[i], "--block") && i + 1 < argc)
+            options.blockMoves = static_cast<std::uint32_t>(std::atol(argv[++i]));
+        else if (!std::strcmp(argv[i], "--crc"))
+            options.checksums = true;
+        else if (!std::strcmp(argv[i], "--arc-tolerance") && i + 1 < argc)
+            arcTolerance = std::atof(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    GCodeReader reader(arcTolerance);
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+    BinaryToolpathWriter writer;
+    if (!writer.open(argv[2], options)) {
+        std::fprintf(stderr, "%s\n", writer.error().c_str());
+        return 1;
+    }
+    std::vector<MotionSegment> batch;
+    while (reader.nextBatch(batch)) {
+        if (!writer.write(batch))
+            break;
+    }
+    if (!reader.error().empty()) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+    if (!writer.close()) {
+        std::fprintf(stderr, "%s: %s\n", argv[2], writer.error().c_str());
+        return 1;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::printf("moves:        %llu from %lld lines\n", static_cast<unsigned long long>(writer.movesWritten()),
+                static_cast<long long>(reader.linesRead()));
+    std::printf("size:         %.2f MB -> %.2f MB  (%.1fx, %.2f bytes/move)\n", reader.bytesRead() / 1e6,
+                writer.bytesWritten() / 1e6, double(reader.bytesRead()) / writer.bytesWritten(),
+                double(writer.bytesWritten()) / std::max<std::uint64_t>(1, writer.movesWritten()));
+    std::printf("resolution:   %.4g um%s\n", 1000.0 / options.unitsPerMm, options.checksums ? ", CRC-32 per block" : "");
+    std::printf("time:         %.3f s\n", std::chrono::duration<double>(t1 - t0).count());
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "gcodeparser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+int axisForLetter(char c)
+{
+    switch (c) {
+    case 'X': return AxisX;
+    case 'Y': return AxisY;
+    case 'Z': return AxisZ;
+    case 'A': return AxisA;
+    case 'U': return AxisU;
+    case 'V': return AxisV;
+    default: return -1;
+    }
+}
+
+constexpr double kPow10[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7};
+constexpr std::uint64_t kScale[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+// Up to eight characters at p as a little-endian word, zero padded past e.
+// Near the end of the line the word is loaded from e - 8 and shifted down,
+// so only lines shorter than eight characters are read byte by byte.
+std::uint64_t load8(const char *p, const char *begin, const char *e)
+{
+    std::uint64_t w = 0;
+    if (e - p >= 8) {
+        std::memcpy(&w, p, 8);
+    } else if (e - begin >= 8) {
+        if (p < e) {
+            std::memcpy(&w, e - 8, 8);
+            w >>= 8 * (8 - (e - p));
+        }
+    } else {
+        for (int k = 0; p + k < e; ++k)
+            w |= std::uint64_t(static_cast<unsigned char>(p[k])) << (8 * k);
+    }
+    return w;
+}
+
+// Number of leading ASCII digits in w (8 when all are digits).
+int digitRun(std::uint64_t w)
+{
+    // A byte is a digit when both its high nibble and that of byte + 6 are 3.
+    const std::uint64_t high = 0xF0F0F0F0F0F0F0F0;
+    const std::uint64_t odd = ((w & high) | (((w + 0x0606060606060606) & high) >> 4)) ^ 0x3333333333333333;
+    return odd ? __builtin_ctzll(odd) >> 3 : 8;
+}
+
+// Value of the first count (1..7) digits of w, combined in three multiplies.
+std::uint64_t digitValue(std::uint64_t w, int count)
+{
+    w = (w << (8 * (8 - count))) | (0x3030303030303030 >> (8 * count)); // left-pad with '0'
+    w -= 0x3030303030303030;
+    w = w * 10 + (w >> 8);
+    return (((w & 0x000000FF000000FF) * (100 + (1000000ULL << 32)))
+            + (((w >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+}
+
+// Numbers as CAM posts write them, [-]digits[.digits] with up to seven
+// digits on each side, are read a word at a time: the digits form an exact
+// integer below 2^53 and the scale an exact power of ten, so one division
+// gives the correctly rounded value, the same double from_chars returns.
+// Anything else (exponents, longer digit runs, inf/nan) goes to from_chars.
+const char *scanNumber(const char *p, const char *begin, const char *e, double &value)
+{
+    const char *start = p;
+    const bool negative = p < e && *p == '-';
+    p += negative;
+    const std::uint64_t w = load8(p, begin, e);
+    const int whole = digitRun(w);
+    if (whole < 8) {
+        std::uint64_t m = whole ? digitValue(w, whole) : 0;
+        p += whole;
+        int fraction = 0;
+        if (p < e && *p == '.') {
+            const std::uint64_t f = load8(++p, begin, e);
+            fraction = digitRun(f);
+            if (fraction > 0 && fraction < 8)
+                m = m * kScale[fraction] + digitValue(f, fraction);
+            p += fraction;
+        }
+        if ((whole || fraction) && fraction < 8 && (p == e || (*p != 'e' && *p != 'E'))) {
+            const double v = static_cast<double>(m) / kPow10[fraction];
+            value = negative ? -v : v;
+            return p;
+        }
+    }
+    auto [next, ec] = std::from_chars(start, e, value);
+    return ec == std::errc() ? next : nullptr;
+}
+
+} // namespace
+
+GCodeParser::GCodeParser(double arcTolerance)
+    : arcTolerance(arcTolerance > 0 ? arcTolerance : 0.01)
+{
+}
+
+bool GCodeParser::parseLine(std::string_view line, std::vector<MotionSegment> &out)
+{
+    ++lineNo;
+    err.clear();
+
+    double words[kAxisCount];
+    unsigned haveWords = 0; // bit per axis
+    double i = 0.0, j = 0.0, r = 0.0, f = 0.0;
+    bool haveR = false, haveF = false, setPosition = false;
+    int newUnits = 0; // 20 or 21 when given on this line
+
+    const char *p = line.data();
+    const char *e = p + line.size();
+    while (p < e) {
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '%') {
+            ++p;
+            continue;
+        }
+        if (c == ';')
+            break;
+        if (c == '(') {
+            const char *close = static_cast<const char *>(std::memchr(p, ')', e - p));
+            p = close ? close + 1 : e;
+            continue;
+        }
+        if (c >= 'a' && c <= 'z')
+            c = static_cast<char>(c - 'a' + 'A');
+        if (c < 'A' || c > 'Z') {
+            err = "line " + std::to_string(lineNo) + ": unexpected character '" + std::string(1, c) + "'";
+            return false;
+        }
+
+        ++p;
+        while (p < e && (*p == ' ' || *p == '\t'))
+            ++p;
+        // from_chars does not accept a leading '+'.
+        if (p < e && *p == '+')
+            ++p;
+        double value = 0.0;
+        const char *next = scanNumber(p, line.data(), e, value);
+        if (!next) {
+            err = "line " + std::to_string(lineNo) + ": bad number after '" + std::string(1, c) + "'";
+            return false;
+        }
+        p = next;
+
+        const int axis = axisForLetter(c);
+        if (axis >= 0) {
+            words[axis] = value;
+            haveWords |= 1u << axis;
+            continue;
+        }
+        switch (c) {
+        case 'G': {
+            const int code = static_cast<int>(std::lround(value * 10));
+            if (code == 0 || code == 10 || code == 20 || code == 30)
+                motionMode = code / 10;
+            else if (code == 200 || code == 210)
+                newUnits = code / 10;
+            else if (code == 900)
+                absolute = true;
+            else if (code == 910)
+                absolute = false;
+            else if (code == 920)
+                setPosition = true;
+            break;
+        }
+        case 'I': i = value; break;
+        case 'J': j = value; break;
+        case 'R': r = value; haveR = true; break;
+        case 'F': f = value; haveF = true; break;
+        default: break; // N, M, S, T, P, ... do not move the tool
+        }
+    }
+
+    if (newUnits)
+        unitScale = newUnits == 20 ? 25.4 : 1.0;
+    if (haveF)
+        feed = f * unitScale;
+
+    if (setPosition || !haveWords || motionMode > 1) {
+        AxisPoint target = pos;
+        for (unsigned m = haveWords; m; m &= m - 1) {
+            const int a = __builtin_ctz(m);
+            const double v = a == AxisA ? words[a] : words[a] * unitScale;
+            target[a] = absolute || setPosition ? v : pos[a] + v;
+        }
+        if (!setPosition && haveWords) {
+            addArc(target, motionMode == 2, i * unitScale, j * unitScale, r * unitScale, haveR, out);
+            if (!err.empty())
+                return false;
+        }
+        pos = target;
+        return true;
+    }
+
+    // A line move, built in place. The new position is stored axis by axis
+    // into both the move and pos, never copied as a block from just-written
+    // doubles: that would stall on store forwarding. Copying the previous
+    // move is cheaper than value-initializing a fresh one.
+    if (out.empty())
+        out.emplace_back();
+    else
+        out.push_back(out.back());
+    MotionSegment &seg = out.back();
+    seg.start = pos;
+    seg.end = pos;
+    for (unsigned m = haveWords; m; m &= m - 1) {
+        const int a = __builtin_ctz(m);
+        const double v = a == AxisA ? words[a] : words[a] * unitScale;
+        const double t = absolute ? v : pos[a] + v;
+        seg.end[a] = t;
+        pos[a] = t;
+    }
+    seg.feed = feed;
+    seg.rapid = motionMode == 0;
+    seg.line = lineNo;
+    return true;
+}
+
+void GCodeParser::addArc(const AxisPoint &target, bool clockwise, double i, double j, double r,
+                         bool haveR, std::vector<MotionSegment> &out)
+{
+    const double x0 = pos[AxisX], y0 = pos[AxisY];
+    const double x1 = target[AxisX], y1 = target[AxisY];
+    double cx, cy;
+    if (haveR) {
+        // Center on the perpendicular bisector; negative R picks the long arc.
+        const double dx = x1 - x0, dy = y1 - y0;
+        const double chord = std::hypot(dx, dy);
+        if (chord == 0.0) {
+            err = "line " + std::to_string(lineNo) + ": R arc with identical end points";
+            return;
+        }
+        const double h = std::sqrt(std::max(0.0, r * r - chord * chord / 4));
+        double side = (clockwise ? -1.0 : 1.0) * (r < 0 ? -1.0 : 1.0);
+        cx = (x0 + x1) / 2 - side * h * dy / chord;
+        cy = (y0 + y1) / 2 + side * h * dx / chord;
+    } else {
+        cx = x0 + i;
+        cy = y0 + j;
+    }
+
+    const double radius = std::hypot(x0 - cx, y0 - cy);
+    const double a0 = std::atan2(y0 - cy, x0 - cx);
+    double sweep = std::atan2(y1 - cy, x1 - cx) - a0;
+    if (clockwise && sweep >= 0)
+        sweep -= 2 * M_PI;
+    else if (!clockwise && sweep <= 0)
+        sweep += 2 * M_PI;
+
+    // Angle per chord so the sagitta stays within the tolerance.
+    int n = 1;
+    if (radius > arcTolerance) {
+        const double step = 2 * std::acos(1 - arcTolerance / radius);
+        n = std::max(1, static_cast<int>(std::ceil(std::fabs(sweep) / step)));
+    }
+
+    AxisPoint prev = pos;
+    for (int k = 1; k <= n; ++k) {
+        const double u = double(k) / n;
+        AxisPoint p;
+        for (int a = 0; a < kAxisCount; ++a)
+            p[a] = pos[a] + (target[a] - pos[a]) * u; // helical Z and other axes
+        if (k < n) {
+            p[AxisX] = cx + radius * std::cos(a0 + sweep * u);
+            p[AxisY] = cy + radius * std::sin(a0 + sweep * u);
+        } else {
+            p = target;
+        }
+        MotionSegment seg;
+        seg.start = prev;
+        seg.end = p;
+        seg.feed = feed;
+        seg.line = lineNo;
+        out.push_back(seg);
+        prev = p;
+    }
+}
+
+void GCodeParser::reset()
+{
+    *this = GCodeParser(arcTolerance);
+}
+
+GCodeReader::GCodeReader(double arcTolerance)
+    : parser(arcTolerance),
+      buffer(1 << 20)
+{
+}
+
+GCodeReader::~GCodeReader()
+{
+    if (file)
+        std::fclose(file);
+}
+
+bool GCodeReader::open(const std::string &path)
+{
+    if (file)
+        std::fclose(file);
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        err = "cannot open " + path;
+        return false;
+    }
+    begin = end = totalBytes = 0;
+    eof = false;
+    parser.reset();
+    err.clear();
+    return true;
+}
+
+bool GCodeReader::fill()
+{
+    // Move the partial last line to the front and read behind it.
+    std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    if (end == buffer.size())
+        buffer.resize(buffer.size() * 2); // a single line longer than the buffer
+    const std::size_t n = std::fread(buffer.data() + end, 1, buffer.size() - end, file);
+    totalBytes += n;
+    end += n;
+    if (n == 0)
+        eof = true;
+    return n > 0;
+}
+
+bool GCodeReader::nextBatch(std::vector<MotionSegment> &out, std::size_t maxSegments)
+{
+    out.clear();
+    if (!file || !err.empty())
+        return false;
+
+    while (out.size() < maxSegments) {
+        const char *data = buffer.data();
+        const char *nl = static_cast<const char *>(std::memchr(data + begin, '\n', end - begin));
+        if (!nl) {
+            if (!eof && fill())
+                continue;
+            if (begin == end)
+                break;
+            // Last line without a trailing newline.
+            nl = data + end;
+        }
+        const std::size_t lineEnd = nl - data;
+        if (!parser.parseLine(std::string_view(data + begin, lineEnd - begin), out)) {
+            err = parser.error();
+            return false;
+        }
+        begin = std::min(end, lineEnd + 1);
+    }
+    return !out.empty();
+}
@@ -0,0 +1,83 @@
+#ifndef GCODEPARSER_H
+#define GCODEPARSER_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "toolpath.h"
+
+// Streaming G-code parser producing MotionSegments.
+//
+// Supported: G0/G1/G2/G3 (arcs in G17 with I/J or R, split by chord
+// tolerance), G20/G21, G90/G91, G92, F, and the X Y Z A U V words.
+// Comments in () and after ; are skipped; unknown words are ignored.
+class GCodeParser
+{
+public:
+    explicit GCodeParser(double arcTolerance = 0.01);
+
+    // Parses one line (without the newline) and appends its moves to out.
+    // Returns false and sets error() on a malformed word.
+    bool parseLine(std::string_view line, std::vector<MotionSegment> &out);
+
+    // Back to the start-of-program state: origin, G0, G21, G90, line 0.
+    void reset();
+
+    const AxisPoint &position() const { return pos; }
+    std::int64_t lineNumber() const { return lineNo; }
+    const std::string &error() const { return err; }
+
+private:
+    void addArc(const AxisPoint &target, bool clockwise, double i, double j, double r,
+                bool haveR, std::vector<MotionSegment> &out);
+
+    double arcTolerance;
+    AxisPoint pos{};
+    double feed = 0.0;
+    double unitScale = 1.0;  // 25.4 in G20
+    bool absolute = true;
+    int motionMode = 0;      // modal G0..G3
+    std::int64_t lineNo = 0;
+    std::string err;
+};
+
+// Reads a G-code file in large blocks and hands out segments in batches,
+// so arbitrarily large programs run in bounded memory.
+class GCodeReader
+{
+public:
+    explicit GCodeReader(double arcTolerance = 0.01);
+    ~GCodeReader();
+
+    GCodeReader(const GCodeReader &) = delete;
+    GCodeReader &operator=(const GCodeReader &) = delete;
+
+    // Opens a program and starts parsing it from the initial modal state,
+    // so a reader can be reused for another file or a second pass.
+    bool open(const std::string &path);
+
+    // Replaces out with up to maxSegments moves (possibly a few more when a
+    // line expands into an arc). Returns false at end of file or on error.
+    bool nextBatch(std::vector<MotionSegment> &out, std::size_t maxSegments = 65536);
+
+    std::int64_t linesRead() const { return parser.lineNumber(); }
+    std::size_t bytesRead() const { return totalBytes; }
+    const std::string &error() const { return err; }
+
+private:
+    bool fill();
+
+    GCodeParser parser;
+    std::FILE *file = nullptr;
+    std::vector<char> buffer;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t totalBytes = 0;
+    bool eof = false;
+    std::string err;
+};
+
+#endif // GCODEPARSER_H
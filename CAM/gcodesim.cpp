@@ -0,0 +1,168 @@
+// Headless material-removal preview of a G-code job.
+//
+//   gcodesim <job.nc> [--tool flat|ball] [--diameter D] [--cell C]
+//            [--stock X0 Y0 X1 Y1 ZTOP ZBOTTOM] [--threads N]
+//            [--pgm surface.pgm] [--volumes moves.csv]
+//
+// Without --stock the stock is the XY extent of the cutting moves plus the
+// tool radius, from Z0 down to the deepest move.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gcodeparser.h"
+#include "materialremoval.h"
+#include "workstealingpool.h"
+
+namespace {
+
+struct StockBox
+{
+    double x0 = 1e300, y0 = 1e300, x1 = -1e300, y1 = -1e300;
+    double zTop = 0.0, zBottom = 0.0;
+};
+
+bool scanBounds(const std::string &path, double radius, StockBox &box)
+{
+    GCodeReader reader;
+    if (!reader.open(path))
+        return false;
+    std::vector<MotionSegment> batch;
+    while (reader.nextBatch(batch)) {
+        for (const MotionSegment &s : batch) {
+            if (s.rapid)
+                continue;
+            for (const AxisPoint *p : {&s.start, &s.end}) {
+                box.x0 = std::min(box.x0, (*p)[AxisX] - radius);
+                box.x1 = std::max(box.x1, (*p)[AxisX] + radius);
+                box.y0 = std::min(box.y0, (*p)[AxisY] - radius);
+                box.y1 = std::max(box.y1, (*p)[AxisY] + radius);
+                box.zBottom = std::min(box.zBottom, (*p)[AxisZ]);
+            }
+        }
+    }
+    if (!reader.error().empty()) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return false;
+    }
+    return box.x0 < box.x1 && box.y0 < box.y1;
+}
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s <job.nc> [--tool flat|ball] [--diameter D] [--cell C]\n"
+                 "       [--stock X0 Y0 X1 Y1 ZTOP ZBOTTOM] [--threads N]\n"
+                 "       [--pgm surface.pgm] [--volumes moves.csv]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::string input = argv[1];
+    CutterTool tool;
+    double cell = 0.1;
+    int threads = 0;
+    bool haveStock = false;
+    StockBox box;
+    std::string pgmPath, volumesPath;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--tool") && i + 1 < argc)
+            tool.shape = !std::strcmp(argv[++i], "ball") ? CutterTool::BallEnd : CutterTool::FlatEnd;
+        else if (!std::strcmp(argv[i], "--diameter") && i + 1 < argc)
+            tool.diameter = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--cell") && i + 1 < argc)
+            cell = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--pgm") && i + 1 < argc)
+            pgmPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--volumes") && i + 1 < argc)
+            volumesPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--stock") && i + 6 < argc) {
+            box.x0 = std::atof(argv[++i]);
+            box.y0 = std::atof(argv[++i]);
+            box.x1 = std::atof(argv[++i]);
+            box.y1 = std::atof(argv[++i]);
+            box.zTop = std::atof(argv[++i]);
+            box.zBottom = std::atof(argv[++i]);
+            haveStock = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (cell <= 0 || tool.diameter <= 0) {
+        std::fprintf(stderr, "cell size and tool diameter must be positive\n");
+        return 2;
+    }
+
+    if (!haveStock && !scanBounds(input, tool.diameter / 2, box)) {
+        std::fprintf(stderr, "could not determine stock bounds from %s\n", input.c_str());
+        return 1;
+    }
+
+    HeightMap stock(box.x0, box.y0, box.x1 - box.x0, box.y1 - box.y0, cell,
+                    static_cast<float>(box.zTop), static_cast<float>(box.zBottom));
+    WorkStealingPool pool(threads);
+    MaterialRemovalSim sim(stock, tool, &pool);
+
+    GCodeReader reader;
+    if (!reader.open(input)) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+    std::FILE *csv = volumesPath.empty() ? nullptr : std::fopen(volumesPath.c_str(), "w");
+    if (csv)
+        std::fprintf(csv, "move,line,rapid,volume_mm3\n");
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<MotionSegment> batch;
+    std::vector<double> volumes;
+    std::size_t moveIndex = 0;
+    while (reader.nextBatch(batch, 1 << 18)) {
+        volumes.clear();
+        sim.run(batch, volumes);
+        if (csv) {
+            for (std::size_t k = 0; k < batch.size(); ++k)
+                std::fprintf(csv, "%zu,%lld,%d,%.6f\n", moveIndex + k,
+                             static_cast<long long>(batch[k].line), batch[k].rapid ? 1 : 0, volumes[k]);
+        }
+        moveIndex += batch.size();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    if (csv)
+        std::fclose(csv);
+    if (!reader.error().empty()) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+
+    std::printf("stock:        X %.3f..%.3f  Y %.3f..%.3f  Z %.3f..%.3f\n", box.x0, box.x1, box.y0,
+                box.y1, box.zBottom, box.zTop);
+    std::printf("grid:         %d x %d cells of %.3f mm, %zu/%d tiles touched (%.1f MB)\n",
+                stock.cellsX(), stock.cellsY(), cell, stock.allocatedTiles(),
+                stock.tilesX() * stock.tilesY(), stock.footprintBytes() / 1e6);
+    std::printf("moves:        %zu from %lld lines\n", sim.movesSimulated(),
+                static_cast<long long>(reader.linesRead()));
+    std::printf("removed:      %.3f mm^3\n", sim.totalVolume());
+    std::printf("rapid cuts:   %zu%s\n", sim.rapidCollisions(), sim.rapidCollisions() ? "  (check G0 moves!)" : "");
+    std::printf("time:         %.3f s on %d threads\n",
+                std::chrono::duration<double>(t1 - t0).count(), pool.size());
+
+    if (!pgmPath.empty() && !stock.writePgm(pgmPath)) {
+        std::fprintf(stderr, "cannot write %s\n", pgmPath.c_str());
+        return 1;
+    }
+    return 0;
+}
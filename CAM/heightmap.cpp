@@ -0,0 +1,74 @@
+#include "heightmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+HeightMap::HeightMap(double x0, double y0, double width, double depth, double cellSize,
+                     float zTop, float zBottom)
+    : ox(x0),
+      oy(y0),
+      cell(cellSize),
+      nx(std::max(1, static_cast<int>(std::ceil(width / cellSize)))),
+      ny(std::max(1, static_cast<int>(std::ceil(depth / cellSize)))),
+      tx((nx + kTileSize - 1) / kTileSize),
+      ty((ny + kTileSize - 1) / kTileSize),
+      top(zTop),
+      bottom(std::min(zTop, zBottom)),
+      tiles(static_cast<std::size_t>(tx) * ty)
+{
+}
+
+float HeightMap::height(int ix, int iy) const
+{
+    const float *t = tileIfAllocated(ix >> kTileBits, iy >> kTileBits);
+    if (!t)
+        return top;
+    return t[(iy & (kTileSize - 1)) * kTileSize + (ix & (kTileSize - 1))];
+}
+
+float *HeightMap::tile(int tileX, int tileY)
+{
+    std::unique_ptr<float[]> &t = tiles[static_cast<std::size_t>(tileY) * tx + tileX];
+    if (!t) {
+        t.reset(new float[kTileSize * kTileSize]);
+        std::fill(t.get(), t.get() + kTileSize * kTileSize, top);
+    }
+    return t.get();
+}
+
+const float *HeightMap::tileIfAllocated(int tileX, int tileY) const
+{
+    return tiles[static_cast<std::size_t>(tileY) * tx + tileX].get();
+}
+
+std::size_t HeightMap::allocatedTiles() const
+{
+    return std::count_if(tiles.begin(), tiles.end(), [](const auto &t) { return t != nullptr; });
+}
+
+std::size_t HeightMap::footprintBytes() const
+{
+    return allocatedTiles() * kTileSize * kTileSize * sizeof(float) + tiles.size() * sizeof(tiles[0]);
+}
+
+bool HeightMap::writePgm(const std::string &path) const
+{
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "P5\n%d %d\n65535\n", nx, ny);
+    std::vector<unsigned char> row(nx * 2);
+    const float range = std::max(1e-6f, top - bottom);
+    // PGM rows run top to bottom; print +Y up.
+    for (int iy = ny - 1; iy >= 0; --iy) {
+        for (int ix = 0; ix < nx; ++ix) {
+            const float v = std::clamp((height(ix, iy) - bottom) / range, 0.0f, 1.0f);
+            const unsigned g = static_cast<unsigned>(v * 65535.0f + 0.5f);
+            row[ix * 2] = static_cast<unsigned char>(g >> 8);
+            row[ix * 2 + 1] = static_cast<unsigned char>(g & 0xFF);
+        }
+        std::fwrite(row.data(), 1, row.size(), f);
+    }
+    return std::fclose(f) == 0;
+}
@@ -0,0 +1,59 @@
+#ifndef HEIGHTMAP_H
+#define HEIGHTMAP_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Dexel heightmap of the stock: one top-surface height per XY cell.
+//
+// Cells are grouped in 64 x 64 tiles (16 KiB of floats) that are allocated
+// only when a tool first reaches them; untouched tiles read as the stock
+// top. Tiles are the unit of cache blocking and of parallel work in
+// MaterialRemovalSim.
+class HeightMap
+{
+public:
+    static constexpr int kTileBits = 6;
+    static constexpr int kTileSize = 1 << kTileBits;
+
+    // Stock from (x0, y0) covering width x depth mm, from zBottom up to zTop.
+    HeightMap(double x0, double y0, double width, double depth, double cellSize,
+              float zTop, float zBottom);
+
+    int cellsX() const { return nx; }
+    int cellsY() const { return ny; }
+    int tilesX() const { return tx; }
+    int tilesY() const { return ty; }
+    double originX() const { return ox; }
+    double originY() const { return oy; }
+    double cellSize() const { return cell; }
+    float stockTop() const { return top; }
+    float stockBottom() const { return bottom; }
+
+    // Center of cell (ix, iy) in machine coordinates.
+    double cellX(int ix) const { return ox + (ix + 0.5) * cell; }
+    double cellY(int iy) const { return oy + (iy + 0.5) * cell; }
+
+    float height(int ix, int iy) const;
+
+    // Cell storage of a tile, allocating it (filled with the stock top) on
+    // first use. Row-major, kTileSize x kTileSize.
+    float *tile(int tileX, int tileY);
+    const float *tileIfAllocated(int tileX, int tileY) const;
+
+    std::size_t allocatedTiles() const;
+    std::size_t footprintBytes() const;
+
+    // 16-bit binary PGM, stock bottom -> black, stock top -> white.
+    bool writePgm(const std::string &path) const;
+
+private:
+    double ox, oy, cell;
+    int nx, ny, tx, ty;
+    float top, bottom;
+    std::vector<std::unique_ptr<float[]>> tiles;
+};
+
+#endif // HEIGHTMAP_H
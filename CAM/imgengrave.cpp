@@ -0,0 +1,175 @@
+// Raster engraving of a grayscale image (see rasterengrave.h).
+//
+//   imgengrave <image.pgm> [--out FILE.nc|FILE.cnb] [--pixel MM] [--mode gray|threshold|ordered|fs]
+//              [--levels N] [--threshold D] [--invert] [--uni] [--no-skip] [--gap MM]
+//              [--overscan MM] [--feed F] [--dark-feed F] [--power S] [--min-power S]
+//              [--spindle] [--depth MM] [--safe-z MM] [--threads N] [--band ROWS]
+//
+// Streams a binary PGM (8 or 16 bits, e.g. a heightmap from gcodesim) into
+// a laser program (power S follows darkness under M4) or, with --spindle, a
+// relief cut whose depth follows darkness. Output is G-code, or with a
+// .cnb name (spindle only) a binary toolpath. Without --out only the
+// report is printed.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "binarytoolpath.h"
+#include "rasterengrave.h"
+#include "workstealingpool.h"
+
+namespace {
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s <image.pgm> [--out FILE.nc|FILE.cnb] [--pixel MM] [--mode gray|threshold|ordered|fs]\n"
+                 "          [--levels N] [--threshold D] [--invert] [--uni] [--no-skip] [--gap MM]\n"
+                 "          [--overscan MM] [--feed F] [--dark-feed F] [--power S] [--min-power S]\n"
+                 "          [--spindle] [--depth MM] [--safe-z MM] [--threads N] [--band ROWS]\n", argv0);
+}
+
+bool parseMode(const char *name, EngraveMode &mode)
+{
+    if (!std::strcmp(name, "gray"))
+        mode = EngraveMode::Grayscale;
+    else if (!std::strcmp(name, "threshold"))
+        mode = EngraveMode::Threshold;
+    else if (!std::strcmp(name, "ordered"))
+        mode = EngraveMode::Ordered;
+    else if (!std::strcmp(name, "fs"))
+        mode = EngraveMode::FloydSteinberg;
+    else
+        return false;
+    return true;
+}
+
+bool endsWith(const std::string &s, const char *suffix)
+{
+    const std::size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string input, output;
+    EngraveOptions options;
+    bool feedSet = false, darkFeedSet = false;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--out") && i + 1 < argc)
+            output = argv[++i];
+        else if (!std::strcmp(argv[i], "--pixel") && i + 1 < argc)
+            options.pixelSize = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--mode") && i + 1 < argc) {
+            if (!parseMode(argv[++i], options.mode)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (!std::strcmp(argv[i], "--levels") && i + 1 < argc)
+            options.levels = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threshold") && i + 1 < argc)
+            options.threshold = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--invert"))
+            options.invert = true;
+        else if (!std::strcmp(argv[i], "--uni"))
+            options.bidirectional = false;
+        else if (!std::strcmp(argv[i], "--no-skip"))
+            options.skipBlank = false;
+        else if (!std::strcmp(argv[i], "--gap") && i + 1 < argc)
+            options.blankGap = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--overscan") && i + 1 < argc)
+            options.overscan = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--feed") && i + 1 < argc) {
+            options.feed = std::atof(argv[++i]);
+            feedSet = true;
+        } else if (!std::strcmp(argv[i], "--dark-feed") && i + 1 < argc) {
+            options.darkFeed = std::atof(argv[++i]);
+            darkFeedSet = true;
+        } else if (!std::strcmp(argv[i], "--power") && i + 1 < argc)
+            options.maxPower = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--min-power") && i + 1 < argc)
+            options.minPower = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--spindle"))
+            options.spindle = true;
+        else if (!std::strcmp(argv[i], "--depth") && i + 1 < argc)
+            options.maxDepth = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--safe-z") && i + 1 < argc)
+            options.safeZ = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--band") && i + 1 < argc)
+            options.bandRows = std::atoi(argv[++i]);
+        else if (argv[i][0] != '-' && input.empty())
+            input = argv[i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input.empty() || options.pixelSize <= 0.0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (feedSet && !darkFeedSet)
+        options.darkFeed = options.feed;
+
+    PgmReader image;
+    if (!image.open(input)) {
+        std::fprintf(stderr, "%s\n", image.error().c_str());
+        return 1;
+    }
+
+    const bool binary = endsWith(output, ".cnb");
+    WorkStealingPool pool(threads);
+    RasterEngraver engraver(options, binary ? EngraveFormat::Segments : EngraveFormat::GCode, &pool);
+    BinaryToolpathWriter writer;
+    std::FILE *text = nullptr;
+    if (binary && !writer.open(output)) {
+        std::fprintf(stderr, "%s\n", writer.error().c_str());
+        return 1;
+    }
+    if (!binary && !output.empty()) {
+        text = std::fopen(output.c_str(), "w");
+        if (!text) {
+            std::fprintf(stderr, "cannot create %s\n", output.c_str());
+            return 1;
+        }
+        const std::string header = engraver.header();
+        std::fwrite(header.data(), 1, header.size(), text);
+    }
+
+    const bool ok = engraver.run(image, [&](EngraveBand &band) {
+        if (binary)
+            return writer.write(band.moves);
+        if (text)
+            return std::fwrite(band.gcode.data(), 1, band.gcode.size(), text) == band.gcode.size();
+        return true;
+    });
+    bool closed = true;
+    if (binary)
+        closed = writer.close();
+    if (text) {
+        const std::string footer = engraver.footer();
+        std::fwrite(footer.data(), 1, footer.size(), text);
+        closed = std::fclose(text) == 0;
+    }
+    if (!ok || !closed) {
+        const std::string &e = !engraver.error().empty() ? engraver.error() : writer.error();
+        std::fprintf(stderr, "%s\n", e.empty() ? "write failed" : e.c_str());
+        return 1;
+    }
+
+    const EngraveReport &r = engraver.report();
+    std::printf("image:    %d x %d px, %.1f x %.1f mm\n", r.width, r.height, r.width * options.pixelSize,
+                r.height * options.pixelSize);
+    std::printf("rows:     %ld engraved, %ld blank\n", r.rowsEngraved, r.rowsBlank);
+    std::printf("moves:    %ld G1, %ld G0\n", r.moves, r.rapids);
+    std::printf("burn:     %.1f mm, travel %.1f mm\n", r.burnLength, r.travel);
+    std::printf("output:   %zu bytes, peak memory %.1f MB\n", r.outputBytes, r.peakBytes / 1048576.0);
+    std::printf("time:     %.3f s, %d threads\n", r.seconds, pool.size());
+    return 0;
+}
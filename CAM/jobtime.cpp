@@ -0,0 +1,177 @@
+// Cycle-time quote for a G-code job or a wave program, without stepping.
+//
+//   jobtime <job.nc> [--vmax V] [--accel A] [--junction D]
+//           [--machine cartesian|rotary|hotwire] [--smooth TOL]
+//   jobtime --wave TICKS [--motors N] [--factor F] [--stroke L] [--step S]
+//           [--tick-ms MS] [--vmax V] [--accel A]
+//
+// The job may be text G-code or a binary toolpath (.cnb). Limits default
+// to the lead-screw gantry of Build_wave.md; --vmax/--accel override the
+// linear axes (mm/s, mm/s^2). With --machine the job is in program
+// coordinates and the limits apply to the machine's joints. --smooth fits
+// the feed moves with curves first (see pathsmoothing.h, TOL in mm) and
+// quotes those, slowed on tight curves.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "binarytoolpath.h"
+#include "cycletime.h"
+#include "gcodeparser.h"
+#include "kinematics.h"
+#include "pathsmoothing.h"
+#include "wavekernel.h"
+
+namespace {
+
+const char *const kAxisNames = "XYZAUV";
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s <job.nc> [--vmax V] [--accel A] [--junction D]\n"
+                 "          [--machine cartesian|rotary|hotwire] [--smooth TOL]\n"
+                 "       %s --wave TICKS [--motors N] [--factor F] [--stroke L] [--step S]\n"
+                 "          [--tick-ms MS] [--vmax V] [--accel A]\n", argv0, argv0);
+}
+
+void printDuration(const char *label, double seconds)
+{
+    const long whole = static_cast<long>(seconds);
+    std::printf("%-14s%.3f s  (%ld:%02ld:%02ld)\n", label, seconds, whole / 3600, whole / 60 % 60, whole % 60);
+}
+
+template <typename Reader>
+int runJob(const std::string &path, const MachineLimits &limits, const Kinematics *kinematics, double smoothTolerance)
+{
+    Reader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    CycleTimeEstimator estimator(limits, kinematics);
+    std::vector<MotionSegment> batch;
+    SmoothingOptions smoothing;
+    smoothing.tolerance = smoothTolerance;
+    PathSmoother smoother(smoothing);
+    std::vector<SmoothSegment> smooth;
+    while (reader.nextBatch(batch, CycleTimeEstimator::kBatchMoves)) {
+        if (smoothTolerance <= 0.0) {
+            estimator.add(batch);
+            continue;
+        }
+        smoother.add(batch, smooth);
+        estimator.add(smooth);
+        smooth.clear();
+    }
+    if (smoothTolerance > 0.0) {
+        smoother.finish(smooth);
+        estimator.add(smooth);
+    }
+    const CycleTimeReport r = estimator.finish();
+    auto t1 = std::chrono::steady_clock::now();
+    if (!reader.error().empty()) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+
+    printDuration("cycle time:", r.totalSeconds);
+    printDuration("  feed:", r.feedSeconds);
+    printDuration("  rapid:", r.rapidSeconds);
+    std::printf("moves:        %zu from %lld lines\n", r.segments, static_cast<long long>(reader.linesRead()));
+    if (smoothTolerance > 0.0)
+        std::printf("smoothed:     %zu moves into %zu segments\n", smoother.segmentsIn(), smoother.segmentsOut());
+    std::printf("axis  travel       peak v      duty\n");
+    for (int a = 0; a < kAxisCount; ++a) {
+        if (r.travel[a] == 0.0)
+            continue;
+        std::printf("%c     %-12.3f %-11.3f %.1f%%\n", kAxisNames[a], r.travel[a], r.peakVelocity[a],
+                    100.0 * r.duty(a));
+    }
+    std::printf("estimated in: %.3f s\n", std::chrono::duration<double>(t1 - t0).count());
+    return 0;
+}
+
+int runWave(long ticks, const WaveParams &params, double tickSeconds, const MachineLimits &limits)
+{
+    const WaveTimingReport r = estimateWaveProgram(params, ticks, tickSeconds, limits.maxVelocity[AxisZ],
+                                                   limits.maxAccel[AxisZ]);
+    printDuration("nominal:", r.nominalSeconds);
+    printDuration("required:", r.requiredSeconds);
+    std::printf("time scale:   %.3f%s\n", r.timeScale, r.timeScale > 1.0 ? "  (motors cannot keep up)" : "");
+    std::printf("motor  peak v      peak a       duty\n");
+    for (int i = 0; i < params.numMotors; ++i)
+        std::printf("%-6d %-11.3f %-12.3f %.1f%%\n", i, r.peakVelocity[i], r.peakAccel[i], 100.0 * r.duty[i]);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    MachineLimits limits = MachineLimits::leadScrewGantry();
+    WaveParams params;
+    params.waveFactorValue = 1.0;
+    double tickSeconds = 0.05; // matches the 50 ms UI timer
+    long waveTicks = 0;
+    double smoothTolerance = 0.0;
+    std::string input;
+    std::unique_ptr<Kinematics> kinematics;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--vmax") && i + 1 < argc) {
+            const double v = std::atof(argv[++i]);
+            for (int a : {AxisX, AxisY, AxisZ, AxisU, AxisV})
+                limits.maxVelocity[a] = v;
+        } else if (!std::strcmp(argv[i], "--accel") && i + 1 < argc) {
+            const double acc = std::atof(argv[++i]);
+            for (int a : {AxisX, AxisY, AxisZ, AxisU, AxisV})
+                limits.maxAccel[a] = acc;
+        } else if (!std::strcmp(argv[i], "--junction") && i + 1 < argc)
+            limits.junctionDeviation = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--machine") && i + 1 < argc) {
+            kinematics = makeKinematics(argv[++i]);
+            if (!kinematics) {
+                std::fprintf(stderr, "unknown machine '%s'\n", argv[i]);
+                return 2;
+            }
+        } else if (!std::strcmp(argv[i], "--smooth") && i + 1 < argc)
+            smoothTolerance = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--wave") && i + 1 < argc)
+            waveTicks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            params.numMotors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--factor") && i + 1 < argc)
+            params.waveFactorValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--stroke") && i + 1 < argc)
+            params.strokeLengthValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--step") && i + 1 < argc)
+            params.step = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--tick-ms") && i + 1 < argc)
+            tickSeconds = std::atof(argv[++i]) / 1000.0;
+        else if (argv[i][0] != '-' && input.empty())
+            input = argv[i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (waveTicks > 0 ? params.numMotors < 1 || tickSeconds <= 0 : input.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (waveTicks > 0)
+        return runWave(waveTicks, params, tickSeconds, limits);
+    if (isBinaryToolpath(input))
+        return runJob<BinaryToolpathReader>(input, limits, kinematics.get(), smoothTolerance);
+    return runJob<GCodeReader>(input, limits, kinematics.get(), smoothTolerance);
+}
@@ -0,0 +1,480 @@
+#include "kinematics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kDegPerRad = 180.0 / M_PI;
+
+// Whole turns nearest to degrees. Rounds through an integer conversion:
+// nearbyint is a libm call unless the target has SSE4.1.
+inline double wholeTurns(double degrees)
+{
+    const double turns = degrees * (1.0 / 360.0);
+    return static_cast<double>(static_cast<long long>(turns + (turns < 0 ? -0.5 : 0.5)));
+}
+
+// Moves offset by whole turns so it is within half a turn of reference.
+inline double nearestTurn(double offset, double reference)
+{
+    return offset + 360.0 * wholeTurns(reference - offset);
+}
+
+// atan2(y, x) in radians without a libm call, so the loops that use it
+// vectorize: the octant is reduced to [0, 1], then to [-0.34, 0.66] by
+// atan(r) = pi/4 + atan((r - 1) / (r + 1)), and the Cephes rational
+// approximation takes it from there (within 1e-15 of std::atan2; at the
+// origin it returns 0 or pi).
+inline double polarAngle(double y, double x)
+{
+    const double ay = std::fabs(y), ax = std::fabs(x);
+    const double lo = ay < ax ? ay : ax, hi = ay < ax ? ax : ay;
+    const bool upper = lo > 0.66 * hi;
+    const double r = (upper ? lo - hi : lo) / (upper ? lo + hi : (hi > 0.0 ? hi : 1.0));
+    const double z = r * r;
+    const double p = (((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z
+                        - 7.500855792314704667340e1) * z
+                       - 1.228866684490136173410e2) * z
+                   - 6.485021904942025371773e1;
+    const double q = ((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z
+                       + 4.328810604912902668951e2) * z
+                      + 4.853903996359136964868e2) * z
+                   + 1.945506571482613964425e2;
+    double angle = r + r * z * p / q + (upper ? M_PI / 4 + 3.061616997868382943065e-17 : 0.0);
+    angle = ay > ax ? M_PI / 2 - angle : angle;
+    angle = x < 0.0 ? M_PI - angle : angle;
+    return y < 0.0 ? -angle : angle;
+}
+
+// Split count for a rotation of sweep radians at radius.
+inline int rotaryPieces(double sweep, double radius, double tolerance)
+{
+    // Sagitta bound: a chord of angle phi at radius r deviates by
+    // r (1 - cos(phi / 2)), so phi may be at most 2 acos(1 - tol / r). The
+    // radius also varies along a move, hence the 20% margin.
+    if (radius <= tolerance || sweep == 0.0)
+        return 1;
+    const double maxAngle = 2.0 * std::acos(1.0 - 0.8 * tolerance / radius);
+    return static_cast<int>(std::min(10000.0, std::max(1.0, std::ceil(sweep / maxAngle))));
+}
+
+// Unwraps the masked axes of joints[first, last) along the path: the
+// offset joint - program of each point is moved to within half a turn of
+// the previous point's, starting from *offset, which receives the last.
+void unwrapRange(unsigned mask, const PointBatch &program, PointBatch &joints, std::size_t first,
+                 std::size_t last, double *offset)
+{
+    for (int a = 0; a < kAxisCount; ++a) {
+        if (!(mask & (1u << a)))
+            continue;
+        // The turns between neighbours only depend on their raw offsets, so
+        // the only serial dependency is the running turn count.
+        const double *p = program.axis[a].data();
+        double *j = joints.axis[a].data();
+        double previous = offset[a];
+        double turns = 0.0;
+        for (std::size_t i = first; i < last; ++i) {
+            const double raw = j[i] - p[i];
+            turns += wholeTurns(previous - raw);
+            previous = raw;
+            j[i] = p[i] + (raw + 360.0 * turns);
+        }
+        if (last > first)
+            offset[a] = j[last - 1] - p[last - 1];
+    }
+}
+
+} // namespace
+
+void PointBatch::resize(std::size_t n)
+{
+    for (std::vector<double> &v : axis)
+        v.resize(n);
+}
+
+void PointBatch::set(std::size_t i, const AxisPoint &p)
+{
+    for (int a = 0; a < kAxisCount; ++a)
+        axis[a][i] = p[a];
+}
+
+AxisPoint PointBatch::get(std::size_t i) const
+{
+    AxisPoint p;
+    for (int a = 0; a < kAxisCount; ++a)
+        p[a] = axis[a][i];
+    return p;
+}
+
+int Kinematics::subdivisions(const AxisPoint &, const AxisPoint &, const AxisPoint &, const AxisPoint &,
+                             double) const
+{
+    return 1;
+}
+
+void Kinematics::subdivisions(const PointBatch &program, const PointBatch &joints, const std::size_t *startIndex,
+                              std::size_t count, double tolerance, int *pieces) const
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t k = startIndex[i];
+        pieces[i] = subdivisions(program.get(k), program.get(k + 1), joints.get(k), joints.get(k + 1), tolerance);
+    }
+}
+
+void Kinematics::interpolate(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0, const AxisPoint &,
+                             int pieces, AxisPoint *joints) const
+{
+    PointBatch program, out;
+    program.resize(pieces - 1);
+    for (int j = 1; j < pieces; ++j) {
+        const double t = double(j) / pieces;
+        for (int a = 0; a < kAxisCount; ++a)
+            program.axis[a][j - 1] = p0[a] + (p1[a] - p0[a]) * t;
+    }
+    inverse(program, out);
+    AxisPoint offset;
+    for (int a = 0; a < kAxisCount; ++a)
+        offset[a] = j0[a] - p0[a];
+    unwrapRange(wrappedAxes(), program, out, 0, program.size(), offset.data());
+    for (int j = 1; j < pieces; ++j)
+        joints[j - 1] = out.get(j - 1);
+}
+
+// ---------------------------------------------------------------------------
+
+void CartesianKinematics::inverse(const PointBatch &program, PointBatch &joints) const
+{
+    joints = program;
+}
+
+void CartesianKinematics::forward(const PointBatch &joints, PointBatch &program) const
+{
+    program = joints;
+}
+
+// ---------------------------------------------------------------------------
+
+void RotaryKinematics::inverse(const PointBatch &program, PointBatch &joints) const
+{
+    const std::size_t n = program.size();
+    joints.resize(n);
+    const double *y = program.axis[AxisY].data();
+    const double *z = program.axis[AxisZ].data();
+    const double *a = program.axis[AxisA].data();
+    double *jy = joints.axis[AxisY].data();
+    double *jz = joints.axis[AxisZ].data();
+    double *ja = joints.axis[AxisA].data();
+    for (std::size_t i = 0; i < n; ++i) {
+        jy[i] = 0.0;
+        jz[i] = std::sqrt(y[i] * y[i] + z[i] * z[i]);
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        ja[i] = a[i] + polarAngle(y[i], z[i]) * kDegPerRad;
+    for (int axis : {AxisX, AxisU, AxisV})
+        std::copy(program.axis[axis].begin(), program.axis[axis].end(), joints.axis[axis].begin());
+}
+
+void RotaryKinematics::forward(const PointBatch &joints, PointBatch &program) const
+{
+    // Joint Y is the tool's offset across the axis; the part frame has A = 0.
+    const std::size_t n = joints.size();
+    program.resize(n);
+    const double *jy = joints.axis[AxisY].data();
+    const double *jz = joints.axis[AxisZ].data();
+    const double *ja = joints.axis[AxisA].data();
+    double *y = program.axis[AxisY].data();
+    double *z = program.axis[AxisZ].data();
+    double *a = program.axis[AxisA].data();
+    for (std::size_t i = 0; i < n; ++i) {
+        const double s = std::sin(ja[i] / kDegPerRad), c = std::cos(ja[i] / kDegPerRad);
+        y[i] = jz[i] * s + jy[i] * c;
+        z[i] = jz[i] * c - jy[i] * s;
+        a[i] = 0.0;
+    }
+    for (int axis : {AxisX, AxisU, AxisV})
+        std::copy(joints.axis[axis].begin(), joints.axis[axis].end(), program.axis[axis].begin());
+}
+
+int RotaryKinematics::subdivisions(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0,
+                                   const AxisPoint &j1, double tolerance) const
+{
+    const double sweep = std::fabs((j1[AxisA] - p1[AxisA]) - (j0[AxisA] - p0[AxisA])) / kDegPerRad;
+    return rotaryPieces(sweep, std::max(j0[AxisZ], j1[AxisZ]), tolerance);
+}
+
+void RotaryKinematics::subdivisions(const PointBatch &program, const PointBatch &joints,
+                                    const std::size_t *startIndex, std::size_t count, double tolerance,
+                                    int *pieces) const
+{
+    // Straight from the arrays. r (1 - cos(phi / 2)) <= r phi^2 / 8, so a
+    // move whose sweep passes that bound needs no split: nearly all of them,
+    // and they skip the acos.
+    const double *pa = program.axis[AxisA].data();
+    const double *ja = joints.axis[AxisA].data();
+    const double *jz = joints.axis[AxisZ].data();
+    const double quickBound = 6.4 * tolerance * kDegPerRad * kDegPerRad;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t k = startIndex[i];
+        const double sweep = std::fabs((ja[k + 1] - pa[k + 1]) - (ja[k] - pa[k]));
+        const double radius = std::max(jz[k], jz[k + 1]);
+        pieces[i] = sweep * sweep * radius <= quickBound ? 1 : rotaryPieces(sweep / kDegPerRad, radius, tolerance);
+    }
+}
+
+void RotaryKinematics::interpolate(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0,
+                                   const AxisPoint &, int pieces, AxisPoint *joints) const
+{
+    double ref = j0[AxisA] - p0[AxisA];
+    for (int j = 1; j < pieces; ++j) {
+        const double t = double(j) / pieces;
+        AxisPoint &q = joints[j - 1];
+        for (int a = 0; a < kAxisCount; ++a)
+            q[a] = p0[a] + (p1[a] - p0[a]) * t;
+        const double y = q[AxisY], z = q[AxisZ];
+        ref = nearestTurn(polarAngle(y, z) * kDegPerRad, ref);
+        q[AxisY] = 0.0;
+        q[AxisZ] = std::sqrt(y * y + z * z);
+        q[AxisA] += ref;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+HotWireKinematics::HotWireKinematics(double span, double rootPlane, double tipPlane)
+    : wireSpan(span), root(rootPlane), tip(tipPlane)
+{
+}
+
+void HotWireKinematics::inverse(const PointBatch &program, PointBatch &joints) const
+{
+    // The wire is the line through the root point (X, Y) at z = root and the
+    // tip point (U, V) at z = tip, extended to the towers at 0 and span.
+    const std::size_t n = program.size();
+    joints.resize(n);
+    const double kLeft = -root / (tip - root);
+    const double kRight = (wireSpan - root) / (tip - root);
+    const double *x = program.axis[AxisX].data();
+    const double *y = program.axis[AxisY].data();
+    const double *u = program.axis[AxisU].data();
+    const double *v = program.axis[AxisV].data();
+    double *jx = joints.axis[AxisX].data();
+    double *jy = joints.axis[AxisY].data();
+    double *ju = joints.axis[AxisU].data();
+    double *jv = joints.axis[AxisV].data();
+    // One loop per plane: with all four axes in one, the alias checks the
+    // vectorizer needs between the eight arrays are too many for it.
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dx = u[i] - x[i];
+        jx[i] = x[i] + dx * kLeft;
+        ju[i] = x[i] + dx * kRight;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dy = v[i] - y[i];
+        jy[i] = y[i] + dy * kLeft;
+        jv[i] = y[i] + dy * kRight;
+    }
+    for (int axis : {AxisZ, AxisA})
+        std::copy(program.axis[axis].begin(), program.axis[axis].end(), joints.axis[axis].begin());
+}
+
+void HotWireKinematics::forward(const PointBatch &joints, PointBatch &program) const
+{
+    const std::size_t n = joints.size();
+    program.resize(n);
+    const double kRoot = root / wireSpan, kTip = tip / wireSpan;
+    const double *jx = joints.axis[AxisX].data();
+    const double *jy = joints.axis[AxisY].data();
+    const double *ju = joints.axis[AxisU].data();
+    const double *jv = joints.axis[AxisV].data();
+    double *x = program.axis[AxisX].data();
+    double *y = program.axis[AxisY].data();
+    double *u = program.axis[AxisU].data();
+    double *v = program.axis[AxisV].data();
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dx = ju[i] - jx[i];
+        x[i] = jx[i] + dx * kRoot;
+        u[i] = jx[i] + dx * kTip;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dy = jv[i] - jy[i];
+        y[i] = jy[i] + dy * kRoot;
+        v[i] = jy[i] + dy * kTip;
+    }
+    for (int axis : {AxisZ, AxisA})
+        std::copy(joints.axis[axis].begin(), joints.axis[axis].end(), program.axis[axis].begin());
+}
+
+std::unique_ptr<Kinematics> makeKinematics(const std::string &name)
+{
+    if (name == "cartesian")
+        return std::make_unique<CartesianKinematics>();
+    if (name == "rotary")
+        return std::make_unique<RotaryKinematics>();
+    if (name == "hotwire")
+        return std::make_unique<HotWireKinematics>();
+    return nullptr;
+}
+
+// ---------------------------------------------------------------------------
+
+KinematicsStream::KinematicsStream(const Kinematics &kinematics, double tolerance)
+    : kin(kinematics), tolerance(tolerance > 0 ? tolerance : 0.01)
+{
+}
+
+const std::vector<MotionSegment> &KinematicsStream::apply(const std::vector<MotionSegment> &in)
+{
+    countIn += in.size();
+    if (kin.identity()) {
+        countOut += in.size();
+        return in;
+    }
+    out.clear();
+    if (in.empty())
+        return out;
+    transform(in.data(), in.size());
+    if (kin.linear())
+        emitLinear(in.data(), in.size());
+    else
+        emitSubdivided(in.data(), in.size());
+    countOut += out.size();
+    return out;
+}
+
+const PointBatch &KinematicsStream::applyDeltas(const MotionSegment *in, std::size_t n)
+{
+    countIn += n;
+    deltas.resize(n);
+    source.resize(n);
+    if (kin.identity() || n == 0) {
+        countOut += n;
+        for (std::size_t i = 0; i < n; ++i) {
+            for (int a = 0; a < kAxisCount; ++a)
+                deltas.axis[a][i] = in[i].end[a] - in[i].start[a];
+            source[i] = i;
+        }
+        return deltas;
+    }
+
+    transform(in, n);
+    split(n);
+    std::size_t total = n;
+    for (std::size_t i = 0; i < n; ++i)
+        total += pieces[i] - 1;
+    countOut += total;
+    deltas.resize(total);
+    source.resize(total);
+    std::size_t o = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t k = startIndex[i];
+        if (pieces[i] == 1) {
+            for (int a = 0; a < kAxisCount; ++a)
+                deltas.axis[a][o] = joints.axis[a][k + 1] - joints.axis[a][k];
+            source[o++] = i;
+            continue;
+        }
+        const AxisPoint j0 = joints.get(k), j1 = joints.get(k + 1);
+        interior.resize(pieces[i] - 1);
+        kin.interpolate(in[i].start, in[i].end, j0, j1, pieces[i], interior.data());
+        for (int j = 0; j < pieces[i]; ++j, ++o) {
+            const AxisPoint &from = j == 0 ? j0 : interior[j - 1];
+            const AxisPoint &to = j + 1 < pieces[i] ? interior[j] : j1;
+            for (int a = 0; a < kAxisCount; ++a)
+                deltas.axis[a][o] = to[a] - from[a];
+            source[o] = i;
+        }
+    }
+    return deltas;
+}
+
+void KinematicsStream::transform(const MotionSegment *in, std::size_t n)
+{
+    // Gather the path's points: each segment's end, plus its start when it
+    // does not continue the previous segment (first of a batch, G92).
+    program.resize(2 * n);
+    startIndex.resize(n);
+    std::size_t m = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i == 0 || in[i].start != in[i - 1].end)
+            program.set(m++, in[i].start);
+        startIndex[i] = m - 1;
+        program.set(m++, in[i].end);
+    }
+    program.resize(m);
+
+    kin.inverse(program, joints);
+
+    const unsigned wrapped = kin.wrappedAxes();
+    if (wrapped) {
+        if (!haveLast) {
+            for (int a = 0; a < kAxisCount; ++a)
+                lastOffset[a] = joints.axis[a][0] - program.axis[a][0];
+        }
+        unwrapRange(wrapped, program, joints, 0, m, lastOffset.data());
+        haveLast = true;
+    }
+}
+
+void KinematicsStream::split(std::size_t n)
+{
+    // Split counts for the whole batch from the transformed endpoints.
+    pieces.resize(n);
+    if (kin.linear())
+        std::fill(pieces.begin(), pieces.end(), 1);
+    else
+        kin.subdivisions(program, joints, startIndex.data(), n, tolerance, pieces.data());
+}
+
+void KinematicsStream::emitLinear(const MotionSegment *in, std::size_t n)
+{
+    out.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        MotionSegment &s = out[i];
+        const std::size_t k = startIndex[i];
+        for (int a = 0; a < kAxisCount; ++a) {
+            s.start[a] = joints.axis[a][k];
+            s.end[a] = joints.axis[a][k + 1];
+        }
+        s.feed = in[i].feed;
+        s.rapid = in[i].rapid;
+        s.line = in[i].line;
+    }
+}
+
+void KinematicsStream::emitSubdivided(const MotionSegment *in, std::size_t n)
+{
+    split(n);
+    std::size_t total = n;
+    for (std::size_t i = 0; i < n; ++i)
+        total += pieces[i] - 1;
+
+    out.resize(total);
+    std::size_t o = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t k = startIndex[i];
+        const MotionSegment &move = in[i];
+        if (pieces[i] == 1) {
+            MotionSegment &s = out[o++];
+            for (int a = 0; a < kAxisCount; ++a) {
+                s.start[a] = joints.axis[a][k];
+                s.end[a] = joints.axis[a][k + 1];
+            }
+            s.feed = move.feed;
+            s.rapid = move.rapid;
+            s.line = move.line;
+            continue;
+        }
+        const AxisPoint j0 = joints.get(k), j1 = joints.get(k + 1);
+        interior.resize(pieces[i] - 1);
+        kin.interpolate(move.start, move.end, j0, j1, pieces[i], interior.data());
+        for (int j = 0; j < pieces[i]; ++j, ++o) {
+            MotionSegment &s = out[o];
+            s.start = j == 0 ? j0 : interior[j - 1];
+            s.end = j + 1 < pieces[i] ? interior[j] : j1;
+            s.feed = move.feed;
+            s.rapid = move.rapid;
+            s.line = move.line;
+        }
+    }
+}
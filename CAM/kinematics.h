@@ -0,0 +1,173 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "toolpath.h"
+
+// Points in struct-of-arrays form: one array per axis, so a kinematic
+// transform is a plain loop over points that the compiler vectorizes.
+struct PointBatch
+{
+    std::array<std::vector<double>, kAxisCount> axis;
+
+    std::size_t size() const { return axis[0].size(); }
+    void resize(std::size_t n);
+    void set(std::size_t i, const AxisPoint &p);
+    AxisPoint get(std::size_t i) const;
+};
+
+// Maps program coordinates (what the CAM output describes) to joint
+// coordinates (what the motors move) and back, a batch at a time.
+class Kinematics
+{
+public:
+    virtual ~Kinematics() = default;
+
+    virtual const char *name() const = 0;
+
+    // program -> joints and joints -> program. in and out may not alias.
+    virtual void inverse(const PointBatch &program, PointBatch &joints) const = 0;
+    virtual void forward(const PointBatch &joints, PointBatch &program) const = 0;
+
+    // Joints are the program coordinates; segments pass through untouched.
+    virtual bool identity() const { return false; }
+
+    // inverse() is a linear map: straight program moves stay straight and
+    // move displacements transform like points.
+    virtual bool linear() const { return true; }
+
+    // Joint axes that inverse() only returns modulo 360 degrees, relative to
+    // the program value of the same axis. KinematicsStream unwraps them so
+    // the joint path is continuous.
+    virtual unsigned wrappedAxes() const { return 0; }
+
+    // Pieces a program move must be split into so the straight joint move
+    // between each pair stays within tolerance of the true path. Only asked
+    // for non-linear machines; j0/j1 are the unwrapped joint endpoints.
+    virtual int subdivisions(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0,
+                             const AxisPoint &j1, double tolerance) const;
+
+    // The same for count moves at once: move i runs from point startIndex[i]
+    // to the next one of program/joints. The default asks subdivisions().
+    virtual void subdivisions(const PointBatch &program, const PointBatch &joints, const std::size_t *startIndex,
+                              std::size_t count, double tolerance, int *pieces) const;
+
+    // The pieces - 1 joint points between j0 and j1 that split a program
+    // move into pieces, continuing from j0 on wrapped axes. The default
+    // transforms equally spaced program points.
+    virtual void interpolate(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0, const AxisPoint &j1,
+                             int pieces, AxisPoint *joints) const;
+};
+
+// 3-axis (or more) gantry: every axis drives one motor directly.
+class CartesianKinematics : public Kinematics
+{
+public:
+    const char *name() const override { return "cartesian"; }
+    void inverse(const PointBatch &program, PointBatch &joints) const override;
+    void forward(const PointBatch &joints, PointBatch &program) const override;
+    bool identity() const override { return true; }
+};
+
+// Gantry with a rotary 4th axis along X. The program is in the part frame
+// (X along the rotary axis, Y/Z across it, origin on the axis); the tool
+// stays over the axis (joint Y = 0) at height Z = radius while A turns the
+// part. A program A word adds to the rotation.
+class RotaryKinematics : public Kinematics
+{
+public:
+    const char *name() const override { return "rotary"; }
+    void inverse(const PointBatch &program, PointBatch &joints) const override;
+    void forward(const PointBatch &joints, PointBatch &program) const override;
+    bool linear() const override { return false; }
+    unsigned wrappedAxes() const override { return 1u << AxisA; }
+    int subdivisions(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0,
+                     const AxisPoint &j1, double tolerance) const override;
+    void subdivisions(const PointBatch &program, const PointBatch &joints, const std::size_t *startIndex,
+                      std::size_t count, double tolerance, int *pieces) const override;
+    // Equally spaced program points, transformed one at a time in place.
+    void interpolate(const AxisPoint &p0, const AxisPoint &p1, const AxisPoint &j0, const AxisPoint &j1, int pieces,
+                     AxisPoint *joints) const override;
+};
+
+// Four-axis hot-wire cutter: two independent XY gantries (towers) at the
+// ends of a wire of length span. The program gives the root profile in X/Y
+// at distance rootPlane from the left tower and the tip profile in U/V at
+// tipPlane; the towers move so the wire passes through both.
+class HotWireKinematics : public Kinematics
+{
+public:
+    HotWireKinematics(double span = 1000.0, double rootPlane = 100.0, double tipPlane = 900.0);
+
+    const char *name() const override { return "hotwire"; }
+    void inverse(const PointBatch &program, PointBatch &joints) const override;
+    void forward(const PointBatch &joints, PointBatch &program) const override;
+
+    double span() const { return wireSpan; }
+    double rootPlane() const { return root; }
+    double tipPlane() const { return tip; }
+
+private:
+    double wireSpan;
+    double root;
+    double tip;
+};
+
+// Creates kinematics by name ("cartesian", "rotary", "hotwire"); nullptr
+// for an unknown name.
+std::unique_ptr<Kinematics> makeKinematics(const std::string &name);
+
+// Applies kinematics to a segment stream batch by batch.
+//
+// Each batch gathers the distinct segment endpoints into a PointBatch and
+// transforms them in one vectorized call, unwraps rotary joints in a short
+// scalar pass, then splits moves of non-linear machines: split counts for
+// the whole batch in one call, interior points per split move. State
+// carries across batches so the joint path stays continuous. Feeds are
+// passed through unchanged and so apply to the joint-space path, as on
+// grbl-style controllers.
+class KinematicsStream
+{
+public:
+    explicit KinematicsStream(const Kinematics &kinematics, double tolerance = 0.01);
+
+    // Returns the joint-space moves for in, valid until the next call. For
+    // identity kinematics this is in itself.
+    const std::vector<MotionSegment> &apply(const std::vector<MotionSegment> &in);
+
+    // The same joint moves as displacements (end - start per axis), without
+    // building segments, for count moves at in; sources()[k] is the input
+    // move displacement k belongs to. Both valid until the next call.
+    const PointBatch &applyDeltas(const MotionSegment *in, std::size_t count);
+    const std::vector<std::size_t> &sources() const { return source; }
+
+    std::size_t movesIn() const { return countIn; }
+    std::size_t movesOut() const { return countOut; }
+
+private:
+    void transform(const MotionSegment *in, std::size_t n);
+    void split(std::size_t n);
+    void emitLinear(const MotionSegment *in, std::size_t n);
+    void emitSubdivided(const MotionSegment *in, std::size_t n);
+
+    const Kinematics &kin;
+    double tolerance;
+    PointBatch program, joints;
+    std::vector<std::size_t> startIndex; // point index of each segment start
+    std::vector<int> pieces;
+    std::vector<AxisPoint> interior;
+    PointBatch deltas;
+    std::vector<std::size_t> source;
+    std::vector<MotionSegment> out;
+    AxisPoint lastOffset{}; // joint - program of the last point, unwrapped
+    bool haveLast = false;
+    std::size_t countIn = 0;
+    std::size_t countOut = 0;
+};
+
+#endif // KINEMATICS_H
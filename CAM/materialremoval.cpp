@@ -0,0 +1,196 @@
+#include "materialremoval.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "workstealingpool.h"
+
+namespace {
+
+constexpr double kNoCut = std::numeric_limits<double>::infinity();
+
+} // namespace
+
+MaterialRemovalSim::MaterialRemovalSim(HeightMap &stock, const CutterTool &tool, WorkStealingPool *pool)
+    : stock(stock),
+      tool(tool),
+      pool(pool),
+      radius(tool.diameter / 2),
+      bins(static_cast<std::size_t>(stock.tilesX()) * stock.tilesY())
+{
+}
+
+void MaterialRemovalSim::prepare(const std::vector<MotionSegment> &moves)
+{
+    batch.resize(moves.size());
+    for (std::uint32_t &t : activeTiles)
+        bins[t].clear();
+    activeTiles.clear();
+
+    const double cell = stock.cellSize();
+    const int tileBits = HeightMap::kTileBits;
+    for (std::size_t k = 0; k < moves.size(); ++k) {
+        const MotionSegment &s = moves[k];
+        Move &m = batch[k];
+        m.x0 = s.start[AxisX];
+        m.y0 = s.start[AxisY];
+        m.z0 = s.start[AxisZ];
+        m.dx = s.end[AxisX] - m.x0;
+        m.dy = s.end[AxisY] - m.y0;
+        m.dz = s.end[AxisZ] - m.z0;
+        m.lenSq = m.dx * m.dx + m.dy * m.dy;
+        m.invLenSq = m.lenSq > 1e-18 ? 1.0 / m.lenSq : 0.0;
+
+        // Moves entirely above the stock cannot cut.
+        if (std::min(m.z0, m.z0 + m.dz) >= stock.stockTop()) {
+            m.cellX0 = 1;
+            m.cellX1 = 0;
+            continue;
+        }
+
+        const double minX = std::min(m.x0, m.x0 + m.dx) - radius;
+        const double maxX = std::max(m.x0, m.x0 + m.dx) + radius;
+        const double minY = std::min(m.y0, m.y0 + m.dy) - radius;
+        const double maxY = std::max(m.y0, m.y0 + m.dy) + radius;
+        m.cellX0 = std::max(0, static_cast<int>(std::floor((minX - stock.originX()) / cell - 0.5)));
+        m.cellX1 = std::min(stock.cellsX() - 1, static_cast<int>(std::ceil((maxX - stock.originX()) / cell - 0.5)));
+        m.cellY0 = std::max(0, static_cast<int>(std::floor((minY - stock.originY()) / cell - 0.5)));
+        m.cellY1 = std::min(stock.cellsY() - 1, static_cast<int>(std::ceil((maxY - stock.originY()) / cell - 0.5)));
+        if (m.cellX0 > m.cellX1 || m.cellY0 > m.cellY1)
+            continue;
+
+        for (int ty = m.cellY0 >> tileBits; ty <= m.cellY1 >> tileBits; ++ty) {
+            for (int tx = m.cellX0 >> tileBits; tx <= m.cellX1 >> tileBits; ++tx) {
+                const std::uint32_t t = static_cast<std::uint32_t>(ty * stock.tilesX() + tx);
+                if (bins[t].empty())
+                    activeTiles.push_back(t);
+                bins[t].push_back(static_cast<std::uint32_t>(k));
+            }
+        }
+    }
+    // Tile order fixes the floating-point summation order of the volumes.
+    std::sort(activeTiles.begin(), activeTiles.end());
+}
+
+double MaterialRemovalSim::flatBottom(const Move &m, double qx, double qy) const
+{
+    const double r2 = radius * radius;
+    const double q2 = qx * qx + qy * qy;
+    if (m.lenSq <= 1e-18)
+        return q2 <= r2 ? std::min(m.z0, m.z0 + m.dz) : kNoCut;
+
+    // Parameter range [s1, s2] where the cutter disk covers the cell.
+    const double proj = (qx * m.dx + qy * m.dy) * m.invLenSq;
+    const double perp2 = q2 - proj * proj * m.lenSq;
+    if (perp2 > r2)
+        return kNoCut;
+    const double half = std::sqrt((r2 - perp2) * m.invLenSq);
+    const double s1 = std::max(0.0, proj - half);
+    const double s2 = std::min(1.0, proj + half);
+    if (s1 > s2)
+        return kNoCut;
+    return m.z0 + m.dz * (m.dz >= 0 ? s1 : s2);
+}
+
+double MaterialRemovalSim::ballBottom(const Move &m, double qx, double qy) const
+{
+    const double r2 = radius * radius;
+    const double q2 = qx * qx + qy * qy;
+    if (m.lenSq <= 1e-18) {
+        if (q2 > r2)
+            return kNoCut;
+        return std::min(m.z0, m.z0 + m.dz) + radius - std::sqrt(r2 - q2);
+    }
+
+    const double proj = (qx * m.dx + qy * m.dy) * m.invLenSq;
+    const double perp2 = q2 - proj * proj * m.lenSq;
+    if (perp2 > r2)
+        return kNoCut;
+    const double half = std::sqrt((r2 - perp2) * m.invLenSq);
+    double lo = std::max(0.0, proj - half);
+    double hi = std::min(1.0, proj + half);
+    if (lo > hi)
+        return kNoCut;
+
+    // Height of the ball surface over the cell with the tip at parameter s.
+    auto bottomAt = [&](double s) {
+        const double ds = s - proj;
+        const double d2 = std::min(r2, perp2 + ds * ds * m.lenSq);
+        return m.z0 + m.dz * s + radius - std::sqrt(r2 - d2);
+    };
+
+    // With u the distance along the move from the closest approach, the
+    // surface is w*u - sqrt(rho^2 - u^2) + const (w = slope, rho^2 = r^2 -
+    // perp^2): convex, minimum at u = -w*rho / sqrt(1 + w^2). Clamping that
+    // to the covered interval gives the lowest point.
+    const double len = std::sqrt(m.lenSq);
+    const double w = m.dz / len;
+    const double rho = std::sqrt(r2 - perp2);
+    const double u = -w * rho / std::sqrt(1.0 + w * w);
+    return bottomAt(std::clamp(proj + u / len, lo, hi));
+}
+
+void MaterialRemovalSim::cutTile(std::size_t tileIndex, std::vector<std::pair<std::uint32_t, double>> &removed)
+{
+    removed.clear();
+    const int tx = static_cast<int>(tileIndex % stock.tilesX());
+    const int ty = static_cast<int>(tileIndex / stock.tilesX());
+    float *cells = stock.tile(tx, ty);
+    const int baseX = tx << HeightMap::kTileBits;
+    const int baseY = ty << HeightMap::kTileBits;
+    const float floorZ = stock.stockBottom();
+    const bool ball = tool.shape == CutterTool::BallEnd;
+
+    for (std::uint32_t k : bins[tileIndex]) {
+        const Move &m = batch[k];
+        const int x0 = std::max(m.cellX0, baseX);
+        const int x1 = std::min(m.cellX1, baseX + HeightMap::kTileSize - 1);
+        const int y0 = std::max(m.cellY0, baseY);
+        const int y1 = std::min(m.cellY1, baseY + HeightMap::kTileSize - 1);
+
+        double removedHeight = 0.0;
+        for (int iy = y0; iy <= y1; ++iy) {
+            const double qy = stock.cellY(iy) - m.y0;
+            float *row = cells + (iy - baseY) * HeightMap::kTileSize;
+            for (int ix = x0; ix <= x1; ++ix) {
+                const double qx = stock.cellX(ix) - m.x0;
+                const double z = ball ? ballBottom(m, qx, qy) : flatBottom(m, qx, qy);
+                const float newZ = std::max(floorZ, static_cast<float>(z));
+                float &h = row[ix - baseX];
+                if (newZ < h) {
+                    removedHeight += h - newZ;
+                    h = newZ;
+                }
+            }
+        }
+        if (removedHeight > 0.0)
+            removed.emplace_back(k, removedHeight * stock.cellSize() * stock.cellSize());
+    }
+}
+
+void MaterialRemovalSim::run(const std::vector<MotionSegment> &moves, std::vector<double> &volumes)
+{
+    prepare(moves);
+    tileRemoved.resize(std::max(tileRemoved.size(), activeTiles.size()));
+
+    auto work = [this](std::size_t i, int) { cutTile(activeTiles[i], tileRemoved[i]); };
+    if (pool)
+        pool->parallelFor(activeTiles.size(), work);
+    else
+        for (std::size_t i = 0; i < activeTiles.size(); ++i)
+            work(i, 0);
+
+    const std::size_t first = volumes.size();
+    volumes.resize(first + moves.size(), 0.0);
+    for (std::size_t i = 0; i < activeTiles.size(); ++i) {
+        for (const auto &[k, v] : tileRemoved[i])
+            volumes[first + k] += v;
+    }
+    for (std::size_t k = 0; k < moves.size(); ++k) {
+        total += volumes[first + k];
+        if (moves[k].rapid && volumes[first + k] > 0.0)
+            ++collisions;
+    }
+    moveCount += moves.size();
+}
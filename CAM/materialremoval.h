@@ -0,0 +1,78 @@
+#ifndef MATERIALREMOVAL_H
+#define MATERIALREMOVAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "heightmap.h"
+#include "toolpath.h"
+
+class WorkStealingPool;
+
+struct CutterTool
+{
+    enum Shape
+    {
+        FlatEnd,
+        BallEnd
+    };
+
+    Shape shape = FlatEnd;
+    double diameter = 3.175;
+};
+
+// Sweeps a cutter along straight moves through a HeightMap, lowering every
+// cell the tool passes over and measuring the volume each move removes.
+//
+// Moves are binned by heightmap tile; each tile is then processed by one
+// worker, applying its moves in program order. Because a tile never sees
+// moves out of order, per-move volumes and the final surface are identical
+// for any thread count.
+class MaterialRemovalSim
+{
+public:
+    // pool may be null for a single-threaded run.
+    MaterialRemovalSim(HeightMap &stock, const CutterTool &tool, WorkStealingPool *pool = nullptr);
+
+    // Applies a batch of moves (call repeatedly to stream a long program)
+    // and appends one removed volume in mm^3 per move to volumes.
+    void run(const std::vector<MotionSegment> &moves, std::vector<double> &volumes);
+
+    double totalVolume() const { return total; }
+    std::size_t movesSimulated() const { return moveCount; }
+    // Rapid (G0) moves that removed material: the tool would crash.
+    std::size_t rapidCollisions() const { return collisions; }
+
+private:
+    struct Move
+    {
+        double x0, y0, z0;
+        double dx, dy, dz;
+        double lenSq;     // dx^2 + dy^2
+        double invLenSq;
+        int cellX0, cellX1, cellY0, cellY1; // covered cell range, inclusive
+    };
+
+    void prepare(const std::vector<MotionSegment> &moves);
+    void cutTile(std::size_t tileIndex, std::vector<std::pair<std::uint32_t, double>> &removed);
+    double flatBottom(const Move &m, double qx, double qy) const;
+    double ballBottom(const Move &m, double qx, double qy) const;
+
+    HeightMap &stock;
+    CutterTool tool;
+    WorkStealingPool *pool;
+    double radius;
+
+    std::vector<Move> batch;
+    std::vector<std::vector<std::uint32_t>> bins; // moves per tile
+    std::vector<std::uint32_t> activeTiles;
+    std::vector<std::vector<std::pair<std::uint32_t, double>>> tileRemoved;
+
+    double total = 0.0;
+    std::size_t moveCount = 0;
+    std::size_t collisions = 0;
+};
+
+#endif // MATERIALREMOVAL_H
@@ -0,0 +1,320 @@
+#include "pathsmoothing.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using Vec3 = std::array<double, 3>;
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Vertices fitted already are dropped from the run buffers in chunks.
+constexpr std::size_t kCompactAt = 4096;
+
+inline Vec3 operator+(const Vec3 &a, const Vec3 &b) { return {a[0] + b[0], a[1] + b[1], a[2] + b[2]}; }
+inline Vec3 operator-(const Vec3 &a, const Vec3 &b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+inline Vec3 operator*(const Vec3 &a, double s) { return {a[0] * s, a[1] * s, a[2] * s}; }
+inline double dot(const Vec3 &a, const Vec3 &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+inline double norm(const Vec3 &a) { return std::sqrt(dot(a, a)); }
+
+inline Vec3 unit(const Vec3 &a)
+{
+    const double n = norm(a);
+    return n > 0.0 ? a * (1.0 / n) : Vec3{0.0, 0.0, 0.0};
+}
+
+inline Vec3 xyz(const AxisPoint &p) { return {p[AxisX], p[AxisY], p[AxisZ]}; }
+
+inline AxisPoint withXyz(AxisPoint p, const Vec3 &v)
+{
+    p[AxisX] = v[0];
+    p[AxisY] = v[1];
+    p[AxisZ] = v[2];
+    return p;
+}
+
+struct Bezier
+{
+    Vec3 p0, p1, p2, p3;
+
+    Vec3 at(double t) const
+    {
+        const double s = 1.0 - t;
+        return p0 * (s * s * s) + p1 * (3 * s * s * t) + p2 * (3 * s * t * t) + p3 * (t * t * t);
+    }
+    Vec3 d1(double t) const
+    {
+        const double s = 1.0 - t;
+        return (p1 - p0) * (3 * s * s) + (p2 - p1) * (6 * s * t) + (p3 - p2) * (3 * t * t);
+    }
+    Vec3 d2(double t) const { return (p2 - p1 * 2.0 + p0) * (6 * (1.0 - t)) + (p3 - p2 * 2.0 + p1) * (6 * t); }
+};
+
+// Squared distance from p to the segment a-b.
+double segmentDistance2(const Vec3 &p, const Vec3 &a, const Vec3 &b)
+{
+    const Vec3 ab = b - a;
+    const double len2 = dot(ab, ab);
+    const double t = len2 > 0.0 ? std::clamp(dot(p - a, ab) / len2, 0.0, 1.0) : 0.0;
+    const Vec3 d = p - (a + ab * t);
+    return dot(d, d);
+}
+
+bool smoothable(const MotionSegment &m)
+{
+    return !m.rapid && m.start[AxisA] == m.end[AxisA] && m.start[AxisU] == m.end[AxisU]
+           && m.start[AxisV] == m.end[AxisV];
+}
+
+SmoothSegment straight(const AxisPoint &start, const AxisPoint &end, double feed, bool rapid, int sources,
+                       std::int64_t line)
+{
+    SmoothSegment s;
+    s.start = start;
+    s.end = end;
+    for (int a = 0; a < kAxisCount; ++a) {
+        s.control1[a] = start[a] + (end[a] - start[a]) / 3;
+        s.control2[a] = end[a] - (end[a] - start[a]) / 3;
+    }
+    s.feed = feed;
+    s.rapid = rapid;
+    s.sources = sources;
+    s.line = line;
+    return s;
+}
+
+} // namespace
+
+AxisPoint SmoothSegment::at(double t) const
+{
+    const double s = 1.0 - t;
+    const double b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+    AxisPoint p;
+    for (int a = 0; a < kAxisCount; ++a)
+        p[a] = start[a] * b0 + control1[a] * b1 + control2[a] * b2 + end[a] * b3;
+    return p;
+}
+
+PathSmoother::PathSmoother(const SmoothingOptions &options)
+    : opts(options), cornerCos(std::cos(options.cornerAngle * kPi / 180.0))
+{
+    opts.maxSpan = std::max(1, opts.maxSpan);
+}
+
+void PathSmoother::add(const std::vector<MotionSegment> &moves, std::vector<SmoothSegment> &out)
+{
+    for (const MotionSegment &m : moves)
+        addMove(m, out);
+}
+
+void PathSmoother::finish(std::vector<SmoothSegment> &out)
+{
+    fitPending(true, out);
+}
+
+void PathSmoother::emit(const SmoothSegment &segment, std::vector<SmoothSegment> &out)
+{
+    out.push_back(segment);
+    ++movesOut;
+}
+
+void PathSmoother::addMove(const MotionSegment &move, std::vector<SmoothSegment> &out)
+{
+    ++movesIn;
+    if (!smoothable(move)) {
+        fitPending(true, out);
+        emit(straight(move.start, move.end, move.feed, move.rapid, 1 + carry, move.line), out);
+        carry = 0;
+        return;
+    }
+
+    const Vec3 a = xyz(move.start);
+    const Vec3 b = xyz(move.end);
+    const bool joins = !points.empty() && points.back() == a && move.feed == runFeed
+                       && move.start[AxisA] == runAxes[AxisA] && move.start[AxisU] == runAxes[AxisU]
+                       && move.start[AxisV] == runAxes[AxisV];
+    if (a == b) {
+        // Nothing to fit; it is counted with whatever comes next.
+        ++carry;
+        return;
+    }
+    if (joins && points.size() - head >= 2) {
+        const Vec3 d0 = points.back() - points[points.size() - 2];
+        const Vec3 d1 = b - a;
+        if (dot(d0, d1) < cornerCos * norm(d0) * norm(d1)) {
+            fitPending(true, out);
+            points.push_back(a);
+            sources.push_back(0);
+            lines.push_back(move.line);
+        }
+    } else if (!joins) {
+        fitPending(true, out);
+        runAxes = move.start;
+        runFeed = move.feed;
+        points.push_back(a);
+        sources.push_back(0);
+        lines.push_back(move.line);
+    }
+    points.push_back(b);
+    sources.push_back(1 + carry);
+    lines.push_back(move.line);
+    carry = 0;
+    if (points.size() - head > static_cast<std::size_t>(opts.maxSpan) + 1)
+        fitPending(false, out);
+}
+
+PathSmoother::Point PathSmoother::tangentAt(std::size_t i, bool final) const
+{
+    const Vec3 in = unit(points[i] - points[i - 1]);
+    if (final && i + 1 == points.size())
+        return in;
+    const Vec3 bisector = unit(in + unit(points[i + 1] - points[i]));
+    return norm(bisector) > 0.5 ? bisector : in;
+}
+
+bool PathSmoother::fit(std::size_t first, std::size_t last, const Point &t0, const Point &t1, Point &c1,
+                       Point &c2)
+{
+    const std::size_t n = last - first;
+    params.resize(n + 1);
+    params[0] = 0.0;
+    for (std::size_t i = 1; i <= n; ++i)
+        params[i] = params[i - 1] + norm(points[first + i] - points[first + i - 1]);
+    const double length = params[n];
+    for (std::size_t i = 1; i <= n; ++i)
+        params[i] /= length;
+
+    const double tol2 = opts.tolerance * opts.tolerance;
+    const Vec3 q0 = points[first];
+    const Vec3 q3 = points[last];
+    const Vec3 v2 = t1 * -1.0;
+    Bezier bz{q0, q0, q3, q3};
+    for (int pass = 0; pass < 3; ++pass) {
+        // Least-squares tangent lengths (Schneider, Graphics Gems I).
+        double c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0;
+        for (std::size_t i = 1; i < n; ++i) {
+            const double u = params[i], s = 1.0 - u;
+            const double b0 = s * s * s, b1 = 3 * s * s * u, b2 = 3 * s * u * u, b3 = u * u * u;
+            const Vec3 a1 = t0 * b1;
+            const Vec3 a2 = v2 * b2;
+            const Vec3 r = points[first + i] - (q0 * (b0 + b1) + q3 * (b2 + b3));
+            c00 += dot(a1, a1);
+            c01 += dot(a1, a2);
+            c11 += dot(a2, a2);
+            x0 += dot(a1, r);
+            x1 += dot(a2, r);
+        }
+        const double det = c00 * c11 - c01 * c01;
+        const double chord = norm(q3 - q0);
+        double alpha1 = chord / 3, alpha2 = chord / 3;
+        if (std::fabs(det) > 1e-12 * (c00 * c11 + 1e-300)) {
+            const double a1 = (x0 * c11 - x1 * c01) / det;
+            const double a2 = (c00 * x1 - c01 * x0) / det;
+            // Negative or vanishing lengths mean a cusp or loop; the chord
+            // heuristic is the safe fallback.
+            if (a1 > 1e-6 * length && a2 > 1e-6 * length && a1 < length && a2 < length) {
+                alpha1 = a1;
+                alpha2 = a2;
+            }
+        }
+        bz.p1 = q0 + t0 * alpha1;
+        bz.p2 = q3 + v2 * alpha2;
+
+        // Vertices against the curve (one Newton step towards the closest
+        // parameter, kept for the next pass), then the curve midway between
+        // vertices against the input segment there.
+        double worst = 0.0;
+        for (std::size_t i = 1; i < n && worst <= tol2; ++i) {
+            const Vec3 q = points[first + i];
+            double u = params[i];
+            const Vec3 d = bz.at(u) - q;
+            const Vec3 du = bz.d1(u);
+            const double f1 = dot(du, du) + dot(d, bz.d2(u));
+            if (f1 > 0.0)
+                u = std::clamp(u - dot(d, du) / f1, 0.0, 1.0);
+            params[i] = u;
+            const Vec3 e = bz.at(u) - q;
+            worst = std::max(worst, dot(e, e));
+        }
+        for (std::size_t i = 0; i < n && worst <= tol2; ++i) {
+            const Vec3 m = bz.at(0.5 * (params[i] + params[i + 1]));
+            worst = std::max(worst, segmentDistance2(m, points[first + i], points[first + i + 1]));
+        }
+        if (worst <= tol2) {
+            c1 = bz.p1;
+            c2 = bz.p2;
+            return true;
+        }
+        if (worst > 16 * tol2)
+            return false;
+    }
+    return false;
+}
+
+void PathSmoother::fitPending(bool final, std::vector<SmoothSegment> &out)
+{
+    const std::size_t span = static_cast<std::size_t>(opts.maxSpan);
+    while (head + 1 < points.size()) {
+        const std::size_t avail = points.size() - 1 - head;
+        if (!final && avail <= span)
+            break;
+        const std::size_t limit = std::min(span, avail);
+        const Vec3 t0 = haveStartTangent ? startTangent : unit(points[head + 1] - points[head]);
+
+        // Longest span that fits: double, then bisect. A single move always
+        // fits as its own line.
+        std::size_t good = 0;
+        std::size_t bad = limit + 1;
+        Vec3 c1, c2;
+        for (std::size_t k = 2;; k *= 2) {
+            const std::size_t kk = std::min(k, limit);
+            if (kk <= good)
+                break;
+            if (!fit(head, head + kk, t0, tangentAt(head + kk, final), c1, c2)) {
+                bad = kk;
+                break;
+            }
+            good = kk;
+        }
+        while (good > 0 && bad - good > 1) {
+            const std::size_t mid = (good + bad) / 2;
+            if (fit(head, head + mid, t0, tangentAt(head + mid, final), c1, c2))
+                good = mid;
+            else
+                bad = mid;
+        }
+
+        const std::size_t last = head + std::max<std::size_t>(good, 1);
+        int count = 0;
+        for (std::size_t i = head + 1; i <= last; ++i)
+            count += sources[i];
+        SmoothSegment s = straight(withXyz(runAxes, points[head]), withXyz(runAxes, points[last]), runFeed, false,
+                                   count, lines[head + 1]);
+        if (good > 0) {
+            // Successful fits only grow, so c1/c2 are those of span good.
+            s.control1 = withXyz(runAxes, c1);
+            s.control2 = withXyz(runAxes, c2);
+            s.curve = true;
+            startTangent = tangentAt(last, final);
+            haveStartTangent = true;
+        } else {
+            haveStartTangent = false;
+        }
+        emit(s, out);
+        head = last;
+    }
+
+    if (final) {
+        points.clear();
+        sources.clear();
+        lines.clear();
+        head = 0;
+        haveStartTangent = false;
+    } else if (head >= kCompactAt) {
+        points.erase(points.begin(), points.begin() + static_cast<std::ptrdiff_t>(head));
+        sources.erase(sources.begin(), sources.begin() + static_cast<std::ptrdiff_t>(head));
+        lines.erase(lines.begin(), lines.begin() + static_cast<std::ptrdiff_t>(head));
+        head = 0;
+    }
+}
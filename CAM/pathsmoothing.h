@@ -0,0 +1,95 @@
+#ifndef PATHSMOOTHING_H
+#define PATHSMOOTHING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "toolpath.h"
+
+// One move after smoothing: a cubic Bezier from start to end (one span of
+// a cubic B-spline with triple knots). Straight moves keep their line with
+// the control points at the thirds, so every output has the same shape.
+struct SmoothSegment
+{
+    AxisPoint start{};
+    AxisPoint control1{};
+    AxisPoint control2{};
+    AxisPoint end{};
+    double feed = 0.0;      // mm/min; ignored for rapids
+    bool rapid = false;     // G0
+    bool curve = false;     // fitted; false for a move passed through
+    int sources = 1;        // input moves this replaces
+    std::int64_t line = 0;  // source line of the first of them
+
+    // Point at t in [0, 1].
+    AxisPoint at(double t) const;
+};
+
+struct SmoothingOptions
+{
+    double tolerance = 0.01;   // mm, chord tolerance between input and curve
+    double cornerAngle = 30.0; // degrees of turn at a vertex that stays a sharp corner
+    int maxSpan = 256;         // most input moves fitted by one curve
+};
+
+// Streaming smoother for dense G1 output of surface CAM.
+//
+// Runs of feed moves with one feed rate, only X/Y/Z changing and no corner
+// sharper than cornerAngle are fitted with cubic Beziers in XYZ. Each curve
+// covers as many moves as it can (doubling, then bisection) while every
+// input vertex, and the curve midway between them, stays within tolerance
+// of the other path. Curves meet with a common tangent (the bisector of
+// the two input directions), so the output is G1 continuous inside a run.
+// The fit is Schneider's least-squares for the two tangent lengths with a
+// Newton reparametrization, O(moves) per attempt.
+//
+// Rapids and moves with A/U/V motion pass through as lines. A run is held
+// back only until maxSpan + 1 moves are pending, so memory stays bounded
+// and output trails input by at most that.
+class PathSmoother
+{
+public:
+    explicit PathSmoother(const SmoothingOptions &options = SmoothingOptions());
+
+    // Appends the smoothed form of moves (whatever of it is final) to out.
+    void add(const std::vector<MotionSegment> &moves, std::vector<SmoothSegment> &out);
+
+    // Fits what is still pending; the next add() starts afresh.
+    void finish(std::vector<SmoothSegment> &out);
+
+    std::size_t segmentsIn() const { return movesIn; }
+    std::size_t segmentsOut() const { return movesOut; }
+
+private:
+    using Point = std::array<double, 3>; // XYZ
+
+    void addMove(const MotionSegment &move, std::vector<SmoothSegment> &out);
+    void fitPending(bool final, std::vector<SmoothSegment> &out);
+    bool fit(std::size_t first, std::size_t last, const Point &startTangent, const Point &endTangent,
+             Point &control1, Point &control2);
+    Point tangentAt(std::size_t i, bool final) const;
+    void emit(const SmoothSegment &segment, std::vector<SmoothSegment> &out);
+
+    SmoothingOptions opts;
+    double cornerCos;
+
+    // The run being fitted: its vertices, and per vertex the input moves
+    // ending there and the source line of the first.
+    std::vector<Point> points;
+    std::vector<int> sources;
+    std::vector<std::int64_t> lines;
+    std::size_t head = 0;      // first vertex not yet fitted
+    AxisPoint runAxes{};       // A/U/V (and template) of the run
+    double runFeed = 0.0;
+    Point startTangent{0, 0, 0};
+    bool haveStartTangent = false;
+    int carry = 0;             // zero-length moves not yet accounted for
+
+    std::vector<double> params; // fit scratch
+    std::size_t movesIn = 0;
+    std::size_t movesOut = 0;
+};
+
+#endif // PATHSMOOTHING_H
@@ -0,0 +1,518 @@
+#include "rasterengrave.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "workstealingpool.h"
+
+namespace {
+
+// Threshold ranks of the 8 x 8 Bayer matrix.
+const std::uint8_t kBayer[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},   {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38},  {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},   {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37},  {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+bool readInt(std::FILE *f, int &value)
+{
+    int c = std::fgetc(f);
+    for (;;) {
+        while (c != EOF && std::strchr(" \t\r\n", c))
+            c = std::fgetc(f);
+        if (c != '#')
+            break;
+        while (c != EOF && c != '\n')
+            c = std::fgetc(f);
+    }
+    if (c < '0' || c > '9')
+        return false;
+    long v = 0;
+    while (c >= '0' && c <= '9' && v <= INT_MAX / 10) {
+        v = v * 10 + (c - '0');
+        c = std::fgetc(f);
+    }
+    value = static_cast<int>(v);
+    return c != EOF && std::strchr(" \t\r\n", c); // exactly one whitespace after the last field
+}
+
+// Appends v in mm with up to three decimals and no trailing zeros.
+void appendMm(std::string &s, double v)
+{
+    long long q = std::llround(v * 1000.0);
+    if (q < 0) {
+        s += '-';
+        q = -q;
+    }
+    char buf[24];
+    char *end = std::to_chars(buf, buf + sizeof buf, q / 1000).ptr;
+    int frac = static_cast<int>(q % 1000);
+    if (frac) {
+        *end++ = '.';
+        for (int d = 100; frac; d /= 10) {
+            *end++ = static_cast<char>('0' + frac / d);
+            frac %= d;
+        }
+    }
+    s.append(buf, end);
+}
+
+void appendInt(std::string &s, double v)
+{
+    char buf[24];
+    s.append(buf, std::to_chars(buf, buf + sizeof buf, std::llround(v)).ptr);
+}
+
+struct BandStats
+{
+    long rowsEngraved = 0;
+    long rowsBlank = 0;
+    long moves = 0;
+    long rapids = 0;
+    double burnLength = 0.0;
+    double travel = 0.0;
+    bool any = false;
+    double firstX = 0.0, firstY = 0.0; // target of the band's first rapid
+    AxisPoint last{};                  // where the band ends
+};
+
+// Writes moves as G-code or MotionSegments. The band does not know where
+// the previous one ended, so its first move prints every word (and its
+// first segment's start is filled in by the caller).
+class Emitter
+{
+public:
+    Emitter(EngraveFormat format, bool spindle, EngraveBand &band, BandStats &stats)
+        : format(format), spindle(spindle), band(band), stats(stats)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        pos = AxisPoint{};
+        pos[AxisX] = pos[AxisY] = pos[AxisZ] = nan;
+        printed.fill(nan);
+    }
+
+    const AxisPoint &position() const { return pos; }
+
+    void move(double x, double y, double z, bool rapid, double feed, double power, int row, bool burning)
+    {
+        if (x == pos[AxisX] && y == pos[AxisY] && z == pos[AxisZ])
+            return;
+        if (rapid) {
+            if (stats.any)
+                stats.travel += std::hypot(x - pos[AxisX], y - pos[AxisY]);
+            else {
+                stats.any = true;
+                stats.firstX = x;
+                stats.firstY = y;
+            }
+            ++stats.rapids;
+        } else {
+            ++stats.moves;
+            if (burning)
+                stats.burnLength += std::hypot(x - pos[AxisX], z - pos[AxisZ]);
+        }
+        AxisPoint end = pos;
+        end[AxisX] = x;
+        end[AxisY] = y;
+        end[AxisZ] = z;
+        if (format == EngraveFormat::Segments) {
+            MotionSegment m;
+            m.start = pos;
+            m.end = end;
+            m.feed = rapid ? 0.0 : feed;
+            m.rapid = rapid;
+            m.line = row + 1;
+            band.moves.push_back(m);
+        } else {
+            text(end, rapid, feed, power);
+        }
+        pos = end;
+    }
+
+private:
+    void word(char letter, double value, int axis)
+    {
+        if (!std::isnan(printed[axis]) && std::llround(value * 1000.0) == std::llround(printed[axis] * 1000.0))
+            return;
+        band.gcode += ' ';
+        band.gcode += letter;
+        appendMm(band.gcode, value);
+        printed[axis] = value;
+    }
+
+    void text(const AxisPoint &end, bool rapid, double feed, double power)
+    {
+        std::string &s = band.gcode;
+        const std::size_t mark = s.size();
+        if (gMode != (rapid ? 0 : 1)) {
+            s += rapid ? "G0" : "G1";
+            gMode = rapid ? 0 : 1;
+        }
+        const std::size_t words = s.size();
+        word('X', end[AxisX], AxisX);
+        word('Y', end[AxisY], AxisY);
+        if (spindle)
+            word('Z', end[AxisZ], AxisZ);
+        if (s.size() == words) { // nothing moves at this resolution
+            s.resize(mark);
+            return;
+        }
+        if (!rapid && std::llround(feed) != lastFeed) {
+            s += " F";
+            appendInt(s, feed);
+            lastFeed = std::llround(feed);
+        }
+        if (!rapid && !spindle && std::llround(power) != lastPower) {
+            s += " S";
+            appendInt(s, power);
+            lastPower = std::llround(power);
+        }
+        if (s[mark] == ' ')
+            s.erase(mark, 1);
+        s += '\n';
+    }
+
+    EngraveFormat format;
+    bool spindle;
+    EngraveBand &band;
+    BandStats &stats;
+    AxisPoint pos;
+    AxisPoint printed; // last value printed per axis word
+    int gMode = -1;
+    long long lastFeed = -1;
+    long long lastPower = -1;
+};
+
+struct Run
+{
+    int begin;
+    int end;
+    int level;
+};
+
+} // namespace
+
+PgmReader::~PgmReader()
+{
+    if (file)
+        std::fclose(file);
+}
+
+bool PgmReader::open(const std::string &path)
+{
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        err = "cannot open " + path;
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    char magic[2] = {};
+    if (std::fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '5') {
+        err = path + ": not a binary PGM (P5)";
+        return false;
+    }
+    if (!readInt(file, w) || !readInt(file, h) || !readInt(file, maxValue) || w <= 0 || h <= 0 || maxValue <= 0
+        || maxValue > 65535) {
+        err = path + ": bad PGM header";
+        return false;
+    }
+    rowsRead = 0;
+    return true;
+}
+
+int PgmReader::readRows(std::uint8_t *out, int count)
+{
+    if (!file)
+        return 0;
+    const int n = std::min(count, h - rowsRead);
+    if (n <= 0)
+        return 0;
+    const std::size_t pixels = static_cast<std::size_t>(w) * n;
+    std::size_t got;
+    if (maxValue < 256) {
+        got = std::fread(out, 1, pixels, file);
+        if (maxValue != 255)
+            for (std::size_t k = 0; k < got; ++k)
+                out[k] = static_cast<std::uint8_t>(std::min(255, out[k] * 255 / maxValue));
+    } else {
+        wide.resize(pixels * 2);
+        got = std::fread(wide.data(), 2, pixels, file);
+        for (std::size_t k = 0; k < got; ++k) {
+            const unsigned v = (wide[2 * k] << 8) | wide[2 * k + 1];
+            out[k] = static_cast<std::uint8_t>(std::min<unsigned>(255, (v * 255u + maxValue / 2) / maxValue));
+        }
+    }
+    const int rows = static_cast<int>(got / w);
+    rowsRead += rows;
+    if (rows < n)
+        err = "PGM truncated at row " + std::to_string(rowsRead);
+    return rows;
+}
+
+RasterEngraver::RasterEngraver(const EngraveOptions &options, EngraveFormat format, WorkStealingPool *pool)
+    : opt(options), format(format), pool(pool)
+{
+    opt.levels = std::clamp(opt.levels, 2, 256);
+    opt.bandRows = std::max(1, opt.bandRows);
+    if (opt.spindle)
+        opt.overscan = 0.0;
+}
+
+std::string RasterEngraver::header() const
+{
+    std::string s = "G21 G90\n";
+    if (opt.spindle) {
+        s += "G0 Z";
+        appendMm(s, opt.safeZ);
+        s += "\nM3\n";
+    } else {
+        s += "M4 S0\n";
+    }
+    return s;
+}
+
+std::string RasterEngraver::footer() const
+{
+    std::string s;
+    if (opt.spindle) {
+        s += "G0 Z";
+        appendMm(s, opt.safeZ);
+        s += '\n';
+    }
+    s += "M5\nG0 X0 Y0\n";
+    return s;
+}
+
+bool RasterEngraver::run(RasterSource &image, const std::function<bool(EngraveBand &)> &sink)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    rep = EngraveReport();
+    err.clear();
+    const int width = image.width(), height = image.height();
+    rep.width = width;
+    rep.height = height;
+    if (width <= 0 || height <= 0) {
+        err = image.error().empty() ? "empty image" : image.error();
+        return false;
+    }
+    if (format == EngraveFormat::Segments && !opt.spindle) {
+        err = "MotionSegments carry no laser power: write G-code, or engrave by depth with a spindle";
+        return false;
+    }
+
+    const int workers = pool ? pool->size() : 1;
+    const int bands = 2 * workers;
+    const int windowRows = bands * opt.bandRows;
+    const int levelCount = opt.mode == EngraveMode::Grayscale ? opt.levels : 2;
+    const int gapPixels = opt.skipBlank ? std::max(1, static_cast<int>(std::ceil(opt.blankGap / opt.pixelSize)))
+                                        : INT_MAX;
+    const int thresholdLevel = static_cast<int>(std::ceil(opt.threshold * 255.0));
+    std::vector<std::uint8_t> pixels(static_cast<std::size_t>(width) * windowRows);
+    std::vector<float> diffuse[2] = {std::vector<float>(width + 2, 0.0f), std::vector<float>(width + 2, 0.0f)};
+    std::vector<EngraveBand> out(bands);
+    std::vector<BandStats> stats(bands);
+    std::vector<std::vector<Run>> runs(workers);
+
+    // Quantizes one row in place: gray -> level 0 (off) .. levelCount - 1.
+    auto quantize = [&](std::uint8_t *row, int r) {
+        const int inv = opt.invert ? 0 : 255, sign = opt.invert ? 1 : -1;
+        switch (opt.mode) {
+        case EngraveMode::Grayscale:
+            for (int c = 0; c < width; ++c) {
+                const int d = inv + sign * row[c];
+                row[c] = static_cast<std::uint8_t>((d * (levelCount - 1) + 127) / 255);
+            }
+            break;
+        case EngraveMode::Threshold:
+            for (int c = 0; c < width; ++c)
+                row[c] = inv + sign * row[c] >= thresholdLevel;
+            break;
+        case EngraveMode::Ordered: {
+            int limit[8];
+            for (int k = 0; k < 8; ++k)
+                limit[k] = (2 * kBayer[r & 7][k] + 1) * 255 / 128;
+            for (int c = 0; c < width; ++c)
+                row[c] = inv + sign * row[c] > limit[c & 7];
+            break;
+        }
+        case EngraveMode::FloydSteinberg: {
+            float *cur = diffuse[r & 1].data() + 1, *next = diffuse[(r + 1) & 1].data() + 1;
+            std::fill(next - 1, next + width + 1, 0.0f);
+            for (int c = 0; c < width; ++c) {
+                const float v = static_cast<float>(inv + sign * row[c]) + cur[c];
+                const bool on = v >= 127.5f;
+                const float e = v - (on ? 255.0f : 0.0f);
+                cur[c + 1] += e * (7.0f / 16);
+                next[c - 1] += e * (3.0f / 16);
+                next[c] += e * (5.0f / 16);
+                next[c + 1] += e * (1.0f / 16);
+                row[c] = on;
+            }
+            break;
+        }
+        }
+    };
+
+    auto engraveBand = [&](std::size_t b, int worker, int firstRow, int rows) {
+        EngraveBand &band = out[b];
+        BandStats &st = stats[b];
+        band.firstRow = firstRow;
+        band.rows = rows;
+        band.gcode.clear();
+        band.moves.clear();
+        st = BandStats();
+        Emitter emit(format, opt.spindle, band, st);
+        std::vector<Run> &rowRuns = runs[worker];
+        const double p = opt.pixelSize;
+        auto power = [&](int level) {
+            return level ? opt.minPower + (opt.maxPower - opt.minPower) * level / (levelCount - 1) : 0.0;
+        };
+        auto feed = [&](int level) { return opt.feed + (opt.darkFeed - opt.feed) * level / (levelCount - 1); };
+        auto depth = [&](int level) { return -opt.maxDepth * level / (levelCount - 1); };
+
+        for (int k = 0; k < rows; ++k) {
+            const int r = firstRow + k;
+            std::uint8_t *row = pixels.data() + static_cast<std::size_t>(r % windowRows) * width;
+            if (opt.mode != EngraveMode::FloydSteinberg)
+                quantize(row, r);
+
+            // Runs of equal level; blank stretches are skipped 8 pixels at
+            // a time.
+            rowRuns.clear();
+            bool anyBurn = false;
+            for (int c = 0; c < width;) {
+                const int level = row[c];
+                int e = c + 1;
+                if (level == 0) {
+                    for (std::uint64_t word; e + 8 <= width && (std::memcpy(&word, row + e, 8), word == 0);)
+                        e += 8;
+                }
+                while (e < width && row[e] == level)
+                    ++e;
+                rowRuns.push_back({c, e, level});
+                anyBurn = anyBurn || level > 0;
+                c = e;
+            }
+            if (!anyBurn) {
+                ++st.rowsBlank;
+                continue;
+            }
+            ++st.rowsEngraved;
+
+            // Islands: burned runs joined by blank ones shorter than the
+            // gap, in scan order.
+            const bool forward = !opt.bidirectional || r % 2 == 0;
+            const double y = (height - r - 0.5) * p;
+            const int n = static_cast<int>(rowRuns.size());
+            const int step = forward ? 1 : -1;
+            int i = forward ? 0 : n - 1;
+            while (i >= 0 && i < n) {
+                if (rowRuns[i].level == 0) {
+                    i += step;
+                    continue;
+                }
+                int j = i; // last burned run of the island
+                for (int k2 = i + step; k2 >= 0 && k2 < n; k2 += step) {
+                    if (rowRuns[k2].level > 0)
+                        j = k2;
+                    else if (rowRuns[k2].end - rowRuns[k2].begin >= gapPixels)
+                        break;
+                }
+                const double xs = (forward ? rowRuns[i].begin : rowRuns[i].end) * p;
+                const double xe = (forward ? rowRuns[j].end : rowRuns[j].begin) * p;
+                const double lead = forward ? opt.overscan : -opt.overscan;
+                if (opt.spindle) {
+                    emit.move(xs, y, opt.safeZ, true, 0, 0, r, false);
+                } else {
+                    emit.move(xs - lead, y, 0.0, true, 0, 0, r, false);
+                    emit.move(xs, y, 0.0, false, feed(0), 0.0, r, false);
+                }
+                for (int k2 = i;; k2 += step) {
+                    const Run &run = rowRuns[k2];
+                    const double x = (forward ? run.end : run.begin) * p;
+                    if (opt.spindle) {
+                        const double z = depth(run.level);
+                        emit.move(emit.position()[AxisX], y, z, false, opt.plungeFeed, 0.0, r, run.level > 0);
+                        emit.move(x, y, z, false, feed(run.level), 0.0, r, run.level > 0);
+                    } else {
+                        emit.move(x, y, 0.0, false, feed(run.level), power(run.level), r, run.level > 0);
+                    }
+                    if (k2 == j)
+                        break;
+                }
+                if (opt.spindle)
+                    emit.move(xe, y, opt.safeZ, true, 0, 0, r, false);
+                else
+                    emit.move(xe + lead, y, 0.0, false, feed(0), 0.0, r, false);
+                i = j + step;
+            }
+        }
+        st.last = emit.position();
+    };
+
+    AxisPoint last{};
+    last[AxisZ] = opt.spindle ? opt.safeZ : 0.0;
+    for (int firstRow = 0; firstRow < height;) {
+        const int want = std::min(windowRows, height - firstRow);
+        int got = 0;
+        while (got < want) {
+            const int n = image.readRows(pixels.data() + static_cast<std::size_t>(got) * width, want - got);
+            if (n <= 0)
+                break;
+            got += n;
+        }
+        if (got < want) {
+            err = image.error().empty() ? "image ended early" : image.error();
+            return false;
+        }
+        if (opt.mode == EngraveMode::FloydSteinberg)
+            for (int k = 0; k < got; ++k)
+                quantize(pixels.data() + static_cast<std::size_t>(k) * width, firstRow + k);
+
+        const int nb = (got + opt.bandRows - 1) / opt.bandRows;
+        auto task = [&](std::size_t b, int worker) {
+            const int r0 = firstRow + static_cast<int>(b) * opt.bandRows;
+            engraveBand(b, worker, r0, std::min(opt.bandRows, firstRow + got - r0));
+        };
+        if (pool && nb > 1)
+            pool->parallelFor(nb, task);
+        else
+            for (int b = 0; b < nb; ++b)
+                task(b, 0);
+
+        std::size_t windowBytes = pixels.size();
+        for (int b = 0; b < nb; ++b)
+            windowBytes += out[b].gcode.capacity() + out[b].moves.capacity() * sizeof(MotionSegment);
+        rep.peakBytes = std::max(rep.peakBytes, windowBytes);
+        for (int b = 0; b < nb; ++b) {
+            const BandStats &st = stats[b];
+            rep.rowsEngraved += st.rowsEngraved;
+            rep.rowsBlank += st.rowsBlank;
+            rep.moves += st.moves;
+            rep.rapids += st.rapids;
+            rep.burnLength += st.burnLength;
+            rep.travel += st.travel;
+            if (!st.any)
+                continue;
+            rep.travel += std::hypot(st.firstX - last[AxisX], st.firstY - last[AxisY]);
+            if (!out[b].moves.empty())
+                out[b].moves.front().start = last;
+            last = st.last;
+            rep.outputBytes += format == EngraveFormat::GCode ? out[b].gcode.size()
+                                                              : out[b].moves.size() * sizeof(MotionSegment);
+            if (!sink(out[b])) {
+                err = "output failed";
+                return false;
+            }
+        }
+        firstRow += got;
+    }
+    rep.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
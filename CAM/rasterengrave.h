@@ -0,0 +1,158 @@
+#ifndef RASTERENGRAVE_H
+#define RASTERENGRAVE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "toolpath.h"
+
+class WorkStealingPool;
+
+// Grayscale image read a band of rows at a time, so images far larger than
+// memory (20k x 20k and up) stream through. Pixels are 8-bit, 0 black to
+// 255 white.
+class RasterSource
+{
+public:
+    virtual ~RasterSource() = default;
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    // Reads up to count rows of width() pixels into out; returns the rows
+    // read, 0 at the end of the image or on error.
+    virtual int readRows(std::uint8_t *out, int count) = 0;
+
+    virtual const std::string &error() const = 0;
+};
+
+// Binary PGM (P5), 8 or 16 bits; other maxvals are scaled to 0..255.
+class PgmReader : public RasterSource
+{
+public:
+    PgmReader() = default;
+    ~PgmReader() override;
+
+    PgmReader(const PgmReader &) = delete;
+    PgmReader &operator=(const PgmReader &) = delete;
+
+    bool open(const std::string &path);
+
+    int width() const override { return w; }
+    int height() const override { return h; }
+    int readRows(std::uint8_t *out, int count) override;
+    const std::string &error() const override { return err; }
+
+private:
+    std::FILE *file = nullptr;
+    int w = 0, h = 0, maxValue = 255;
+    int rowsRead = 0;
+    std::vector<std::uint8_t> wide; // 16-bit rows before scaling
+    std::string err;
+};
+
+enum class EngraveMode
+{
+    Grayscale,     // darkness quantized to `levels` power (or depth) levels
+    Threshold,     // on where darkness >= threshold
+    Ordered,       // 8 x 8 Bayer dither: on/off, parallel per band
+    FloydSteinberg // error diffusion: on/off, serial in reading order
+};
+
+enum class EngraveFormat
+{
+    GCode,    // text, modal words only when they change
+    Segments  // MotionSegments for BinaryToolpathWriter
+};
+
+struct EngraveOptions
+{
+    EngraveMode mode = EngraveMode::Grayscale;
+    double pixelSize = 0.1;    // mm per pixel, both axes
+    int levels = 64;           // grayscale steps, counting "off"
+    double threshold = 0.5;    // darkness 0..1 (Threshold)
+    bool invert = false;       // engrave the light pixels instead
+    bool bidirectional = true; // alternate rows scan right to left
+    bool skipBlank = true;     // cross blank stretches with G0
+    double blankGap = 2.0;     // mm: shorter blank stretches are burned through at zero power
+    double overscan = 1.0;     // mm of zero-power lead-in/out so the head is at speed (laser)
+
+    bool spindle = false;      // depth modulation with a spindle instead of laser power
+    double feed = 3000.0;      // mm/min for the lightest level
+    double darkFeed = 3000.0;  // and the darkest; equal: no feed modulation
+    double minPower = 0.0;     // S for the lightest level (laser, M4 dynamic power)
+    double maxPower = 1000.0;  // S for the darkest
+    double maxDepth = 0.3;     // mm below the surface for the darkest (spindle)
+    double safeZ = 2.0;        // rapid height (spindle)
+    double plungeFeed = 300.0; // mm/min for depth changes (spindle)
+
+    int bandRows = 32;         // rows per parallel work item
+};
+
+struct EngraveReport
+{
+    int width = 0;
+    int height = 0;
+    long rowsEngraved = 0;
+    long rowsBlank = 0;
+    long moves = 0;            // G1, lead-ins and depth steps included
+    long rapids = 0;
+    double burnLength = 0.0;   // mm moved with the laser on / below the surface
+    double travel = 0.0;       // mm of G0 in XY
+    std::size_t outputBytes = 0;  // G-code text, or MotionSegments in memory
+    std::size_t peakBytes = 0;    // largest pixel window plus its output at once
+    double seconds = 0.0;
+};
+
+// Rows r in [firstRow, firstRow + rows) of the image, as G-code text or
+// MotionSegments (line = image row + 1). Bands arrive in row order and
+// continue from where the previous one ended.
+struct EngraveBand
+{
+    int firstRow = 0;
+    int rows = 0;
+    std::string gcode;
+    std::vector<MotionSegment> moves;
+};
+
+// Raster engraving: every image row becomes a scan line at y = (height -
+// row - 0.5) * pixelSize, runs of equal level merge into one move, and
+// blank stretches of at least blankGap are crossed with G0 (rows with
+// nothing to engrave emit nothing). Laser: power S follows the level under
+// M4, with overscan at zero power around each burned stretch. Spindle: Z
+// follows the level from 0 to -maxDepth, rapids at safeZ.
+//
+// The image streams through a window of bands, two per pool worker: rows
+// are read (and Floyd-Steinberg dithered, which has to run in order) on the
+// calling thread, then every band of the window is quantized, scanned and
+// formatted on the pool and handed to the sink in order. Memory is bounded
+// by the window, not the image.
+class RasterEngraver
+{
+public:
+    RasterEngraver(const EngraveOptions &options, EngraveFormat format, WorkStealingPool *pool = nullptr);
+
+    // Returns false on a read error or when sink returns false, and for
+    // the Segments format without spindle (segments have no power channel).
+    bool run(RasterSource &image, const std::function<bool(EngraveBand &)> &sink);
+
+    const EngraveReport &report() const { return rep; }
+    const std::string &error() const { return err; }
+
+    // Program start and end for the G-code format (units, modes, spindle or
+    // laser on and off, return to the origin).
+    std::string header() const;
+    std::string footer() const;
+
+private:
+    EngraveOptions opt;
+    EngraveFormat format;
+    WorkStealingPool *pool;
+    EngraveReport rep;
+    std::string err;
+};
+
+#endif // RASTERENGRAVE_H
@@ -0,0 +1,33 @@
+#ifndef TOOLPATH_H
+#define TOOLPATH_H
+
+#include <array>
+#include <cstdint>
+
+// Machine axes understood by the toolpath code. X/Y/Z for gantries, A for a
+// rotary 4th axis, U/V for the second tower of a hot-wire cutter.
+enum Axis
+{
+    AxisX,
+    AxisY,
+    AxisZ,
+    AxisA,
+    AxisU,
+    AxisV,
+    kAxisCount
+};
+
+using AxisPoint = std::array<double, kAxisCount>;
+
+// One straight move, in mm (A in degrees). Arcs are split into these by the
+// parser, so everything downstream only sees lines.
+struct MotionSegment
+{
+    AxisPoint start{};
+    AxisPoint end{};
+    double feed = 0.0;      // mm/min; ignored for rapids
+    bool rapid = false;     // G0
+    std::int64_t line = 0;  // 1-based source line, for reports
+};
+
+#endif // TOOLPATH_H
@@ -0,0 +1,108 @@
+#include "heightmapwindow.h"
+
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QStatusBar>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gcodeparser.h"
+#include "workstealingpool.h"
+
+// Constructor: image area plus a status line
+HeightMapWindow::HeightMapWindow(QWidget *parent)
+    : QMainWindow(parent)
+{
+    imageLabel = new QLabel;
+    imageLabel->setAlignment(Qt::AlignCenter);
+
+    scrollArea = new QScrollArea;
+    scrollArea->setWidget(imageLabel);
+    scrollArea->setWidgetResizable(true);
+    setCentralWidget(scrollArea);
+
+    statusLabel = new QLabel("No job loaded");
+    statusBar()->addWidget(statusLabel);
+
+    setWindowTitle("Material Removal Preview");
+    resize(900, 700);
+}
+
+bool HeightMapWindow::loadJob(const QString &path, const CutterTool &tool, double cellSize)
+{
+    // First pass: stock bounds from the cutting moves
+    GCodeReader reader;
+    if (!reader.open(path.toStdString())) {
+        statusLabel->setText(QString::fromStdString(reader.error()));
+        return false;
+    }
+    const double r = tool.diameter / 2;
+    double x0 = 1e300, y0 = 1e300, x1 = -1e300, y1 = -1e300, zMin = 0.0;
+    std::vector<MotionSegment> batch;
+    while (reader.nextBatch(batch)) {
+        for (const MotionSegment &s : batch) {
+            if (s.rapid)
+                continue;
+            x0 = std::min({x0, s.start[AxisX] - r, s.end[AxisX] - r});
+            x1 = std::max({x1, s.start[AxisX] + r, s.end[AxisX] + r});
+            y0 = std::min({y0, s.start[AxisY] - r, s.end[AxisY] - r});
+            y1 = std::max({y1, s.start[AxisY] + r, s.end[AxisY] + r});
+            zMin = std::min({zMin, s.start[AxisZ], s.end[AxisZ]});
+        }
+    }
+    if (!reader.error().empty() || x0 >= x1 || y0 >= y1) {
+        statusLabel->setText(reader.error().empty() ? "No cutting moves in job"
+                                                    : QString::fromStdString(reader.error()));
+        return false;
+    }
+
+    // Second pass: simulate on all cores
+    HeightMap stock(x0, y0, x1 - x0, y1 - y0, cellSize, 0.0f, static_cast<float>(zMin));
+    WorkStealingPool pool;
+    MaterialRemovalSim sim(stock, tool, &pool);
+    GCodeReader job;
+    if (!job.open(path.toStdString())) {
+        statusLabel->setText(QString::fromStdString(job.error()));
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<double> volumes;
+    while (job.nextBatch(batch, 1 << 18)) {
+        volumes.clear();
+        sim.run(batch, volumes);
+    }
+
+    imageLabel->setPixmap(QPixmap::fromImage(renderShaded(stock)));
+    statusLabel->setText(QString("%1 moves, %2 mm^3 removed, %3 rapid cuts, %4 ms")
+                             .arg(sim.movesSimulated())
+                             .arg(sim.totalVolume(), 0, 'f', 1)
+                             .arg(sim.rapidCollisions())
+                             .arg(timer.elapsed()));
+    setWindowTitle("Material Removal Preview - " + path);
+    return true;
+}
+
+QImage HeightMapWindow::renderShaded(const HeightMap &stock) const
+{
+    const int w = stock.cellsX();
+    const int h = stock.cellsY();
+    const float range = std::max(1e-6f, stock.stockTop() - stock.stockBottom());
+    QImage image(w, h, QImage::Format_Grayscale8);
+
+    for (int iy = 0; iy < h; ++iy) {
+        uchar *line = image.scanLine(h - 1 - iy);  // +Y up
+        for (int ix = 0; ix < w; ++ix) {
+            // Height gives the base tone, the slope towards the light adds relief
+            const float z = stock.height(ix, iy);
+            const float dzx = stock.height(std::min(ix + 1, w - 1), iy) - stock.height(std::max(ix - 1, 0), iy);
+            const float dzy = stock.height(ix, std::min(iy + 1, h - 1)) - stock.height(ix, std::max(iy - 1, 0));
+            const float slope = (dzx + dzy) / static_cast<float>(4 * stock.cellSize());
+            const float tone = 0.35f + 0.45f * (z - stock.stockBottom()) / range + 0.2f * std::tanh(slope);
+            line[ix] = static_cast<uchar>(std::clamp(tone, 0.0f, 1.0f) * 255.0f);
+        }
+    }
+    return image;
+}
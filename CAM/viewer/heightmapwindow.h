@@ -0,0 +1,34 @@
+#ifndef HEIGHTMAPWINDOW_H
+#define HEIGHTMAPWINDOW_H
+
+#include <QMainWindow>
+#include <QLabel>
+#include <QScrollArea>
+#include <QImage>
+
+#include "heightmap.h"
+#include "materialremoval.h"
+
+// Optional viewer for the headless material-removal simulation: runs a
+// G-code job through MaterialRemovalSim and shows the finished stock as a
+// hill-shaded image.
+class HeightMapWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    HeightMapWindow(QWidget *parent = nullptr);
+
+    // Simulates the job and displays the result; false on a parse error.
+    bool loadJob(const QString &path, const CutterTool &tool, double cellSize);
+
+private:
+    // Converts the heightmap to a grayscale image with simple lighting
+    QImage renderShaded(const HeightMap &stock) const;
+
+    QScrollArea *scrollArea;   // Lets large stock images be panned
+    QLabel *imageLabel;        // Displays the shaded surface
+    QLabel *statusLabel;       // Removed volume, move count, timing
+};
+
+#endif // HEIGHTMAPWINDOW_H
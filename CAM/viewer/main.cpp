@@ -0,0 +1,27 @@
+// main.cpp
+#include <QApplication>
+#include <QFileDialog>
+#include "heightmapwindow.h"
+
+// Usage: CamViewer [job.nc] [tool diameter mm] [ball]
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QString path = argc > 1 ? QString(argv[1])
+                            : QFileDialog::getOpenFileName(nullptr, "Open G-code", QString(),
+                                                           "G-code (*.nc *.gcode *.ngc *.tap);;All files (*)");
+    if (path.isEmpty())
+        return 0;
+
+    CutterTool tool;
+    if (argc > 2)
+        tool.diameter = QString(argv[2]).toDouble();
+    if (argc > 3 && QString(argv[3]) == "ball")
+        tool.shape = CutterTool::BallEnd;
+
+    HeightMapWindow window;
+    window.loadJob(path, tool, 0.1);
+    window.show();
+    return app.exec();
+}
@@ -0,0 +1,19 @@
+QT += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = CamViewer
+TEMPLATE = app
+
+CONFIG += c++17 thread
+
+INCLUDEPATH += .. ../../SIM/motion
+
+SOURCES += main.cpp \
+           heightmapwindow.cpp \
+           ../gcodeparser.cpp \
+           ../heightmap.cpp \
+           ../materialremoval.cpp \
+           ../../SIM/motion/workstealingpool.cpp
+
+HEADERS += heightmapwindow.h
@@ -0,0 +1,251 @@
+#include "accountstore.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+
+namespace {
+
+// FNV-1a; good enough for short names and cheap to compute.
+std::uint32_t hashBytes(std::string_view s)
+{
+    std::uint32_t h = 2166136261u;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+} // namespace
+
+StringPool::StringPool(StringPool &&other) noexcept
+    : bytes(std::move(other.bytes)),
+      slotIds(std::move(other.slotIds)),
+      slotHashes(std::move(other.slotHashes)),
+      count(std::exchange(other.count, 0))
+{
+    other.bytes.clear();
+    other.slotIds.clear();
+    other.slotHashes.clear();
+}
+
+StringPool &StringPool::operator=(StringPool &&other) noexcept
+{
+    if (this != &other) {
+        bytes = std::move(other.bytes);
+        slotIds = std::move(other.slotIds);
+        slotHashes = std::move(other.slotHashes);
+        count = std::exchange(other.count, 0);
+        other.bytes.clear();
+        other.slotIds.clear();
+        other.slotHashes.clear();
+    }
+    return *this;
+}
+
+std::uint32_t StringPool::intern(std::string_view s)
+{
+    // Keep the load factor under 1/2.
+    if ((count + 1) * 2 > slotIds.size())
+        grow();
+
+    const std::uint32_t h = hashBytes(s);
+    const std::size_t mask = slotIds.size() - 1;
+    std::size_t slot = h & mask;
+    while (slotIds[slot] != 0) {
+        if (slotHashes[slot] == h && view(slotIds[slot] - 1) == s)
+            return slotIds[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+
+    // The length goes in front as a varint: 7 bits per byte, low bits
+    // first, high bit set on every byte but the last.
+    const std::uint32_t id = static_cast<std::uint32_t>(bytes.size());
+    for (std::size_t len = s.size(); ; len >>= 7) {
+        bytes.push_back(static_cast<char>(len < 0x80 ? len : (len & 0x7F) | 0x80));
+        if (len < 0x80)
+            break;
+    }
+    bytes.insert(bytes.end(), s.begin(), s.end());
+
+    slotIds[slot] = id + 1;
+    slotHashes[slot] = h;
+    ++count;
+    return id;
+}
+
+std::string_view StringPool::view(std::uint32_t id) const
+{
+    const char *p = bytes.data() + id;
+    std::size_t len = 0;
+    for (int shift = 0; ; shift += 7) {
+        const unsigned char c = static_cast<unsigned char>(*p++);
+        len |= static_cast<std::size_t>(c & 0x7F) << shift;
+        if (c < 0x80)
+            break;
+    }
+    return std::string_view(p, len);
+}
+
+std::size_t StringPool::footprintBytes() const
+{
+    return bytes.capacity() + (slotIds.capacity() + slotHashes.capacity()) * sizeof(std::uint32_t);
+}
+
+void StringPool::grow()
+{
+    const std::size_t newSize = slotIds.empty() ? 64 : slotIds.size() * 2;
+    std::vector<std::uint32_t> oldIds(newSize, 0);
+    std::vector<std::uint32_t> oldHashes(newSize, 0);
+    oldIds.swap(slotIds);
+    oldHashes.swap(slotHashes);
+
+    const std::size_t mask = newSize - 1;
+    for (std::size_t i = 0; i < oldIds.size(); ++i) {
+        if (oldIds[i] == 0)
+            continue;
+        std::size_t slot = oldHashes[i] & mask;
+        while (slotIds[slot] != 0)
+            slot = (slot + 1) & mask;
+        slotIds[slot] = oldIds[i];
+        slotHashes[slot] = oldHashes[i];
+    }
+}
+
+AccountStore::AccountStore(AccountStore &&other) noexcept
+    : blocks(std::move(other.blocks)),
+      indexKeys(std::move(other.indexKeys)),
+      indexRecords(std::move(other.indexRecords)),
+      strings(std::move(other.strings)),
+      count(std::exchange(other.count, 0))
+{
+    other.blocks.clear();
+    other.indexKeys.clear();
+    other.indexRecords.clear();
+}
+
+AccountStore &AccountStore::operator=(AccountStore &&other) noexcept
+{
+    if (this != &other) {
+        blocks = std::move(other.blocks);
+        indexKeys = std::move(other.indexKeys);
+        indexRecords = std::move(other.indexRecords);
+        strings = std::move(other.strings);
+        count = std::exchange(other.count, 0);
+        other.blocks.clear();
+        other.indexKeys.clear();
+        other.indexRecords.clear();
+    }
+    return *this;
+}
+
+void AccountStore::reserve(std::size_t n)
+{
+    growIndex(n * 2);
+    blocks.reserve((n + kBlockRecords - 1) / kBlockRecords);
+}
+
+std::uint32_t AccountStore::findSlot(int accNum) const
+{
+    const std::size_t mask = indexKeys.size() - 1;
+    std::size_t slot = (static_cast<std::uint32_t>(accNum) * 2654435761u) & mask;
+    while (indexRecords[slot] != 0 && indexKeys[slot] != accNum)
+        slot = (slot + 1) & mask;
+    return static_cast<std::uint32_t>(slot);
+}
+
+void AccountStore::growIndex(std::size_t minSlots)
+{
+    std::size_t newSize = indexKeys.empty() ? 64 : indexKeys.size();
+    while (newSize < minSlots)
+        newSize *= 2;
+    if (newSize == indexKeys.size())
+        return;
+
+    std::vector<int> oldKeys(newSize, 0);
+    std::vector<std::uint32_t> oldRecords(newSize, 0);
+    oldKeys.swap(indexKeys);
+    oldRecords.swap(indexRecords);
+    for (std::size_t i = 0; i < oldKeys.size(); ++i) {
+        if (oldRecords[i] == 0)
+            continue;
+        const std::uint32_t slot = findSlot(oldKeys[i]);
+        indexKeys[slot] = oldKeys[i];
+        indexRecords[slot] = oldRecords[i];
+    }
+}
+
+AccountRecord *AccountStore::create(std::string_view name, int accNum,
+                                    std::string_view password, double balance)
+{
+    // Keep the load factor under 1/2.
+    if ((count + 1) * 2 > indexKeys.size())
+        growIndex((count + 1) * 2);
+
+    const std::uint32_t slot = findSlot(accNum);
+    if (indexRecords[slot] != 0)
+        return nullptr;
+
+    if (count % kBlockRecords == 0)
+        blocks.emplace_back(new AccountRecord[kBlockRecords]);
+
+    AccountRecord *rec = &record(static_cast<std::uint32_t>(count));
+    rec->accountNumber = accNum;
+    rec->nameId = strings.intern(name);
+    rec->passwordId = strings.intern(password);
+    rec->balance = balance;
+    ++count;
+
+    indexKeys[slot] = accNum;
+    indexRecords[slot] = static_cast<std::uint32_t>(count);
+    return rec;
+}
+
+AccountRecord *AccountStore::find(int accNum)
+{
+    return const_cast<AccountRecord *>(static_cast<const AccountStore *>(this)->find(accNum));
+}
+
+const AccountRecord *AccountStore::find(int accNum) const
+{
+    if (count == 0 || indexKeys.empty())
+        return nullptr;
+    const std::uint32_t slot = findSlot(accNum);
+    return indexRecords[slot] == 0 ? nullptr : &record(indexRecords[slot] - 1);
+}
+
+bool AccountStore::login(const AccountRecord &rec, std::string_view pass) const
+{
+    return strings.view(rec.passwordId) == pass;
+}
+
+std::size_t AccountStore::footprintBytes() const
+{
+    return blocks.size() * kBlockRecords * sizeof(AccountRecord)
+        + blocks.capacity() * sizeof(blocks[0])
+        + indexKeys.capacity() * sizeof(int)
+        + indexRecords.capacity() * sizeof(std::uint32_t)
+        + strings.footprintBytes();
+}
+
+void AccountStore::save(std::ostream &out) const
+{
+    forEach([&](const AccountRecord &rec) {
+        out << rec.accountNumber << " " << strings.view(rec.nameId) << " "
+            << strings.view(rec.passwordId) << " " << rec.balance << "\n";
+    });
+}
+
+bool AccountStore::load(std::istream &in)
+{
+    std::string n, pass;
+    int accNum;
+    double bal;
+    while (in >> accNum >> n >> pass >> bal) {
+        if (!create(n, accNum, pass, bal))
+            return false;
+    }
+    return in.eof();
+}
@@ -0,0 +1,108 @@
+#ifndef ACCOUNTSTORE_H
+#define ACCOUNTSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Fixed-size, trivially copyable account record. Strings live in the
+// store's StringPool and are referenced by their pool offset.
+struct AccountRecord {
+    int accountNumber;
+    std::uint32_t nameId;
+    std::uint32_t passwordId;
+    double balance;
+};
+
+// Append-only pool of interned strings. Every distinct string is stored
+// once, as a varint length followed by its bytes, in one contiguous buffer.
+// Ids are byte offsets into that buffer, so they survive buffer growth.
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+    // A moved-from pool is empty and usable.
+    StringPool(StringPool &&other) noexcept;
+    StringPool &operator=(StringPool &&other) noexcept;
+
+    // Returns the id of s, adding it to the pool if it is not there yet.
+    std::uint32_t intern(std::string_view s);
+
+    std::string_view view(std::uint32_t id) const;
+
+    std::size_t uniqueCount() const { return count; }
+    std::size_t footprintBytes() const;
+
+private:
+    void grow();
+
+    std::vector<char> bytes;
+    // Open-addressing table: slot holds id + 1 (0 = empty) and the full hash.
+    std::vector<std::uint32_t> slotIds;
+    std::vector<std::uint32_t> slotHashes;
+    std::size_t count = 0;
+};
+
+// Arena-backed account table. Records are carved out of fixed-size blocks
+// that are never reallocated, so pointers returned by create()/find() stay
+// valid for the lifetime of the store. Move-only.
+class AccountStore {
+public:
+    static constexpr std::size_t kBlockRecords = 4096;
+
+    AccountStore() = default;
+    AccountStore(const AccountStore &) = delete;
+    AccountStore &operator=(const AccountStore &) = delete;
+    // A moved-from store is empty and usable.
+    AccountStore(AccountStore &&other) noexcept;
+    AccountStore &operator=(AccountStore &&other) noexcept;
+
+    // Pre-sizes the index and block list for n accounts.
+    void reserve(std::size_t n);
+
+    // Adds an account and returns its record. Returns nullptr if the
+    // account number is already taken.
+    AccountRecord *create(std::string_view name, int accNum,
+                          std::string_view password, double balance);
+
+    AccountRecord *find(int accNum);
+    const AccountRecord *find(int accNum) const;
+
+    std::string_view name(const AccountRecord &rec) const { return strings.view(rec.nameId); }
+    bool login(const AccountRecord &rec, std::string_view pass) const;
+
+    std::size_t size() const { return count; }
+    const StringPool &pool() const { return strings; }
+
+    // Bytes held by records, index and string pool (capacity, not size).
+    std::size_t footprintBytes() const;
+
+    // Same text format as BankAccount::saveToFile / loadFromFile.
+    void save(std::ostream &out) const;
+    bool load(std::istream &in);
+
+    template <typename Fn>
+    void forEach(Fn fn) const
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            fn(record(static_cast<std::uint32_t>(i)));
+    }
+
+private:
+    AccountRecord &record(std::uint32_t i) const { return blocks[i / kBlockRecords][i % kBlockRecords]; }
+    std::uint32_t findSlot(int accNum) const;
+    void growIndex(std::size_t minSlots);
+
+    std::vector<std::unique_ptr<AccountRecord[]>> blocks;
+    // Open-addressing index from account number to record number + 1 (0 = empty).
+    std::vector<int> indexKeys;
+    std::vector<std::uint32_t> indexRecords;
+    StringPool strings;
+    std::size_t count = 0;
+};
+
+#endif // ACCOUNTSTORE_H
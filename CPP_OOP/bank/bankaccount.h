@@ -0,0 +1,68 @@
+#ifndef BANKACCOUNT_H
+#define BANKACCOUNT_H
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// A single bank account. Owns its name and password strings.
+class BankAccount {
+private:
+    std::string name;
+    int accountNumber;
+    std::string password;
+    double balance;
+
+public:
+    // Strings are taken by value and moved in, so callers passing
+    // temporaries (or std::move) never pay for a second copy.
+    BankAccount(std::string n, int accNum, std::string pass, double initialBal)
+        : name(std::move(n)),
+          accountNumber(accNum),
+          password(std::move(pass)),
+          balance(initialBal) {}
+
+    int getAccountNumber() const {
+        return accountNumber;
+    }
+
+    bool login(const std::string &pass) const {
+        return password == pass;
+    }
+
+    void deposit(double amount) {
+        balance += amount;
+        std::cout << "Deposited: $" << amount << std::endl;
+    }
+
+    void withdraw(double amount) {
+        if (amount > balance) {
+            std::cout << "Insufficient balance!" << std::endl;
+        } else {
+            balance -= amount;
+            std::cout << "Withdrawn: $" << amount << std::endl;
+        }
+    }
+
+    void showInfo() const {
+        std::cout << "\nAccount Holder: " << name << std::endl;
+        std::cout << "Account Number: " << accountNumber << std::endl;
+        std::cout << "Balance: $" << balance << std::endl;
+    }
+
+    // Save account data to file
+    void saveToFile(std::ofstream &outFile) const {
+        outFile << accountNumber << " " << name << " " << password << " " << balance << std::endl;
+    }
+
+    // Load account data from file
+    static BankAccount loadFromFile(std::ifstream &inFile) {
+        std::string n, pass;
+        int accNum = 0;
+        double bal = 0.0;
+        inFile >> accNum >> n >> pass >> bal;
+        return BankAccount(std::move(n), accNum, std::move(pass), bal);
+    }
+};
+
+#endif // BANKACCOUNT_H
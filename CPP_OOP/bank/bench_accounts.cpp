@@ -0,0 +1,225 @@
+// Memory / footprint benchmark: vector<BankAccount> vs. AccountStore.
+//
+//   bench_accounts [numAccounts]
+//
+// Live heap bytes are measured by replacing the global allocator, so the
+// numbers include std::string heap buffers, vector slack and index nodes.
+// Then checks the store: every account survives save() and load(), a
+// 70000-byte name round-trips whole, and a moved-from store and pool are
+// empty and usable. Fails on a lookup miss or a failed check.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "accountstore.h"
+#include "bankaccount.h"
+
+static std::size_t liveBytes = 0;
+static std::size_t peakBytes = 0;
+static std::size_t allocCount = 0;
+
+void *operator new(std::size_t n)
+{
+    // Stash the size in front of the block so delete can account for it.
+    void *p = std::malloc(n + 16);
+    if (!p)
+        throw std::bad_alloc();
+    *static_cast<std::size_t *>(p) = n;
+    liveBytes += n;
+    if (liveBytes > peakBytes)
+        peakBytes = liveBytes;
+    ++allocCount;
+    return static_cast<char *>(p) + 16;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (!p)
+        return;
+    char *base = static_cast<char *>(p) - 16;
+    liveBytes -= *reinterpret_cast<std::size_t *>(base);
+    std::free(base);
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+void *operator new[](std::size_t n) { return operator new(n); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete[](void *p, std::size_t) noexcept { operator delete(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char *kFirst[] = {"Arun", "Priya", "Karthik", "Lakshmi", "Vijay", "Meena",
+                        "Suresh", "Divya", "Ramesh", "Anitha", "Ganesh", "Kavitha"};
+const char *kLast[] = {"Subramanian", "Krishnan", "Raman", "Natarajan",
+                       "Venkatesan", "Balasubramaniam", "Iyer", "Pillai"};
+
+// Deterministic account data: names repeat (as real customer tables do),
+// passwords are unique-ish.
+void makeAccount(std::size_t i, std::string &name, std::string &pass)
+{
+    name = std::string(kFirst[i % 12]) + "_" + kLast[(i / 12) % 8] + "_" + std::to_string(i % 997);
+    pass = "pw" + std::to_string((i * 2654435761u) % 100000);
+}
+
+struct Result {
+    double buildMs;
+    double lookupMs;
+    std::size_t bytes;
+    std::size_t allocs;
+};
+
+Result benchVector(std::size_t n, const std::vector<int> &probes, bool &lookupsOk)
+{
+    const std::size_t before = liveBytes;
+    const std::size_t allocsBefore = allocCount;
+    auto t0 = Clock::now();
+
+    std::vector<BankAccount> accounts;
+    std::string name, pass;
+    for (std::size_t i = 0; i < n; ++i) {
+        makeAccount(i, name, pass);
+        accounts.push_back(BankAccount(name, static_cast<int>(i), pass, 100.0));
+    }
+    auto t1 = Clock::now();
+    const std::size_t bytes = liveBytes - before;
+    const std::size_t allocs = allocCount - allocsBefore;
+
+    // Linear scan, as findAccount() in main.cpp does.
+    long found = 0;
+    for (int accNum : probes) {
+        for (auto &acc : accounts) {
+            if (acc.getAccountNumber() == accNum) {
+                ++found;
+                break;
+            }
+        }
+    }
+    auto t2 = Clock::now();
+    lookupsOk = found == static_cast<long>(probes.size());
+    if (!lookupsOk)
+        std::printf("vector lookup mismatch\n");
+
+    return {std::chrono::duration<double, std::milli>(t1 - t0).count(),
+            std::chrono::duration<double, std::milli>(t2 - t1).count(), bytes, allocs};
+}
+
+Result benchStore(std::size_t n, const std::vector<int> &probes, std::size_t &unique, bool &lookupsOk)
+{
+    const std::size_t before = liveBytes;
+    const std::size_t allocsBefore = allocCount;
+    auto t0 = Clock::now();
+
+    AccountStore store;
+    store.reserve(n);
+    std::string name, pass;
+    for (std::size_t i = 0; i < n; ++i) {
+        makeAccount(i, name, pass);
+        store.create(name, static_cast<int>(i), pass, 100.0);
+    }
+    auto t1 = Clock::now();
+    const std::size_t bytes = liveBytes - before;
+    const std::size_t allocs = allocCount - allocsBefore;
+
+    long found = 0;
+    for (int accNum : probes)
+        found += store.find(accNum) != nullptr;
+    auto t2 = Clock::now();
+    lookupsOk = found == static_cast<long>(probes.size());
+    if (!lookupsOk)
+        std::printf("store lookup mismatch\n");
+
+    unique = store.pool().uniqueCount();
+    return {std::chrono::duration<double, std::milli>(t1 - t0).count(),
+            std::chrono::duration<double, std::milli>(t2 - t1).count(), bytes, allocs};
+}
+
+// Saves n accounts plus one with a 70000-byte name, loads them into a
+// fresh store and compares every field. Balances stay within the six
+// digits the text format keeps.
+bool checkRoundTrip(std::size_t n)
+{
+    AccountStore store;
+    std::string name, pass;
+    for (std::size_t i = 0; i < n; ++i) {
+        makeAccount(i, name, pass);
+        store.create(name, static_cast<int>(i), pass, static_cast<double>(i % 1000) + 0.25);
+    }
+    const std::string longName(70000, 'N');
+    store.create(longName, -1, "long", 1.0);
+
+    std::stringstream file;
+    store.save(file);
+    AccountStore loaded;
+    if (!loaded.load(file) || loaded.size() != store.size())
+        return false;
+    bool same = true;
+    store.forEach([&](const AccountRecord &rec) {
+        const AccountRecord *back = loaded.find(rec.accountNumber);
+        same = same && back && loaded.name(*back) == store.name(rec) && back->balance == rec.balance
+               && loaded.login(*back, store.pool().view(rec.passwordId));
+    });
+    return same && loaded.name(*loaded.find(-1)).size() == longName.size();
+}
+
+bool checkMovedFrom()
+{
+    AccountStore store;
+    store.create("Arun", 1, "pw", 1.0);
+    AccountStore moved(std::move(store));
+    AccountStore assigned;
+    assigned = std::move(moved);
+
+    bool ok = store.size() == 0 && !store.find(1) && moved.size() == 0 && !moved.find(1);
+    std::ostringstream out;
+    store.save(out);
+    ok = ok && out.str().empty() && assigned.size() == 1 && assigned.find(1);
+    // Both stay usable.
+    ok = ok && store.create("Priya", 2, "pw", 2.0) && store.find(2) && store.pool().uniqueCount() == 2;
+    ok = ok && moved.create("Vijay", 3, "pw", 3.0) && moved.name(*moved.find(3)) == "Vijay";
+
+    StringPool pool;
+    pool.intern("Meena");
+    StringPool other(std::move(pool));
+    ok = ok && pool.uniqueCount() == 0 && other.uniqueCount() == 1;
+    return ok && pool.view(pool.intern("Meena")) == "Meena" && pool.uniqueCount() == 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::vector<int> probes;
+    for (std::size_t i = 0; i < 200; ++i)
+        probes.push_back(static_cast<int>((i * 7919) % n));
+
+    bool vecOk = false, storeOk = false;
+    Result vec = benchVector(n, probes, vecOk);
+    std::size_t unique = 0;
+    Result arena = benchStore(n, probes, unique, storeOk);
+
+    std::printf("accounts: %zu  (unique pooled strings: %zu)\n", n, unique);
+    std::printf("%-22s %12s %12s %12s %12s %14s\n", "layout", "build ms", "bytes", "bytes/acct",
+                "allocations", "200 lookups ms");
+    std::printf("%-22s %12.1f %12zu %12.1f %12zu %14.3f\n", "vector<BankAccount>", vec.buildMs,
+                vec.bytes, double(vec.bytes) / n, vec.allocs, vec.lookupMs);
+    std::printf("%-22s %12.1f %12zu %12.1f %12zu %14.3f\n", "AccountStore", arena.buildMs,
+                arena.bytes, double(arena.bytes) / n, arena.allocs, arena.lookupMs);
+    std::printf("sizeof(BankAccount)=%zu sizeof(AccountRecord)=%zu  footprint ratio %.2fx\n",
+                sizeof(BankAccount), sizeof(AccountRecord), double(vec.bytes) / arena.bytes);
+
+    const bool roundTrip = checkRoundTrip(n);
+    const bool moved = checkMovedFrom();
+    std::printf("save/load:    %s\n", roundTrip ? "all accounts and a 70000-byte name round-trip" : "MISMATCH");
+    std::printf("moved-from:   %s\n", moved ? "empty and usable" : "NOT EMPTY");
+    const bool ok = vecOk && storeOk && roundTrip && moved;
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -1,104 +1,57 @@
 #include<iostream>
-#include<vector>
 #include<fstream>
+#include<string>
+#include "accountstore.h"
 using namespace std;
 
-class BankAccount {
-private:
-    string name;
-    int accountNumber;
-    string password;
-    double balance;
-
-public:
-    BankAccount(string n, int accNum, string pass, double initialBal) {
-        name = n;
-        accountNumber = accNum;
-        password = pass;
-        balance = initialBal;
-    }
-
-    int getAccountNumber() {
-        return accountNumber;
-    }
-
-    bool login(string pass) {
-        return password == pass;
-    }
-
-    void deposit(double amount) {
-        balance += amount;
-        cout << "Deposited: $" << amount << endl;
-    }
-
-    void withdraw(double amount) {
-        if (amount > balance) {
-            cout << "Insufficient balance!" << endl;
-        } else {
-            balance -= amount;
-            cout << "Withdrawn: $" << amount << endl;
-        }
-    }
-
-    void showInfo() {
-        cout << "\nAccount Holder: " << name << endl;
-        cout << "Account Number: " << accountNumber << endl;
-        cout << "Balance: $" << balance << endl;
-    }
-
-    // Save account data to file
-    void saveToFile(ofstream &outFile) {
-        outFile << accountNumber << " " << name << " " << password << " " << balance << endl;
-    }
-
-    // Load account data from file
-    static BankAccount loadFromFile(ifstream &inFile) {
-        string n, pass;
-        int accNum;
-        double bal;
-        inFile >> accNum >> n >> pass >> bal;
-        return BankAccount(n, accNum, pass, bal);
-    }
-};
-
 // Find account by account number
-BankAccount* findAccount(vector<BankAccount>& accounts, int accNum) {
-    for (auto& acc : accounts) {
-        if (acc.getAccountNumber() == accNum) {
-            return &acc;
-        }
-    }
-    return nullptr;
+AccountRecord* findAccount(AccountStore& accounts, int accNum) {
+    return accounts.find(accNum);
 }
 
 // Load all accounts from file
-void loadAccounts(vector<BankAccount>& accounts) {
+void loadAccounts(AccountStore& accounts) {
     ifstream inFile("accounts.dat", ios::in);
     if (!inFile) {
         cout << "No existing account data found!" << endl;
         return;
     }
 
-    while (inFile) {
-        BankAccount acc = BankAccount::loadFromFile(inFile);
-        if (inFile)
-            accounts.push_back(acc);
-    }
+    if (!accounts.load(inFile))
+        cout << "accounts.dat is damaged; loaded " << accounts.size() << " accounts." << endl;
     inFile.close();
 }
 
 // Save all accounts to file
-void saveAccounts(vector<BankAccount>& accounts) {
+void saveAccounts(const AccountStore& accounts) {
     ofstream outFile("accounts.dat", ios::out);
-    for (auto& acc : accounts) { // Use reference here
-        acc.saveToFile(outFile); // This will modify the object, so it's safe
-    }
+    accounts.save(outFile);
     outFile.close();
 }
 
+void deposit(AccountRecord& acc, double amount) {
+    acc.balance += amount;
+    cout << "Deposited: $" << amount << endl;
+}
+
+void withdraw(AccountRecord& acc, double amount) {
+    if (amount > acc.balance) {
+        cout << "Insufficient balance!" << endl;
+    } else {
+        acc.balance -= amount;
+        cout << "Withdrawn: $" << amount << endl;
+    }
+}
+
+void showInfo(const AccountStore& accounts, const AccountRecord& acc) {
+    cout << "\nAccount Holder: " << accounts.name(acc) << endl;
+    cout << "Account Number: " << acc.accountNumber << endl;
+    cout << "Balance: $" << acc.balance << endl;
+}
+
 
 int main() {
-    vector<BankAccount> accounts;
+    AccountStore accounts;
     loadAccounts(accounts); // Load accounts from file on startup
 
     int mainChoice;
@@ -124,7 +77,10 @@ int main() {
             cout << "Enter initial balance: ";
             cin >> balance;
 
-            accounts.push_back(BankAccount(name, accNum, password, balance));
+            if (!accounts.create(name, accNum, password, balance)) {
+                cout << "Account number " << accNum << " is already taken!" << endl;
+                continue;
+            }
             saveAccounts(accounts); // Save updated accounts to file
             cout << "Account created successfully!" << endl;
 
@@ -137,8 +93,8 @@ int main() {
             cout << "Enter password: ";
             cin >> password;
 
-            BankAccount* user = findAccount(accounts, accNum);
-            if (user && user->login(password)) {
+            AccountRecord* user = findAccount(accounts, accNum);
+            if (user && accounts.login(*user, password)) {
                 cout << "Login successful!" << endl;
 
                 int choice;
@@ -152,15 +108,15 @@ int main() {
                         case 1:
                             cout << "Enter amount to deposit: ";
                             cin >> amount;
-                            user->deposit(amount);
+                            deposit(*user, amount);
                             break;
                         case 2:
                             cout << "Enter amount to withdraw: ";
                             cin >> amount;
-                            user->withdraw(amount);
+                            withdraw(*user, amount);
                             break;
                         case 3:
-                            user->showInfo();
+                            showInfo(accounts, *user);
                             break;
                         case 4:
                             cout << "Logged out." << endl;
@@ -5,7 +5,11 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = WaveControlApp
 TEMPLATE = app
 
+INCLUDEPATH += ../motion
+
 SOURCES += main.cpp \
-           wavecontrolwindow.cpp
+           wavecontrolwindow.cpp \
+           ../motion/wavekernel.cpp
 
-HEADERS += wavecontrolwindow.h
+HEADERS += wavecontrolwindow.h \
+           ../motion/wavekernel.h
@@ -79,19 +79,23 @@ void WaveControlWindow::setupChart()
     chartView->setRenderHint(QPainter::Antialiasing);
 }
 
-QVector<double> WaveControlWindow::generateWavePositions()
+WaveParams WaveControlWindow::waveParams() const
 {
-    QVector<double> positions(numMotors);
-    double currentPhaseShift = basePhaseShift * waveFactorValue;
-    for (int i = 0; i < numMotors; ++i)
-        positions[i] = amp * sin(2 * M_PI * 0.5 * t + i * currentPhaseShift);
-    return positions;
+    WaveParams p;
+    p.numMotors = numMotors;
+    p.amp = amp;
+    p.step = step;
+    p.basePhaseShift = basePhaseShift;
+    p.waveFactorValue = waveFactorValue;
+    p.strokeLengthValue = strokeLengthValue;
+    return p;
 }
 
 void WaveControlWindow::updateWave()
 {
-    QVector<double> positions = generateWavePositions();
+    positions.resize(numMotors);
+    generateWavePositions(waveParams(), t, positions.data());
     for (int i = 0; i < numMotors; ++i)
-        barSet->replace(i, positions[i] * strokeLengthValue);
+        barSet->replace(i, positions[i]);
     t += step;
 }
@@ -13,6 +13,8 @@
 #include <QBarSeries>
 #include <QValueAxis>
 
+#include "wavekernel.h"
+
 QT_CHARTS_USE_NAMESPACE
 
 class WaveControlWindow : public QMainWindow
@@ -25,7 +27,7 @@ public:
 
 private:
     void setupChart();
-    QVector<double> generateWavePositions();
+    WaveParams waveParams() const;
     void updateWave();
 
     QWidget *mainWidget;
@@ -48,6 +50,7 @@ private:
     double waveFactorValue;
     int strokeLengthValue;
     double t;
+    QVector<double> positions;
 };
 
 #endif // WAVECONTROLWINDOW_H
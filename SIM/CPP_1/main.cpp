@@ -1,11 +1,31 @@
 // main.cpp
 #include <QApplication>
+#include <cstdio>
+#include <cstring>
 #include "wavecontrolwindow.h"
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
     WaveControlWindow window;
+
+    // --record FILE: journal slider changes for wavereplay
+    // --publish NAME: shared-memory position feed (see shmfeed_reader)
+    // --telemetry FILE: compressed position/velocity log (see telemetry_reader)
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (!std::strcmp(argv[i], "--record") && !window.startRecording(argv[i + 1])) {
+            std::fprintf(stderr, "cannot create %s\n", argv[i + 1]);
+            return 1;
+        }
+        if (!std::strcmp(argv[i], "--publish") && !window.startPublishing(argv[i + 1])) {
+            std::fprintf(stderr, "cannot publish to %s\n", argv[i + 1]);
+            return 1;
+        }
+        if (!std::strcmp(argv[i], "--telemetry") && !window.startTelemetry(argv[i + 1])) {
+            std::fprintf(stderr, "cannot create %s\n", argv[i + 1]);
+            return 1;
+        }
+    }
     window.show();
     return app.exec();
 }
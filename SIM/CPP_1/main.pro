@@ -2,10 +2,29 @@ QT += core gui charts
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# The motion sources need C++17 (qmake defaults to C++11)
+CONFIG += c++17
+
 TARGET = WaveControlApp.exe
 TEMPLATE = app
 
+INCLUDEPATH += ../motion
+
 SOURCES += main.cpp \
-           wavecontrolwindow.cpp
+           wavecontrolwindow.cpp \
+           ../motion/wavekernel.cpp \
+           ../motion/wavejournal.cpp \
+           ../motion/shmfeed.cpp \
+           ../motion/telemetry.cpp \
+           ../motion/closedloop.cpp \
+           ../motion/waveexpression.cpp
+
+HEADERS += wavecontrolwindow.h \
+           ../motion/wavekernel.h \
+           ../motion/wavejournal.h \
+           ../motion/shmfeed.h \
+           ../motion/telemetry.h \
+           ../motion/closedloop.h \
+           ../motion/waveexpression.h
 
-HEADERS += wavecontrolwindow.h
+unix:!macx: LIBS += -lrt
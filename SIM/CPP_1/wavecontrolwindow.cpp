@@ -1,8 +1,16 @@
 #include "wavecontrolwindow.h"
+#include <algorithm>   // for std::copy(), std::max()
 #include <cmath>       // for sin()
 #include <QSlider>
 #include <QLabel>
 
+namespace {
+
+// The drive statistics label is refreshed a few times a second, not per frame
+constexpr int kServoLabelMs = 250;
+
+} // namespace
+
 // Constructor: Sets up the GUI, sliders, chart, and animation timer
 WaveControlWindow::WaveControlWindow(QWidget *parent)
     : QMainWindow(parent),
@@ -12,7 +20,9 @@ WaveControlWindow::WaveControlWindow(QWidget *parent)
       basePhaseShift(M_PI / 6), // Phase shift between each motor/bar
       waveFactorValue(1.0),     // 1.0 = full sine wave
       strokeLengthValue(5),     // Amplitude multiplier
-      t(0.0)                     // Initial time
+      t(0.0),                    // Initial time
+      frameCount(0),
+      servo(numMotors)           // 20 kHz servo, closed loop by default
 {
     mainWidget = new QWidget(this);
     mainLayout = new QVBoxLayout(mainWidget);
@@ -46,6 +56,33 @@ WaveControlWindow::WaveControlWindow(QWidget *parent)
     strokeLengthLabel = new QLabel("Stroke Length: 0");
     controlLayout->addWidget(strokeLengthLabel);   // Add the label to the layout
 
+    // Simulated drives: servo mode, load, and how well they track the wave
+    closedLoopBox = new QCheckBox("Closed-loop drives");
+    closedLoopBox->setChecked(true);
+    connect(closedLoopBox, &QCheckBox::toggled, this, &WaveControlWindow::updateClosedLoop);
+    controlLayout->addWidget(closedLoopBox);
+
+    servoLoadSlider = new QSlider(Qt::Horizontal);
+    servoLoadSlider->setRange(0, 120);          // % of holding force
+    servoLoadSlider->setValue(0);
+    connect(servoLoadSlider, &QSlider::valueChanged, this, &WaveControlWindow::updateServoLoad);
+    controlLayout->addWidget(new QLabel("Drive Load (% of holding force)"));
+    controlLayout->addWidget(servoLoadSlider);
+
+    servoLabel = new QLabel("Tracking error: -");
+    controlLayout->addWidget(servoLabel);
+
+    // Custom wave shape: an expression in t and i (see waveexpression.h),
+    // after any "name=value;" parameters; empty keeps the built-in sine
+    expressionEdit = new QLineEdit;
+    expressionEdit->setPlaceholderText("d=0.2; A*sin(2*pi*f*t + i*phi) * exp(-d*t)");
+    connect(expressionEdit, &QLineEdit::editingFinished, this, &WaveControlWindow::updateExpression);
+    controlLayout->addWidget(new QLabel("Wave Expression"));
+    controlLayout->addWidget(expressionEdit);
+
+    expressionLabel = new QLabel("Built-in sine");
+    controlLayout->addWidget(expressionLabel);
+
 
 
     mainLayout->addLayout(controlLayout);
@@ -65,9 +102,36 @@ WaveControlWindow::WaveControlWindow(QWidget *parent)
     resize(800, 400);
 }
 
-// Destructor: Nothing special here
+// Destructor: the recorder writes the journal's end record
 WaveControlWindow::~WaveControlWindow() {}
 
+// Start journaling from the current state; changes are stamped with the
+// frame they first apply to, so the replay is exact whatever the timer did
+bool WaveControlWindow::startRecording(const QString &path)
+{
+    if (!recorder.open(path.toStdString(), waveParams()))
+        return false;
+    if (expression.isCompiled())
+        recorder.recordExpression(frameCount, expression.source());
+    return true;
+}
+
+// Open the shared-memory feed; readers see the parameters straight away
+bool WaveControlWindow::startPublishing(const QString &name)
+{
+    if (!feed.open(name.toStdString(), numMotors))
+        return false;
+    feed.setParams(waveParams());
+    return true;
+}
+
+// Open the telemetry log: pos0.. and vel0.. channels, positions kept to
+// 0.1 um (far below a step), which compresses them several-fold
+bool WaveControlWindow::startTelemetry(const QString &path)
+{
+    return telemetry.open(path.toStdString(), waveTelemetryChannels(numMotors, 1e-4, timer->interval() / 1000.0));
+}
+
 
 // Setup chart elements: bars, axes, and rendering options
 void WaveControlWindow::setupChart()
@@ -107,6 +171,8 @@ void WaveControlWindow::setupChart()
 void WaveControlWindow::updateWaveFactor(int value)
 {
     waveFactorValue = value / 100.0;
+    recorder.record(frameCount, WaveParam::WaveFactor, waveFactorValue);
+    feed.setParams(waveParams());
     waveFactorLabel->setText("Wave Factor: " + QString::number(value));
 }
 
@@ -114,19 +180,116 @@ void WaveControlWindow::updateWaveFactor(int value)
 void WaveControlWindow::updateStrokeLength(int value)
 {
     strokeLengthValue = value;
+    recorder.record(frameCount, WaveParam::StrokeLength, strokeLengthValue);
+    feed.setParams(waveParams());
     strokeLengthLabel->setText("stroke Length: " + QString::number(value));
 }
 
+// Switch the simulated drives between open and closed loop; the error
+// statistics start over
+void WaveControlWindow::updateClosedLoop(bool closed)
+{
+    servo.setClosedLoop(closed);
+    servo.clearStats();
+}
+
+// Load on every drive as a fraction of the holding force
+void WaveControlWindow::updateServoLoad(int percent)
+{
+    servo.setLoad(percent / 100.0 * servo.config().maxForce);
+    servo.clearStats();
+}
+
+// Compile the typed expression and its parameters; a bad one leaves the
+// current shape running. The journal gets the change like a slider's
+void WaveControlWindow::updateExpression()
+{
+    const std::string source = expressionEdit->text().trimmed().toStdString();
+    if (source.empty()) {
+        if (expression.isCompiled())
+            recorder.recordExpression(frameCount, "");
+        expression = WaveExpression();
+        expressionLabel->setText("Built-in sine");
+        return;
+    }
+    WaveExpression compiled;
+    if (!compiled.compileDefinition(source)) {
+        expressionLabel->setText(QString::fromStdString("Error: " + compiled.error()));
+        return;
+    }
+    if (source != expression.source())
+        recorder.recordExpression(frameCount, source);
+    expression = compiled;
+    expressionLabel->setText(QString("Compiled: %1 instructions")
+                                 .arg(expression.program().uniformCode.size() + expression.program().code.size()));
+}
+
+// Current slider/variable state as kernel parameters
+WaveParams WaveControlWindow::waveParams() const
+{
+    WaveParams p;
+    p.numMotors = numMotors;
+    p.amp = amp;
+    p.step = step;
+    p.basePhaseShift = basePhaseShift;
+    p.waveFactorValue = waveFactorValue;
+    p.strokeLengthValue = strokeLengthValue;
+    return p;
+}
+
 // Called by timer to animate the wave
 void WaveControlWindow::updateWave()
 {
-    double currentPhaseShift = basePhaseShift * waveFactorValue;  // Phase shift scaled by wave factor
+    // Sine wave formula lives in wavekernel.cpp (phase shift scaled by wave factor)
+    // The last frame moves to previousPositions; swapping the two buffers
+    // keeps a frame free of allocations
+    positions.swap(previousPositions);
+    positions.resize(numMotors);
+    previousPositions.resize(numMotors);
+
+    // Telemetry row: the previous frame goes in the velocity half first
+    double *row = telemetry.isOpen() ? telemetry.frame() : nullptr;
+    const bool firstRow = row && telemetry.framesRecorded() == 0;
+    if (row)
+        std::copy(previousPositions.cbegin(), previousPositions.cend(), row + numMotors);
 
-    // Update each bar's height using sine wave
-    for (int i = 0; i < numMotors; ++i) {
-        double pos = strokeLengthValue * sin(2 * M_PI * 0.5 * t + i * currentPhaseShift);  // Sine wave formula
-        barSet->replace(i, pos);  // Set bar height
+    if (expression.isCompiled())
+        expression.evaluate(waveParams(), t, 0, numMotors, positions.data());
+    else
+        generateWavePositions(waveParams(), t, positions.data());
+
+    // The drives follow the wave from the previous frame to this one at the
+    // servo rate on the worker's thread; this only queues the frame. The
+    // bars still show the commanded positions
+    if (frameCount == 0)
+        servo.reset(positions.data());
+    else
+        servo.advance(previousPositions.constData(), positions.data(), servo.ticksFor(timer->interval() / 1000.0));
+    if (frameCount % std::max(1, kServoLabelMs / timer->interval()) == 0) {
+        const ClosedLoopStats s = servo.stats();
+        servoLabel->setText(QString("Tracking error: max %1 mm, rms %2 mm, missed steps %3 on %4 axes, %5 stalled")
+                                .arg(s.maxError, 0, 'f', 4)
+                                .arg(s.rmsError, 0, 'f', 4)
+                                .arg(s.missedSteps, 0, 'f', 0)
+                                .arg(s.axesMissing)
+                                .arg(s.axesStalled));
+    }
+    if (recorder.isOpen())
+        recorder.frame(positions.data(), numMotors);
+    feed.publish(positions.data(), numMotors, t);
+    if (row) {
+        const double dt = timer->interval() / 1000.0;
+        for (int i = 0; i < numMotors; ++i) {
+            row[numMotors + i] = firstRow ? 0.0 : (positions[i] - row[numMotors + i]) / dt;
+            row[i] = positions[i];
+        }
+        telemetry.commit();
     }
+    ++frameCount;
+
+    // Update each bar's height
+    for (int i = 0; i < numMotors; ++i)
+        barSet->replace(i, positions[i]);  // Set bar height
 
     t += step;  // Advance time for next wave update
 }
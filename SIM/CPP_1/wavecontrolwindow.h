@@ -7,6 +7,15 @@
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QSlider>
+#include <QCheckBox>
+#include <QLineEdit>
+
+#include "wavekernel.h"  // Headless wave math shared with tools/benchmarks
+#include "wavejournal.h" // Parameter-change journal for headless replay
+#include "shmfeed.h"     // Shared-memory position feed for other processes
+#include "telemetry.h"   // Compressed position/velocity log
+#include "closedloop.h"  // Encoder/servo/missed-step model of the drives
+#include "waveexpression.h" // User-defined wave shapes
 
 // Enable the Qt Charts namespace to avoid prefixing
 QT_CHARTS_USE_NAMESPACE
@@ -21,6 +30,18 @@ public:
     WaveControlWindow(QWidget *parent = nullptr);
     ~WaveControlWindow();
 
+    // Journal every slider change (and a digest of every frame) to path,
+    // for replay with wavereplay. Returns false if the file can't be created.
+    bool startRecording(const QString &path);
+
+    // Publish every frame into the POSIX shared-memory feed name (e.g.
+    // "/cncwave") for external viewers, loggers and hardware bridges.
+    bool startPublishing(const QString &name);
+
+    // Log every frame's positions and velocities to path, compressed on a
+    // background thread; read back with telemetry_reader.
+    bool startTelemetry(const QString &path);
+
 private slots:
     // Called periodically by timer to update the wave animation
     void updateWave();
@@ -31,10 +52,20 @@ private slots:
     // Called when stroke length slider changes
     void updateStrokeLength(int value);
 
+    // Called when the servo mode checkbox or load slider changes
+    void updateClosedLoop(bool closed);
+    void updateServoLoad(int percent);
+
+    // Called when the wave expression has been edited
+    void updateExpression();
+
 private:
     // Setup chart components and UI layout
     void setupChart();
 
+    // Current slider/variable state as kernel parameters
+    WaveParams waveParams() const;
+
     // Main widget and layout for the window
     QWidget *mainWidget;
     QVBoxLayout *mainLayout;
@@ -48,6 +79,8 @@ private:
     QValueAxis *axisY;             // Y-axis showing wave amplitude
     QLabel *waveFactorLabel;  // Declare the label here
     QLabel *strokeLengthLabel;
+    QLabel *servoLabel;            // Tracking error and missed steps
+    QLabel *expressionLabel;       // Expression status or compile error
 
     // Wave control variables
     int numMotors;                 // Number of bars/motors
@@ -57,11 +90,23 @@ private:
     double waveFactorValue;        // Multiplier to adjust wave shape
     double strokeLengthValue;      // Multiplier for bar height
     double t;                      // Time variable for wave animation
+    long frameCount;               // Frames computed so far (journal tick)
+    QVector<double> positions;     // Last computed motor positions
+    QVector<double> previousPositions; // The frame before, for the drives
 
     // Timer and sliders for interactivity
     QTimer *timer;                 // Timer to drive animation updates
     QSlider *waveFactorSlider;     // Slider to adjust wave factor
     QSlider *strokeLengthSlider;   // Slider to adjust stroke length
+    QCheckBox *closedLoopBox;      // Servo mode of the simulated drives
+    QSlider *servoLoadSlider;      // Drive load, % of holding force
+    QLineEdit *expressionEdit;     // Custom wave shape
+
+    WaveRecorder recorder;         // Parameter journal, when recording
+    ShmFeedWriter feed;            // Shared-memory position feed, when publishing
+    TelemetryRecorder telemetry;   // Position/velocity log, when logging
+    ClosedLoopWorker servo;        // Drives following the wave, on their own thread
+    WaveExpression expression;     // Custom shape, when one is compiled
 };
 
 #endif // WAVECONTROLWINDOW_H
@@ -0,0 +1,198 @@
+// Behaviour check and throughput of the closed-loop drive simulation.
+//
+//   bench_closedloop [--axes N] [--rate HZ] [--seconds S] [--timing AXIS_TICKS]
+//
+// The UI's wave (20 frames/s) is fed to ClosedLoopSim at HZ, with a stroke
+// jump halfway (a slider move) and loads of 0 to 85 % of the holding force
+// across the axes:
+//
+// 1. open loop, no load: no missed steps, error within a few microsteps
+// 2. open loop, loaded: the jump makes loaded axes miss steps
+// 3. closed loop, loaded: no missed steps and a smaller worst error
+// 4. one axis loaded beyond the holding force is reported stalled
+// 5. ClosedLoopWorker gives the same result as 3 when each frame is waited
+//    for, and keeps every tick when all frames are queued at once
+//
+// Then the cost per axis and tick for 64 .. 4096 axes, open and closed
+// loop, and how much faster than real time that is, each timed over about
+// AXIS_TICKS axis-ticks (default 2e7).
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "closedloop.h"
+#include "wavekernel.h"
+
+namespace {
+
+constexpr double kFrameSeconds = 0.05;
+
+void settle(ClosedLoopSim &)
+{
+}
+
+void settle(ClosedLoopWorker &worker)
+{
+    worker.wait();
+}
+
+// Runs seconds of the wave through sim; the stroke jumps from 5 to 20 mm
+// halfway if jump is set. With eachFrame a worker finishes every frame
+// before the next is queued.
+template <typename Sim>
+void runWave(Sim &sim, double seconds, bool jump, bool eachFrame = false)
+{
+    WaveParams p;
+    p.numMotors = sim.axisCount();
+    p.waveFactorValue = 1.0;
+    p.strokeLengthValue = 5;
+    WaveGenerator wave(p);
+    const long frames = static_cast<long>(seconds / kFrameSeconds);
+    std::vector<double> from = wave.tick();
+    sim.reset(from.data());
+    const int ticks = sim.ticksFor(kFrameSeconds);
+    for (long f = 1; f < frames; ++f) {
+        if (jump && f == frames / 2)
+            wave.params().strokeLengthValue = 20;
+        const std::vector<double> &to = wave.tick();
+        sim.advance(from.data(), to.data(), ticks);
+        if (eachFrame)
+            settle(sim);
+        from = to;
+    }
+    settle(sim);
+}
+
+template <typename Sim>
+void loadAxes(Sim &sim)
+{
+    const double fractions[] = {0.0, 0.3, 0.6, 0.85};
+    for (int a = 0; a < sim.axisCount(); ++a)
+        sim.setLoad(a, fractions[a % 4] * sim.config().maxForce);
+}
+
+void printStats(const char *title, const ClosedLoopStats &s)
+{
+    std::printf("  %-24s max error %8.4f mm  rms %8.4f mm  missed %6.0f steps on %3d axes  stalled %d\n", title,
+                s.maxError, s.rmsError, s.missedSteps, s.axesMissing, s.axesStalled);
+}
+
+double nsPerAxisTick(int axes, double rate, bool closed, double work)
+{
+    ClosedLoopConfig cfg;
+    cfg.rateHz = rate;
+    cfg.closedLoop = closed;
+    ClosedLoopSim sim(axes, cfg);
+    loadAxes(sim);
+    std::vector<double> from(axes), to(axes);
+    for (int a = 0; a < axes; ++a) {
+        from[a] = 0.01 * a;
+        to[a] = from[a] + 1.0;
+    }
+    sim.reset(from.data());
+    const int ticks = sim.ticksFor(kFrameSeconds);
+    const long frames = std::max(2L, static_cast<long>(work / (static_cast<double>(axes) * ticks)));
+    double best = 1e300;
+    for (int rep = 0; rep < 3; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (long f = 0; f < frames; ++f) {
+            sim.advance(from.data(), to.data(), ticks);
+            std::swap(from, to);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best / (static_cast<double>(frames) * ticks * axes) * 1e9;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int axes = 64;
+    double rate = 20000.0;
+    double seconds = 10.0;
+    double work = 2e7;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--axes") && i + 1 < argc)
+            axes = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc)
+            rate = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc)
+            seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--timing") && i + 1 < argc)
+            work = std::atof(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--axes N] [--rate HZ] [--seconds S] [--timing AXIS_TICKS]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (axes < 4 || rate < 1000.0 || seconds < 1.0) {
+        std::fprintf(stderr, "need at least 4 axes, 1 kHz and 1 s\n");
+        return 2;
+    }
+    std::printf("axes: %d  rate: %.0f Hz  %.1f s of wave\n", axes, rate, seconds);
+
+    ClosedLoopConfig cfg;
+    cfg.rateHz = rate;
+    const double microstep = cfg.fullStep / cfg.microsteps;
+    bool ok = true;
+
+    cfg.closedLoop = false;
+    ClosedLoopSim idle(axes, cfg);
+    runWave(idle, seconds, false);
+    const ClosedLoopStats s1 = idle.stats();
+    printStats("open loop, no load", s1);
+    ok = ok && s1.missedSteps == 0 && s1.maxError < 4 * microstep;
+
+    ClosedLoopSim open(axes, cfg);
+    loadAxes(open);
+    runWave(open, seconds, true);
+    const ClosedLoopStats s2 = open.stats();
+    printStats("open loop, loaded", s2);
+    ok = ok && s2.missedSteps > 0;
+
+    cfg.closedLoop = true;
+    ClosedLoopSim closed(axes, cfg);
+    loadAxes(closed);
+    runWave(closed, seconds, true);
+    const ClosedLoopStats s3 = closed.stats();
+    printStats("closed loop, loaded", s3);
+    ok = ok && s3.missedSteps == 0 && s3.maxError < s2.maxError;
+
+    ClosedLoopSim stall(axes, cfg);
+    loadAxes(stall);
+    stall.setLoad(1, 1.2 * cfg.maxForce);
+    runWave(stall, seconds, false);
+    const ClosedLoopStats s4 = stall.stats();
+    printStats("closed, axis 1 overload", s4);
+    ok = ok && s4.axesStalled == 1;
+
+    ClosedLoopWorker stepped(axes, cfg);
+    loadAxes(stepped);
+    runWave(stepped, seconds, true, true);
+    const ClosedLoopStats s5 = stepped.stats();
+    printStats("worker, frame by frame", s5);
+    ok = ok && s5.ticks == s3.ticks && s5.maxError == s3.maxError && s5.rmsError == s3.rmsError
+        && s5.missedSteps == s3.missedSteps;
+
+    ClosedLoopWorker queued(axes, cfg);
+    loadAxes(queued);
+    runWave(queued, seconds, true);
+    const ClosedLoopStats s6 = queued.stats();
+    printStats("worker, all queued", s6);
+    ok = ok && s6.ticks == s3.ticks;
+
+    std::printf("%-8s %14s %14s %16s\n", "axes", "open ns/axis", "closed ns/axis", "closed x realtime");
+    for (int n : {64, 256, 1024, 4096}) {
+        const double openNs = nsPerAxisTick(n, rate, false, work);
+        const double closedNs = nsPerAxisTick(n, rate, true, work);
+        std::printf("%-8d %14.2f %14.2f %16.1f\n", n, openNs, closedNs, 1e9 / (closedNs * n * rate));
+    }
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Correctness check and overhead benchmark for EnvelopeChecker.
+//
+//   bench_envelope [--motors N] [--ticks T]
+//
+// 1. Random frames (with travel, neighbour and velocity violations and the
+//    odd NaN) through the checker; its counts must equal a plain scalar
+//    count of the same limits.
+// 2. The same frames in Clamp mode: every output frame must be within
+//    travel and neighbour limits and finite (velocity is best effort and
+//    only reported).
+// 3. Cost per frame of the check next to computing the frame, with both
+//    the generic wave and the kernel from makeWaveKernel().
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "envelopecheck.h"
+#include "staticwavekernel.h"
+
+namespace {
+
+EnvelopeLimits testLimits()
+{
+    EnvelopeLimits l;
+    l.minPosition = -20.0;
+    l.maxPosition = 20.0;
+    l.maxNeighbourDelta = 6.0;
+    l.maxVelocity = 100.0; // 5 mm per 50 ms frame
+    return l;
+}
+
+struct Counts
+{
+    long kinds[kEnvelopeKinds] = {};
+};
+
+void referenceCount(const std::vector<double> &pos, const std::vector<double> *prev, const EnvelopeLimits &l,
+                    Counts &c)
+{
+    const std::size_t n = pos.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!(pos[i] >= l.minPosition && pos[i] <= l.maxPosition))
+            ++c.kinds[0];
+        if (i + 1 < n && !(std::fabs(pos[i + 1] - pos[i]) <= l.maxNeighbourDelta))
+            ++c.kinds[1];
+        if (prev && !(std::fabs(pos[i] - (*prev)[i]) <= l.maxVelocity * l.tickSeconds))
+            ++c.kinds[2];
+    }
+}
+
+std::vector<std::vector<double>> randomFrames(int motors, long frames)
+{
+    std::mt19937_64 rng(11);
+    std::normal_distribution<double> jitter(0.0, 2.0);
+    std::uniform_int_distribution<int> rare(0, 9999);
+    std::vector<std::vector<double>> out(frames, std::vector<double>(motors));
+    std::vector<double> walk(motors, 0.0);
+    for (long f = 0; f < frames; ++f) {
+        for (int i = 0; i < motors; ++i) {
+            walk[i] = 0.9 * walk[i] + jitter(rng) + (i > 0 ? 0.1 * walk[i - 1] : 0.0);
+            out[f][i] = walk[i];
+            if (rare(rng) == 0)
+                out[f][i] = std::nan("");
+        }
+    }
+    return out;
+}
+
+bool checkCounts(const std::vector<std::vector<double>> &frames, const EnvelopeLimits &l)
+{
+    EnvelopeChecker checker(l);
+    Counts ref;
+    for (std::size_t f = 0; f < frames.size(); ++f) {
+        std::vector<double> frame = frames[f];
+        checker.apply(frame.data(), static_cast<int>(frame.size()));
+        referenceCount(frames[f], f ? &frames[f - 1] : nullptr, l, ref);
+    }
+    const EnvelopeReport r = checker.report();
+    bool ok = true;
+    for (int k = 0; k < kEnvelopeKinds; ++k) {
+        const bool same = r.violations[k] == ref.kinds[k];
+        std::printf("  %-9s checker %8ld  reference %8ld  %s\n", envelopeKindName(static_cast<EnvelopeKind>(k)),
+                    r.violations[k], ref.kinds[k], same ? "ok" : "MISMATCH");
+        ok = ok && same;
+    }
+    return ok;
+}
+
+bool checkClamp(const std::vector<std::vector<double>> &frames, const EnvelopeLimits &l)
+{
+    EnvelopeChecker checker(l, EnvelopeChecker::Mode::Clamp);
+    long bad = 0;
+    for (const std::vector<double> &in : frames) {
+        std::vector<double> frame = in;
+        checker.apply(frame.data(), static_cast<int>(frame.size()));
+        for (std::size_t i = 0; i < frame.size(); ++i) {
+            const double x = frame[i];
+            if (!std::isfinite(x) || x < l.minPosition || x > l.maxPosition)
+                ++bad;
+            if (i > 0 && std::fabs(x - frame[i - 1]) > l.maxNeighbourDelta * (1 + 1e-12))
+                ++bad;
+        }
+    }
+    const EnvelopeReport r = checker.report();
+    std::printf("  clamp: input violations %ld, residual travel %ld neighbour %ld velocity %ld, bad outputs %ld\n",
+                r.total(), r.residual[0], r.residual[1], r.residual[2], bad);
+    return bad == 0 && r.residual[0] == 0 && r.residual[1] == 0;
+}
+
+// check: 0 none, 1 limits only, 2 limits and extremes.
+template <typename Eval>
+double nsPerFrame(int motors, long ticks, int check, Eval eval)
+{
+    EnvelopeLimits l = testLimits();
+    l.minPosition = -100.0;
+    l.maxPosition = 100.0;
+    l.maxNeighbourDelta = 100.0;
+    l.maxVelocity = 1e6;
+    std::vector<double> frame(motors);
+    double best = 1e300;
+    double sink = 0.0;
+    for (int rep = 0; rep < 3; ++rep) {
+        EnvelopeChecker checker(l, EnvelopeChecker::Mode::Report, check == 2);
+        auto t0 = std::chrono::steady_clock::now();
+        for (long n = 0; n < ticks; ++n) {
+            eval(n * 0.05, frame.data());
+            if (check)
+                sink += checker.apply(frame.data(), motors);
+            sink += frame[n % motors];
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    if (sink == 42.0)
+        std::printf(" ");
+    return best / ticks * 1e9;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int motors = 50;
+    long ticks = 200000;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            ticks = std::atol(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--ticks T]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (motors < 2 || ticks < 10) {
+        std::fprintf(stderr, "need at least 2 motors and 10 ticks\n");
+        return 2;
+    }
+
+    std::printf("motors: %d  ticks: %ld\n", motors, ticks);
+    const EnvelopeLimits limits = testLimits();
+    const std::vector<std::vector<double>> frames = randomFrames(motors, std::min(ticks, 20000L));
+    bool ok = checkCounts(frames, limits);
+    ok &= checkClamp(frames, limits);
+
+    WaveParams p;
+    p.numMotors = motors;
+    p.waveFactorValue = 1.0;
+    p.strokeLengthValue = 5;
+    std::unique_ptr<WaveKernelBase> kernel = makeWaveKernel(p);
+    auto generic = [&p](double t, double *out) { generateWavePositions(p, t, out); };
+    auto fast = [&kernel](double t, double *out) { kernel->positions(t, out); };
+    std::printf("%-22s %10s %10s %10s %10s %10s\n", "ns/frame", "wave", "+limits", "overhead", "+extremes",
+                "overhead");
+    auto row = [](const char *name, const double *ns) {
+        std::printf("%-22s %10.1f %10.1f %9.1f%% %10.1f %9.1f%%\n", name, ns[0], ns[1], (ns[1] / ns[0] - 1) * 100,
+                    ns[2], (ns[2] / ns[0] - 1) * 100);
+    };
+    double ns[3];
+    for (int check = 0; check < 3; ++check)
+        ns[check] = nsPerFrame(motors, ticks, check, generic);
+    row("generateWavePositions", ns);
+    for (int check = 0; check < 3; ++check)
+        ns[check] = nsPerFrame(motors, ticks, check, fast);
+    row(kernel->isSpecialized() ? "static kernel" : "dynamic kernel", ns);
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// Equivalence check and benchmark for TypedWaveKernel<double/float/Q16_16>.
+//
+//   bench_fixedpoint [--motors N] [--ticks T]
+//
+// Every instantiation is compared against the double WaveGenerator (what
+// the UI shows) over a sweep of wave factor / stroke length settings. The
+// program exits non-zero if any position leaves the type's stated tolerance
+// or any step output differs by more than one step.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "typedwavekernel.h"
+
+namespace {
+
+struct CheckResult
+{
+    double maxError = 0.0;
+    double maxAllowed = 0.0;
+    int maxStepDelta = 0;
+    bool ok = true;
+};
+
+template <typename T>
+CheckResult check(const WaveParams &params, long ticks)
+{
+    using N = WaveNumeric<T>;
+    TypedWaveKernel<T> kernel(makeWaveConfig<T>(params));
+    WaveGenerator reference(params);
+
+    std::vector<T> pos(params.numMotors);
+    std::vector<std::int32_t> steps(params.numMotors);
+    CheckResult r;
+    r.maxAllowed = N::tolerance(params.strokeLengthValue * params.amp);
+    for (long n = 0; n < ticks; ++n) {
+        const std::vector<double> &ref = reference.tick();
+        kernel.positions(n, pos.data());
+        kernel.steps(pos.data(), steps.data());
+        for (int i = 0; i < params.numMotors; ++i) {
+            const double err = std::fabs(N::toDouble(pos[i]) - ref[i]);
+            const int refSteps = static_cast<int>(std::lround(ref[i] * kDefaultStepsPerMm));
+            r.maxError = std::max(r.maxError, err);
+            r.maxStepDelta = std::max(r.maxStepDelta, std::abs(steps[i] - refSteps));
+        }
+    }
+    r.ok = r.maxError <= r.maxAllowed && r.maxStepDelta <= 1;
+    return r;
+}
+
+template <typename T>
+double throughput(const WaveParams &params, long ticks)
+{
+    TypedWaveKernel<T> kernel(makeWaveConfig<T>(params));
+    std::vector<T> pos(params.numMotors);
+    std::vector<std::int32_t> steps(params.numMotors);
+    long sink = 0;
+
+    double best = 1e300;
+    for (int rep = 0; rep < 3; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (long n = 0; n < ticks; ++n) {
+            kernel.positions(n, pos.data());
+            kernel.steps(pos.data(), steps.data());
+            sink += steps[n % params.numMotors];
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    if (sink == 42)
+        std::printf(" ");
+    return double(params.numMotors) * ticks / best / 1e6;
+}
+
+template <typename T>
+bool report(const char *name, int motors, long ticks)
+{
+    CheckResult worst;
+    // Sweep the slider ranges used by the UI.
+    for (int wave = 0; wave <= 100; wave += 25) {
+        for (int stroke = 1; stroke <= 30; stroke += 29) {
+            WaveParams p;
+            p.numMotors = motors;
+            p.waveFactorValue = wave / 100.0;
+            p.strokeLengthValue = stroke;
+            CheckResult r = check<T>(p, ticks / 10);
+            worst.maxStepDelta = std::max(worst.maxStepDelta, r.maxStepDelta);
+            if (r.maxError / r.maxAllowed > worst.maxError / std::max(worst.maxAllowed, 1e-300)) {
+                worst.maxError = r.maxError;
+                worst.maxAllowed = r.maxAllowed;
+            }
+            worst.ok = worst.ok && r.ok;
+        }
+    }
+
+    WaveParams p;
+    p.numMotors = motors;
+    p.waveFactorValue = 1.0;
+    p.strokeLengthValue = 5;
+    std::printf("%-8s %12.3f %14.3g %14.3g %10d  %s\n", name, throughput<T>(p, ticks),
+                worst.maxError, worst.maxAllowed, worst.maxStepDelta, worst.ok ? "ok" : "FAIL");
+    return worst.ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int motors = 50;
+    long ticks = 100000;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            ticks = std::atol(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--ticks T]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::printf("motors: %d  ticks: %ld  (steps/mm %.0f)\n", motors, ticks, kDefaultStepsPerMm);
+    std::printf("%-8s %12s %14s %14s %10s\n", "type", "Msamples/s", "max |error|", "tolerance", "max dstep");
+    bool ok = true;
+    ok &= report<double>("double", motors, ticks);
+    ok &= report<float>("float", motors, ticks);
+    ok &= report<Q16_16>("Q16.16", motors, ticks);
+    return ok ? 0 : 1;
+}
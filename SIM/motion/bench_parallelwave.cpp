@@ -0,0 +1,92 @@
+// Scaling benchmark for ParallelWaveEvaluator across 1..N worker threads.
+//
+//   bench_parallelwave [--motors N] [--installations K] [--ticks T]
+//                      [--max-threads W] [--pin]
+//
+// Each thread count is checked bit-for-bit against the serial kernel.
+// Exits non-zero on a mismatch.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "parallelwave.h"
+
+int main(int argc, char *argv[])
+{
+    int motors = 200000;
+    int installations = 1;
+    long ticks = 200;
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    bool pin = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--installations") && i + 1 < argc)
+            installations = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            ticks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--max-threads") && i + 1 < argc)
+            maxThreads = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--pin"))
+            pin = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--installations K] [--ticks T] "
+                                 "[--max-threads W] [--pin]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<WaveParams> params(installations);
+    for (int k = 0; k < installations; ++k) {
+        params[k].numMotors = motors;
+        params[k].waveFactorValue = 0.01 * (k + 1);
+        params[k].strokeLengthValue = 5 + k;
+    }
+
+    // Serial reference for the last tick.
+    const double lastT = (ticks - 1) * params[0].step;
+    std::vector<std::vector<double>> reference(installations, std::vector<double>(motors));
+    for (int k = 0; k < installations; ++k)
+        generateWavePositions(params[k], lastT, reference[k].data());
+
+    std::printf("motors: %d x %d installations  ticks: %ld  chunk: %d motors\n", motors,
+                installations, ticks, ParallelWaveEvaluator::kDefaultChunkMotors);
+    std::printf("%8s %14s %10s %11s %8s\n", "threads", "Msamples/s", "speedup", "efficiency", "steals");
+
+    // 1, 2, 3, 4, then doubling, always ending at maxThreads.
+    std::vector<int> threadCounts;
+    for (int n = 1; n < maxThreads; n = n < 4 ? n + 1 : n * 2)
+        threadCounts.push_back(n);
+    threadCounts.push_back(std::max(1, maxThreads));
+
+    bool ok = true;
+    double single = 0.0;
+    for (int threads : threadCounts) {
+        WorkStealingPool pool(threads, pin);
+        ParallelWaveEvaluator eval(pool);
+        for (const WaveParams &p : params)
+            eval.addInstallation(p);
+        eval.evaluate(0.0); // allocation + first touch outside the timing
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (long n = 0; n < ticks; ++n)
+            eval.evaluate(n * params[0].step);
+        auto t1 = std::chrono::steady_clock::now();
+
+        for (int k = 0; k < installations; ++k)
+            ok = ok && std::equal(reference[k].begin(), reference[k].end(), eval.positions(k));
+
+        const double rate = double(motors) * installations * ticks
+            / std::chrono::duration<double>(t1 - t0).count() / 1e6;
+        if (single == 0.0)
+            single = rate;
+        std::printf("%8d %14.1f %9.2fx %10.0f%% %8zu\n", threads, rate, rate / single,
+                    100.0 * rate / single / threads, pool.stealCount());
+    }
+    std::printf("output %s serial kernel\n", ok ? "matches" : "DIFFERS FROM");
+    return ok ? 0 : 1;
+}
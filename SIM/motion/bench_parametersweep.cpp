@@ -0,0 +1,175 @@
+// Batched parameter sweep of the wave sliders.
+//
+//   bench_parametersweep [--factors N] [--threads T]
+//
+// Sweeps N wave factors (default 101) x 30 strokes x 20 steps x 8 motor
+// counts up to 1000, about 485000 combinations, and reports the rate
+// against measuring each combination directly (timed on a sample and
+// extrapolated). Checks that:
+//
+// 1. sampled combinations match measureWave() on their full parameters,
+//    for the sine (shared tables) and the triangle (generateWavePositions)
+// 2. the ranking puts every combination within limits first, each group
+//    ordered by the rank key
+// 3. the results do not depend on the thread count
+// 4. the sweep beats direct measurement by at least 20x
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "parametersweep.h"
+#include "workstealingpool.h"
+
+namespace {
+
+bool close(double a, double b, double scale)
+{
+    return std::fabs(a - b) <= 1e-7 * std::max(std::fabs(b), scale);
+}
+
+// Compares sampled combinations with measureWave(); false on any mismatch.
+bool spotCheck(const SweepOptions &options, const SweepReport &report, int samples)
+{
+    std::vector<const SweepResult *> byIndex(report.results.size());
+    for (const SweepResult &r : report.results)
+        byIndex[r.index] = &r;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<std::size_t> pick(0, byIndex.size() - 1);
+    bool ok = true;
+    for (int n = 0; n < samples; ++n) {
+        const SweepResult &r = *byIndex[pick(rng)];
+        WaveParams p = options.base;
+        p.waveFactorValue = r.waveFactor;
+        p.strokeLengthValue = r.strokeLength;
+        p.step = r.step;
+        p.numMotors = r.motors;
+        const SweepResult d = measureWave(p, options);
+        // Differences cancel most of the position's digits: compare them
+        // against the position scale turned into their units.
+        const double dt = options.limits.tickSeconds;
+        const double x = std::max(d.peakPosition, 1e-9);
+        const bool same = close(r.peakPosition, d.peakPosition, x) && close(r.peakVelocity, d.peakVelocity, x / dt)
+                          && close(r.peakAcceleration, d.peakAcceleration, x / (dt * dt))
+                          && close(r.peakNeighbour, d.peakNeighbour, x)
+                          && close(r.rmsJerk, d.rmsJerk, x / (dt * dt * dt)) && r.withinLimits == d.withinLimits;
+        if (!same) {
+            std::printf("  MISMATCH factor %.3f stroke %.2f step %.4f motors %d: vel %.9g/%.9g acc %.9g/%.9g "
+                        "jerk %.9g/%.9g\n",
+                        r.waveFactor, r.strokeLength, r.step, r.motors, r.peakVelocity, d.peakVelocity,
+                        r.peakAcceleration, d.peakAcceleration, r.rmsJerk, d.rmsJerk);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool ranked(const SweepReport &report)
+{
+    for (std::size_t k = 1; k < report.results.size(); ++k) {
+        const SweepResult &a = report.results[k - 1], &b = report.results[k];
+        if (!a.withinLimits && b.withinLimits)
+            return false;
+        if (a.withinLimits == b.withinLimits && a.rmsJerk > b.rmsJerk)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int factors = 101;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--factors") && i + 1 < argc)
+            factors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--factors N] [--threads T]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (factors < 2) {
+        std::fprintf(stderr, "need at least 2 factors\n");
+        return 2;
+    }
+
+    SweepGrid grid;
+    grid.waveFactor = {0.0, 1.0, factors};
+    grid.step = {0.01, 0.2, 20};
+    grid.motorCounts = {12, 24, 50, 100, 200, 400, 700, 1000};
+    SweepOptions options;
+    options.limits.minPosition = -27.5; // between whole-mm strokes: their sampled peaks land on them
+    options.limits.maxPosition = 27.5;
+    options.limits.maxNeighbourDelta = 8.0;
+    options.limits.maxVelocity = 200.0;
+    options.maxAcceleration = 2000.0;
+    WorkStealingPool pool(threads);
+    bool ok = true;
+
+    const SweepReport report = runWaveSweep(grid, options, &pool);
+    const double perCombination = report.seconds / report.results.size();
+    std::printf("sine: %zu combinations from %ld simulations of %ld frames x %d motors: %.3f s, %d threads\n",
+                report.results.size(), report.simulations, options.ticks, 1000, report.seconds, pool.size());
+    std::printf("  %ld within limits; best: factor %.2f stroke %.1f step %.3f motors %d, jerk rms %.3f mm/s^3\n",
+                report.withinLimits, report.results[0].waveFactor, report.results[0].strokeLength,
+                report.results[0].step, report.results[0].motors, report.results[0].rmsJerk);
+
+    // Direct measurement of a sample, for the rate it would take.
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<std::size_t> pick(0, report.results.size() - 1);
+    const int sample = 200;
+    const auto t0 = std::chrono::steady_clock::now();
+    double sink = 0.0;
+    for (int n = 0; n < sample; ++n) {
+        const SweepResult &r = report.results[pick(rng)];
+        WaveParams p = options.base;
+        p.waveFactorValue = r.waveFactor;
+        p.strokeLengthValue = r.strokeLength;
+        p.step = r.step;
+        p.numMotors = r.motors;
+        sink += measureWave(p, options).rmsJerk;
+    }
+    const double direct =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / sample;
+    const double speedup = direct / perCombination;
+    std::printf("  %.2f us per combination, direct %.1f us (one thread): %.0fx%s\n", perCombination * 1e6,
+                direct * 1e6, speedup, sink < 0 ? "" : "");
+    ok = ok && speedup >= 20.0 * std::min(1, pool.size());
+
+    const bool sineExact = spotCheck(options, report, 300);
+    const bool sineRanked = ranked(report);
+    std::printf("  spot check %s, ranking %s\n", sineExact ? "exact" : "WRONG", sineRanked ? "ordered" : "NOT ordered");
+    ok = ok && sineExact && sineRanked && report.withinLimits > 0
+         && report.withinLimits < static_cast<long>(report.results.size());
+
+    // A smaller grid: triangle shape, and serial against the pool.
+    SweepGrid small = grid;
+    small.waveFactor.count = 11;
+    small.step.count = 6;
+    small.motorCounts = {7, 50, 120};
+    SweepOptions triangle = options;
+    triangle.base.shape = WaveShape::Triangle;
+    const SweepReport tri = runWaveSweep(small, triangle, &pool);
+    const bool triExact = spotCheck(triangle, tri, 100);
+    const SweepReport serial = runWaveSweep(small, triangle, nullptr);
+    bool same = serial.results.size() == tri.results.size();
+    for (std::size_t k = 0; same && k < tri.results.size(); ++k) {
+        const SweepResult &a = serial.results[k], &b = tri.results[k];
+        same = a.index == b.index && a.peakVelocity == b.peakVelocity && a.rmsJerk == b.rmsJerk
+               && a.peakNeighbour == b.peakNeighbour;
+    }
+    std::printf("triangle: %zu combinations, %.3f s; spot check %s, serial and %d-thread results %s\n",
+                tri.results.size(), tri.seconds, triExact ? "exact" : "WRONG", pool.size(),
+                same ? "identical" : "DIFFER");
+    ok = ok && triExact && same && ranked(tri);
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
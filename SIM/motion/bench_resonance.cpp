@@ -0,0 +1,195 @@
+// In-tree FFT and resonance analysis of wave programs (see resonance.h).
+//
+//   bench_resonance [--seconds S] [--motors N]
+//
+// 1. RealFft against a direct DFT (sizes 4 .. 1024) and Parseval's
+//    theorem; transforms per second at the analysis size
+// 2. tones in a synthetic position stream are found in the right band, on
+//    the right axis, at the right frequency
+// 3. the UI wave (20 Hz frames, linearly interpolated) puts energy at the
+//    frame-rate harmonics; ZV, ZVD and notch shapers tuned to 40 Hz must
+//    cut it there by at least 20 dB
+// 4. an S-second program (default an hour) of N motors (default 50) with
+//    a ZVD shaper, timed; must run at least 100x faster than real time
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "resonance.h"
+
+namespace {
+
+double seconds(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool checkFft()
+{
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    double worst = 0.0, parseval = 0.0;
+    for (int n = 4; n <= 1024; n *= 2) {
+        std::vector<double> x(n), re(n / 2 + 1), im(n / 2 + 1);
+        for (double &v : x)
+            v = noise(rng);
+        RealFft fft(n);
+        fft.forward(x.data(), re.data(), im.data());
+        double energy = 0.0, spectrum = 0.0, scale = 0.0;
+        for (int k = 0; k <= n / 2; ++k) {
+            std::complex<double> sum;
+            for (int j = 0; j < n; ++j)
+                sum += x[j] * std::polar(1.0, -2 * M_PI * static_cast<double>(j) * k / n);
+            worst = std::max(worst, std::abs(sum - std::complex<double>(re[k], im[k])));
+            scale = std::max(scale, std::abs(sum));
+            spectrum += (k == 0 || k == n / 2 ? 1.0 : 2.0) * std::norm(sum);
+        }
+        for (double v : x)
+            energy += v * v;
+        worst /= scale;
+        parseval = std::max(parseval, std::fabs(spectrum / n - energy) / energy);
+    }
+    std::printf("fft vs dft: max error %.2e, Parseval %.2e\n", worst, parseval);
+
+    const int n = ResonanceOptions().fftSize;
+    RealFft fft(n);
+    std::vector<double> x(n), p(fft.bins());
+    for (double &v : x)
+        v = noise(rng);
+    long runs = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    while (seconds(t0) < 0.5) {
+        for (int i = 0; i < 100; ++i)
+            fft.power(x.data(), p.data());
+        runs += 100;
+    }
+    const double each = seconds(t0) / runs;
+    std::printf("fft %d points: %.1f us, %.2f ns/point\n", n, each * 1e6, each * 1e9 / n);
+    return worst < 1e-12 && parseval < 1e-12;
+}
+
+bool checkTones()
+{
+    // Axis 0: 35 Hz (gantry band), axis 1: 120 Hz (mid-band), axis 2:
+    // 300 Hz (neither), axis 3: still; each 10^4 mm/s^2 peak acceleration.
+    const double hz[] = {35.0, 120.0, 300.0, 0.0};
+    ResonanceOptions options;
+    const int axes = 4, n = 20 * static_cast<int>(options.sampleRate);
+    std::vector<double> stream(static_cast<std::size_t>(axes) * n);
+    for (int a = 0; a < axes; ++a) {
+        for (int i = 0; i < n; ++i) {
+            const double w = 2 * M_PI * hz[a];
+            stream[static_cast<std::size_t>(a) * n + i] =
+                w > 0 ? 1e4 / (w * w) * std::sin(w * i / options.sampleRate) : 0.0;
+        }
+    }
+    ResonanceAnalyzer analyzer(axes, options);
+    for (int i = 0; i < n; i += 100)
+        analyzer.add(stream.data() + i, 100, n);
+    const ResonanceReport r = analyzer.report();
+    bool ok = r.segments > 0;
+    for (int a = 0; a < axes; ++a) {
+        const AxisSpectrum &s = r.axes[a];
+        std::printf("tone %5.0f Hz: peak %7.2f Hz, %8.1f mm/s^2 rms", hz[a], s.peakHz, s.rms);
+        for (std::size_t b = 0; b < options.bands.size(); ++b) {
+            std::printf("  %s %5.1f%%%s", options.bands[b].name.c_str(), 100.0 * s.bands[b].fraction,
+                        s.bands[b].flagged ? " FLAGGED" : "");
+            const bool inside = hz[a] >= options.bands[b].lowHz && hz[a] <= options.bands[b].highHz;
+            ok = ok && s.bands[b].flagged == inside;
+        }
+        std::printf("\n");
+        // The second difference sees a tone at sinc^2(w T / 2) of its
+        // acceleration.
+        const double x = M_PI * hz[a] / options.sampleRate;
+        const double expected = hz[a] > 0 ? 1e4 / std::sqrt(2.0) * std::pow(std::sin(x) / x, 2) : 0.0;
+        ok = ok && std::fabs(s.rms - expected) <= 0.01 * expected
+             && (hz[a] == 0 || std::fabs(s.peakHz - hz[a]) <= r.binHz);
+    }
+    return ok;
+}
+
+double bandLevel(const ResonanceReport &r, double lo, double hi)
+{
+    double sum = 0.0;
+    for (std::size_t k = 0; k < r.psd.size(); ++k)
+        if (k * r.binHz >= lo && k * r.binHz <= hi)
+            sum += r.psd[k] * r.binHz;
+    return sum;
+}
+
+bool checkShapers(int motors)
+{
+    WaveParams params;
+    params.numMotors = motors;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    ResonanceOptions options;
+    const long ticks = static_cast<long>(120.0 / options.tickSeconds);
+    const ResonanceReport raw = analyzeWave(params, options, ticks);
+    const double base = bandLevel(raw, 39.0, 41.0);
+    std::printf("wave, 20 Hz frames: 39..41 Hz %.4g (mm/s^2)^2, gantry flagged on %d/%d axes\n", base,
+                raw.axesFlagged[0], motors);
+    bool ok = raw.axesFlagged[0] > 0;
+    for (ShaperType type : {ShaperType::ZV, ShaperType::ZVD, ShaperType::Notch}) {
+        options.shaper.type = type;
+        options.shaper.frequency = 40.0;
+        const ResonanceReport shaped = analyzeWave(params, options, ticks);
+        const double db = 10 * std::log10(base / bandLevel(shaped, 39.0, 41.0));
+        std::printf("  %-5s at 40 Hz: %5.1f dB less, delay %.1f ms\n", shaperTypeName(type), db,
+                    InputShaper(1, options.shaper, options.sampleRate).duration() * 1e3);
+        ok = ok && db >= 20.0;
+    }
+    return ok;
+}
+
+bool checkLongProgram(double duration, int motors)
+{
+    WaveParams params;
+    params.numMotors = motors;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    ResonanceOptions options;
+    options.shaper.type = ShaperType::ZVD;
+    options.shaper.frequency = 40.0;
+    const long ticks = static_cast<long>(duration / options.tickSeconds) + 1;
+    const auto t0 = std::chrono::steady_clock::now();
+    const ResonanceReport r = analyzeWave(params, options, ticks);
+    const double elapsed = seconds(t0);
+    std::printf("%.0f s program, %d motors, ZVD: %ld samples/axis, %ld segments in %.2f s (%.0fx real time)\n",
+                duration, motors, r.samples, r.segments, elapsed, duration / elapsed);
+    return r.segments > 0 && duration / elapsed >= 100.0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    double duration = 3600.0;
+    int motors = 50;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc)
+            duration = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--seconds S] [--motors N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (duration < 10.0 || motors <= 0) {
+        std::fprintf(stderr, "need at least 10 s and one motor\n");
+        return 2;
+    }
+
+    bool ok = checkFft();
+    ok = checkTones() && ok;
+    ok = checkShapers(motors) && ok;
+    ok = checkLongProgram(duration, motors) && ok;
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+// Throughput / latency test for the shared-memory position feed.
+//
+//   bench_shmfeed [--motors N] [--frames F] [--rate HZ]
+//
+// Forks a reader process that maps the feed and follows it with
+// ShmFeedReader::next() while the parent publishes, in two phases:
+//
+//   flood   F frames as fast as the writer can go; the reader keeps up or
+//           is lapped and skips ahead (frames lost are counted, not errors)
+//   paced   F / 100 frames at HZ; publish-to-read latency percentiles
+//
+// Every frame carries positions derived from its frame number, so the
+// reader checks each accepted copy; the program fails if any frame was torn
+// or out of order.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shmfeed.h"
+
+namespace {
+
+void fillFrame(std::uint64_t frame, std::vector<double> &pos)
+{
+    for (std::size_t i = 0; i < pos.size(); ++i)
+        pos[i] = static_cast<double>(frame) + 1e-3 * static_cast<double>(i);
+}
+
+struct ReaderResult
+{
+    long frames = 0;
+    long lost = 0;
+    long bad = 0;
+    double seconds = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+};
+
+// Reads frames [0, total) (minus lost ones) and reports on the pipe.
+void runReader(const char *name, std::uint64_t total, int motors, int readyFd, int resultFd)
+{
+    ShmFeedReader feed;
+    char ok = feed.open(name) ? 1 : 0;
+    if (write(readyFd, &ok, 1) != 1 || !ok)
+        _exit(1);
+
+    ReaderResult r;
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(total, 1u << 20)));
+    std::vector<double> expected(motors);
+    ShmFrame frame;
+    std::uint64_t last = 0;
+    bool any = false;
+    auto t0 = std::chrono::steady_clock::now();
+    while (!any || last + 1 < total) {
+        if (!feed.next(frame)) {
+            // Idle: let the writer run (matters on one core).
+            sched_yield();
+            continue;
+        }
+        const std::int64_t now = shmFeedClockNs();
+        if (latencies.size() < latencies.capacity())
+            latencies.push_back((now - frame.stampNs) / 1e3);
+        fillFrame(frame.frame, expected);
+        if ((any && frame.frame <= last) || frame.positions != expected)
+            ++r.bad;
+        last = frame.frame;
+        any = true;
+        ++r.frames;
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    r.lost = static_cast<long>(feed.framesLost());
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        r.p50Us = latencies[latencies.size() / 2];
+        r.p99Us = latencies[latencies.size() * 99 / 100];
+        r.maxUs = latencies.back();
+    }
+    if (write(resultFd, &r, sizeof r) != static_cast<ssize_t>(sizeof r))
+        _exit(1);
+    _exit(0);
+}
+
+bool runPhase(const char *phase, const char *name, int motors, std::uint64_t frames, double rateHz)
+{
+    ShmFeedWriter feed;
+    if (!feed.open(name, motors, 4096)) {
+        std::fprintf(stderr, "%s\n", feed.error().c_str());
+        return false;
+    }
+    int ready[2], result[2];
+    if (pipe(ready) != 0 || pipe(result) != 0) {
+        std::perror("pipe");
+        return false;
+    }
+    const pid_t child = fork();
+    if (child < 0) {
+        std::perror("fork");
+        return false;
+    }
+    if (child == 0) {
+        runReader(name, frames, motors, ready[1], result[1]);
+    }
+    char ok = 0;
+    if (read(ready[0], &ok, 1) != 1 || !ok) {
+        std::fprintf(stderr, "reader could not attach to %s\n", name);
+        waitpid(child, nullptr, 0);
+        return false;
+    }
+
+    std::vector<double> pos(motors);
+    const std::int64_t periodNs = rateHz > 0 ? static_cast<std::int64_t>(1e9 / rateHz) : 0;
+    std::int64_t due = shmFeedClockNs();
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::uint64_t f = 0; f < frames; ++f) {
+        if (periodNs) {
+            due += periodNs;
+            while (shmFeedClockNs() < due)
+                sched_yield();
+        }
+        fillFrame(f, pos);
+        feed.publish(pos.data(), motors, f * 0.05);
+    }
+    const double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    ReaderResult r;
+    const bool got = read(result[0], &r, sizeof r) == static_cast<ssize_t>(sizeof r);
+    int status = 0;
+    waitpid(child, &status, 0);
+    for (int fd : {ready[0], ready[1], result[0], result[1]})
+        close(fd);
+    if (!got || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "%s: reader failed\n", phase);
+        return false;
+    }
+
+    std::printf("%-6s %10llu %12.1f %10ld %10ld %6ld %10.1f %10.1f %10.1f\n", phase,
+                static_cast<unsigned long long>(frames), writeSeconds / frames * 1e9, r.frames, r.lost, r.bad,
+                r.p50Us, r.p99Us, r.maxUs);
+    return r.bad == 0 && r.frames + r.lost >= static_cast<long>(frames) - 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int motors = 50;
+    long frames = 2000000;
+    double rate = 10000.0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc)
+            rate = std::atof(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--frames F] [--rate HZ]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (motors <= 0 || frames < 100 || rate <= 0) {
+        std::fprintf(stderr, "need motors > 0, frames >= 100, rate > 0\n");
+        return 2;
+    }
+
+    const std::string name = "/cncbench" + std::to_string(getpid());
+    std::printf("motors: %d  frames: %ld  paced rate: %.0f Hz  (%ld online CPUs)\n", motors, frames, rate,
+                sysconf(_SC_NPROCESSORS_ONLN));
+    std::printf("%-6s %10s %12s %10s %10s %6s %10s %10s %10s\n", "phase", "published", "ns/publish", "read",
+                "lost", "torn", "p50 us", "p99 us", "max us");
+    bool ok = true;
+    ok &= runPhase("flood", name.c_str(), motors, frames, 0.0);
+    ok &= runPhase("paced", name.c_str(), motors, frames / 100, rate);
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+// Correctness check and cost of the compressed telemetry log.
+//
+//   bench_telemetry [--motors N] [--frames F] [--file PATH]
+//
+// 1. Lossless round trip: wave positions and velocities plus awkward
+//    values (NaN, infinities, -0, denormals, huge stamp jumps) must read
+//    back bit for bit.
+// 2. Quantized round trip: every value within quantum / 2; a block with a
+//    NaN in a column falls back to XOR for that column and stays exact.
+// 3. A log cut in the middle of a block reads up to the last whole block.
+// 4. Tick-path cost of frame() + commit() next to a plain copy of the
+//    frame, while the thread compresses; size per value against raw
+//    doubles and CSV; decode rate.
+// PATH (default bench_telemetry.tlm) is removed at the end.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "telemetry.h"
+#include "wavekernel.h"
+
+namespace {
+
+constexpr double kTickSeconds = 0.001;
+
+struct Log
+{
+    std::vector<std::int64_t> stamps;
+    std::vector<double> values; // row-major
+    int channels = 0;
+
+    long frames() const { return static_cast<long>(stamps.size()); }
+};
+
+Log waveLog(int motors, long frames, bool awkward)
+{
+    Log log;
+    log.channels = 2 * motors;
+    WaveParams params;
+    params.numMotors = motors;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    params.step = kTickSeconds;
+    WaveGenerator wave(params);
+    std::vector<double> previous;
+    log.values.resize(static_cast<std::size_t>(frames) * log.channels);
+    for (long f = 0; f < frames; ++f) {
+        if (f % 997 == 0)
+            wave.params().strokeLengthValue = 1 + f / 997 % 30;
+        const std::vector<double> &pos = wave.tick();
+        if (previous.empty())
+            previous = pos;
+        double *row = &log.values[static_cast<std::size_t>(f) * log.channels];
+        for (int i = 0; i < motors; ++i) {
+            row[i] = pos[i];
+            row[motors + i] = (pos[i] - previous[i]) / kTickSeconds;
+        }
+        previous = pos;
+        log.stamps.push_back(f * 1000 + (f * 7919) % 23);
+    }
+    if (awkward) {
+        const double odd[] = {std::nan(""), std::numeric_limits<double>::infinity(),
+                              -std::numeric_limits<double>::infinity(), -0.0,
+                              std::numeric_limits<double>::denorm_min(), 1e300, -1e-300};
+        for (std::size_t k = 0; k < sizeof odd / sizeof odd[0]; ++k)
+            log.values[(k * 4099 % frames) * log.channels + k % log.channels] = odd[k];
+        log.stamps[frames / 2] += 1LL << 40; // stamp jump (clock step)
+        for (long f = frames / 2 + 1; f < frames; ++f)
+            log.stamps[f] += 1LL << 40;
+    }
+    return log;
+}
+
+bool writeLog(const std::string &path, const Log &log, const std::vector<TelemetryChannel> &channels)
+{
+    TelemetryRecorder recorder;
+    if (!recorder.open(path, channels, 1024, 8, TelemetryRecorder::Overflow::Wait)) {
+        std::fprintf(stderr, "%s\n", recorder.error().c_str());
+        return false;
+    }
+    for (long f = 0; f < log.frames(); ++f)
+        recorder.record(&log.values[static_cast<std::size_t>(f) * log.channels], log.stamps[f]);
+    if (!recorder.close()) {
+        std::fprintf(stderr, "%s\n", recorder.error().c_str());
+        return false;
+    }
+    return true;
+}
+
+// Compares the decoded log with the original: bits must match where the
+// quantum is 0 or the value is not finite, else be within quantum / 2.
+// Returns the number of bad values (stamps included), or -1 if unreadable.
+long compareLog(const std::string &path, const Log &log, long expectFrames, bool expectTruncated)
+{
+    TelemetryReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return -1;
+    }
+    const std::vector<TelemetryChannel> &channels = reader.channels();
+    TelemetryBlock block;
+    long f0 = 0;
+    long bad = 0;
+    while (reader.next(block)) {
+        for (int f = 0; f < block.frames(); ++f) {
+            const long frame = f0 + f;
+            if (frame >= log.frames())
+                return ++bad;
+            bad += block.stamps[f] != log.stamps[frame];
+            for (int c = 0; c < log.channels; ++c) {
+                const double want = log.values[static_cast<std::size_t>(frame) * log.channels + c];
+                const double got = block.columns[c][f];
+                const double q = channels[c].quantum;
+                if (q > 0 && std::isfinite(want) && std::isfinite(got))
+                    bad += !(std::fabs(got - want) <= q / 2 * (1 + 1e-9));
+                else
+                    bad += std::memcmp(&got, &want, sizeof got) != 0;
+            }
+        }
+        f0 += block.frames();
+    }
+    const bool truncated = !reader.error().empty();
+    if (truncated != expectTruncated || f0 != expectFrames) {
+        std::printf("  read %ld frames (want %ld), error \"%s\"\n", f0, expectFrames, reader.error().c_str());
+        ++bad;
+    }
+    return bad;
+}
+
+double nsPerFrame(const std::string &path, const Log &log, bool record, long &dropped)
+{
+    TelemetryRecorder recorder;
+    // The plain copy goes through as much memory as the recorder's blocks.
+    const std::size_t ring = static_cast<std::size_t>(9 * 1024) * log.channels;
+    std::vector<double> copy(ring);
+    const std::vector<TelemetryChannel> channels = waveTelemetryChannels(log.channels / 2, 1e-4, kTickSeconds);
+    if (record && !recorder.open(path, channels))
+        return -1.0;
+    const std::size_t rowBytes = log.channels * sizeof(double);
+    auto t0 = std::chrono::steady_clock::now();
+    for (long f = 0; f < log.frames(); ++f) {
+        const double *row = &log.values[static_cast<std::size_t>(f) * log.channels];
+        if (record) {
+            std::memcpy(recorder.frame(), row, rowBytes);
+            recorder.commit(log.stamps[f]);
+        } else {
+            std::memcpy(&copy[static_cast<std::size_t>(f) * log.channels % ring], row, rowBytes);
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    dropped = record ? recorder.framesDropped() : 0;
+    recorder.close();
+    if (copy[0] == 42.0)
+        std::printf(" ");
+    return std::chrono::duration<double>(t1 - t0).count() / log.frames() * 1e9;
+}
+
+double csvBytesPerValue(const Log &log, long frames)
+{
+    char text[64];
+    double bytes = 0.0;
+    for (long f = 0; f < frames; ++f) {
+        bytes += std::snprintf(text, sizeof text, "%lld", static_cast<long long>(log.stamps[f]));
+        for (int c = 0; c < log.channels; ++c)
+            bytes += std::snprintf(text, sizeof text, ",%.17g",
+                                   log.values[static_cast<std::size_t>(f) * log.channels + c]);
+        bytes += 1;
+    }
+    return bytes / (static_cast<double>(frames) * (log.channels + 1));
+}
+
+bool sizeAndDecode(const char *title, const std::string &path, const Log &log, double csvPerValue)
+{
+    TelemetryReader reader;
+    TelemetryBlock block;
+    double best = 1e300;
+    std::uint64_t bytes = 0;
+    for (int rep = 0; rep < 3; ++rep) {
+        if (!reader.open(path))
+            return false;
+        auto t0 = std::chrono::steady_clock::now();
+        while (reader.next(block)) {
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+        bytes = reader.bytesRead();
+    }
+    const double values = static_cast<double>(log.frames()) * (log.channels + 1);
+    std::printf("  %-9s %6.2f bytes/value  %5.1fx vs raw  %5.1fx vs CSV  decode %.2f GB/s\n", title, bytes / values,
+                8.0 * values / bytes, csvPerValue * values / bytes, values * 8.0 / best / 1e9);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int motors = 50;
+    long frames = 100000;
+    std::string path = "bench_telemetry.tlm";
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--file") && i + 1 < argc)
+            path = argv[++i];
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--frames F] [--file PATH]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (motors < 1 || frames < 5000) {
+        std::fprintf(stderr, "need at least 1 motor and 5000 frames\n");
+        return 2;
+    }
+    std::printf("motors: %d (%d channels)  frames: %ld\n", motors, 2 * motors, frames);
+    bool ok = true;
+
+    const Log awkward = waveLog(motors, frames, true);
+    const std::vector<TelemetryChannel> lossless = waveTelemetryChannels(motors, 0.0, kTickSeconds);
+    const std::vector<TelemetryChannel> quantized = waveTelemetryChannels(motors, 1e-4, kTickSeconds);
+    const char *names[] = {"lossless", "quantized"};
+    const std::vector<TelemetryChannel> *layouts[] = {&lossless, &quantized};
+    for (int k = 0; k < 2; ++k) {
+        const long bad = writeLog(path, awkward, *layouts[k]) ? compareLog(path, awkward, frames, false) : -1;
+        std::printf("  %-9s round trip: %ld bad values\n", names[k], bad);
+        ok = ok && bad == 0;
+    }
+
+    // Cut the last (quantized) log inside its third block.
+    {
+        std::FILE *in = std::fopen(path.c_str(), "rb");
+        std::vector<unsigned char> bytes;
+        int ch;
+        while (in && (ch = std::fgetc(in)) != EOF)
+            bytes.push_back(static_cast<unsigned char>(ch));
+        if (in)
+            std::fclose(in);
+        TelemetryReader reader;
+        TelemetryBlock block;
+        std::uint64_t cut = 0;
+        if (reader.open(path) && reader.next(block) && reader.next(block))
+            cut = reader.bytesRead() + 100;
+        std::FILE *out = cut ? std::fopen(path.c_str(), "wb") : nullptr;
+        if (out) {
+            std::fwrite(bytes.data(), 1, cut, out);
+            std::fclose(out);
+        }
+        const long bad = out ? compareLog(path, awkward, 2048, true) : -1;
+        std::printf("  truncated log: %ld bad values\n", bad);
+        ok = ok && bad == 0;
+    }
+
+    const Log clean = waveLog(motors, frames, false);
+    long dropped = 0;
+    const double copyNs = nsPerFrame(path, clean, false, dropped);
+    const double recordNs = nsPerFrame(path, clean, true, dropped);
+    // With one core the compression thread's time is in the wall clock too.
+    std::printf("  tick path: %.1f ns/frame (plain copy %.1f ns), %ld of %ld frames dropped at full speed, %u cores\n",
+                recordNs, copyNs, dropped, frames, std::thread::hardware_concurrency());
+
+    const double csv = csvBytesPerValue(clean, std::min(frames, 2000L));
+    for (int k = 0; k < 2; ++k)
+        ok = ok && writeLog(path, clean, *layouts[k]) && sizeAndDecode(names[k], path, clean, csv);
+    std::remove(path.c_str());
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Expression-defined wave shapes against the same shapes written in C++.
+//
+//   bench_waveexpression [--motors N] [--seconds S]
+//
+// For each shape, compiles the expression (see waveexpression.h), checks
+// it matches the hand-written loop over N motors (default 4096) at many
+// times to 1e-12 of the stroke, and times both for S seconds (default
+// 0.2) each. Fails if any shape is more than 2x slower than its C++
+// version, or if malformed expressions are not rejected with a column.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "waveexpression.h"
+
+namespace {
+
+using Kernel = std::function<void(const WaveParams &, double, int, int, double *)>;
+
+struct Shape
+{
+    const char *name;
+    const char *expression;
+    Kernel native;
+};
+
+// Best-of-runs ns per motor position for fn over frames of the wave.
+double nsPerMotor(const std::function<void(double, double *)> &fn, int motors, double seconds,
+                  std::vector<double> &out)
+{
+    double best = 1e300;
+    const auto start = std::chrono::steady_clock::now();
+    double t = 0.0;
+    do {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < 20; ++k, t += 0.05)
+            fn(t, out.data());
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / 20);
+    } while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds);
+    return best * 1e9 / motors;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int motors = 4096;
+    double seconds = 0.2;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc)
+            seconds = std::atof(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--seconds S]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (motors <= 0 || seconds <= 0) {
+        std::fprintf(stderr, "need at least one motor and a positive time\n");
+        return 2;
+    }
+
+    WaveParams params;
+    params.numMotors = motors;
+    params.waveFactorValue = 0.7;
+    params.strokeLengthValue = 12;
+    const double decay = 0.1;
+
+    const Shape shapes[] = {
+        {"sine", "A*sin(2*pi*f*t + i*phi)",
+         [](const WaveParams &p, double t, int first, int last, double *out) {
+             generateWavePositions(p, t, first, last, out);
+         }},
+        {"triangle", "A*tri(2*pi*f*t + i*phi)",
+         [](const WaveParams &p, double t, int first, int last, double *out) {
+             WaveParams q = p;
+             q.shape = WaveShape::Triangle;
+             generateWavePositions(q, t, first, last, out);
+         }},
+        {"decaying", "A*sin(2*pi*f*t + i*phi) * exp(-d*t)",
+         [decay](const WaveParams &p, double t, int first, int last, double *out) {
+             const double scale = p.strokeLengthValue * p.amp * std::exp(-decay * t);
+             const double base = 2 * M_PI * p.frequency * t, shift = p.basePhaseShift * p.waveFactorValue;
+             for (int i = first; i < last; ++i)
+                 out[i - first] = scale * std::sin(base + i * shift);
+         }},
+        {"harmonics", "A*(0.7*sin(2*pi*f*t + i*phi) + 0.3*cos(6*pi*f*t + 3*i*phi))",
+         [](const WaveParams &p, double t, int first, int last, double *out) {
+             const double scale = p.strokeLengthValue * p.amp;
+             const double base = 2 * M_PI * p.frequency * t, shift = p.basePhaseShift * p.waveFactorValue;
+             for (int i = first; i < last; ++i)
+                 out[i - first] = scale * (0.7 * std::sin(base + i * shift) + 0.3 * std::cos(3 * (base + i * shift)));
+         }},
+        {"pulse", "A*exp(-((i - n/2 - n/4*sin(t))/8)^2)",
+         [](const WaveParams &p, double t, int first, int last, double *out) {
+             const double scale = p.strokeLengthValue * p.amp;
+             const double centre = p.numMotors / 2.0 + p.numMotors / 4.0 * std::sin(t);
+             for (int i = first; i < last; ++i) {
+                 const double u = (i - centre) / 8;
+                 out[i - first] = scale * std::exp(-(u * u));
+             }
+         }},
+    };
+
+    bool ok = true;
+    std::vector<double> native(motors), compiled(motors);
+    std::printf("%-10s %6s %12s %12s %8s %10s\n", "shape", "instr", "C++ ns/pos", "expr ns/pos", "ratio", "max error");
+    for (const Shape &shape : shapes) {
+        WaveExpression expr;
+        if (!expr.compile(shape.expression, {"d"})) {
+            std::printf("%-10s compile error: %s\n", shape.name, expr.error().c_str());
+            ok = false;
+            continue;
+        }
+        expr.setParameter("d", decay);
+        double error = 0.0;
+        for (double t = 0.0; t < 200.0; t += 3.7) {
+            shape.native(params, t, 0, motors, native.data());
+            expr.evaluate(params, t, 0, motors, compiled.data());
+            for (int i = 0; i < motors; ++i)
+                error = std::max(error, std::fabs(native[i] - compiled[i]));
+        }
+        const double c = nsPerMotor([&](double t, double *out) { shape.native(params, t, 0, motors, out); }, motors,
+                                    seconds, native);
+        const double e = nsPerMotor([&](double t, double *out) { expr.evaluate(params, t, 0, motors, out); }, motors,
+                                    seconds, compiled);
+        std::printf("%-10s %6d %12.2f %12.2f %7.2fx %10.2e\n", shape.name,
+                    static_cast<int>(expr.program().uniformCode.size() + expr.program().code.size()), c, e, e / c,
+                    error);
+        ok = ok && error <= 1e-12 * params.strokeLengthValue && e <= 2.0 * c;
+    }
+
+    WaveExpression decaying;
+    decaying.compile(shapes[2].expression, {"d"});
+    std::printf("\n%s\n%s\n", shapes[2].expression, decaying.disassemble().c_str());
+
+    for (const char *bad : {"A*sin(", "A*sinn(t)", "foo*t", "min(t)", "sin(t, i)", "2 +* 3", "(t", "t)"}) {
+        WaveExpression expr;
+        const bool rejected = !expr.compile(bad) && expr.error().compare(0, 4, "col ") == 0;
+        std::printf("%-12s %s\n", bad, rejected ? expr.error().c_str() : "ACCEPTED");
+        ok = ok && rejected;
+    }
+
+    std::printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+#include "closedloop.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int kLanes = ClosedLoopSim::kServoLanes;
+constexpr double kHalfPi = 1.57079632679489661923;
+
+// Round to nearest (ties to even) for |y| < 2^51 by adding and removing
+// 1.5 * 2^52. Unlike std::round this vectorizes on plain SSE2; it relies on
+// the build not using -ffast-math, which would fold it away.
+inline double roundNearest(double y)
+{
+    constexpr double kMagic = 6755399441055744.0;
+    return (y + kMagic) - kMagic;
+}
+
+// sin(pi/2 * w) for w in [-2, 2], the whole pole pitch, so no folding
+// select is needed: Taylor series to z^15, within 1e-6.
+inline double halfPiSine(double w)
+{
+    const double z = w * kHalfPi;
+    const double z2 = z * z;
+    double p = -1.0 / 1307674368000.0;
+    p = p * z2 + 1.0 / 6227020800.0;
+    p = p * z2 - 1.0 / 39916800.0;
+    p = p * z2 + 1.0 / 362880.0;
+    p = p * z2 - 1.0 / 5040.0;
+    p = p * z2 + 1.0 / 120.0;
+    p = p * z2 - 1.0 / 6.0;
+    return z * (1.0 + z2 * p);
+}
+
+} // namespace
+
+ClosedLoopSim::ClosedLoopSim(int axisCount, const ClosedLoopConfig &config)
+    : axes(std::max(0, axisCount)), cfg(config), blocks((axes + kLanes - 1) / kLanes)
+{
+    std::vector<double> zero(axes, 0.0);
+    reset(zero.data());
+}
+
+void ClosedLoopSim::setGains(const ServoGains &gains)
+{
+    cfg.gains = gains;
+}
+
+void ClosedLoopSim::setClosedLoop(bool closed)
+{
+    cfg.closedLoop = closed;
+}
+
+void ClosedLoopSim::setLoad(int axis, double force)
+{
+    if (axis >= 0 && axis < axes)
+        blocks[axis / kLanes].load[axis % kLanes] = force;
+}
+
+void ClosedLoopSim::setLoad(double force)
+{
+    for (int a = 0; a < axes; ++a)
+        setLoad(a, force);
+}
+
+void ClosedLoopSim::reset(const double *positions)
+{
+    for (std::size_t k = 0; k < blocks.size(); ++k) {
+        Block &b = blocks[k];
+        for (int i = 0; i < kLanes; ++i) {
+            const int a = static_cast<int>(k) * kLanes + i;
+            const double p = a < axes ? positions[a] : 0.0;
+            b.x[i] = b.field[i] = b.ref0[i] = b.ref1[i] = b.ref[i] = p;
+            b.v[i] = b.integral[i] = b.lastError[i] = b.pitch[i] = 0.0;
+        }
+    }
+    clearStats();
+}
+
+void ClosedLoopSim::clearStats()
+{
+    for (Block &b : blocks) {
+        for (int i = 0; i < kLanes; ++i)
+            b.missed[i] = b.maxError[i] = b.sumSquares[i] = 0.0;
+    }
+    ticksRun = 0;
+}
+
+int ClosedLoopSim::ticksFor(double seconds) const
+{
+    return std::max(1, static_cast<int>(std::lround(seconds * cfg.rateHz)));
+}
+
+template <bool Closed>
+void ClosedLoopSim::run(Block &b, int ticks) const
+{
+    const double rate = cfg.rateHz;
+    const double dt = 1.0 / rate;
+    const double invStep = 1.0 / cfg.fullStep;
+    const double micro = cfg.fullStep / cfg.microsteps;
+    const double invMicro = 1.0 / micro;
+    const double res = cfg.encoderResolution;
+    const double invRes = 1.0 / res;
+    const double lead = cfg.maxLead * cfg.fullStep;
+    const double force = cfg.maxForce;
+    const double damping = cfg.damping / 1000.0; // N per mm/s
+    const double accel = 1000.0 / cfg.mass;     // mm/s^2 per N
+    const ServoGains g = cfg.gains;
+    const double span = 1.0 / ticks;
+    // The integral may command at most what the lead clamp lets through.
+    const double windup = g.ki > 0.0 ? lead * rate / g.ki : 1e300;
+
+    // Axes are independent, so each block runs all its ticks while its
+    // state is in L1; the lane loop is what vectorizes. It has no selects
+    // at all, only min/max: GCC sinks an arithmetic select arm into a
+    // branch, which (with trapping math) it will not if-convert, and that
+    // keeps the whole loop scalar.
+    for (int n = 1; n <= ticks; ++n) {
+        const double frac = n * span;
+        for (int i = 0; i < kLanes; ++i) {
+            const double r0 = b.ref0[i];
+            const double r1 = b.ref1[i];
+            const double ref = r0 + (r1 - r0) * frac;
+            const double x = b.x[i];
+            double field = ref;
+            if (Closed) {
+                const double encoder = roundNearest(x * invRes) * res; // counts centred on x = 0
+                const double e = ref - encoder;
+                const double refVelocity = (r1 - r0) * span * rate;
+                const double u = g.kff * refVelocity + g.kp * e + g.ki * b.integral[i]
+                                 + g.kd * (e - b.lastError[i]) * rate;
+                const double wanted = b.field[i] + u * dt - encoder;
+                field = encoder + std::min(lead, std::max(-lead, wanted));
+                b.integral[i] = std::min(windup, std::max(-windup, b.integral[i] + e * dt));
+                b.lastError[i] = e;
+            }
+            b.field[i] = field;
+
+            // Stepper: field at the microstep, rotor in pole pitch k.
+            const double s = roundNearest(field * invMicro) * micro;
+            const double phi = (s - x) * invStep;
+            const double k = roundNearest(phi * 0.25);
+            const double w = phi - 4.0 * k; // -2 .. 2
+            // The load opposes motion (friction, cutting force); the 1 mm/s
+            // knee keeps it continuous through standstill.
+            const double vOld = b.v[i];
+            const double load = b.load[i] * vOld / (std::fabs(vOld) + 1.0);
+            const double f = force * halfPiSine(w) - damping * vOld - load;
+            const double v = vOld + dt * f * accel;
+            const double nx = x + dt * v;
+            b.v[i] = v;
+            b.x[i] = nx;
+            b.missed[i] += 4.0 * std::fabs(k - b.pitch[i]);
+            b.pitch[i] = k;
+
+            const double err = std::fabs(ref - nx);
+            b.maxError[i] = std::max(b.maxError[i], err);
+            b.sumSquares[i] += err * err;
+        }
+    }
+}
+
+void ClosedLoopSim::advance(const double *from, const double *to, int ticks)
+{
+    if (ticks <= 0)
+        return;
+    for (std::size_t k = 0; k < blocks.size(); ++k) {
+        Block &b = blocks[k];
+        for (int i = 0; i < kLanes; ++i) {
+            const int a = static_cast<int>(k) * kLanes + i;
+            b.ref0[i] = a < axes ? from[a] : 0.0;
+            b.ref1[i] = a < axes ? to[a] : 0.0;
+        }
+        if (cfg.closedLoop)
+            run<true>(b, ticks);
+        else
+            run<false>(b, ticks);
+        for (int i = 0; i < kLanes; ++i)
+            b.ref[i] = b.ref1[i];
+    }
+    ticksRun += ticks;
+}
+
+void ClosedLoopSim::positions(double *out) const
+{
+    for (int a = 0; a < axes; ++a)
+        out[a] = blocks[a / kLanes].x[a % kLanes];
+}
+
+void ClosedLoopSim::errors(double *out) const
+{
+    for (int a = 0; a < axes; ++a) {
+        const Block &b = blocks[a / kLanes];
+        out[a] = b.ref[a % kLanes] - b.x[a % kLanes];
+    }
+}
+
+double ClosedLoopSim::missedSteps(int axis) const
+{
+    return axis >= 0 && axis < axes ? blocks[axis / kLanes].missed[axis % kLanes] : 0.0;
+}
+
+ClosedLoopStats ClosedLoopSim::stats() const
+{
+    ClosedLoopStats s;
+    s.ticks = ticksRun;
+    double sum = 0.0;
+    for (int a = 0; a < axes; ++a) {
+        const Block &b = blocks[a / kLanes];
+        const int i = a % kLanes;
+        s.maxError = std::max(s.maxError, b.maxError[i]);
+        sum += b.sumSquares[i];
+        s.missedSteps += b.missed[i];
+        s.axesMissing += b.missed[i] > 0.0;
+        s.axesStalled += std::fabs(b.ref[i] - b.x[i]) > 4.0 * cfg.fullStep;
+    }
+    if (ticksRun > 0 && axes > 0)
+        s.rmsError = std::sqrt(sum / (static_cast<double>(ticksRun) * axes));
+    return s;
+}
+
+// ---------------------------------------------------------------------------
+
+ClosedLoopWorker::ClosedLoopWorker(int axisCount, const ClosedLoopConfig &config)
+    : axes(std::max(0, axisCount)),
+      cfg(config),
+      sim(axes, config),
+      resetTo(axes),
+      from(axes),
+      to(axes),
+      loads(axes, 0.0),
+      closedLoop(config.closedLoop),
+      worker(&ClosedLoopWorker::run, this)
+{
+}
+
+ClosedLoopWorker::~ClosedLoopWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+int ClosedLoopWorker::ticksFor(double seconds) const
+{
+    return sim.ticksFor(seconds); // reads the rate, which never changes
+}
+
+void ClosedLoopWorker::setClosedLoop(bool closed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closedLoop = closed;
+        settingsPending = true;
+    }
+    wake.notify_one();
+}
+
+void ClosedLoopWorker::setLoad(int axis, double force)
+{
+    if (axis < 0 || axis >= axes)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads[axis] = force;
+        settingsPending = true;
+    }
+    wake.notify_one();
+}
+
+void ClosedLoopWorker::setLoad(double force)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::fill(loads.begin(), loads.end(), force);
+        settingsPending = true;
+    }
+    wake.notify_one();
+}
+
+void ClosedLoopWorker::reset(const double *positions)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::copy(positions, positions + axes, resetTo.begin());
+        resetPending = true;
+        ticks = 0;
+    }
+    wake.notify_one();
+}
+
+void ClosedLoopWorker::advance(const double *start, const double *end, int count)
+{
+    if (count <= 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ticks == 0)
+            std::copy(start, start + axes, from.begin());
+        std::copy(end, end + axes, to.begin());
+        ticks += count;
+    }
+    wake.notify_one();
+}
+
+void ClosedLoopWorker::clearStats()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        clearPending = true;
+    }
+    wake.notify_one();
+}
+
+void ClosedLoopWorker::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return !busy && !resetPending && !settingsPending && !clearPending && ticks == 0; });
+}
+
+ClosedLoopStats ClosedLoopWorker::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return last;
+}
+
+void ClosedLoopWorker::run()
+{
+    // The frame is swapped out so advance() can queue the next one while
+    // this one runs; the buffers keep their size, so nothing allocates.
+    std::vector<double> frameFrom(axes), frameTo(axes);
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || resetPending || settingsPending || clearPending || ticks > 0; });
+        if (stopping)
+            return;
+        busy = true;
+        if (resetPending) {
+            sim.reset(resetTo.data());
+            resetPending = false;
+        }
+        if (settingsPending) {
+            sim.setClosedLoop(closedLoop);
+            for (int a = 0; a < axes; ++a)
+                sim.setLoad(a, loads[a]);
+            settingsPending = false;
+        }
+        if (clearPending) {
+            sim.clearStats();
+            clearPending = false;
+        }
+        const int frameTicks = ticks;
+        frameFrom.swap(from);
+        frameTo.swap(to);
+        ticks = 0;
+        lock.unlock();
+        sim.advance(frameFrom.data(), frameTo.data(), frameTicks);
+        const ClosedLoopStats s = sim.stats();
+        lock.lock();
+        last = s;
+        busy = false;
+        done.notify_all();
+    }
+}
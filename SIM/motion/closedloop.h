@@ -0,0 +1,194 @@
+#ifndef CLOSEDLOOP_H
+#define CLOSEDLOOP_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Closed-loop simulation of the actuator drives: the sims so far assume
+// every stepper lands exactly on the commanded position, but under load
+// real ones miss steps.
+//
+// Each axis is a stepper on an 8 mm lead screw. The step generator puts the
+// stator field at s (quantized to microsteps) and the carriage at x feels
+// F = maxForce * sin(pi/2 * (s - x) / fullStep), so the rotor lags behind
+// the field under load and, once the lag passes two full steps, falls into
+// the next pole pitch: four missed full steps. The carriage has the
+// reflected mass of the screw and rotor, viscous damping and a load force
+// (friction, cutting force) that opposes motion. An encoder reads x.
+//
+// The controller runs at rateHz:
+//   open loop    the step generator follows the reference directly, as the
+//                sims assumed; missed steps stay missed
+//   closed loop  velocity command = kff * refVelocity + kp * e + ki * int(e)
+//                + kd * de/dt with e = reference - encoder, integrated into
+//                the step generator; the field may lead the encoder by at
+//                most maxLead full steps, which keeps the rotor short of
+//                slipping as long as the load is below maxForce, and the
+//                integral is clamped to what that lead lets through
+//
+// State is stored SoA in blocks of kServoLanes axes (one record of
+// kServoLanes-wide arrays per block), so the per-tick update is a fixed-
+// width inner loop the compiler vectorizes with no run-time alias checks.
+// Units: mm, s, N, kg.
+
+struct ServoGains
+{
+    double kp = 300.0; // 1/s
+    double ki = 0.0;   // 1/s^2
+    double kd = 0.0;   // -
+    double kff = 1.0;  // velocity feedforward
+};
+
+struct ClosedLoopConfig
+{
+    double rateHz = 20000.0;
+    bool closedLoop = true;
+    ServoGains gains;
+    double maxLead = 1.0;           // full steps the field may lead the encoder
+
+    double fullStep = 8.0 / 200.0;  // mm: 200-step motor on an 8 mm lead screw
+    int microsteps = 16;
+    double encoderResolution = 8.0 / 4000.0; // mm per count: 1000-line quadrature encoder
+    double maxForce = 314.0;        // N at the nut: 0.4 N m holding torque through the screw
+    double mass = 4.0;              // kg, carriage plus reflected rotor inertia
+    double damping = 700.0;         // N s/m
+};
+
+struct ClosedLoopStats
+{
+    double maxError = 0.0;  // mm, |reference - x| over all axes and ticks
+    double rmsError = 0.0;  // mm
+    double missedSteps = 0.0; // full steps, all axes
+    int axesMissing = 0;    // axes that have missed steps
+    int axesStalled = 0;    // axes more than a pole pitch behind right now
+    long ticks = 0;
+};
+
+class ClosedLoopSim
+{
+public:
+    static constexpr int kServoLanes = 8;
+
+    explicit ClosedLoopSim(int axes, const ClosedLoopConfig &config = ClosedLoopConfig());
+
+    int axisCount() const { return axes; }
+    const ClosedLoopConfig &config() const { return cfg; }
+
+    // Gains and the loop mode may be changed between calls (offline tuning,
+    // UI toggles).
+    void setGains(const ServoGains &gains);
+    void setClosedLoop(bool closed);
+
+    // Load force (N, opposing motion) on one axis, or on all.
+    void setLoad(int axis, double force);
+    void setLoad(double force);
+
+    // Puts every axis at rest at positions (axisCount() values), encoder
+    // and step generator included, and clears the statistics.
+    void reset(const double *positions);
+
+    // Runs ticks controller ticks while the reference moves linearly from
+    // `from` to `to` (a wave frame to the next; axisCount() values each).
+    void advance(const double *from, const double *to, int ticks);
+
+    // Ticks that span seconds of real time at the controller rate.
+    int ticksFor(double seconds) const;
+
+    // Current carriage positions, and reference - position, per axis.
+    void positions(double *out) const;
+    void errors(double *out) const;
+
+    // Full steps an axis has missed so far.
+    double missedSteps(int axis) const;
+
+    ClosedLoopStats stats() const;
+    void clearStats();
+
+private:
+    struct Block
+    {
+        double x[kServoLanes];       // carriage
+        double v[kServoLanes];
+        double field[kServoLanes];   // step generator, before microstep rounding
+        double integral[kServoLanes];
+        double lastError[kServoLanes];
+        double pitch[kServoLanes];   // pole pitch the rotor sits in
+        double load[kServoLanes];
+        double ref0[kServoLanes];    // reference at the start of advance()
+        double ref1[kServoLanes];    // and at its end
+        double ref[kServoLanes];     // last reference reached
+        double missed[kServoLanes];
+        double maxError[kServoLanes];
+        double sumSquares[kServoLanes];
+    };
+
+    template <bool Closed>
+    void run(Block &b, int ticks) const;
+
+    int axes;
+    ClosedLoopConfig cfg;
+    std::vector<Block> blocks;
+    long ticksRun = 0;
+};
+
+// A ClosedLoopSim on its own thread, for callers that must not spend the
+// servo ticks themselves (the UI timer). Calls only queue work and return.
+//
+// One frame is pending at a time. A frame submitted before the thread has
+// taken the previous one is merged into it: the start is kept, the end
+// replaced and the ticks added. A thread that falls behind loses detail,
+// never time. Settings, clearStats() and reset() apply before the next
+// frame the thread takes; reset() drops a pending frame. stats() is the
+// state after the last finished frame.
+class ClosedLoopWorker
+{
+public:
+    explicit ClosedLoopWorker(int axes, const ClosedLoopConfig &config = ClosedLoopConfig());
+    ~ClosedLoopWorker();
+
+    ClosedLoopWorker(const ClosedLoopWorker &) = delete;
+    ClosedLoopWorker &operator=(const ClosedLoopWorker &) = delete;
+
+    int axisCount() const { return axes; }
+    // The configuration the worker was created with (the loop mode may
+    // have changed since).
+    const ClosedLoopConfig &config() const { return cfg; }
+    int ticksFor(double seconds) const;
+
+    void setClosedLoop(bool closed);
+    void setLoad(int axis, double force);
+    void setLoad(double force);
+    void reset(const double *positions);
+    void advance(const double *from, const double *to, int ticks);
+    void clearStats();
+
+    // Blocks until everything queued so far has run.
+    void wait();
+
+    ClosedLoopStats stats() const;
+
+private:
+    void run();
+
+    const int axes;
+    const ClosedLoopConfig cfg;
+    ClosedLoopSim sim; // the thread's only
+
+    mutable std::mutex mutex;
+    std::condition_variable wake; // the thread: work is pending
+    std::condition_variable done; // wait(): the thread is idle
+    std::vector<double> resetTo, from, to, loads;
+    int ticks = 0; // of the pending frame, 0 when there is none
+    bool closedLoop;
+    bool resetPending = false;
+    bool settingsPending = false;
+    bool clearPending = false;
+    bool busy = false;
+    bool stopping = false;
+    ClosedLoopStats last;
+    std::thread worker; // last: started once the rest is built
+};
+
+#endif // CLOSEDLOOP_H
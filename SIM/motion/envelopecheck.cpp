@@ -0,0 +1,222 @@
+#include "envelopecheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+} // namespace
+
+const char *envelopeKindName(EnvelopeKind kind)
+{
+    switch (kind) {
+    case EnvelopeKind::Travel: return "travel";
+    case EnvelopeKind::NeighbourDelta: return "neighbour";
+    case EnvelopeKind::Velocity: return "velocity";
+    }
+    return "?";
+}
+
+double EnvelopeReport::amplitudeScale(const EnvelopeLimits &limits) const
+{
+    double s = 1.0;
+    if (limits.minPosition < limits.maxPosition) {
+        if (maxPosition > limits.maxPosition && limits.maxPosition > 0)
+            s = std::min(s, limits.maxPosition / maxPosition);
+        if (minPosition < limits.minPosition && limits.minPosition < 0)
+            s = std::min(s, limits.minPosition / minPosition);
+    }
+    if (limits.maxNeighbourDelta > 0 && maxNeighbourDelta > limits.maxNeighbourDelta)
+        s = std::min(s, limits.maxNeighbourDelta / maxNeighbourDelta);
+    return s;
+}
+
+double EnvelopeReport::timeScale(const EnvelopeLimits &limits) const
+{
+    const double v = maxVelocity * amplitudeScale(limits);
+    return limits.maxVelocity > 0 && v > limits.maxVelocity ? v / limits.maxVelocity : 1.0;
+}
+
+EnvelopeChecker::EnvelopeChecker(const EnvelopeLimits &limits, Mode mode, bool trackExtremes)
+    : lim(limits), mode(mode), trackExtremes(trackExtremes)
+{
+    const bool travel = lim.minPosition < lim.maxPosition;
+    low = travel ? lim.minPosition : -kInf;
+    high = travel ? lim.maxPosition : kInf;
+    centre = travel ? (lim.minPosition + lim.maxPosition) / 2 : 0.0;
+    halfRange = travel ? (lim.maxPosition - lim.minPosition) / 2 : kInf;
+    deltaLimit = lim.maxNeighbourDelta > 0 ? lim.maxNeighbourDelta : kInf;
+    moveLimit = lim.maxVelocity > 0 ? lim.maxVelocity * lim.tickSeconds : kInf;
+}
+
+void EnvelopeChecker::reset()
+{
+    havePrevious = false;
+}
+
+double EnvelopeChecker::sweep(const double *pos, int count) const
+{
+    // Without a previous frame every move compares against itself (0).
+    const double *prev = havePrevious ? previous.data() : pos;
+    const double c = centre, h = halfRange, dl = deltaLimit, ml = moveLimit;
+    // Counts motors with any violation (a motor's neighbour pair included):
+    // one compare per limit and a chain of selects. A double sum vectorizes
+    // on SSE2, an integer one does not.
+    double bad = 0.0;
+    for (int i = 0; i + 1 < count; ++i) {
+        const double x = pos[i];
+        const double travel = std::fabs(x - c) <= h ? 0.0 : 1.0;
+        const double delta = std::fabs(pos[i + 1] - x) <= dl ? travel : 1.0;
+        bad += std::fabs(x - prev[i]) <= ml ? delta : 1.0;
+    }
+    const double x = pos[count - 1];
+    const double travel = std::fabs(x - c) <= h ? 0.0 : 1.0;
+    bad += std::fabs(x - prev[count - 1]) <= ml ? travel : 1.0;
+    return bad;
+}
+
+void EnvelopeChecker::track(const double *pos, int count)
+{
+    if (extremes.size() < static_cast<std::size_t>(count))
+        extremes.resize(count, Extremes{kInf, -kInf, 0.0, 0.0});
+    const double *prev = havePrevious ? previous.data() : pos;
+    Extremes *e = extremes.data();
+    auto one = [&](int i, double d) {
+        const double x = pos[i];
+        const double m = std::fabs(x - prev[i]);
+        Extremes &q = e[i];
+        q.lowest = x < q.lowest ? x : q.lowest;
+        q.highest = x > q.highest ? x : q.highest;
+        q.widest = d > q.widest ? d : q.widest;
+        q.fastest = m > q.fastest ? m : q.fastest;
+    };
+    for (int i = 0; i + 1 < count; ++i)
+        one(i, std::fabs(pos[i + 1] - pos[i]));
+    one(count - 1, 0.0);
+}
+
+unsigned EnvelopeChecker::scan(const double *pos, int count, long *counts, bool list)
+{
+    unsigned mask = 0;
+    auto note = [&](int motor, EnvelopeKind kind, double value) {
+        const int k = static_cast<int>(kind);
+        mask |= 1u << k;
+        ++counts[k];
+        if (list && rep.first.size() < static_cast<std::size_t>(EnvelopeReport::kMaxListed))
+            rep.first.push_back({rep.frames, motor, kind, value});
+    };
+    for (int i = 0; i < count; ++i) {
+        const double x = pos[i];
+        if (!(x >= low && x <= high))
+            note(i, EnvelopeKind::Travel, x);
+        if (i + 1 < count) {
+            const double d = std::fabs(pos[i + 1] - x);
+            if (!(d <= deltaLimit))
+                note(i, EnvelopeKind::NeighbourDelta, d);
+        }
+        if (havePrevious) {
+            const double m = std::fabs(x - previous[i]);
+            if (!(m <= moveLimit))
+                note(i, EnvelopeKind::Velocity, m / lim.tickSeconds);
+        }
+    }
+    return mask;
+}
+
+void EnvelopeChecker::clamp(double *pos, int count)
+{
+    auto limit = [](double x, double lo, double hi) { return x < lo ? lo : (x > hi ? hi : x); };
+    // A hair inside the relative limits, so that the rounded difference of
+    // a clamped pair does not read as a violation again.
+    const double move = moveLimit * (1 - 1e-12);
+    const double delta = deltaLimit * (1 - 1e-12);
+    for (int i = 0; i < count; ++i) {
+        double x = pos[i];
+        if (x != x) // NaN: hold the last output, or park at 0
+            x = havePrevious ? previous[i] : 0.0;
+        if (havePrevious)
+            x = limit(x, previous[i] - move, previous[i] + move);
+        if (i > 0)
+            x = limit(x, pos[i - 1] - delta, pos[i - 1] + delta);
+        // pos[i - 1] is within travel, so this keeps the neighbour limit.
+        pos[i] = limit(x, low, high);
+    }
+}
+
+unsigned EnvelopeChecker::apply(double *pos, int count)
+{
+    if (count <= 0)
+        return 0;
+    if (havePrevious && previous.size() != static_cast<std::size_t>(count))
+        havePrevious = false;
+
+    if (trackExtremes)
+        track(pos, count);
+    unsigned mask = 0;
+    if (sweep(pos, count) != 0.0) {
+        mask = scan(pos, count, rep.violations, true);
+        if (mode == Mode::Clamp) {
+            clamp(pos, count);
+            scan(pos, count, rep.residual, false);
+        }
+    }
+    previous.assign(pos, pos + count);
+    havePrevious = true;
+    ++rep.frames;
+    return mask;
+}
+
+EnvelopeReport EnvelopeChecker::report() const
+{
+    EnvelopeReport r = rep;
+    if (extremes.empty())
+        return r;
+    r.minPosition = kInf;
+    r.maxPosition = -kInf;
+    for (const Extremes &q : extremes) {
+        r.minPosition = std::min(r.minPosition, q.lowest);
+        r.maxPosition = std::max(r.maxPosition, q.highest);
+        r.maxNeighbourDelta = std::max(r.maxNeighbourDelta, q.widest);
+        r.maxVelocity = std::max(r.maxVelocity, q.fastest);
+    }
+    r.maxVelocity /= lim.tickSeconds;
+    return r;
+}
+
+EnvelopeReport preflightWave(const WaveJournal &journal, const EnvelopeLimits &limits, long ticks)
+{
+    if (ticks < 0)
+        ticks = journal.complete ? journal.ticks : 0;
+    EnvelopeChecker checker(limits);
+    WaveReplay replay(journal);
+    std::vector<double> frame;
+    for (long t = 0; t < ticks; ++t) {
+        const std::vector<double> &pos = replay.tick();
+        frame.assign(pos.begin(), pos.end());
+        checker.apply(frame.data(), static_cast<int>(frame.size()));
+    }
+    return checker.report();
+}
+
+EnvelopeReport preflightWave(const WaveParams &params, const EnvelopeLimits &limits, long ticks)
+{
+    WaveJournal journal;
+    journal.initial = params;
+    return preflightWave(journal, limits, ticks);
+}
+
+WaveParams fitWave(const WaveParams &params, const EnvelopeReport &report, const EnvelopeLimits &limits,
+                   double headroom)
+{
+    WaveParams p = params;
+    const double a = report.amplitudeScale(limits);
+    const double s = report.timeScale(limits);
+    if (a < 1.0)
+        p.strokeLengthValue *= a * headroom;
+    if (s > 1.0)
+        p.step *= headroom / s;
+    return p;
+}
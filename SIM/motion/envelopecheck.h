@@ -0,0 +1,143 @@
+#ifndef ENVELOPECHECK_H
+#define ENVELOPECHECK_H
+
+#include <vector>
+
+#include "wavejournal.h"
+#include "wavekernel.h"
+
+// Mechanical envelope of an actuator row: travel of each actuator, how far
+// two neighbours may be apart before their bars (or the cloth between
+// them) collide or tear, and the speed the screws can follow. A delta or
+// velocity limit of 0 is not checked, nor is travel if min >= max.
+struct EnvelopeLimits
+{
+    double minPosition = -30.0;     // mm
+    double maxPosition = 30.0;      // mm
+    double maxNeighbourDelta = 0.0; // mm between actuators i and i + 1
+    double maxVelocity = 0.0;       // mm/s
+    double tickSeconds = 0.05;      // real time per frame (the UI timer period)
+};
+
+enum class EnvelopeKind
+{
+    Travel,
+    NeighbourDelta,
+    Velocity
+};
+constexpr int kEnvelopeKinds = 3;
+
+const char *envelopeKindName(EnvelopeKind kind);
+
+struct EnvelopeViolation
+{
+    long frame;
+    int motor; // for NeighbourDelta the left one of the pair
+    EnvelopeKind kind;
+    double value; // position, |delta| or |velocity|
+};
+
+struct EnvelopeReport
+{
+    long frames = 0;
+    long violations[kEnvelopeKinds] = {}; // motor-frames (pairs for neighbours)
+    long residual[kEnvelopeKinds] = {};   // still violated after clamping
+    std::vector<EnvelopeViolation> first; // the first kMaxListed violations
+
+    // Extremes of the checked (unclamped) stream.
+    double minPosition = 0.0;
+    double maxPosition = 0.0;
+    double maxNeighbourDelta = 0.0;
+    double maxVelocity = 0.0;
+
+    static constexpr int kMaxListed = 20;
+
+    long total() const { return violations[0] + violations[1] + violations[2]; }
+    bool ok() const { return total() == 0; }
+
+    // Stroke multiplier that brings travel and neighbour delta within
+    // limits, and the factor to slow the wave by (divide WaveParams::step)
+    // so the scaled stream also meets the velocity limit. Positions scale
+    // linearly with the stroke length, so both follow from the extremes.
+    double amplitudeScale(const EnvelopeLimits &limits) const;
+    double timeScale(const EnvelopeLimits &limits) const;
+};
+
+// Per-frame constraint checker.
+//
+// Meant to run right after each frame is computed, while it is still in L1.
+// The common case (every limit met) is one branch-free, vectorized sweep
+// over the frame that counts the motors breaking any limit with chained
+// selects; with trackExtremes a second vectorized pass keeps each motor's
+// extremes for the report (about as costly again). Only a frame with
+// violations is scanned again, scalar, to name the motors. NaN positions
+// count as violations of every kind they take part in.
+class EnvelopeChecker
+{
+public:
+    enum class Mode
+    {
+        Report, // record violations, leave the frame alone
+        Clamp   // also correct the frame in place
+    };
+
+    explicit EnvelopeChecker(const EnvelopeLimits &limits, Mode mode = Mode::Report, bool trackExtremes = true);
+
+    // Forgets the previous frame; the next frame's velocity is not checked.
+    void reset();
+
+    // Checks one frame of count positions. In Clamp mode the frame is then
+    // limited to the velocity (against the previous output frame), then to
+    // the neighbour and travel limits in one pass from left to right, so
+    // motor 0 keeps its place; the output frame is checked again for the
+    // residual counts. Returns a mask of the violated kinds
+    // (1 << EnvelopeKind) in the input frame.
+    unsigned apply(double *pos, int count);
+
+    // Counts so far, with the extremes folded in (0 without trackExtremes).
+    EnvelopeReport report() const;
+    const EnvelopeLimits &limits() const { return lim; }
+
+private:
+    double sweep(const double *pos, int count) const;
+    void track(const double *pos, int count);
+    unsigned scan(const double *pos, int count, long *counts, bool list);
+    void clamp(double *pos, int count);
+
+    EnvelopeLimits lim;
+    Mode mode;
+    bool trackExtremes;
+    EnvelopeReport rep;
+
+    // Thresholds as checked: travel bounds (and as centre +- half range),
+    // |delta| per pair and |move| per frame; infinite where a limit is off.
+    double low, high, centre, halfRange, deltaLimit, moveLimit;
+
+    std::vector<double> previous;
+    bool havePrevious = false;
+
+    // Per-motor extremes, folded into the report on demand. One array of
+    // records rather than four arrays keeps the loop at two alias checks,
+    // within what GCC will version a loop for.
+    struct Extremes
+    {
+        double lowest, highest, widest, fastest;
+    };
+    std::vector<Extremes> extremes;
+};
+
+// Runs a program headless through the checker before it goes to the
+// machine: ticks frames of the journal's wave (all of a complete journal
+// for ticks < 0).
+EnvelopeReport preflightWave(const WaveJournal &journal, const EnvelopeLimits &limits, long ticks = -1);
+
+// The same for fixed parameters.
+EnvelopeReport preflightWave(const WaveParams &params, const EnvelopeLimits &limits, long ticks);
+
+// params with the stroke and step scaled by the report's factors, plus
+// headroom: the rescaled wave is sampled at other phases, so its sampled
+// peaks can come out slightly higher.
+WaveParams fitWave(const WaveParams &params, const EnvelopeReport &report, const EnvelopeLimits &limits,
+                   double headroom = 0.99);
+
+#endif // ENVELOPECHECK_H
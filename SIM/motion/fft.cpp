@@ -0,0 +1,166 @@
+#include "fft.h"
+
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Radix-4 stage with stride 1 (the first): x[p + r m] for r = 0..3 to
+// y[4p + r], twiddles per p.
+void firstRadix4(const double *__restrict xr, const double *__restrict xi, int m, const double *__restrict wr,
+                 const double *__restrict wi, double *__restrict yr, double *__restrict yi)
+{
+    for (int p = 0; p < m; ++p) {
+        const double b0r = xr[p] + xr[p + 2 * m], b0i = xi[p] + xi[p + 2 * m];
+        const double b1r = xr[p] - xr[p + 2 * m], b1i = xi[p] - xi[p + 2 * m];
+        const double b2r = xr[p + m] + xr[p + 3 * m], b2i = xi[p + m] + xi[p + 3 * m];
+        const double b3r = xi[p + m] - xi[p + 3 * m], b3i = xr[p + 3 * m] - xr[p + m]; // -i (a1 - a3)
+        const double t1r = b1r + b3r, t1i = b1i + b3i;
+        const double t2r = b0r - b2r, t2i = b0i - b2i;
+        const double t3r = b1r - b3r, t3i = b1i - b3i;
+        yr[4 * p] = b0r + b2r;
+        yi[4 * p] = b0i + b2i;
+        yr[4 * p + 1] = t1r * wr[p] - t1i * wi[p];
+        yi[4 * p + 1] = t1r * wi[p] + t1i * wr[p];
+        yr[4 * p + 2] = t2r * wr[p + m] - t2i * wi[p + m];
+        yi[4 * p + 2] = t2r * wi[p + m] + t2i * wr[p + m];
+        yr[4 * p + 3] = t3r * wr[p + 2 * m] - t3i * wi[p + 2 * m];
+        yi[4 * p + 3] = t3r * wi[p + 2 * m] + t3i * wr[p + 2 * m];
+    }
+}
+
+// count radix-4 butterflies sharing twiddles w^1..w^3 (w[0..2] real,
+// w[3..5] imaginary): inputs quarter apart, outputs stride apart, each
+// run unit stride.
+void radix4(const double *__restrict xr, const double *__restrict xi, int quarter, const double *w,
+            double *__restrict yr, double *__restrict yi, int stride, int count)
+{
+    const double w1r = w[0], w2r = w[1], w3r = w[2], w1i = w[3], w2i = w[4], w3i = w[5];
+    for (int q = 0; q < count; ++q) {
+        const double b0r = xr[q] + xr[q + 2 * quarter], b0i = xi[q] + xi[q + 2 * quarter];
+        const double b1r = xr[q] - xr[q + 2 * quarter], b1i = xi[q] - xi[q + 2 * quarter];
+        const double b2r = xr[q + quarter] + xr[q + 3 * quarter], b2i = xi[q + quarter] + xi[q + 3 * quarter];
+        const double b3r = xi[q + quarter] - xi[q + 3 * quarter], b3i = xr[q + 3 * quarter] - xr[q + quarter];
+        const double t1r = b1r + b3r, t1i = b1i + b3i;
+        const double t2r = b0r - b2r, t2i = b0i - b2i;
+        const double t3r = b1r - b3r, t3i = b1i - b3i;
+        yr[q] = b0r + b2r;
+        yi[q] = b0i + b2i;
+        yr[q + stride] = t1r * w1r - t1i * w1i;
+        yi[q + stride] = t1r * w1i + t1i * w1r;
+        yr[q + 2 * stride] = t2r * w2r - t2i * w2i;
+        yi[q + 2 * stride] = t2r * w2i + t2i * w2r;
+        yr[q + 3 * stride] = t3r * w3r - t3i * w3i;
+        yi[q + 3 * stride] = t3r * w3i + t3i * w3r;
+    }
+}
+
+// Last stage when the size is not a power of four: count radix-2
+// butterflies with unit twiddle between x[q] and x[q + count].
+void lastRadix2(const double *__restrict xr, const double *__restrict xi, double *__restrict yr,
+                double *__restrict yi, int count)
+{
+    for (int q = 0; q < count; ++q) {
+        yr[q] = xr[q] + xr[q + count];
+        yi[q] = xi[q] + xi[q + count];
+        yr[q + count] = xr[q] - xr[q + count];
+        yi[q + count] = xi[q] - xi[q + count];
+    }
+}
+
+} // namespace
+
+RealFft::RealFft(int size)
+    : n(4)
+{
+    while (n < size)
+        n *= 2;
+    half = n / 2;
+    // Radix-4 stages of length len: w^(r p), w = exp(-2 pi i / len), for
+    // r = 1..3 and p < len / 4, one run of len / 4 per r.
+    for (int len = half; len >= 4; len /= 4) {
+        for (int r = 1; r <= 3; ++r) {
+            for (int p = 0; p < len / 4; ++p) {
+                twiddleRe.push_back(std::cos(2 * M_PI * r * p / len));
+                twiddleIm.push_back(-std::sin(2 * M_PI * r * p / len));
+            }
+        }
+    }
+    splitRe.resize(half);
+    splitIm.resize(half);
+    for (int k = 0; k < half; ++k) {
+        splitRe[k] = std::cos(2 * M_PI * k / n);
+        splitIm[k] = -std::sin(2 * M_PI * k / n);
+    }
+    aRe.resize(half);
+    aIm.resize(half);
+    bRe.resize(half);
+    bIm.resize(half);
+    binRe.resize(half + 1);
+    binIm.resize(half + 1);
+}
+
+void RealFft::complexForward()
+{
+    double *xr = aRe.data(), *xi = aIm.data();
+    double *yr = bRe.data(), *yi = bIm.data();
+    const double *wr = twiddleRe.data(), *wi = twiddleIm.data();
+    // Stockham radix-4 stage with transform length len and stride s
+    // (len * s == half), m = len / 4, for r = 0..3:
+    //   y[q + s*(4p+r)] = w^(r p) * sum_j x[q + s*(p + j m)] * (-i)^(j r)
+    int s = 1, len = half;
+    for (; len >= 4; len /= 4, s *= 4) {
+        const int m = len / 4;
+        if (s == 1) {
+            firstRadix4(xr, xi, m, wr, wi, yr, yi);
+        } else {
+            for (int p = 0; p < m; ++p) {
+                const double w[6] = {wr[p], wr[p + m], wr[p + 2 * m], wi[p], wi[p + m], wi[p + 2 * m]};
+                radix4(xr + s * p, xi + s * p, s * m, w, yr + s * 4 * p, yi + s * 4 * p, s, s);
+            }
+        }
+        wr += 3 * m;
+        wi += 3 * m;
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    if (len == 2) {
+        lastRadix2(xr, xi, yr, yi, s);
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    outRe = xr;
+    outIm = xi;
+}
+
+void RealFft::forward(const double *in, double *re, double *im)
+{
+    for (int j = 0; j < half; ++j) {
+        aRe[j] = in[2 * j];
+        aIm[j] = in[2 * j + 1];
+    }
+    complexForward();
+    const double *zr = outRe, *zi = outIm;
+    // Z = FFT(even + i odd): E[k] = (Z[k] + conj Z[h-k]) / 2 is the even
+    // samples' transform, O[k] = -i (Z[k] - conj Z[h-k]) / 2 the odd ones',
+    // and X[k] = E[k] + exp(-2 pi i k / n) O[k].
+    re[0] = zr[0] + zi[0];
+    im[0] = 0.0;
+    re[half] = zr[0] - zi[0];
+    im[half] = 0.0;
+    for (int k = 1; k < half; ++k) {
+        const double pr = zr[k], pi = zi[k];
+        const double qr = zr[half - k], qi = -zi[half - k];
+        const double er = 0.5 * (pr + qr), ei = 0.5 * (pi + qi);
+        const double odr = 0.5 * (pi - qi), odi = -0.5 * (pr - qr);
+        re[k] = er + splitRe[k] * odr - splitIm[k] * odi;
+        im[k] = ei + splitRe[k] * odi + splitIm[k] * odr;
+    }
+}
+
+void RealFft::power(const double *in, double *power)
+{
+    forward(in, binRe.data(), binIm.data());
+    for (int k = 0; k <= half; ++k)
+        power[k] = binRe[k] * binRe[k] + binIm[k] * binIm[k];
+}
@@ -0,0 +1,52 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+// Forward FFT of real input, for the spectral analysis of motion streams.
+//
+// A real transform of n points runs as a complex transform of n/2 points
+// (even samples as the real part, odd ones as the imaginary part) and a
+// split pass that separates the two. The complex transform is a Stockham
+// autosort FFT of radix-4 stages, plus one radix-2 stage when n/2 is not a
+// power of four: no bit-reversal pass, each stage reads one buffer and
+// writes the other, with the real and imaginary parts in separate arrays
+// and every stage's twiddles precomputed contiguously, so the inner loops
+// are unit-stride streams the compiler vectorizes. The first stage (stride
+// 1) loops over the twiddles innermost, later ones over the stride.
+class RealFft
+{
+public:
+    // Other sizes are rounded up to the next power of two (at least 4).
+    explicit RealFft(int n);
+
+    int size() const { return n; }
+    int bins() const { return n / 2 + 1; }
+
+    // X[k] = sum_j in[j] * exp(-2 pi i j k / n) for k in [0, n/2]; re and
+    // im must hold bins() values each. Not reentrant: uses internal buffers.
+    void forward(const double *in, double *re, double *im);
+
+    // |X[k]|^2 for k in [0, n/2] into power (bins() values).
+    void power(const double *in, double *power);
+
+private:
+    void complexForward();
+
+    int n;
+    int half;
+    std::vector<double> twiddleRe, twiddleIm; // every stage's twiddles, one stage after another
+    std::vector<double> splitRe, splitIm;     // exp(-2 pi i k / n), k in [0, n/2)
+    std::vector<double> aRe, aIm, bRe, bIm;   // ping-pong buffers
+    double *outRe = nullptr;                  // where complexForward() left its result
+    double *outIm = nullptr;
+    std::vector<double> binRe, binIm;
+};
+
+// Whether n is a power of two >= 4 (a valid RealFft size).
+inline bool isFftSize(int n)
+{
+    return n >= 4 && (n & (n - 1)) == 0;
+}
+
+#endif // FFT_H
@@ -0,0 +1,15 @@
+#include "fixedpoint.h"
+
+#include <cmath>
+
+TurnPhase turnsFromRadians(double radians)
+{
+    // Reduce to [0, 1) turns first so the 64-bit conversion cannot overflow.
+    double turns = radians / (2 * M_PI);
+    turns -= std::floor(turns);
+    // 2^64 does not fit in a double-to-uint64 conversion; split in halves.
+    const double scaled = std::ldexp(turns, 32);
+    const std::uint64_t hi = static_cast<std::uint64_t>(scaled);
+    const std::uint64_t lo = static_cast<std::uint64_t>(std::ldexp(scaled - static_cast<double>(hi), 32));
+    return (hi << 32) | lo;
+}
@@ -0,0 +1,104 @@
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <array>
+#include <cstdint>
+
+// Integer-only arithmetic for controller boards without an FPU.
+//
+// Q16_16 is a signed 32-bit fixed-point number with 16 fractional bits
+// (range about +/-32768, resolution 1/65536). Angles are kept as unsigned
+// 64-bit fractions of a full turn, so phase accumulation wraps for free and
+// never loses precision however long the program runs.
+
+struct Q16_16
+{
+    static constexpr int kFracBits = 16;
+    static constexpr std::int32_t kOne = 1 << kFracBits;
+
+    std::int32_t raw = 0;
+
+    static constexpr Q16_16 fromRaw(std::int32_t r)
+    {
+        Q16_16 q;
+        q.raw = r;
+        return q;
+    }
+    static constexpr Q16_16 fromInt(int v) { return fromRaw(v * kOne); }
+
+    // Host-side conversions (use floating point; not for the target loop).
+    static constexpr Q16_16 fromDouble(double v)
+    {
+        return fromRaw(static_cast<std::int32_t>(v * kOne + (v >= 0 ? 0.5 : -0.5)));
+    }
+    constexpr double toDouble() const { return static_cast<double>(raw) / kOne; }
+
+    friend constexpr Q16_16 operator+(Q16_16 a, Q16_16 b) { return fromRaw(a.raw + b.raw); }
+    friend constexpr Q16_16 operator-(Q16_16 a, Q16_16 b) { return fromRaw(a.raw - b.raw); }
+    friend constexpr Q16_16 operator-(Q16_16 a) { return fromRaw(-a.raw); }
+    friend constexpr Q16_16 operator*(Q16_16 a, Q16_16 b)
+    {
+        // Round to nearest: add half an LSB before dropping the extra bits.
+        return fromRaw(static_cast<std::int32_t>(
+            (static_cast<std::int64_t>(a.raw) * b.raw + (1 << (kFracBits - 1))) >> kFracBits));
+    }
+    friend constexpr bool operator==(Q16_16 a, Q16_16 b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Q16_16 a, Q16_16 b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(Q16_16 a, Q16_16 b) { return a.raw < b.raw; }
+};
+
+// Phase as a fraction of one turn: 2^64 == 2*pi.
+using TurnPhase = std::uint64_t;
+
+// Host-side conversion from radians (any sign, any magnitude).
+TurnPhase turnsFromRadians(double radians);
+
+namespace fixedpoint_detail {
+
+constexpr int kSineBits = 10;
+constexpr int kSineSize = 1 << kSineBits;
+
+// Taylor series, good to ~1e-13 on [-pi, pi]. Only used at compile time.
+constexpr double taylorSin(double x)
+{
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 13; ++n) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr std::array<std::int32_t, kSineSize + 1> makeSineTable()
+{
+    constexpr double pi = 3.14159265358979323846;
+    std::array<std::int32_t, kSineSize + 1> table{};
+    for (int k = 0; k <= kSineSize; ++k) {
+        // Reduce to [-pi, pi] so the series converges quickly.
+        double x = 2 * pi * k / kSineSize;
+        if (x > pi)
+            x -= 2 * pi;
+        table[k] = Q16_16::fromDouble(taylorSin(x)).raw;
+    }
+    return table;
+}
+
+// One full turn plus a guard entry for interpolation; lives in ROM.
+inline constexpr std::array<std::int32_t, kSineSize + 1> kSineTable = makeSineTable();
+
+} // namespace fixedpoint_detail
+
+// sin() of a turn phase: 1024-entry table with linear interpolation.
+// Max error is below 1.5 LSB of Q16.16 (about 2.3e-5).
+inline Q16_16 sinTurns(TurnPhase phase)
+{
+    using namespace fixedpoint_detail;
+    const std::uint32_t index = static_cast<std::uint32_t>(phase >> (64 - kSineBits));
+    const std::int64_t frac = static_cast<std::int64_t>((phase >> (48 - kSineBits)) & 0xFFFF);
+    const std::int32_t a = kSineTable[index];
+    const std::int32_t b = kSineTable[index + 1];
+    return Q16_16::fromRaw(a + static_cast<std::int32_t>(((b - a) * frac + 0x8000) >> 16));
+}
+
+#endif // FIXEDPOINT_H
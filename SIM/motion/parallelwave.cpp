@@ -0,0 +1,64 @@
+#include "parallelwave.h"
+
+#include <algorithm>
+
+ParallelWaveEvaluator::ParallelWaveEvaluator(WorkStealingPool &pool, int chunkMotors)
+    : pool(pool),
+      chunkMotors(std::max(1, chunkMotors))
+{
+}
+
+int ParallelWaveEvaluator::addInstallation(const WaveParams &p)
+{
+    installs.push_back(Installation{p, 0, nullptr});
+    dirty = true;
+    return static_cast<int>(installs.size()) - 1;
+}
+
+WaveParams &ParallelWaveEvaluator::params(int installation)
+{
+    return installs[installation].params;
+}
+
+const double *ParallelWaveEvaluator::positions(int installation) const
+{
+    return installs[installation].buffer.get();
+}
+
+void ParallelWaveEvaluator::prepare()
+{
+    chunks.clear();
+    for (int k = 0; k < installationCount(); ++k) {
+        Installation &inst = installs[k];
+        const int n = inst.params.numMotors;
+        if (inst.allocatedMotors != n) {
+            // new double[] leaves the memory untouched; the pool touches it.
+            inst.buffer.reset(new double[n]);
+            inst.allocatedMotors = n;
+        }
+        for (int first = 0; first < n; first += chunkMotors)
+            chunks.push_back({k, first, std::min(n, first + chunkMotors)});
+    }
+
+    // First touch by each chunk's home worker.
+    pool.parallelFor(chunks.size(), [this](std::size_t c, int) {
+        const Chunk &ch = chunks[c];
+        std::fill(installs[ch.installation].buffer.get() + ch.first,
+                  installs[ch.installation].buffer.get() + ch.last, 0.0);
+    });
+    dirty = false;
+}
+
+void ParallelWaveEvaluator::evaluate(double t)
+{
+    for (const Installation &inst : installs)
+        dirty = dirty || inst.allocatedMotors != inst.params.numMotors;
+    if (dirty)
+        prepare();
+
+    pool.parallelFor(chunks.size(), [this, t](std::size_t c, int) {
+        const Chunk &ch = chunks[c];
+        const Installation &inst = installs[ch.installation];
+        generateWavePositions(inst.params, t, ch.first, ch.last, inst.buffer.get() + ch.first);
+    });
+}
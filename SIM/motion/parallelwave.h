@@ -0,0 +1,68 @@
+#ifndef PARALLELWAVE_H
+#define PARALLELWAVE_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "wavekernel.h"
+#include "workstealingpool.h"
+
+// Evaluates very large actuator arrays, or several installations at once, on
+// a WorkStealingPool. Motors are split into cache-sized chunks; each chunk
+// writes only its own slice of the installation's buffer, so the output is
+// identical to the serial generateWavePositions() whatever the scheduling.
+//
+// Position buffers are allocated uninitialized and first touched by each
+// chunk's home worker, which places their pages near the worker that will
+// normally compute them.
+class ParallelWaveEvaluator
+{
+public:
+    // 4096 doubles = 32 KiB, one L1 data cache.
+    static constexpr int kDefaultChunkMotors = 4096;
+
+    explicit ParallelWaveEvaluator(WorkStealingPool &pool, int chunkMotors = kDefaultChunkMotors);
+
+    // Adds an installation and returns its index.
+    int addInstallation(const WaveParams &p);
+
+    int installationCount() const { return static_cast<int>(installs.size()); }
+
+    // Parameters may change between evaluations; changing numMotors
+    // re-allocates the buffers on the next evaluate().
+    WaveParams &params(int installation);
+
+    // Evaluates every installation at time t.
+    void evaluate(double t);
+
+    // Last evaluated frame of an installation (numMotors values).
+    const double *positions(int installation) const;
+
+    std::size_t chunkCount() const { return chunks.size(); }
+
+private:
+    struct Installation
+    {
+        WaveParams params;
+        int allocatedMotors = 0;
+        std::unique_ptr<double[]> buffer;
+    };
+
+    struct Chunk
+    {
+        int installation;
+        int first;
+        int last;
+    };
+
+    void prepare();
+
+    WorkStealingPool &pool;
+    int chunkMotors;
+    std::vector<Installation> installs;
+    std::vector<Chunk> chunks;
+    bool dirty = true;
+};
+
+#endif // PARALLELWAVE_H
@@ -0,0 +1,285 @@
+#include "parametersweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "workstealingpool.h"
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// Per-motor extremes of the unit-stroke row, in position units per frame
+// (differences are scaled to time at the end). Four fields: GCC
+// vectorizes interleaved records of a power-of-two size only.
+struct MotorStats
+{
+    double lowest, highest, velocity, acceleration;
+};
+
+// A worker's arena: the last four frames and the per-motor accumulators,
+// sized for the largest row once and reused for every simulation.
+struct Scratch
+{
+    std::vector<double> frames; // 4 rows of maxMotors
+    std::vector<MotorStats> motors;
+    std::vector<double> jerkSquares;
+    std::vector<double> neighbour; // per pair i, i + 1
+};
+
+// Folds frame x into the accumulators; p1..p3 are the previous frames and
+// wv, wa, wj 1 once velocity, acceleration and jerk are defined, else 0.
+void foldFrame(const double *__restrict x, const double *__restrict p1, const double *__restrict p2,
+               const double *__restrict p3, int count, double wv, double wa, double wj, MotorStats *__restrict s,
+               double *__restrict jerkSquares, double *__restrict neighbour)
+{
+    for (int i = 0; i < count; ++i) {
+        const double v = std::fabs(x[i] - p1[i]) * wv;
+        const double a = std::fabs(x[i] - 2 * p1[i] + p2[i]) * wa;
+        const double j = (x[i] - 3 * p1[i] + 3 * p2[i] - p3[i]) * wj;
+        MotorStats &q = s[i];
+        q.lowest = std::min(q.lowest, x[i]);
+        q.highest = std::max(q.highest, x[i]);
+        q.velocity = std::max(q.velocity, v);
+        q.acceleration = std::max(q.acceleration, a);
+        jerkSquares[i] += j * j;
+    }
+    for (int i = 0; i + 1 < count; ++i)
+        neighbour[i] = std::max(neighbour[i], std::fabs(x[i + 1] - x[i]));
+}
+
+// Runs ticks frames of a row of count motors; frame(k, out) computes frame k.
+template <typename Frame>
+void simulate(long ticks, int count, Scratch &scratch, Frame frame)
+{
+    scratch.motors.assign(count, MotorStats{kInf, -kInf, 0.0, 0.0});
+    scratch.jerkSquares.assign(count, 0.0);
+    scratch.neighbour.assign(count, 0.0);
+    double *row[4];
+    for (int r = 0; r < 4; ++r)
+        row[r] = scratch.frames.data() + static_cast<std::size_t>(r) * count;
+    for (long k = 0; k < ticks; ++k) {
+        frame(k, row[0]);
+        foldFrame(row[0], k >= 1 ? row[1] : row[0], k >= 2 ? row[2] : row[0], k >= 3 ? row[3] : row[0], count,
+                  k >= 1, k >= 2, k >= 3, scratch.motors.data(), scratch.jerkSquares.data(),
+                  scratch.neighbour.data());
+        std::rotate(row, row + 3, row + 4); // the current frame becomes p1
+    }
+}
+
+// Metrics of the first motors of the accumulated row at stroke scale.
+void fillMetrics(SweepResult &r, const MotorStats &prefix, double jerkSquares, double neighbour, long ticks,
+                 int motors, double scale, double tickSeconds)
+{
+    const double dt = tickSeconds;
+    const long jerkFrames = std::max(1L, ticks - 3);
+    const double s = std::fabs(scale);
+    r.peakPosition = s * std::max(std::fabs(prefix.lowest), std::fabs(prefix.highest));
+    r.peakVelocity = s * prefix.velocity / dt;
+    r.peakAcceleration = s * prefix.acceleration / (dt * dt);
+    r.peakNeighbour = s * neighbour;
+    r.rmsJerk = s * std::sqrt(jerkSquares / (static_cast<double>(motors) * jerkFrames)) / (dt * dt * dt);
+}
+
+bool meetsLimits(const SweepResult &r, double lowest, double highest, const SweepOptions &o)
+{
+    const EnvelopeLimits &l = o.limits;
+    if (l.minPosition < l.maxPosition && (lowest < l.minPosition || highest > l.maxPosition))
+        return false;
+    if (l.maxNeighbourDelta > 0 && r.peakNeighbour > l.maxNeighbourDelta)
+        return false;
+    if (l.maxVelocity > 0 && r.peakVelocity > l.maxVelocity)
+        return false;
+    return !(o.maxAcceleration > 0 && r.peakAcceleration > o.maxAcceleration);
+}
+
+double rankKey(const SweepResult &r, SweepRank rank)
+{
+    switch (rank) {
+    case SweepRank::Smoothness: return r.rmsJerk;
+    case SweepRank::Velocity: return r.peakVelocity;
+    case SweepRank::Acceleration: return r.peakAcceleration;
+    case SweepRank::Neighbour: return r.peakNeighbour;
+    case SweepRank::Stroke: return -r.strokeLength;
+    }
+    return 0.0;
+}
+
+} // namespace
+
+const char *sweepRankName(SweepRank rank)
+{
+    switch (rank) {
+    case SweepRank::Smoothness: return "smoothness";
+    case SweepRank::Velocity: return "velocity";
+    case SweepRank::Acceleration: return "acceleration";
+    case SweepRank::Neighbour: return "neighbour";
+    case SweepRank::Stroke: return "stroke";
+    }
+    return "?";
+}
+
+SweepReport runWaveSweep(const SweepGrid &grid, const SweepOptions &options, WorkStealingPool *pool)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    SweepReport report;
+    const int factors = grid.waveFactor.count, strokes = grid.strokeLength.count, steps = grid.step.count;
+    const int counts = static_cast<int>(grid.motorCounts.size());
+    const int maxMotors = counts ? *std::max_element(grid.motorCounts.begin(), grid.motorCounts.end()) : 0;
+    const int minMotors = counts ? *std::min_element(grid.motorCounts.begin(), grid.motorCounts.end()) : 0;
+    const long ticks = options.ticks;
+    if (factors < 1 || strokes < 1 || steps < 1 || minMotors < 1 || ticks < 1)
+        return report;
+
+    // Shared tables: amp * cos/sin(i * phi) per factor, cos/sin(2 pi f t)
+    // per step and frame.
+    const WaveParams &base = options.base;
+    const bool sine = base.shape == WaveShape::Sine;
+    std::vector<double> motorCos, motorSin, tickCos, tickSin;
+    if (sine) {
+        motorCos.resize(static_cast<std::size_t>(factors) * maxMotors);
+        motorSin.resize(motorCos.size());
+        for (int f = 0; f < factors; ++f) {
+            const double phi = base.basePhaseShift * grid.waveFactor.value(f);
+            for (int i = 0; i < maxMotors; ++i) {
+                motorCos[static_cast<std::size_t>(f) * maxMotors + i] = base.amp * std::cos(i * phi);
+                motorSin[static_cast<std::size_t>(f) * maxMotors + i] = base.amp * std::sin(i * phi);
+            }
+        }
+        tickCos.resize(static_cast<std::size_t>(steps) * ticks);
+        tickSin.resize(tickCos.size());
+        for (int s = 0; s < steps; ++s)
+            for (long k = 0; k < ticks; ++k) {
+                const double wt = 2 * M_PI * base.frequency * (k * grid.step.value(s));
+                tickCos[static_cast<std::size_t>(s) * ticks + k] = std::cos(wt);
+                tickSin[static_cast<std::size_t>(s) * ticks + k] = std::sin(wt);
+            }
+    }
+
+    const int workers = pool ? pool->size() : 1;
+    std::vector<Scratch> scratch(workers);
+    for (Scratch &s : scratch)
+        s.frames.resize(4 * static_cast<std::size_t>(maxMotors));
+    report.results.resize(static_cast<std::size_t>(grid.size()));
+    std::vector<double> lowest(report.results.size()), highest(report.results.size());
+
+    auto run = [&](std::size_t item, int worker) {
+        const int f = static_cast<int>(item) / steps, s = static_cast<int>(item) % steps;
+        Scratch &arena = scratch[worker];
+        if (sine) {
+            const double *mc = motorCos.data() + static_cast<std::size_t>(f) * maxMotors;
+            const double *ms = motorSin.data() + static_cast<std::size_t>(f) * maxMotors;
+            const double *tc = tickCos.data() + static_cast<std::size_t>(s) * ticks;
+            const double *ts = tickSin.data() + static_cast<std::size_t>(s) * ticks;
+            simulate(ticks, maxMotors, arena, [&](long k, double *out) {
+                // sin(wt + i*phi) = sin(wt) cos(i*phi) + cos(wt) sin(i*phi)
+                const double a = ts[k], b = tc[k];
+                for (int i = 0; i < maxMotors; ++i)
+                    out[i] = a * mc[i] + b * ms[i];
+            });
+        } else {
+            WaveParams p = base;
+            p.numMotors = maxMotors;
+            p.waveFactorValue = grid.waveFactor.value(f);
+            p.strokeLengthValue = 1.0;
+            p.step = grid.step.value(s);
+            simulate(ticks, maxMotors, arena,
+                     [&](long k, double *out) { generateWavePositions(p, k * p.step, out); });
+        }
+
+        // Prefix folds: the stats of the first N motors for every N at
+        // index N - 1 (neighbour: of the pairs below motor N - 1).
+        std::vector<MotorStats> &m = arena.motors;
+        std::vector<double> &jerk = arena.jerkSquares;
+        std::vector<double> &neighbour = arena.neighbour;
+        double pairs = 0.0;
+        for (int i = 1; i < maxMotors; ++i) {
+            MotorStats &q = m[i];
+            const MotorStats &before = m[i - 1];
+            q.lowest = std::min(q.lowest, before.lowest);
+            q.highest = std::max(q.highest, before.highest);
+            q.velocity = std::max(q.velocity, before.velocity);
+            q.acceleration = std::max(q.acceleration, before.acceleration);
+            jerk[i] += jerk[i - 1];
+            const double pair = neighbour[i - 1];
+            neighbour[i - 1] = pairs;
+            pairs = std::max(pairs, pair);
+        }
+        neighbour[maxMotors - 1] = pairs;
+        for (int st = 0; st < strokes; ++st) {
+            const double stroke = grid.strokeLength.value(st);
+            for (int c = 0; c < counts; ++c) {
+                const long index = ((static_cast<long>(f) * strokes + st) * steps + s) * counts + c;
+                const int motors = grid.motorCounts[c];
+                SweepResult &r = report.results[index];
+                r.index = index;
+                r.waveFactor = grid.waveFactor.value(f);
+                r.strokeLength = stroke;
+                r.step = grid.step.value(s);
+                r.motors = motors;
+                const MotorStats &q = m[motors - 1];
+                fillMetrics(r, q, jerk[motors - 1], neighbour[motors - 1], ticks, motors, stroke,
+                            options.limits.tickSeconds);
+                lowest[index] = stroke >= 0 ? stroke * q.lowest : stroke * q.highest;
+                highest[index] = stroke >= 0 ? stroke * q.highest : stroke * q.lowest;
+            }
+        }
+    };
+    const std::size_t items = static_cast<std::size_t>(factors) * steps;
+    if (pool)
+        pool->parallelFor(items, run);
+    else
+        for (std::size_t item = 0; item < items; ++item)
+            run(item, 0);
+
+    for (SweepResult &r : report.results) {
+        r.withinLimits = meetsLimits(r, lowest[r.index], highest[r.index], options);
+        report.withinLimits += r.withinLimits;
+    }
+    std::sort(report.results.begin(), report.results.end(), [&](const SweepResult &a, const SweepResult &b) {
+        if (a.withinLimits != b.withinLimits)
+            return a.withinLimits;
+        const double ka = rankKey(a, options.rank), kb = rankKey(b, options.rank);
+        if (ka != kb)
+            return ka < kb;
+        return a.index < b.index;
+    });
+    report.simulations = static_cast<long>(items);
+    report.frames = report.simulations * ticks;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return report;
+}
+
+SweepResult measureWave(const WaveParams &params, const SweepOptions &options)
+{
+    SweepResult r;
+    r.waveFactor = params.waveFactorValue;
+    r.strokeLength = params.strokeLengthValue;
+    r.step = params.step;
+    r.motors = params.numMotors;
+    if (params.numMotors < 1 || options.ticks < 1)
+        return r;
+    Scratch scratch;
+    scratch.frames.resize(4 * static_cast<std::size_t>(params.numMotors));
+    WaveGenerator generator(params);
+    simulate(options.ticks, params.numMotors, scratch, [&](long, double *out) {
+        const std::vector<double> &frame = generator.tick();
+        std::copy(frame.begin(), frame.end(), out);
+    });
+    MotorStats all{kInf, -kInf, 0.0, 0.0};
+    double jerkSquares = 0.0, neighbour = 0.0;
+    for (int i = 0; i < params.numMotors; ++i) {
+        const MotorStats &q = scratch.motors[i];
+        all.lowest = std::min(all.lowest, q.lowest);
+        all.highest = std::max(all.highest, q.highest);
+        all.velocity = std::max(all.velocity, q.velocity);
+        all.acceleration = std::max(all.acceleration, q.acceleration);
+        jerkSquares += scratch.jerkSquares[i];
+        neighbour = std::max(neighbour, scratch.neighbour[i]);
+    }
+    fillMetrics(r, all, jerkSquares, neighbour, options.ticks, params.numMotors, 1.0, options.limits.tickSeconds);
+    r.withinLimits = meetsLimits(r, all.lowest, all.highest, options);
+    return r;
+}
@@ -0,0 +1,111 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <vector>
+
+#include "envelopecheck.h"
+#include "wavekernel.h"
+
+class WorkStealingPool;
+
+// Batch exploration of the wave sliders: every combination of wave factor,
+// stroke length, time step and motor count in a grid is run headless for
+// the same number of frames, measured and ranked, instead of dragging the
+// sliders one configuration at a time.
+//
+// Most of the grid is never simulated. Positions scale linearly with the
+// stroke, so every metric of a stroke follows from the unit stroke by one
+// multiply; and a row of N motors is the first N motors of the largest
+// row, so per-motor extremes (and jerk sums) folded as prefixes give every
+// motor count. Only factor x step pairs run: each simulates the largest
+// row once, on a pool worker with its own scratch arena (frame history and
+// per-motor accumulators, allocated once per worker), so memory does not
+// grow with the grid. For the sine shape the frames come from shared
+// tables, sin/cos(i * phi) per factor and sin/cos(2 pi f t) per step and
+// frame, computed once before the sweep: a frame is then one vectorized
+// multiply-add per motor (as in StaticWaveKernel) rather than a sin per
+// motor. Other shapes evaluate generateWavePositions().
+
+// Values a slider takes: count steps from first to last inclusive (first
+// only for count 1).
+struct SweepRange
+{
+    double first = 0.0;
+    double last = 0.0;
+    int count = 1;
+
+    double value(int k) const { return count > 1 ? first + (last - first) * k / (count - 1) : first; }
+};
+
+struct SweepGrid
+{
+    SweepRange waveFactor{0.0, 1.0, 21};     // UI slider 0..100 / 100
+    SweepRange strokeLength{1.0, 30.0, 30};  // UI slider 1..30
+    SweepRange step{0.02, 0.1, 5};
+    std::vector<int> motorCounts{12, 24, 50};
+
+    long size() const
+    {
+        return static_cast<long>(waveFactor.count) * strokeLength.count * step.count
+               * static_cast<long>(motorCounts.size());
+    }
+};
+
+enum class SweepRank
+{
+    Smoothness,   // rms jerk, lowest first
+    Velocity,     // peak velocity
+    Acceleration, // peak acceleration
+    Neighbour,    // peak neighbour delta
+    Stroke        // largest stroke first (the most motion within limits)
+};
+
+const char *sweepRankName(SweepRank rank);
+
+struct SweepOptions
+{
+    WaveParams base;             // amp, frequency, basePhaseShift and shape; the rest comes from the grid
+    long ticks = 400;            // frames per combination
+    EnvelopeLimits limits;       // travel, neighbour and velocity, as waveenvelope checks them
+    double maxAcceleration = 0.0; // mm/s^2, 0: not checked
+    SweepRank rank = SweepRank::Smoothness;
+};
+
+// Metrics of one combination over its frames. Velocity counts from the
+// second frame, acceleration from the third and jerk from the fourth (the
+// wave starts from its first frame, not from rest), all as finite
+// differences at limits.tickSeconds per frame, as the drives see them.
+struct SweepResult
+{
+    long index = 0;               // in the grid: factor slowest, then stroke, step, motor count
+    double waveFactor = 0.0;
+    double strokeLength = 0.0;
+    double step = 0.0;
+    int motors = 0;
+
+    double peakPosition = 0.0;     // mm, |x|
+    double peakVelocity = 0.0;     // mm/s
+    double peakAcceleration = 0.0; // mm/s^2
+    double peakNeighbour = 0.0;    // mm between motors i and i + 1
+    double rmsJerk = 0.0;          // mm/s^3 over motors and frames: lower is smoother
+    bool withinLimits = true;
+};
+
+struct SweepReport
+{
+    std::vector<SweepResult> results; // ranked: within limits first, then by options.rank
+    long simulations = 0;             // factor x step runs
+    long frames = 0;                  // frames computed (of the largest row)
+    long withinLimits = 0;
+    double seconds = 0.0;
+};
+
+// Runs the grid on pool (serially without one).
+SweepReport runWaveSweep(const SweepGrid &grid, const SweepOptions &options, WorkStealingPool *pool = nullptr);
+
+// The metrics of one combination the direct way: every frame from
+// generateWavePositions() with the full parameters. The reference the
+// sweep is checked against; also handy for a single setting.
+SweepResult measureWave(const WaveParams &params, const SweepOptions &options);
+
+#endif // PARAMETERSWEEP_H
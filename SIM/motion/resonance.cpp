@@ -0,0 +1,290 @@
+#include "resonance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+std::vector<ResonanceBand> defaultResonanceBands()
+{
+    return {{"gantry", 20.0, 50.0}, {"mid-band", 80.0, 200.0}};
+}
+
+const char *shaperTypeName(ShaperType type)
+{
+    switch (type) {
+    case ShaperType::None: return "none";
+    case ShaperType::ZV: return "zv";
+    case ShaperType::ZVD: return "zvd";
+    case ShaperType::Notch: return "notch";
+    }
+    return "?";
+}
+
+bool ResonanceReport::flagged() const
+{
+    for (int n : axesFlagged)
+        if (n > 0)
+            return true;
+    return false;
+}
+
+InputShaper::InputShaper(int axes, const ShaperOptions &options, double sampleRate)
+    : axes(axes), opt(options), z1(axes, 0.0), z2(axes, 0.0)
+{
+    const double zeta = std::clamp(opt.damping, 0.0, 0.99);
+    const double root = std::sqrt(1.0 - zeta * zeta);
+    const double k = std::exp(-zeta * M_PI / root);
+    const double period = opt.frequency > 0 ? 1.0 / (opt.frequency * root) : 0.0;
+    if (opt.type == ShaperType::ZV && period > 0) {
+        amp = {1.0 / (1.0 + k), k / (1.0 + k)};
+        time = {0.0, period / 2};
+    } else if (opt.type == ShaperType::ZVD && period > 0) {
+        const double d = (1.0 + k) * (1.0 + k);
+        amp = {1.0 / d, 2.0 * k / d, k * k / d};
+        time = {0.0, period / 2, period};
+    } else {
+        amp = {1.0};
+        time = {0.0};
+    }
+    for (double t : time) {
+        const double d = t * sampleRate;
+        whole.push_back(static_cast<int>(d));
+        fraction.push_back(d - whole.back());
+        historyLength = std::max(historyLength, whole.back() + 1);
+    }
+    history.assign(static_cast<std::size_t>(axes) * historyLength, 0.0);
+
+    if (opt.type == ShaperType::Notch && opt.frequency > 0 && opt.frequency < sampleRate / 2) {
+        const double w0 = 2 * M_PI * opt.frequency / sampleRate;
+        const double alpha = std::sin(w0) / (2 * std::max(opt.notchQ, 1e-3));
+        const double a0 = 1.0 + alpha;
+        b0 = 1.0 / a0;
+        b1 = -2.0 * std::cos(w0) / a0;
+        b2 = 1.0 / a0;
+        a1 = b1;
+        a2 = (1.0 - alpha) / a0;
+    }
+}
+
+void InputShaper::reset(int axis, double position)
+{
+    std::fill_n(history.begin() + static_cast<std::size_t>(axis) * historyLength, historyLength, position);
+    // Direct form II transposed at rest: y = x = position.
+    z2[axis] = (b2 - a2) * position;
+    z1[axis] = (1.0 - b0) * position;
+}
+
+void InputShaper::process(int axis, const double *in, double *out, int count)
+{
+    if (opt.type == ShaperType::Notch) {
+        double s1 = z1[axis], s2 = z2[axis];
+        for (int i = 0; i < count; ++i) {
+            const double x = in[i];
+            const double y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            out[i] = y;
+        }
+        z1[axis] = s1;
+        z2[axis] = s2;
+        return;
+    }
+    if (amp.size() == 1) {
+        if (out != in)
+            std::memmove(out, in, sizeof(double) * count);
+        return;
+    }
+
+    // line = [history | in]; impulse j reads line at i - delay_j.
+    const int h = historyLength;
+    line.resize(static_cast<std::size_t>(h) + count);
+    double *hist = history.data() + static_cast<std::size_t>(axis) * h;
+    std::copy(hist, hist + h, line.begin());
+    std::copy(in, in + count, line.begin() + h);
+    const double *x = line.data() + h;
+    for (int i = 0; i < count; ++i)
+        out[i] = 0.0;
+    for (std::size_t j = 0; j < amp.size(); ++j) {
+        const double *a = x - whole[j];
+        const double wa = amp[j] * (1.0 - fraction[j]), wb = amp[j] * fraction[j];
+        for (int i = 0; i < count; ++i)
+            out[i] += wa * a[i] + wb * a[i - 1];
+    }
+    std::copy(line.end() - h, line.end(), hist);
+}
+
+double InputShaper::duration() const
+{
+    return time.back();
+}
+
+ResonanceAnalyzer::ResonanceAnalyzer(int axes, const ResonanceOptions &options)
+    : axes(axes), opt(options), fft(options.fftSize), fftSize(fft.size())
+{
+    window.resize(fftSize);
+    double sum2 = 0.0;
+    for (int j = 0; j < fftSize; ++j) {
+        window[j] = 0.5 - 0.5 * std::cos(2 * M_PI * j / fftSize);
+        sum2 += window[j] * window[j];
+    }
+    scale = 1.0 / (opt.sampleRate * sum2);
+    signal.assign(static_cast<std::size_t>(axes) * fftSize, 0.0);
+    lastPosition.assign(axes, 0.0);
+    lastVelocity.assign(axes, 0.0);
+    psdSum.assign(static_cast<std::size_t>(axes) * fft.bins(), 0.0);
+    windowed.resize(fftSize);
+    power.resize(fft.bins());
+}
+
+void ResonanceAnalyzer::add(const double *positions, int count, int stride)
+{
+    if (count <= 0)
+        return;
+    if (samples == 0) {
+        for (int a = 0; a < axes; ++a)
+            lastPosition[a] = positions[static_cast<std::size_t>(a) * stride];
+    }
+    const double rate = opt.sampleRate;
+    const bool acceleration = opt.signal == ResonanceSignal::Acceleration;
+    for (int done = 0; done < count;) {
+        const int take = std::min(count - done, fftSize - fill);
+        for (int a = 0; a < axes; ++a) {
+            const double *p = positions + static_cast<std::size_t>(a) * stride + done;
+            double *out = signal.data() + static_cast<std::size_t>(a) * fftSize + fill;
+            double x0 = lastPosition[a], v0 = lastVelocity[a];
+            for (int i = 0; i < take; ++i) {
+                const double v = (p[i] - x0) * rate;
+                out[i] = acceleration ? (v - v0) * rate : v;
+                x0 = p[i];
+                v0 = v;
+            }
+            lastPosition[a] = x0;
+            lastVelocity[a] = v0;
+        }
+        fill += take;
+        done += take;
+        if (fill == fftSize)
+            runSegment();
+    }
+    samples += count;
+}
+
+void ResonanceAnalyzer::runSegment()
+{
+    const int bins = fft.bins();
+    for (int a = 0; a < axes; ++a) {
+        double *s = signal.data() + static_cast<std::size_t>(a) * fftSize;
+        for (int j = 0; j < fftSize; ++j)
+            windowed[j] = s[j] * window[j];
+        fft.power(windowed.data(), power.data());
+        double *sum = psdSum.data() + static_cast<std::size_t>(a) * bins;
+        for (int k = 0; k < bins; ++k)
+            sum[k] += power[k];
+        // 50% overlap: the second half starts the next segment.
+        std::copy(s + fftSize / 2, s + fftSize, s);
+    }
+    fill = fftSize / 2;
+    ++segments;
+}
+
+ResonanceReport ResonanceAnalyzer::report() const
+{
+    ResonanceReport r;
+    const int bins = fft.bins();
+    r.binHz = opt.sampleRate / fftSize;
+    r.samples = samples;
+    r.segments = segments;
+    r.psd.assign(bins, 0.0);
+    r.axesFlagged.assign(opt.bands.size(), 0);
+    r.axes.resize(axes);
+    if (segments == 0)
+        return r;
+
+    std::vector<double> psd(bins);
+    for (int a = 0; a < axes; ++a) {
+        const double *sum = psdSum.data() + static_cast<std::size_t>(a) * bins;
+        // One-sided: every bin but DC and Nyquist stands for two.
+        for (int k = 0; k < bins; ++k)
+            psd[k] = sum[k] * scale / segments * (k == 0 || k == bins - 1 ? 1.0 : 2.0);
+        double total = 0.0, peak = 0.0;
+        AxisSpectrum &axis = r.axes[a];
+        for (int k = 1; k < bins; ++k) {
+            total += psd[k] * r.binHz;
+            if (psd[k] > peak) {
+                peak = psd[k];
+                axis.peakHz = k * r.binHz;
+            }
+            r.psd[k] += psd[k] / axes;
+        }
+        r.psd[0] += psd[0] / axes;
+        axis.rms = std::sqrt(total);
+        for (std::size_t b = 0; b < opt.bands.size(); ++b) {
+            const int lo = std::max(1, static_cast<int>(std::ceil(opt.bands[b].lowHz / r.binHz)));
+            const int hi = std::min(bins - 1, static_cast<int>(std::floor(opt.bands[b].highHz / r.binHz)));
+            BandEnergy e;
+            double bandPeak = 0.0;
+            for (int k = lo; k <= hi; ++k) {
+                e.rms += psd[k] * r.binHz;
+                if (psd[k] > bandPeak) {
+                    bandPeak = psd[k];
+                    e.peakHz = k * r.binHz;
+                }
+            }
+            e.fraction = total > 0 ? e.rms / total : 0.0;
+            e.rms = std::sqrt(e.rms);
+            e.flagged = e.fraction > opt.flagFraction;
+            r.axesFlagged[b] += e.flagged;
+            axis.bands.push_back(e);
+        }
+    }
+    return r;
+}
+
+ResonanceReport analyzeWave(const WaveJournal &journal, const ResonanceOptions &options, long ticks)
+{
+    if (ticks < 0)
+        ticks = journal.complete ? journal.ticks : 0;
+    const int axes = journal.initial.numMotors;
+    ResonanceAnalyzer analyzer(axes, options);
+    InputShaper shaper(axes, options.shaper, options.sampleRate);
+    if (ticks <= 0 || axes <= 0)
+        return analyzer.report();
+
+    WaveReplay replay(journal);
+    std::vector<double> previous = replay.tick();
+    previous.resize(axes);
+    for (int a = 0; a < axes; ++a)
+        shaper.reset(a, previous[a]);
+    analyzer.add(previous.data(), 1, 1);
+
+    // Samples j / sampleRate in (frame f - 1, frame f] interpolate the two.
+    const double rate = options.sampleRate, tick = options.tickSeconds;
+    const int perFrame = static_cast<int>(std::ceil(tick * rate)) + 1;
+    std::vector<double> chunk(static_cast<std::size_t>(axes) * perFrame), u(perFrame);
+    long next = 1;
+    for (long f = 1; f < ticks; ++f) {
+        const std::vector<double> &current = replay.tick();
+        const long last = static_cast<long>(std::floor(f * tick * rate + 1e-9));
+        const int count = static_cast<int>(std::min<long>(last - next + 1, perFrame));
+        for (int i = 0; i < count; ++i)
+            u[i] = ((next + i) / rate - (f - 1) * tick) / tick;
+        for (int a = 0; a < axes; ++a) {
+            double *c = chunk.data() + static_cast<std::size_t>(a) * perFrame;
+            const double p0 = previous[a], d = current[a] - p0;
+            for (int i = 0; i < count; ++i)
+                c[i] = p0 + d * u[i];
+            shaper.process(a, c, c, count);
+            previous[a] = current[a];
+        }
+        analyzer.add(chunk.data(), count, perFrame);
+        next += count;
+    }
+    return analyzer.report();
+}
+
+ResonanceReport analyzeWave(const WaveParams &params, const ResonanceOptions &options, long ticks)
+{
+    WaveJournal journal;
+    journal.initial = params;
+    return analyzeWave(journal, options, ticks);
+}
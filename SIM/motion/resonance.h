@@ -0,0 +1,171 @@
+#ifndef RESONANCE_H
+#define RESONANCE_H
+
+#include <string>
+#include <vector>
+
+#include "fft.h"
+#include "wavejournal.h"
+#include "wavekernel.h"
+
+// Spectral resonance analysis of the motion a wave program commands.
+//
+// The program's frames are resampled (linearly, as the drives follow them)
+// to sampleRate, optionally shaped, differentiated to velocity or
+// acceleration per axis and run through a Welch power spectral density
+// estimate: Hann-windowed segments of fftSize samples, 50% overlap. The
+// report gives each axis's share of energy inside each resonance band and
+// flags bands above flagFraction, which is the sign that the program, not
+// just its disturbances, drives the gantry or motor at its resonance.
+
+// A frequency band where the machine resonates, in Hz.
+struct ResonanceBand
+{
+    std::string name;
+    double lowHz;
+    double highHz;
+};
+
+// Starting points until the machine's own bands are measured (tap test,
+// accelerometer): the gantry frame's first bending modes and the stepper
+// mid-band resonance of 200-step motors at wave speeds.
+std::vector<ResonanceBand> defaultResonanceBands();
+
+enum class ShaperType
+{
+    None,
+    ZV,    // two impulses, zero vibration at the frequency
+    ZVD,   // three impulses, also zero slope: tolerates a mistuned frequency
+    Notch  // second-order IIR band-stop
+};
+
+const char *shaperTypeName(ShaperType type);
+
+struct ShaperOptions
+{
+    ShaperType type = ShaperType::None;
+    double frequency = 30.0; // Hz, the resonance to suppress
+    double damping = 0.05;   // its damping ratio (ZV, ZVD)
+    double notchQ = 2.0;     // notch quality factor: frequency / stop bandwidth
+};
+
+enum class ResonanceSignal
+{
+    Velocity,
+    Acceleration
+};
+
+struct ResonanceOptions
+{
+    double sampleRate = 1000.0;  // Hz the trajectory is resampled to
+    double tickSeconds = 0.05;   // real time per frame (the UI timer period)
+    int fftSize = 4096;          // samples per Welch segment, power of two
+    ResonanceSignal signal = ResonanceSignal::Acceleration;
+    double flagFraction = 0.05;  // flag bands holding more of an axis's energy
+    std::vector<ResonanceBand> bands = defaultResonanceBands();
+    ShaperOptions shaper;
+};
+
+struct BandEnergy
+{
+    double fraction = 0.0; // of the axis's energy above DC
+    double rms = 0.0;      // mm/s or mm/s^2 within the band
+    double peakHz = 0.0;   // strongest bin in the band
+    bool flagged = false;
+};
+
+struct AxisSpectrum
+{
+    double rms = 0.0;      // whole signal, DC excluded
+    double peakHz = 0.0;   // strongest bin above DC
+    std::vector<BandEnergy> bands;
+};
+
+struct ResonanceReport
+{
+    double binHz = 0.0;
+    long samples = 0;           // per axis
+    long segments = 0;          // Welch segments averaged
+    std::vector<double> psd;    // mean over axes, (mm/s)^2/Hz or (mm/s^2)^2/Hz, per bin
+    std::vector<AxisSpectrum> axes;
+    std::vector<int> axesFlagged; // per band
+
+    bool flagged() const;
+};
+
+// Applies a ShaperOptions filter to each axis's position stream at a fixed
+// sample rate. ZV and ZVD convolve with their impulse sequence (fractional
+// delays by linear interpolation) and delay the motion by half a damped
+// period and a full one; the notch is a biquad (RBJ band-stop) with unit
+// DC gain. Every axis keeps its own history, so axes may be processed in
+// any order as long as each axis's samples come in order.
+class InputShaper
+{
+public:
+    InputShaper(int axes, const ShaperOptions &options, double sampleRate);
+
+    // Puts an axis at rest at position.
+    void reset(int axis, double position);
+
+    // count samples of one axis; in and out may be the same array.
+    void process(int axis, const double *in, double *out, int count);
+
+    // s from the first to the last impulse (0 for the notch and None).
+    double duration() const;
+
+    // Impulse amplitudes and times in s (ZV, ZVD).
+    const std::vector<double> &amplitudes() const { return amp; }
+    const std::vector<double> &times() const { return time; }
+
+private:
+    int axes;
+    ShaperOptions opt;
+    std::vector<double> amp, time;
+    std::vector<int> whole;        // per impulse: delay in samples, integer part
+    std::vector<double> fraction;  // and fractional part
+    int historyLength = 0;
+    std::vector<double> history;   // per axis: historyLength past inputs
+    std::vector<double> line;      // scratch: history + this call's input
+    double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    std::vector<double> z1, z2;    // biquad state per axis
+};
+
+// Streaming Welch PSD of every axis's velocity or acceleration, from the
+// positions sampled at options.sampleRate.
+class ResonanceAnalyzer
+{
+public:
+    ResonanceAnalyzer(int axes, const ResonanceOptions &options);
+
+    // count samples of every axis: positions[axis * stride + i]. The first
+    // sample of the stream is taken as a start from rest.
+    void add(const double *positions, int count, int stride);
+
+    // Spectrum of the segments completed so far; a stream shorter than
+    // fftSize has none (use a smaller fftSize).
+    ResonanceReport report() const;
+
+private:
+    void runSegment();
+
+    int axes;
+    ResonanceOptions opt;
+    RealFft fft;
+    int fftSize;
+    std::vector<double> window;
+    double scale;                 // turns |X|^2 into one-sided PSD
+    int fill = 0;
+    std::vector<double> signal;   // per axis: fftSize samples being collected
+    std::vector<double> lastPosition, lastVelocity;
+    std::vector<double> psdSum;   // per axis: bins() sums over segments
+    std::vector<double> windowed, power;
+    long samples = 0;
+    long segments = 0;
+};
+
+// Runs a wave program headless through the shaper and analyzer: a recorded
+// session up to ticks frames (-1: to its end record), or fixed settings.
+ResonanceReport analyzeWave(const WaveJournal &journal, const ResonanceOptions &options, long ticks = -1);
+ResonanceReport analyzeWave(const WaveParams &params, const ResonanceOptions &options, long ticks);
+
+#endif // RESONANCE_H
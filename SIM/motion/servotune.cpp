@@ -0,0 +1,134 @@
+// Offline servo tuning against the UI's wave (see closedloop.h).
+//
+//   servotune [--axes N] [--rate HZ] [--seconds S] [--load N] [--stroke MM] [--factor F]
+//             [--kp G] [--ki G] [--kd G] [--kff G] [--open] [--sweep]
+//
+// Feeds the wave (20 frames/s, --factor in 0..1 and --stroke in mm as in
+// the UI) through ClosedLoopSim at HZ with a load of N newton on every axis
+// and prints the tracking error and missed steps for the given gains, or
+// for the step generator alone with --open. --sweep runs a kp x kd grid
+// (ki and kff as given) and lists the ten settings with the lowest RMS
+// error that miss no steps. Exit code 1 if the (best) setting misses steps.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "closedloop.h"
+#include "wavekernel.h"
+
+namespace {
+
+constexpr double kFrameSeconds = 0.05;
+
+struct Trial
+{
+    ServoGains gains;
+    ClosedLoopStats stats;
+};
+
+ClosedLoopStats runWave(const ClosedLoopConfig &cfg, const WaveParams &params, double load, double seconds)
+{
+    ClosedLoopSim sim(params.numMotors, cfg);
+    sim.setLoad(load);
+    WaveGenerator wave(params);
+    std::vector<double> from = wave.tick();
+    sim.reset(from.data());
+    const int ticks = sim.ticksFor(kFrameSeconds);
+    const long frames = static_cast<long>(seconds / kFrameSeconds);
+    for (long f = 1; f < frames; ++f) {
+        const std::vector<double> &to = wave.tick();
+        sim.advance(from.data(), to.data(), ticks);
+        from = to;
+    }
+    return sim.stats();
+}
+
+void printTrial(const Trial &t)
+{
+    std::printf("  kp %7.1f  ki %8.1f  kd %6.4f  kff %4.2f   max %8.4f mm  rms %8.4f mm  missed %6.0f steps on %d axes\n",
+                t.gains.kp, t.gains.ki, t.gains.kd, t.gains.kff, t.stats.maxError, t.stats.rmsError,
+                t.stats.missedSteps, t.stats.axesMissing);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    ClosedLoopConfig cfg;
+    WaveParams params;
+    params.numMotors = 50;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    double seconds = 10.0;
+    double load = 0.6 * cfg.maxForce;
+    bool sweep = false;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--axes") && i + 1 < argc)
+            params.numMotors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc)
+            cfg.rateHz = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc)
+            seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--load") && i + 1 < argc)
+            load = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--stroke") && i + 1 < argc)
+            params.strokeLengthValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--factor") && i + 1 < argc)
+            params.waveFactorValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--kp") && i + 1 < argc)
+            cfg.gains.kp = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ki") && i + 1 < argc)
+            cfg.gains.ki = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--kd") && i + 1 < argc)
+            cfg.gains.kd = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--kff") && i + 1 < argc)
+            cfg.gains.kff = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--open"))
+            cfg.closedLoop = false;
+        else if (!std::strcmp(argv[i], "--sweep"))
+            sweep = true;
+        else
+            usage = true;
+    }
+    if (usage || params.numMotors < 1 || cfg.rateHz < 1000.0 || seconds < 2 * kFrameSeconds || (sweep && !cfg.closedLoop)) {
+        std::fprintf(stderr,
+                     "usage: %s [--axes N] [--rate HZ] [--seconds S] [--load N] [--stroke MM] [--factor F]\n"
+                     "          [--kp G] [--ki G] [--kd G] [--kff G] [--open] [--sweep]\n",
+                     argv[0]);
+        return 2;
+    }
+    std::printf("axes: %d  rate: %.0f Hz  %.1f s of wave (factor %.2f, stroke %.1f mm)  load %.1f N of %.1f N\n",
+                params.numMotors, cfg.rateHz, seconds, params.waveFactorValue, params.strokeLengthValue, load,
+                cfg.maxForce);
+
+    if (!sweep) {
+        const Trial t{cfg.gains, runWave(cfg, params, load, seconds)};
+        std::printf("%s loop:\n", cfg.closedLoop ? "closed" : "open");
+        printTrial(t);
+        return t.stats.missedSteps == 0 ? 0 : 1;
+    }
+
+    const double kps[] = {50, 100, 200, 300, 500, 800, 1200, 2000};
+    const double kds[] = {0.0, 0.002, 0.005, 0.01, 0.02, 0.05};
+    std::vector<Trial> trials;
+    for (double kp : kps) {
+        for (double kd : kds) {
+            ClosedLoopConfig c = cfg;
+            c.gains.kp = kp;
+            c.gains.kd = kd;
+            trials.push_back({c.gains, runWave(c, params, load, seconds)});
+        }
+    }
+    std::sort(trials.begin(), trials.end(), [](const Trial &a, const Trial &b) {
+        if ((a.stats.missedSteps == 0) != (b.stats.missedSteps == 0))
+            return a.stats.missedSteps == 0;
+        return a.stats.rmsError < b.stats.rmsError;
+    });
+    std::printf("best of %zu settings:\n", trials.size());
+    for (std::size_t k = 0; k < trials.size() && k < 10; ++k)
+        printTrial(trials[k]);
+    return trials.front().stats.missedSteps == 0 ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+#include "shmfeed.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CNC_HAVE_SHM 1
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'N', 'C', 'S', 'H', 'M', '1', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kCacheLine = 64;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "seqlock needs lock-free 64-bit atomics");
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t maxMotors;
+    std::uint32_t slotCount;
+    std::uint32_t slotBytes;
+    alignas(kCacheLine) std::atomic<std::uint64_t> paramsSequence;
+    WaveParams params;
+    alignas(kCacheLine) std::atomic<std::uint64_t> head; // frames published
+};
+
+struct Slot
+{
+    std::atomic<std::uint64_t> sequence; // 2 * frame + 1 while writing, + 2 when done
+    std::uint64_t frame;
+    std::int64_t stampNs;
+    double t;
+    std::uint32_t count;
+    std::uint32_t reserved;
+    // double positions[maxMotors] follow
+};
+
+constexpr std::size_t roundUp(std::size_t n, std::size_t to) { return (n + to - 1) / to * to; }
+
+constexpr std::size_t kHeaderBytes = roundUp(sizeof(Header), kCacheLine);
+
+inline double *slotPositions(Slot *s) { return reinterpret_cast<double *>(s + 1); }
+inline const double *slotPositions(const Slot *s) { return reinterpret_cast<const double *>(s + 1); }
+
+} // namespace
+
+std::int64_t shmFeedClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// === Writer ===
+
+ShmFeedWriter::~ShmFeedWriter()
+{
+    close();
+}
+
+bool ShmFeedWriter::open(const std::string &name, int motorCount, int slotCount)
+{
+    close();
+    if (motorCount <= 0 || slotCount <= 0) {
+        err = "bad feed size";
+        return false;
+    }
+#ifdef CNC_HAVE_SHM
+    std::uint64_t slots = 1;
+    while (slots < static_cast<std::uint64_t>(slotCount))
+        slots <<= 1;
+    const std::size_t perSlot = roundUp(sizeof(Slot) + sizeof(double) * motorCount, kCacheLine);
+    const std::size_t total = kHeaderBytes + perSlot * slots;
+
+    // A fresh object each time: readers of an earlier run keep their old
+    // mapping instead of seeing this one resized under them.
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        err = "shm_open " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        err = "ftruncate " + name + ": " + std::strerror(errno);
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        err = "mmap " + name + ": " + std::strerror(errno);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    base = static_cast<unsigned char *>(p);
+    bytes = total;
+    shmName = name;
+    maxMotors = static_cast<std::uint32_t>(motorCount);
+    slotMask = slots - 1;
+    slotBytes = perSlot;
+    head = 0;
+    paramsVersion = 0;
+
+    Header *h = new (base) Header;
+    h->version = kVersion;
+    h->maxMotors = maxMotors;
+    h->slotCount = static_cast<std::uint32_t>(slots);
+    h->slotBytes = static_cast<std::uint32_t>(perSlot);
+    h->paramsSequence.store(0, std::memory_order_relaxed);
+    h->params = WaveParams();
+    h->head.store(0, std::memory_order_relaxed);
+    for (std::uint64_t k = 0; k < slots; ++k)
+        new (base + kHeaderBytes + k * perSlot) Slot{};
+    // The magic goes in last, so a reader never accepts a half-built feed.
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(h->magic, kMagic, sizeof kMagic);
+    return true;
+#else
+    (void)name;
+    err = "shared-memory feed needs POSIX shm";
+    return false;
+#endif
+}
+
+void ShmFeedWriter::close()
+{
+#ifdef CNC_HAVE_SHM
+    if (!base)
+        return;
+    munmap(base, bytes);
+    shm_unlink(shmName.c_str());
+    base = nullptr;
+#endif
+}
+
+void ShmFeedWriter::setParams(const WaveParams &params)
+{
+    if (!base)
+        return;
+    Header *h = reinterpret_cast<Header *>(base);
+    h->paramsSequence.store(2 * paramsVersion + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    h->params = params;
+    ++paramsVersion;
+    h->paramsSequence.store(2 * paramsVersion, std::memory_order_release);
+}
+
+void ShmFeedWriter::publish(const double *positions, int count, double t)
+{
+    if (!base)
+        return;
+    const std::uint32_t n = count < 0 ? 0 : (static_cast<std::uint32_t>(count) < maxMotors ? count : maxMotors);
+    Slot *s = reinterpret_cast<Slot *>(base + kHeaderBytes + (head & slotMask) * slotBytes);
+    s->sequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->frame = head;
+    s->stampNs = shmFeedClockNs();
+    s->t = t;
+    s->count = n;
+    std::memcpy(slotPositions(s), positions, sizeof(double) * n);
+    s->sequence.store(2 * head + 2, std::memory_order_release);
+    ++head;
+    reinterpret_cast<Header *>(base)->head.store(head, std::memory_order_release);
+}
+
+// === Reader ===
+
+ShmFeedReader::~ShmFeedReader()
+{
+    close();
+}
+
+bool ShmFeedReader::open(const std::string &name)
+{
+    close();
+#ifdef CNC_HAVE_SHM
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        err = "shm_open " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < kHeaderBytes) {
+        err = name + ": not a position feed";
+        ::close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        err = "mmap " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    base = static_cast<const unsigned char *>(p);
+    bytes = static_cast<std::size_t>(st.st_size);
+
+    const Header *h = reinterpret_cast<const Header *>(base);
+    const bool valid = std::memcmp(h->magic, kMagic, sizeof kMagic) == 0 && h->version == kVersion
+                       && h->slotCount > 0 && (h->slotCount & (h->slotCount - 1)) == 0
+                       && h->slotBytes >= sizeof(Slot) + sizeof(double) * h->maxMotors
+                       && kHeaderBytes + std::size_t(h->slotBytes) * h->slotCount <= bytes;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid) {
+        err = name + ": not a position feed (or still being created)";
+        close();
+        return false;
+    }
+    motors = h->maxMotors;
+    slotMask = h->slotCount - 1;
+    slotBytes = h->slotBytes;
+    lost = 0;
+    const std::uint64_t pub = published();
+    cursor = pub ? pub - 1 : 0;
+    return true;
+#else
+    (void)name;
+    err = "shared-memory feed needs POSIX shm";
+    return false;
+#endif
+}
+
+void ShmFeedReader::close()
+{
+#ifdef CNC_HAVE_SHM
+    if (!base)
+        return;
+    munmap(const_cast<unsigned char *>(base), bytes);
+    base = nullptr;
+#endif
+}
+
+std::uint64_t ShmFeedReader::published() const
+{
+    if (!base)
+        return 0;
+    return reinterpret_cast<const Header *>(base)->head.load(std::memory_order_acquire);
+}
+
+bool ShmFeedReader::params(WaveParams &out) const
+{
+    if (!base)
+        return false;
+    const Header *h = reinterpret_cast<const Header *>(base);
+    // An update takes well under a microsecond, but the writer can be
+    // descheduled in the middle of one, or die there and leave the sequence
+    // odd for good; retry until the deadline, yielding the CPU meanwhile.
+    const std::int64_t deadline = shmFeedClockNs() + kParamsTimeoutNs;
+    WaveParams p;
+    for (;;) {
+        const std::uint64_t s1 = h->paramsSequence.load(std::memory_order_acquire);
+        if (!(s1 & 1)) {
+            std::memcpy(static_cast<void *>(&p), &h->params, sizeof p);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (h->paramsSequence.load(std::memory_order_relaxed) == s1) {
+                out = p;
+                return true;
+            }
+        }
+        if (shmFeedClockNs() > deadline)
+            return false;
+        std::this_thread::yield();
+    }
+}
+
+ShmFeedReader::Status ShmFeedReader::read(std::uint64_t frame, ShmFrame &out) const
+{
+    if (!base)
+        return Status::NotYet;
+    const Slot *s = reinterpret_cast<const Slot *>(base + kHeaderBytes + (frame & slotMask) * slotBytes);
+    const std::uint64_t want = 2 * frame + 2;
+    const std::uint64_t s1 = s->sequence.load(std::memory_order_acquire);
+    if (s1 != want)
+        return s1 < want ? Status::NotYet : Status::Overwritten;
+
+    const std::uint32_t count = s->count;
+    out.frame = s->frame;
+    out.stampNs = s->stampNs;
+    out.t = s->t;
+    out.positions.resize(count <= motors ? count : motors);
+    std::memcpy(out.positions.data(), slotPositions(s), sizeof(double) * out.positions.size());
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->sequence.load(std::memory_order_relaxed) != want)
+        return Status::Overwritten;
+    return Status::Ok;
+}
+
+bool ShmFeedReader::next(ShmFrame &out)
+{
+    for (;;) {
+        switch (read(cursor, out)) {
+        case Status::Ok:
+            ++cursor;
+            return true;
+        case Status::NotYet:
+            return false;
+        case Status::Overwritten: {
+            // Jump to the oldest frame that is safe from the writer for a
+            // while: half a ring behind the newest.
+            const std::uint64_t pub = published();
+            const std::uint64_t half = (slotMask + 1) / 2;
+            const std::uint64_t target = pub > half ? pub - half : 0;
+            const std::uint64_t skipTo = target > cursor ? target : cursor + 1;
+            lost += skipTo - cursor;
+            cursor = skipTo;
+            break;
+        }
+        }
+    }
+}
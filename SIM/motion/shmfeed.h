@@ -0,0 +1,136 @@
+#ifndef SHMFEED_H
+#define SHMFEED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wavekernel.h"
+
+// Position feed in POSIX shared memory, for viewers, loggers and hardware
+// bridges running as separate processes.
+//
+// One writer publishes frames into a ring of slots; any number of readers
+// map the same object read-only and copy each frame out of it. After open()
+// neither side makes a system call per frame: each slot carries a seqlock
+// sequence number (odd while the writer fills it, 2 * frame + 2 once frame
+// is complete) and a reader accepts its copy only if the number was the
+// expected even value before and after copying. The wave parameters sit in
+// the header under a second seqlock. The writer never waits for readers; a
+// reader that falls more than a ring behind skips ahead and counts the
+// frames it lost.
+//
+// Layout (all in native byte order, the feed never leaves the machine):
+//   header  "CNCSHM1", u32 version, u32 maxMotors, u32 slotCount,
+//           u32 slotBytes, params seqlock + WaveParams, u64 head
+//   slot    u64 sequence, u64 frame, i64 stampNs, f64 t, u32 count,
+//           f64 positions[maxMotors], padded to a cache line
+//
+// Only available on POSIX systems; elsewhere open() fails with an error.
+
+struct ShmFrame
+{
+    std::uint64_t frame = 0;
+    std::int64_t stampNs = 0; // steady clock at publish, comparable across processes
+    double t = 0.0;           // wave time
+    std::vector<double> positions;
+};
+
+// Steady-clock nanoseconds, the clock of ShmFrame::stampNs.
+std::int64_t shmFeedClockNs();
+
+class ShmFeedWriter
+{
+public:
+    ShmFeedWriter() = default;
+    ~ShmFeedWriter();
+
+    ShmFeedWriter(const ShmFeedWriter &) = delete;
+    ShmFeedWriter &operator=(const ShmFeedWriter &) = delete;
+
+    // Creates (or replaces) the shared-memory object name, e.g. "/cncwave".
+    // slotCount is rounded up to a power of two.
+    bool open(const std::string &name, int maxMotors, int slotCount = 1024);
+
+    // Unmaps and removes the name; readers that have it mapped keep
+    // working until they close.
+    void close();
+
+    bool isOpen() const { return base != nullptr; }
+
+    void setParams(const WaveParams &params);
+
+    // Publishes one frame of count <= maxMotors positions.
+    void publish(const double *positions, int count, double t);
+
+    std::uint64_t framesPublished() const { return head; }
+    const std::string &error() const { return err; }
+
+private:
+    unsigned char *base = nullptr;
+    std::size_t bytes = 0;
+    std::string shmName;
+    std::uint32_t maxMotors = 0;
+    std::uint64_t slotMask = 0;
+    std::size_t slotBytes = 0;
+    std::uint64_t head = 0;
+    std::uint64_t paramsVersion = 0;
+    std::string err;
+};
+
+class ShmFeedReader
+{
+public:
+    enum class Status
+    {
+        Ok,
+        NotYet,     // frame not published yet
+        Overwritten // the writer has lapped the frame
+    };
+
+    ShmFeedReader() = default;
+    ~ShmFeedReader();
+
+    ShmFeedReader(const ShmFeedReader &) = delete;
+    ShmFeedReader &operator=(const ShmFeedReader &) = delete;
+
+    // Maps an existing feed; the cursor starts at the newest frame.
+    bool open(const std::string &name);
+    void close();
+
+    int maxMotors() const { return static_cast<int>(motors); }
+    int slotCount() const { return static_cast<int>(slotMask + 1); }
+
+    // Frames the writer has published so far.
+    std::uint64_t published() const;
+
+    static constexpr std::int64_t kParamsTimeoutNs = 100000000; // 100 ms
+
+    // Consistent copy of the writer's current wave parameters. False if no
+    // consistent copy could be taken within kParamsTimeoutNs, e.g. because
+    // the writer died in the middle of setParams().
+    bool params(WaveParams &out) const;
+
+    // Copies frame number `frame` into out.
+    Status read(std::uint64_t frame, ShmFrame &out) const;
+
+    // Next frame after the last one returned; false if none is ready. Lost
+    // frames (lapped by the writer) are skipped and counted.
+    bool next(ShmFrame &out);
+
+    std::uint64_t framesLost() const { return lost; }
+    const std::string &error() const { return err; }
+
+private:
+    const unsigned char *base = nullptr;
+    std::size_t bytes = 0;
+    std::uint32_t motors = 0;
+    std::uint64_t slotMask = 0;
+    std::size_t slotBytes = 0;
+    std::uint64_t cursor = 0;
+    std::uint64_t lost = 0;
+    std::string err;
+};
+
+#endif // SHMFEED_H
@@ -0,0 +1,75 @@
+// Minimal consumer of the shared-memory position feed (see shmfeed.h).
+//
+//   shmfeed_reader [NAME] [--frames N] [--every K]
+//
+// Attaches to NAME (default /cncwave, as in WaveControlApp_1 --publish
+// /cncwave), follows the stream from the newest frame and prints every K-th
+// frame: frame number, wave time, publish-to-read latency and the first few
+// motor positions. Stops after N frames, or when no frame arrives for 5 s.
+// Polling costs no system calls while frames keep coming; when idle it
+// sleeps for a millisecond between polls.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "shmfeed.h"
+
+int main(int argc, char *argv[])
+{
+    const char *name = "/cncwave";
+    long frames = 100;
+    long every = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--every") && i + 1 < argc)
+            every = std::max(1L, std::atol(argv[++i]));
+        else if (argv[i][0] == '/')
+            name = argv[i];
+        else {
+            std::fprintf(stderr, "usage: %s [NAME] [--frames N] [--every K]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ShmFeedReader feed;
+    if (!feed.open(name)) {
+        std::fprintf(stderr, "%s\n", feed.error().c_str());
+        return 1;
+    }
+    WaveParams p;
+    if (!feed.params(p)) {
+        std::fprintf(stderr, "%s: wave parameters stuck mid-update, writer gone?\n", name);
+        return 1;
+    }
+    std::printf("%s: %d motors max, %d slots; wave factor %.2f, stroke %.0f\n", name, feed.maxMotors(),
+                feed.slotCount(), p.waveFactorValue, p.strokeLengthValue);
+
+    ShmFrame frame;
+    long got = 0;
+    auto lastFrame = std::chrono::steady_clock::now();
+    while (got < frames) {
+        if (!feed.next(frame)) {
+            if (std::chrono::steady_clock::now() - lastFrame > std::chrono::seconds(5)) {
+                std::printf("no frames for 5 s, stopping\n");
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        lastFrame = std::chrono::steady_clock::now();
+        if (got++ % every == 0) {
+            const double latencyUs = (shmFeedClockNs() - frame.stampNs) / 1e3;
+            std::printf("frame %8llu  t %9.3f  latency %8.1f us ", static_cast<unsigned long long>(frame.frame),
+                        frame.t, latencyUs);
+            for (std::size_t i = 0; i < frame.positions.size() && i < 5; ++i)
+                std::printf(" %7.3f", frame.positions[i]);
+            std::printf("\n");
+        }
+    }
+    std::printf("%ld frames read, %llu lost\n", got, static_cast<unsigned long long>(feed.framesLost()));
+    return 0;
+}
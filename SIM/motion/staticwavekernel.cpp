@@ -0,0 +1,58 @@
+#include "staticwavekernel.h"
+
+#include <utility>
+
+namespace {
+
+// Motor counts compiled in: the SIM/CPP (12) and SIM/CPP_1 (50) machines
+// plus common bank sizes. Add a machine's count here to specialize it.
+using StaticMotorCounts = std::integer_sequence<int, 8, 12, 16, 24, 32, 50, 64>;
+
+using KernelFactory = std::unique_ptr<WaveKernelBase> (*)(const WaveParams &);
+
+struct DispatchEntry
+{
+    int numMotors;
+    WaveShape shape;
+    KernelFactory create;
+};
+
+template <int N, WaveShape S>
+std::unique_ptr<WaveKernelBase> createKernel(const WaveParams &p)
+{
+    return std::make_unique<StaticWaveKernel<N, S>>(p);
+}
+
+template <int... Counts>
+constexpr auto makeDispatchTable(std::integer_sequence<int, Counts...>)
+{
+    return std::array<DispatchEntry, 2 * sizeof...(Counts)>{{
+        {Counts, WaveShape::Sine, &createKernel<Counts, WaveShape::Sine>}...,
+        {Counts, WaveShape::Triangle, &createKernel<Counts, WaveShape::Triangle>}...,
+    }};
+}
+
+constexpr auto kDispatchTable = makeDispatchTable(StaticMotorCounts{});
+
+const DispatchEntry *findEntry(int numMotors, WaveShape shape)
+{
+    for (const DispatchEntry &e : kDispatchTable) {
+        if (e.numMotors == numMotors && e.shape == shape)
+            return &e;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+std::unique_ptr<WaveKernelBase> makeWaveKernel(const WaveParams &p)
+{
+    if (const DispatchEntry *e = findEntry(p.numMotors, p.shape))
+        return e->create(p);
+    return std::make_unique<DynamicWaveKernel>(p);
+}
+
+bool hasStaticWaveKernel(int numMotors, WaveShape shape)
+{
+    return findEntry(numMotors, shape) != nullptr;
+}
@@ -0,0 +1,127 @@
+#ifndef STATICWAVEKERNEL_H
+#define STATICWAVEKERNEL_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
+#include "wavekernel.h"
+
+// Wave kernels specialized at compile time for a fixed motor count and wave
+// shape. With the count known the per-tick loop is fully unrolled and
+// vectorized over stack-resident std::array buffers:
+//
+//   Sine:     sin(wt + i*phi) = sin(wt)*cos(i*phi) + cos(wt)*sin(i*phi), so a
+//             tick costs one sin/cos pair plus NumMotors multiply-adds; the
+//             per-motor cos/sin terms only change when a slider moves.
+//   Triangle: per-motor phase offsets in turns, wrapped with a branch-free
+//             select instead of floor().
+//
+// Results match generateWavePositions() to ~1e-13 relative (not bit-exact).
+
+// Type-erased interface so callers can pick a specialization at run time.
+class WaveKernelBase
+{
+public:
+    virtual ~WaveKernelBase() = default;
+
+    // Re-derives per-motor tables; call when the wave parameters change.
+    // numMotors and shape must match the specialization.
+    virtual void configure(const WaveParams &p) = 0;
+
+    // All motor positions at time t; out holds numMotors() values.
+    virtual void positions(double t, double *out) const = 0;
+
+    virtual int numMotors() const = 0;
+    virtual bool isSpecialized() const = 0;
+};
+
+template <int NumMotors, WaveShape Shape>
+class StaticWaveKernel final : public WaveKernelBase
+{
+    static_assert(NumMotors > 0, "motor count must be positive");
+
+public:
+    using Frame = std::array<double, NumMotors>;
+
+    StaticWaveKernel() = default;
+    explicit StaticWaveKernel(const WaveParams &p) { configure(p); }
+
+    void configure(const WaveParams &p) override
+    {
+        omega = 2 * M_PI * p.frequency;
+        const double scale = p.strokeLengthValue * p.amp;
+        const double phaseShift = p.basePhaseShift * p.waveFactorValue;
+        for (int i = 0; i < NumMotors; ++i) {
+            if (Shape == WaveShape::Sine) {
+                cosTerm[i] = scale * std::cos(i * phaseShift);
+                sinTerm[i] = scale * std::sin(i * phaseShift);
+            } else {
+                const double turns = i * phaseShift / (2 * M_PI);
+                cosTerm[i] = turns - std::floor(turns);
+                sinTerm[i] = scale;
+            }
+        }
+    }
+
+    // Fixed-size entry point; the compiler sees the trip count.
+    void positions(double t, Frame &out) const
+    {
+        if (Shape == WaveShape::Sine) {
+            const double s = std::sin(omega * t);
+            const double c = std::cos(omega * t);
+            for (int i = 0; i < NumMotors; ++i)
+                out[i] = s * cosTerm[i] + c * sinTerm[i];
+        } else {
+            double base = omega * t / (2 * M_PI) + 0.25;
+            base -= std::floor(base);
+            for (int i = 0; i < NumMotors; ++i) {
+                double u = base + cosTerm[i];
+                u -= u >= 1.0 ? 1.0 : 0.0;
+                out[i] = sinTerm[i] * (1.0 - 4.0 * std::fabs(u - 0.5));
+            }
+        }
+    }
+
+    void positions(double t, double *out) const override
+    {
+        Frame frame;
+        positions(t, frame);
+        std::copy(frame.begin(), frame.end(), out);
+    }
+
+    int numMotors() const override { return NumMotors; }
+    bool isSpecialized() const override { return true; }
+
+private:
+    double omega = 0.0;
+    // Sine: scaled cos/sin of each motor's phase offset.
+    // Triangle: phase offset in turns (cosTerm) and amplitude (sinTerm).
+    alignas(64) Frame cosTerm{};
+    alignas(64) Frame sinTerm{};
+};
+
+// Fallback for motor counts without a specialization.
+class DynamicWaveKernel final : public WaveKernelBase
+{
+public:
+    explicit DynamicWaveKernel(const WaveParams &p) : params(p) {}
+
+    void configure(const WaveParams &p) override { params = p; }
+    void positions(double t, double *out) const override { generateWavePositions(params, t, out); }
+    int numMotors() const override { return params.numMotors; }
+    bool isSpecialized() const override { return false; }
+
+private:
+    WaveParams params;
+};
+
+// Picks the StaticWaveKernel for p.numMotors / p.shape from the dispatch
+// table, or a DynamicWaveKernel when the combination is not compiled in.
+std::unique_ptr<WaveKernelBase> makeWaveKernel(const WaveParams &p);
+
+// True if makeWaveKernel() would return a specialized kernel.
+bool hasStaticWaveKernel(int numMotors, WaveShape shape);
+
+#endif // STATICWAVEKERNEL_H
@@ -0,0 +1,127 @@
+#include "stepcompensation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+bool loadCompensation(const std::string &path, std::vector<AxisCompensation> &axes, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    axes.clear();
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        AxisCompensation axis;
+        if (!(words >> axis.backlash)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue; // blank or comment-only line
+            error = path + ":" + std::to_string(lineNo) + ": expected backlash";
+            return false;
+        }
+        if (!(words >> axis.tableStart >> axis.tableSpacing)) {
+            axis.tableStart = axis.tableSpacing = 0.0;
+        } else {
+            double e;
+            while (words >> e)
+                axis.pitchError.push_back(e);
+            if (!words.eof() || axis.tableSpacing < 0 || (axis.tableSpacing > 0 && axis.pitchError.empty())) {
+                error = path + ":" + std::to_string(lineNo) + ": bad pitch table";
+                return false;
+            }
+        }
+        if (axis.backlash < 0) {
+            error = path + ":" + std::to_string(lineNo) + ": negative backlash";
+            return false;
+        }
+        axes.push_back(std::move(axis));
+    }
+    return true;
+}
+
+StepCompensator::StepCompensator(const std::vector<AxisCompensation> &axes, double stepsPerMm)
+    : stepsPerMm(stepsPerMm)
+{
+    for (const AxisCompensation &a : axes) {
+        // An axis without a table gets a single zero entry, so the frame
+        // loop needs no special case.
+        const bool hasTable = a.tableSpacing > 0 && !a.pitchError.empty();
+        const std::vector<double> errors = hasTable ? a.pitchError : std::vector<double>{0.0};
+        halfBacklash.push_back(a.backlash / 2);
+        start.push_back(hasTable ? a.tableStart : 0.0);
+        invSpacing.push_back(hasTable ? 1.0 / a.tableSpacing : 0.0);
+        lastIndex.push_back(static_cast<double>(errors.size() - 1));
+        offset.push_back(static_cast<int>(table.size()));
+        for (std::size_t k = 0; k < errors.size(); ++k) {
+            table.push_back(errors[k]);
+            slope.push_back(k + 1 < errors.size() ? errors[k + 1] - errors[k] : 0.0);
+        }
+    }
+    reset();
+}
+
+void StepCompensator::reset(double position)
+{
+    previous.assign(halfBacklash.size(), position);
+    entry.assign(halfBacklash.size(), 0);
+    fraction.assign(halfBacklash.size(), 0.0);
+    direction.assign(halfBacklash.size(), 1.0);
+}
+
+double StepCompensator::pitchError(int axis, double pos) const
+{
+    const double u = std::min(std::max((pos - start[axis]) * invSpacing[axis], 0.0), lastIndex[axis]);
+    const int k = static_cast<int>(u);
+    const int e = offset[axis] + k;
+    return table[e] + (u - k) * slope[e];
+}
+
+void StepCompensator::steps(const double *pos, std::int32_t *out)
+{
+    // Two passes so the first one vectorizes (the selects become blends)
+    // and the second one is only the table gather and rounding. Locals keep
+    // the loops free of member reloads.
+    const int n = axisCount();
+    double *prev = previous.data();
+    double *dir = direction.data();
+    int *ent = entry.data();
+    double *frac = fraction.data();
+    const double *origin = start.data();
+    const double *inv = invSpacing.data();
+    const double *last = lastIndex.data();
+    const int *first = offset.data();
+    for (int i = 0; i < n; ++i) {
+        // Direction memory: sign of the move, or the last direction while
+        // the axis stands still (sign^2 is 1 when moving, 0 when not).
+        const double d = pos[i] - prev[i];
+        const double sign = double(d > 0) - double(d < 0);
+        dir[i] = sign + (1.0 - sign * sign) * dir[i];
+        prev[i] = pos[i];
+
+        // Clamped index into the uniform table; the last entry has slope 0,
+        // so positions past the end hold the last error.
+        double u = (pos[i] - origin[i]) * inv[i];
+        u = u > 0.0 ? u : 0.0;
+        u = u < last[i] ? u : last[i];
+        const int k = static_cast<int>(u);
+        ent[i] = first[i] + k;
+        frac[i] = u - k;
+    }
+
+    const double *errors = table.data();
+    const double *slopes = slope.data();
+    const double *half = halfBacklash.data();
+    const double scale = stepsPerMm;
+    for (int i = 0; i < n; ++i) {
+        const int e = ent[i];
+        const double error = errors[e] + frac[i] * slopes[e];
+        const double motor = (pos[i] - error + dir[i] * half[i]) * scale;
+        // Round half away from zero, like lround, without a libm call.
+        out[i] = static_cast<std::int32_t>(motor + std::copysign(0.5, motor));
+    }
+}
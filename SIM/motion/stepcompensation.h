@@ -0,0 +1,89 @@
+#ifndef STEPCOMPENSATION_H
+#define STEPCOMPENSATION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "typedwavekernel.h"
+
+// Calibration of one lead-screw axis (or wave motor).
+//
+// The parts-list screws are 8 mm trapezoidal with copper nuts: the nut has
+// lost motion on reversal (backlash) and the lead is not exact along the
+// screw (pitch error). pitchError holds actual - commanded position in mm,
+// measured at tableStart + k * tableSpacing; between entries it is
+// interpolated linearly and beyond the ends it is held.
+struct AxisCompensation
+{
+    double backlash = 0.0;     // mm of lost motion on reversal
+    double tableStart = 0.0;   // mm
+    double tableSpacing = 0.0; // mm; 0 disables the pitch table
+    std::vector<double> pitchError;
+};
+
+// Reads one axis per line: "backlash start spacing error0 error1 ...", all
+// in mm; '#' starts a comment. Returns false and sets error on bad input.
+bool loadCompensation(const std::string &path, std::vector<AxisCompensation> &axes, std::string &error);
+
+// Commanded position -> absolute step target with backlash and pitch-error
+// compensation, one frame (one position per axis) at a time.
+//
+// Motor position = pos - pitchError(pos) + dir * backlash / 2, where dir is
+// the last direction of motion, so the nut sits on the same flank whichever
+// way the axis last moved. Per-axis data is stored as flat arrays; a frame
+// is one loop over axes with an O(1) uniform-table lookup each and no
+// branches (direction, clamping and rounding are all selects).
+class StepCompensator
+{
+public:
+    explicit StepCompensator(const std::vector<AxisCompensation> &axes, double stepsPerMm = kDefaultStepsPerMm);
+
+    int axisCount() const { return static_cast<int>(halfBacklash.size()); }
+
+    // Forgets the motion history: every axis is taken to have last moved
+    // in the positive direction (as after homing towards +), at position.
+    void reset(double position = 0.0);
+
+    // pos and out hold axisCount() values.
+    void steps(const double *pos, std::int32_t *out);
+
+    // Positions of a TypedWaveKernel<T>, converted to mm first.
+    template <typename T>
+    void steps(const T *pos, std::int32_t *out);
+
+    // Pitch error interpolated for one axis, in mm.
+    double pitchError(int axis, double pos) const;
+
+private:
+    double stepsPerMm;
+    std::vector<double> halfBacklash;
+    std::vector<double> start;
+    std::vector<double> invSpacing;
+    std::vector<double> lastIndex;  // highest table index, as double
+    std::vector<int> offset;        // first entry of each axis in table
+    std::vector<double> table;      // errors of all axes, back to back
+    std::vector<double> slope;      // table[k + 1] - table[k], 0 at each end
+    std::vector<double> previous;   // last commanded position
+    std::vector<double> direction;  // +1 or -1
+    std::vector<int> entry;         // per-frame scratch: table entry
+    std::vector<double> fraction;   // and position between entries
+    std::vector<double> converted;  // per-frame scratch: T positions in mm
+};
+
+template <typename T>
+void StepCompensator::steps(const T *pos, std::int32_t *out)
+{
+    converted.resize(halfBacklash.size());
+    for (std::size_t i = 0; i < converted.size(); ++i)
+        converted[i] = WaveNumeric<T>::toDouble(pos[i]);
+    steps(converted.data(), out);
+}
+
+template <typename T>
+void TypedWaveKernel<T>::steps(const T *pos, StepCompensator &compensator, std::int32_t *out) const
+{
+    compensator.steps(pos, out);
+}
+
+#endif // STEPCOMPENSATION_H
@@ -0,0 +1,689 @@
+#include "telemetry.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'N', 'C', 'T', 'L', 'M', '1', '\0'};
+constexpr std::uint32_t kVersion = 1;
+
+enum Codec : unsigned char
+{
+    kCodecDod = 0,      // int64 delta-of-delta (stamps)
+    kCodecXor = 1,      // double XOR with the previous value
+    kCodecQuantized = 2 // round(x / quantum), delta-of-delta
+};
+
+constexpr std::size_t kColumnEntryBytes = 5; // u8 codec, u32 bytes
+constexpr double kMaxQuantized = 4503599627370496.0; // 2^52: still exact as a double
+
+// A column may overrun its bit length by one value (at most 77 bits)
+// before the reader notices; the padding keeps those loads in the buffer.
+constexpr std::size_t kReadPadding = 24;
+
+void putU16(std::vector<unsigned char> &out, std::uint16_t v)
+{
+    out.push_back(static_cast<unsigned char>(v));
+    out.push_back(static_cast<unsigned char>(v >> 8));
+}
+
+void putU32(std::vector<unsigned char> &out, std::uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+}
+
+void setU32(unsigned char *p, std::uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+void putF64(std::vector<unsigned char> &out, double v)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<unsigned char>(bits >> (8 * i)));
+}
+
+std::uint32_t getU32(const unsigned char *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+double getF64(const unsigned char *p)
+{
+    std::uint64_t bits = 0;
+    for (int i = 7; i >= 0; --i)
+        bits = bits << 8 | p[i];
+    double v;
+    std::memcpy(&v, &bits, sizeof v);
+    return v;
+}
+
+inline std::uint64_t toBits(double v)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+inline double fromBits(std::uint64_t bits)
+{
+    double v;
+    std::memcpy(&v, &bits, sizeof v);
+    return v;
+}
+
+inline int leadingZeros(std::uint64_t x) // x != 0
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    for (; !(x >> 63); x <<= 1)
+        ++n;
+    return n;
+#endif
+}
+
+inline int trailingZeros(std::uint64_t x) // x != 0
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    for (; !(x & 1); x >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+// MSB-first bit stream appended to a byte vector.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<unsigned char> &out) : out(out) {}
+
+    void put(std::uint64_t bits, int count) // count 1..64, bits < 2^count
+    {
+        if (count > 32) {
+            put(bits >> 32, count - 32);
+            count = 32;
+            bits &= 0xffffffffu;
+        }
+        acc = acc << count | bits;
+        n += count;
+        if (n >= 32) {
+            n -= 32;
+            const std::uint32_t word = static_cast<std::uint32_t>(acc >> n);
+            const unsigned char bytes[4] = {static_cast<unsigned char>(word >> 24),
+                                            static_cast<unsigned char>(word >> 16),
+                                            static_cast<unsigned char>(word >> 8), static_cast<unsigned char>(word)};
+            out.insert(out.end(), bytes, bytes + 4);
+        }
+    }
+
+    void finish()
+    {
+        for (; n >= 8; n -= 8)
+            out.push_back(static_cast<unsigned char>(acc >> (n - 8)));
+        if (n > 0)
+            out.push_back(static_cast<unsigned char>(acc << (8 - n)));
+        n = 0;
+    }
+
+private:
+    std::vector<unsigned char> &out;
+    std::uint64_t acc = 0;
+    int n = 0; // pending bits in the low end of acc, < 32 between calls
+};
+
+// Reads the bit stream through a 64-bit window loaded at any bit position
+// (57 bits valid); the buffer must be padded by kReadPadding bytes.
+class BitReader
+{
+public:
+    explicit BitReader(const unsigned char *data) : data(data) {}
+
+    std::uint64_t window() const
+    {
+        const unsigned char *p = data + (pos >> 3);
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v = v << 8 | p[i];
+        return v << (pos & 7);
+    }
+
+    std::uint64_t take(int count) // 1..64
+    {
+        if (count > 57) {
+            const std::uint64_t high = take(count - 32);
+            return high << 32 | take(32);
+        }
+        const std::uint64_t v = window() >> (64 - count);
+        pos += count;
+        return v;
+    }
+
+    std::size_t pos = 0;
+
+private:
+    const unsigned char *data;
+};
+
+void putDod(BitWriter &w, std::int64_t dod)
+{
+    if (dod == 0) {
+        w.put(0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        w.put(0x2, 2);
+        w.put(static_cast<std::uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        w.put(0x6, 3);
+        w.put(static_cast<std::uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        w.put(0xe, 4);
+        w.put(static_cast<std::uint64_t>(dod + 2047), 12);
+    } else if (dod >= -2147483647LL && dod <= 2147483648LL) {
+        w.put(0x1e, 5);
+        w.put(static_cast<std::uint64_t>(dod + 2147483647LL), 32);
+    } else {
+        w.put(0x1f, 5);
+        w.put(static_cast<std::uint64_t>(dod), 64);
+    }
+}
+
+// Differences are taken modulo 2^64, so any sequence round-trips.
+void encodeDod(BitWriter &w, const std::int64_t *v, int n)
+{
+    std::uint64_t prev = static_cast<std::uint64_t>(v[0]);
+    std::uint64_t delta = 0;
+    w.put(prev, 64);
+    for (int i = 1; i < n; ++i) {
+        const std::uint64_t x = static_cast<std::uint64_t>(v[i]);
+        const std::uint64_t d = x - prev;
+        putDod(w, static_cast<std::int64_t>(d - delta));
+        delta = d;
+        prev = x;
+    }
+}
+
+template <typename Emit>
+bool decodeDod(BitReader &r, std::size_t limit, int n, Emit emit)
+{
+    std::uint64_t prev = r.take(64);
+    std::uint64_t delta = 0;
+    emit(0, prev);
+    for (int i = 1; i < n; ++i) {
+        if (r.pos > limit)
+            return false;
+        const std::uint64_t w = r.window();
+        std::uint64_t dod;
+        if (!(w >> 63)) {
+            r.pos += 1;
+            dod = 0;
+        } else if (!(w >> 62 & 1)) {
+            dod = (w << 2 >> 57) - 63;
+            r.pos += 9;
+        } else if (!(w >> 61 & 1)) {
+            dod = (w << 3 >> 55) - 255;
+            r.pos += 12;
+        } else if (!(w >> 60 & 1)) {
+            dod = (w << 4 >> 52) - 2047;
+            r.pos += 16;
+        } else if (!(w >> 59 & 1)) {
+            dod = (w << 5 >> 32) - 2147483647ULL;
+            r.pos += 37;
+        } else {
+            r.pos += 5;
+            dod = r.take(64);
+        }
+        delta += dod;
+        prev += delta;
+        emit(i, prev);
+    }
+    return r.pos <= limit;
+}
+
+void encodeXor(BitWriter &w, const double *v, std::size_t stride, int n)
+{
+    std::uint64_t prev = toBits(v[0]);
+    w.put(prev, 64);
+    int lead = -1, trail = 0; // current window; none yet
+    for (int i = 1; i < n; ++i) {
+        const std::uint64_t bits = toBits(v[i * stride]);
+        const std::uint64_t x = bits ^ prev;
+        prev = bits;
+        if (x == 0) {
+            w.put(0, 1);
+            continue;
+        }
+        int l = leadingZeros(x);
+        const int t = trailingZeros(x);
+        if (l > 31)
+            l = 31; // 5-bit field
+        if (lead >= 0 && l >= lead && t >= trail) {
+            w.put(0x2, 2);
+            w.put(x >> trail, 64 - lead - trail);
+        } else {
+            lead = l;
+            trail = t;
+            const int sig = 64 - l - t;
+            w.put(0x3, 2);
+            w.put(static_cast<std::uint64_t>(l), 5);
+            w.put(static_cast<std::uint64_t>(sig - 1), 6);
+            w.put(x >> t, sig);
+        }
+    }
+}
+
+bool decodeXor(BitReader &r, std::size_t limit, double *out, int n)
+{
+    std::uint64_t prev = r.take(64);
+    out[0] = fromBits(prev);
+    int sig = 0, trail = 0;
+    for (int i = 1; i < n; ++i) {
+        if (r.pos > limit)
+            return false;
+        const std::uint64_t w = r.window();
+        if (!(w >> 63)) {
+            r.pos += 1;
+        } else if (!(w >> 62 & 1)) {
+            if (sig == 0)
+                return false;
+            r.pos += 2;
+            prev ^= r.take(sig) << trail;
+        } else {
+            const int lead = static_cast<int>(w >> 57 & 31);
+            sig = static_cast<int>(w >> 51 & 63) + 1;
+            trail = 64 - lead - sig;
+            if (trail < 0)
+                return false;
+            r.pos += 13;
+            prev ^= r.take(sig) << trail;
+        }
+        out[i] = fromBits(prev);
+    }
+    return r.pos <= limit;
+}
+
+// round(x / quantum) for every value, or false if one is not finite or
+// too large to come back exactly.
+bool quantize(const double *v, std::size_t stride, int n, double quantum, std::vector<std::int64_t> &q)
+{
+    q.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const double s = v[i * stride] / quantum;
+        if (!(std::fabs(s) <= kMaxQuantized))
+            return false;
+        q[i] = std::llround(s);
+    }
+    return true;
+}
+
+} // namespace
+
+std::int64_t telemetryClockUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::vector<TelemetryChannel> waveTelemetryChannels(int motors, double positionQuantum, double tickSeconds)
+{
+    std::vector<TelemetryChannel> channels(2 * static_cast<std::size_t>(motors));
+    for (int i = 0; i < motors; ++i) {
+        channels[i].name = "pos" + std::to_string(i);
+        channels[i].quantum = positionQuantum;
+        channels[motors + i].name = "vel" + std::to_string(i);
+        channels[motors + i].quantum = positionQuantum / tickSeconds;
+    }
+    return channels;
+}
+
+// --- TelemetryRecorder ---
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    close();
+}
+
+bool TelemetryRecorder::open(const std::string &path, const std::vector<TelemetryChannel> &channels, int frames,
+                             int pendingBlocks, Overflow mode)
+{
+    close();
+    err.clear();
+    if (channels.empty() || frames < 1 || pendingBlocks < 1) {
+        err = "telemetry needs at least one channel, one frame per block and one pending block";
+        return false;
+    }
+    for (const TelemetryChannel &c : channels) {
+        if (c.name.size() > 0xffff || !(c.quantum >= 0.0)) {
+            err = "bad telemetry channel " + c.name;
+            return false;
+        }
+    }
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        err = "cannot create " + path;
+        return false;
+    }
+    channelList = channels;
+    blockFrames = frames;
+
+    std::vector<unsigned char> header(kMagic, kMagic + sizeof kMagic);
+    putU32(header, kVersion);
+    putU32(header, static_cast<std::uint32_t>(channels.size()));
+    putU32(header, static_cast<std::uint32_t>(frames));
+    for (const TelemetryChannel &c : channels) {
+        putF64(header, c.quantum);
+        putU16(header, static_cast<std::uint16_t>(c.name.size()));
+        header.insert(header.end(), c.name.begin(), c.name.end());
+    }
+    if (std::fwrite(header.data(), 1, header.size(), file) != header.size() || std::fflush(file) != 0) {
+        err = "cannot write " + path;
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    written = header.size();
+    recorded = 0;
+    dropped = 0;
+
+    // All buffers up front: the tick path never allocates. One more than
+    // pendingBlocks, for the block being compressed.
+    auto makeBlock = [this] {
+        std::unique_ptr<Block> b(new Block);
+        b->values.resize(static_cast<std::size_t>(blockFrames) * channelList.size());
+        b->stamps.resize(blockFrames);
+        return b;
+    };
+    current = makeBlock();
+    for (int i = 0; i <= pendingBlocks; ++i)
+        spare.push_back(makeBlock());
+    overflow = mode;
+    stopping = false;
+    failed = false;
+    worker = std::thread(&TelemetryRecorder::compressLoop, this);
+    return true;
+}
+
+void TelemetryRecorder::commit(std::int64_t stampUs)
+{
+    current->stamps[current->frames] = stampUs;
+    ++recorded;
+    if (++current->frames == blockFrames)
+        handOff();
+}
+
+void TelemetryRecorder::record(const double *values, std::int64_t stampUs)
+{
+    std::memcpy(frame(), values, channelList.size() * sizeof(double));
+    commit(stampUs);
+}
+
+void TelemetryRecorder::handOff()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (overflow == Overflow::Wait)
+            returned.wait(lock, [this] { return !spare.empty(); });
+        if (spare.empty()) {
+            // The thread (or the disk) is behind: lose this block, not the tick.
+            dropped.fetch_add(current->frames, std::memory_order_relaxed);
+            current->frames = 0;
+            return;
+        }
+        queue.push_back(std::move(current));
+        current = std::move(spare.back());
+        spare.pop_back();
+    }
+    wake.notify_one();
+    current->frames = 0;
+}
+
+void TelemetryRecorder::compressLoop()
+{
+    std::vector<unsigned char> out;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return; // stopping, and everything is written
+        std::unique_ptr<Block> block = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        // failed and err belong to this thread until close() joins it.
+        if (failed || !writeBlock(*block, out)) {
+            failed = true;
+            dropped.fetch_add(block->frames, std::memory_order_relaxed);
+        }
+        block->frames = 0;
+        lock.lock();
+        spare.push_back(std::move(block));
+        returned.notify_one();
+    }
+}
+
+bool TelemetryRecorder::writeBlock(const Block &block, std::vector<unsigned char> &out)
+{
+    const int n = block.frames;
+    const std::size_t channels = channelList.size();
+    out.clear();
+    putU32(out, static_cast<std::uint32_t>(n));
+    putU32(out, 0); // payload bytes, patched below
+    const std::size_t table = out.size();
+    out.resize(table + (channels + 1) * kColumnEntryBytes);
+
+    std::vector<std::int64_t> quantized;
+    for (std::size_t c = 0; c <= channels; ++c) {
+        const std::size_t start = out.size();
+        unsigned char codec;
+        BitWriter w(out);
+        if (c == 0) {
+            codec = kCodecDod;
+            encodeDod(w, block.stamps.data(), n);
+        } else {
+            const double *column = block.values.data() + (c - 1);
+            const double quantum = channelList[c - 1].quantum;
+            if (quantum > 0 && quantize(column, channels, n, quantum, quantized)) {
+                codec = kCodecQuantized;
+                encodeDod(w, quantized.data(), n);
+            } else {
+                codec = kCodecXor;
+                encodeXor(w, column, channels, n);
+            }
+        }
+        w.finish();
+        unsigned char *entry = out.data() + table + c * kColumnEntryBytes;
+        entry[0] = codec;
+        setU32(entry + 1, static_cast<std::uint32_t>(out.size() - start));
+    }
+    setU32(out.data() + 4, static_cast<std::uint32_t>(out.size() - 8));
+
+    if (std::fwrite(out.data(), 1, out.size(), file) != out.size() || std::fflush(file) != 0) {
+        err = "telemetry write failed";
+        return false;
+    }
+    written.fetch_add(out.size(), std::memory_order_relaxed);
+    return true;
+}
+
+bool TelemetryRecorder::close()
+{
+    if (!file)
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current->frames > 0)
+            queue.push_back(std::move(current));
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+
+    bool ok = !failed;
+    if (std::fclose(file) != 0 && ok) {
+        err = "telemetry close failed";
+        ok = false;
+    }
+    file = nullptr;
+    current.reset();
+    spare.clear();
+    queue.clear();
+    return ok;
+}
+
+// --- TelemetryReader ---
+
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+bool TelemetryReader::open(const std::string &path)
+{
+    close();
+    err.clear();
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        err = "cannot open " + path;
+        return false;
+    }
+    unsigned char head[20];
+    if (std::fread(head, 1, sizeof head, file) != sizeof head || std::memcmp(head, kMagic, sizeof kMagic) != 0
+        || getU32(head + 8) != kVersion) {
+        err = path + ": not a telemetry file";
+        close();
+        return false;
+    }
+    const std::uint32_t count = getU32(head + 12);
+    frameLimit = static_cast<int>(getU32(head + 16));
+    consumed = sizeof head;
+    channelList.clear();
+    for (std::uint32_t c = 0; c < count; ++c) {
+        unsigned char entry[10];
+        if (std::fread(entry, 1, sizeof entry, file) != sizeof entry) {
+            err = path + ": truncated header";
+            close();
+            return false;
+        }
+        TelemetryChannel channel;
+        channel.quantum = getF64(entry);
+        channel.name.resize(entry[8] | entry[9] << 8);
+        if (!channel.name.empty() && std::fread(&channel.name[0], 1, channel.name.size(), file) != channel.name.size()) {
+            err = path + ": truncated header";
+            close();
+            return false;
+        }
+        consumed += sizeof entry + channel.name.size();
+        channelList.push_back(channel);
+    }
+    if (channelList.empty() || frameLimit < 1) {
+        err = path + ": bad telemetry header";
+        close();
+        return false;
+    }
+    wanted.assign(channelList.size(), true);
+    return true;
+}
+
+void TelemetryReader::close()
+{
+    if (file)
+        std::fclose(file);
+    file = nullptr;
+}
+
+void TelemetryReader::select(const std::vector<int> &channels)
+{
+    wanted.assign(channelList.size(), false);
+    for (int c : channels) {
+        if (c >= 0 && c < static_cast<int>(wanted.size()))
+            wanted[c] = true;
+    }
+}
+
+bool TelemetryReader::next(TelemetryBlock &block)
+{
+    err.clear();
+    if (!file)
+        return false;
+    unsigned char head[8];
+    const std::size_t got = std::fread(head, 1, sizeof head, file);
+    if (got == 0)
+        return false; // clean end
+    const std::string where = "block at byte " + std::to_string(consumed) + ": ";
+    if (got != sizeof head) {
+        err = where + "truncated";
+        return false;
+    }
+    const std::uint32_t n = getU32(head);
+    const std::uint32_t bytes = getU32(head + 4);
+    const std::size_t columns = channelList.size() + 1;
+    const std::size_t table = columns * kColumnEntryBytes;
+    if (n < 1 || n > static_cast<std::uint32_t>(frameLimit) || bytes < table) {
+        err = where + "corrupt header";
+        return false;
+    }
+    payload.resize(bytes + kReadPadding);
+    if (std::fread(payload.data(), 1, bytes, file) != bytes) {
+        err = where + "truncated";
+        return false;
+    }
+    std::memset(payload.data() + bytes, 0, kReadPadding);
+    consumed += sizeof head + bytes;
+
+    const int frames = static_cast<int>(n);
+    block.stamps.resize(frames);
+    block.columns.resize(channelList.size());
+    std::size_t offset = table;
+    for (std::size_t c = 0; c < columns; ++c) {
+        const unsigned char *entry = payload.data() + c * kColumnEntryBytes;
+        const unsigned char codec = entry[0];
+        const std::size_t size = getU32(entry + 1);
+        if (size > bytes - offset) {
+            err = where + "corrupt column table";
+            return false;
+        }
+        BitReader r(payload.data() + offset);
+        const std::size_t limit = size * 8;
+        offset += size;
+        bool ok;
+        if (c == 0) {
+            std::int64_t *stamps = block.stamps.data();
+            ok = codec == kCodecDod && limit >= 64
+                 && decodeDod(r, limit, frames, [stamps](int i, std::uint64_t v) {
+                        stamps[i] = static_cast<std::int64_t>(v);
+                    });
+        } else if (!wanted[c - 1]) {
+            block.columns[c - 1].clear();
+            continue;
+        } else {
+            std::vector<double> &column = block.columns[c - 1];
+            column.resize(frames);
+            double *out = column.data();
+            const double quantum = channelList[c - 1].quantum;
+            if (limit < 64)
+                ok = false;
+            else if (codec == kCodecXor)
+                ok = decodeXor(r, limit, out, frames);
+            else if (codec == kCodecQuantized && quantum > 0)
+                ok = decodeDod(r, limit, frames, [out, quantum](int i, std::uint64_t v) {
+                    out[i] = static_cast<double>(static_cast<std::int64_t>(v)) * quantum;
+                });
+            else
+                ok = false;
+        }
+        if (!ok) {
+            err = where + "corrupt column " + (c == 0 ? std::string("stamps") : channelList[c - 1].name);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,174 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compressed columnar telemetry log of a production run, for post-mortem
+// analysis of every computed position and velocity.
+//
+// Frames (a microsecond stamp plus one double per channel) are collected
+// into blocks of blockFrames rows. A full block goes to a background thread,
+// which stores it column by column in the style of Gorilla:
+//
+//   stamps      delta-of-delta in variable-width buckets (a steady tick
+//               rate costs one bit per frame)
+//   values      XOR with the previous value of the column, storing only
+//               the bits between the leading and trailing zeros (lossless)
+//   quantized   channels with quantum > 0 are stored as round(x / quantum)
+//               with delta-of-delta: smooth motion needs a few bits per
+//               value, at an error of at most quantum / 2 (a block falls
+//               back to XOR for a column holding NaN or huge values)
+//
+// The file is little-endian and self-describing:
+//   header  "CNCTLM1\0", u32 version, u32 channelCount, u32 blockFrames,
+//           per channel: f64 quantum, u16 name length, name bytes
+//   block   u32 frames, u32 payload bytes, then per column (stamps first)
+//           u8 codec + u32 bytes, then the column bit streams
+//
+// Every block is flushed when written, so a crash loses at most the blocks
+// not yet handed to the thread; a reader stops at a truncated block.
+
+struct TelemetryChannel
+{
+    std::string name;
+    double quantum = 0.0; // 0: lossless
+};
+
+// Steady-clock microseconds, the default frame stamp.
+std::int64_t telemetryClockUs();
+
+// Channels of a wave log: pos0 .. pos<motors-1> in mm, then vel0 .. in
+// mm/s. The velocity quantum matches positionQuantum moved in one tick.
+std::vector<TelemetryChannel> waveTelemetryChannels(int motors, double positionQuantum, double tickSeconds);
+
+class TelemetryRecorder
+{
+public:
+    // What to do with a full block when pendingBlocks are already waiting
+    // for the thread (or the disk): a live run drops it and counts the
+    // frames rather than stalling its tick; offline writers wait.
+    enum class Overflow
+    {
+        Drop,
+        Wait
+    };
+
+    TelemetryRecorder() = default;
+    ~TelemetryRecorder();
+
+    TelemetryRecorder(const TelemetryRecorder &) = delete;
+    TelemetryRecorder &operator=(const TelemetryRecorder &) = delete;
+
+    // Creates path and starts the compression thread.
+    bool open(const std::string &path, const std::vector<TelemetryChannel> &channels, int blockFrames = 1024,
+              int pendingBlocks = 8, Overflow overflow = Overflow::Drop);
+    bool isOpen() const { return file != nullptr; }
+
+    // The row for the next frame: channelCount() doubles, to be filled in
+    // place and committed. This is all the tick path does; the lock is
+    // taken once per block, to hand the block over.
+    double *frame() { return current->values.data() + static_cast<std::size_t>(current->frames) * channelCount(); }
+    void commit(std::int64_t stampUs);
+    void commit() { commit(telemetryClockUs()); }
+
+    // Copies values (channelCount() of them) as the next frame.
+    void record(const double *values, std::int64_t stampUs);
+
+    // Writes the partial block, stops the thread and closes the file.
+    bool close();
+
+    int channelCount() const { return static_cast<int>(channelList.size()); }
+    long framesRecorded() const { return recorded; }
+    long framesDropped() const { return dropped.load(std::memory_order_relaxed); }
+    std::uint64_t bytesWritten() const { return written.load(std::memory_order_relaxed); }
+    const std::string &error() const { return err; }
+
+private:
+    struct Block
+    {
+        std::vector<double> values; // row-major, frames x channels
+        std::vector<std::int64_t> stamps;
+        int frames = 0;
+    };
+
+    void handOff();
+    void compressLoop();
+    bool writeBlock(const Block &block, std::vector<unsigned char> &out);
+
+    std::FILE *file = nullptr;
+    std::vector<TelemetryChannel> channelList;
+    int blockFrames = 0;
+    long recorded = 0;
+
+    std::unique_ptr<Block> current;
+    std::vector<std::unique_ptr<Block>> spare;
+    std::deque<std::unique_ptr<Block>> queue;
+    std::mutex mutex;
+    std::condition_variable wake;     // the thread: a block is queued
+    std::condition_variable returned; // Overflow::Wait: a block is free
+    Overflow overflow = Overflow::Drop;
+    bool stopping = false;
+    bool failed = false;
+    std::thread worker;
+
+    std::atomic<long> dropped{0};
+    std::atomic<std::uint64_t> written{0};
+    std::string err;
+};
+
+// One decoded block; columns[c] is empty for channels not selected.
+struct TelemetryBlock
+{
+    std::vector<std::int64_t> stamps;
+    std::vector<std::vector<double>> columns;
+
+    int frames() const { return static_cast<int>(stamps.size()); }
+};
+
+class TelemetryReader
+{
+public:
+    TelemetryReader() = default;
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader &) = delete;
+    TelemetryReader &operator=(const TelemetryReader &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    const std::vector<TelemetryChannel> &channels() const { return channelList; }
+    int blockFrames() const { return frameLimit; }
+
+    // Decodes only these channels from now on (all by default); the other
+    // columns are skipped without being read bit by bit.
+    void select(const std::vector<int> &channels);
+
+    // Decodes the next block; false at the end of the file, or on a
+    // truncated or corrupt block (then error() says which).
+    bool next(TelemetryBlock &block);
+
+    // File bytes consumed so far, header included.
+    std::uint64_t bytesRead() const { return consumed; }
+    const std::string &error() const { return err; }
+
+private:
+    std::FILE *file = nullptr;
+    std::vector<TelemetryChannel> channelList;
+    std::vector<bool> wanted;
+    int frameLimit = 0;
+    std::vector<unsigned char> payload;
+    std::uint64_t consumed = 0;
+    std::string err;
+};
+
+#endif // TELEMETRY_H
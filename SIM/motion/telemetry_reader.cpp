@@ -0,0 +1,221 @@
+// Reader for compressed telemetry logs (see telemetry.h).
+//
+//   telemetry_reader FILE [--channels A,B,...] [--csv] [--reps R]
+//   telemetry_reader --synth FILE [--motors N] [--frames F] [--quantum MM] [--block B]
+//
+// Decodes the whole log R times (best run timed) and prints its size, the
+// bytes per value against raw doubles and the decode rate in GB/s of
+// decoded doubles. --channels decodes only the named channels (the other
+// columns are skipped); --csv writes them as CSV to stdout instead, with
+// the stamp in microseconds as the first column. A log cut short by a crash
+// decodes up to its last complete block, with a warning.
+//
+// --synth writes a log without the UI: a 1 kHz production run of N motors
+// (positions and velocities, stamps with timer jitter and slider moves in
+// the pattern of wave_workload), recorded through TelemetryRecorder exactly
+// as WaveControlWindow does. --quantum 0 stores the values losslessly.
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "telemetry.h"
+#include "wavekernel.h"
+
+namespace {
+
+int synthesize(const char *path, int motors, long frames, double quantum, int block)
+{
+    const double tickSeconds = 0.001;
+    WaveParams params;
+    params.numMotors = motors;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    params.step = 0.05 * tickSeconds / 0.05; // the UI's wave speed at 1 kHz
+    WaveGenerator wave(params);
+    TelemetryRecorder recorder;
+    if (!recorder.open(path, waveTelemetryChannels(motors, quantum, tickSeconds), block, 8,
+                       TelemetryRecorder::Overflow::Wait)) {
+        std::fprintf(stderr, "%s\n", recorder.error().c_str());
+        return 1;
+    }
+    std::vector<double> previous;
+    std::uint32_t jitter = 1;
+    for (long tick = 0; tick < frames; ++tick) {
+        if (tick % 997 == 0)
+            wave.params().waveFactorValue = tick / 997 % 101 / 100.0;
+        if (tick % 1499 == 0)
+            wave.params().strokeLengthValue = 1 + tick / 1499 % 30;
+        const std::vector<double> &pos = wave.tick();
+        if (previous.empty())
+            previous = pos;
+        double *row = recorder.frame();
+        for (int i = 0; i < motors; ++i) {
+            row[i] = pos[i];
+            row[motors + i] = (pos[i] - previous[i]) / tickSeconds;
+        }
+        previous = pos;
+        jitter = jitter * 1664525u + 1013904223u;
+        recorder.commit(tick * 1000 + static_cast<std::int64_t>(jitter >> 27)); // 0..31 us late
+    }
+    const long dropped = recorder.framesDropped();
+    if (!recorder.close()) {
+        std::fprintf(stderr, "%s: %s\n", path, recorder.error().c_str());
+        return 1;
+    }
+    std::printf("wrote %s: %ld frames, %d channels, %" PRIu64 " bytes, %ld frames dropped\n", path, frames,
+                2 * motors, recorder.bytesWritten(), dropped);
+    return 0;
+}
+
+bool selectChannels(TelemetryReader &reader, const char *list, std::vector<int> &selected)
+{
+    selected.clear();
+    const std::vector<TelemetryChannel> &channels = reader.channels();
+    if (!list) {
+        for (std::size_t c = 0; c < channels.size(); ++c)
+            selected.push_back(static_cast<int>(c));
+        return true;
+    }
+    std::string names(list);
+    for (std::size_t start = 0; start <= names.size();) {
+        std::size_t end = names.find(',', start);
+        if (end == std::string::npos)
+            end = names.size();
+        const std::string name = names.substr(start, end - start);
+        std::size_t c = 0;
+        while (c < channels.size() && channels[c].name != name)
+            ++c;
+        if (c == channels.size()) {
+            std::fprintf(stderr, "no channel %s\n", name.c_str());
+            return false;
+        }
+        selected.push_back(static_cast<int>(c));
+        start = end + 1;
+    }
+    reader.select(selected);
+    return true;
+}
+
+void writeCsv(const TelemetryBlock &block, const std::vector<int> &selected)
+{
+    char line[64];
+    for (int f = 0; f < block.frames(); ++f) {
+        std::fprintf(stdout, "%" PRId64, block.stamps[f]);
+        for (int c : selected) {
+            std::snprintf(line, sizeof line, ",%.17g", block.columns[c][f]);
+            std::fputs(line, stdout);
+        }
+        std::fputc('\n', stdout);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    const char *synthPath = nullptr;
+    const char *channelList = nullptr;
+    bool csv = false;
+    int reps = 3;
+    int motors = 50;
+    long frames = 200000;
+    double quantum = 1e-4;
+    int blockFrames = 1024;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--channels") && i + 1 < argc)
+            channelList = argv[++i];
+        else if (!std::strcmp(argv[i], "--csv"))
+            csv = true;
+        else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc)
+            reps = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--synth") && i + 1 < argc)
+            synthPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--quantum") && i + 1 < argc)
+            quantum = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--block") && i + 1 < argc)
+            blockFrames = std::atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+            usage = true;
+    }
+    if (synthPath && !usage && motors > 0 && frames > 0 && blockFrames > 0 && quantum >= 0)
+        return synthesize(synthPath, motors, frames, quantum, blockFrames);
+    if (!path || usage || synthPath) {
+        std::fprintf(stderr,
+                     "usage: %s FILE [--channels A,B,...] [--csv] [--reps R]\n"
+                     "       %s --synth FILE [--motors N] [--frames F] [--quantum MM] [--block B]\n",
+                     argv[0], argv[0]);
+        return 2;
+    }
+
+    TelemetryReader reader;
+    std::vector<int> selected;
+    if (!reader.open(path) || !selectChannels(reader, channelList, selected)) {
+        if (!reader.error().empty())
+            std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+
+    TelemetryBlock block;
+    if (csv) {
+        std::fputs("stamp_us", stdout);
+        for (int c : selected)
+            std::fprintf(stdout, ",%s", reader.channels()[c].name.c_str());
+        std::fputc('\n', stdout);
+        while (reader.next(block))
+            writeCsv(block, selected);
+        if (!reader.error().empty())
+            std::fprintf(stderr, "%s: %s; stopped there\n", path, reader.error().c_str());
+        return 0;
+    }
+
+    long decoded = 0;
+    long blocks = 0;
+    std::uint64_t bytes = 0;
+    std::string warning;
+    double best = 1e300;
+    for (int rep = 0; rep < reps; ++rep) {
+        if (rep > 0 && (!reader.open(path) || !selectChannels(reader, channelList, selected))) {
+            std::fprintf(stderr, "%s\n", reader.error().c_str());
+            return 1;
+        }
+        decoded = 0;
+        blocks = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        while (reader.next(block)) {
+            decoded += block.frames();
+            ++blocks;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+        bytes = reader.bytesRead();
+        warning = reader.error();
+    }
+
+    const std::size_t all = reader.channels().size();
+    const double values = static_cast<double>(decoded) * (all + 1);
+    const double decodedBytes = static_cast<double>(decoded) * (selected.size() + 1) * sizeof(double);
+    std::printf("%s: %ld frames in %ld blocks, %zu channels (%zu decoded)\n", path, decoded, blocks, all,
+                selected.size());
+    std::printf("  %" PRIu64 " bytes: %.2f bytes/value, %.1fx smaller than raw doubles\n", bytes, bytes / values,
+                values * sizeof(double) / bytes);
+    std::printf("  decode %.1f ms, %.2f GB/s of doubles, %.1f ns/value\n", best * 1e3, decodedBytes / best / 1e9,
+                best / (decodedBytes / sizeof(double)) * 1e9);
+    if (!warning.empty()) {
+        std::printf("  warning: %s; the log ends there\n", warning.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+#ifndef TYPEDWAVEKERNEL_H
+#define TYPEDWAVEKERNEL_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "fixedpoint.h"
+#include "wavekernel.h"
+
+// The wave of wavekernel.h, compile-time parameterized over the numeric type
+// so the same code runs on the host (double), on boards with a single
+// precision FPU (float) and on FPU-less boards (Q16_16).
+//
+// Phase is always accumulated as a TurnPhase integer; only the sine and the
+// amplitude multiply use T. Against the double reference (WaveGenerator)
+// each instantiation stays within WaveNumeric<T>::tolerance(scale) for
+// positions and within one step for step outputs.
+
+class StepCompensator;
+
+// Steps per mm for the parts-list lead screws: 200 full steps x 16
+// microsteps per revolution, 8 mm lead (4 start, 2 mm pitch).
+constexpr double kDefaultStepsPerMm = 200.0 * 16.0 / 8.0;
+
+template <typename T>
+struct WaveNumeric;
+
+template <>
+struct WaveNumeric<double>
+{
+    static double fromDouble(double v) { return v; }
+    static double toDouble(double v) { return v; }
+    static double sinTurns(TurnPhase phase)
+    {
+        // Signed view keeps the argument in [-pi, pi).
+        return std::sin(static_cast<double>(static_cast<std::int64_t>(phase)) * (2 * M_PI / 18446744073709551616.0));
+    }
+    static double mul(double a, double b) { return a * b; }
+    static std::int32_t toSteps(double pos, double stepsPerUnit)
+    {
+        return static_cast<std::int32_t>(std::lround(pos * stepsPerUnit));
+    }
+    static double tolerance(double scale) { return 1e-9 * std::fabs(scale) + 1e-12; }
+};
+
+template <>
+struct WaveNumeric<float>
+{
+    static float fromDouble(double v) { return static_cast<float>(v); }
+    static double toDouble(float v) { return v; }
+    static float sinTurns(TurnPhase phase)
+    {
+        return std::sin(static_cast<float>(static_cast<std::int64_t>(phase)) * (2 * static_cast<float>(M_PI) / 18446744073709551616.0f));
+    }
+    static float mul(float a, float b) { return a * b; }
+    static std::int32_t toSteps(float pos, float stepsPerUnit)
+    {
+        return static_cast<std::int32_t>(std::lround(pos * stepsPerUnit));
+    }
+    static double tolerance(double scale) { return 1e-6 * std::fabs(scale) + 1e-7; }
+};
+
+template <>
+struct WaveNumeric<Q16_16>
+{
+    static Q16_16 fromDouble(double v) { return Q16_16::fromDouble(v); }
+    static double toDouble(Q16_16 v) { return v.toDouble(); }
+    static Q16_16 sinTurns(TurnPhase phase) { return ::sinTurns(phase); }
+    static Q16_16 mul(Q16_16 a, Q16_16 b) { return a * b; }
+    static std::int32_t toSteps(Q16_16 pos, Q16_16 stepsPerUnit)
+    {
+        // Round half up in integer arithmetic.
+        const std::int64_t scaled = static_cast<std::int64_t>(pos.raw) * stepsPerUnit.raw;
+        return static_cast<std::int32_t>((scaled + (std::int64_t(1) << 31)) >> 32);
+    }
+    // Table error (< 1.5 LSB) times the amplitude, plus output rounding.
+    static double tolerance(double scale) { return 4e-5 * std::fabs(scale) + 2.0 / Q16_16::kOne; }
+};
+
+// Everything the per-tick loop needs, already converted to T and turns.
+// Built on the host with makeWaveConfig() and shipped to the target as-is.
+template <typename T>
+struct TypedWaveConfig
+{
+    int numMotors = 0;
+    T scale{};               // strokeLength * amp
+    TurnPhase tickPhase = 0; // 2*pi*f*step
+    TurnPhase motorPhase = 0;// basePhaseShift * waveFactor
+    T stepsPerUnit{};
+};
+
+template <typename T>
+TypedWaveConfig<T> makeWaveConfig(const WaveParams &p, double stepsPerUnit = kDefaultStepsPerMm)
+{
+    using N = WaveNumeric<T>;
+    TypedWaveConfig<T> c;
+    c.numMotors = p.numMotors;
+    c.scale = N::fromDouble(p.strokeLengthValue * p.amp);
+    c.tickPhase = turnsFromRadians(2 * M_PI * p.frequency * p.step);
+    c.motorPhase = turnsFromRadians(p.basePhaseShift * p.waveFactorValue);
+    c.stepsPerUnit = N::fromDouble(stepsPerUnit);
+    return c;
+}
+
+template <typename T>
+class TypedWaveKernel
+{
+public:
+    using N = WaveNumeric<T>;
+
+    explicit TypedWaveKernel(const TypedWaveConfig<T> &config)
+        : c(config)
+    {
+    }
+
+    const TypedWaveConfig<T> &config() const { return c; }
+
+    // Positions at timer tick n (t = n * step); out holds numMotors values.
+    void positions(std::int64_t tick, T *out) const
+    {
+        TurnPhase phase = static_cast<TurnPhase>(tick) * c.tickPhase;
+        for (int i = 0; i < c.numMotors; ++i) {
+            out[i] = N::mul(c.scale, N::sinTurns(phase));
+            phase += c.motorPhase;
+        }
+    }
+
+    // Absolute step targets for a frame of positions.
+    void steps(const T *pos, std::int32_t *out) const
+    {
+        for (int i = 0; i < c.numMotors; ++i)
+            out[i] = N::toSteps(pos[i], c.stepsPerUnit);
+    }
+
+    // The same through a calibrated screw: backlash and pitch error are
+    // compensated and the compensator's steps per mm apply. Defined in
+    // stepcompensation.h; compensator holds numMotors axes.
+    void steps(const T *pos, StepCompensator &compensator, std::int32_t *out) const;
+
+private:
+    TypedWaveConfig<T> c;
+};
+
+#endif // TYPEDWAVEKERNEL_H
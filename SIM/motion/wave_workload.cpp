@@ -0,0 +1,105 @@
+// Headless wave/motion workload derived from WaveControlWindow::updateWave.
+//
+//   wave_workload [--motors N] [--ticks T] [--reps R] [--train]
+//
+// Every tick evaluates the wave for all motors and pushes the positions into
+// a float "bar set" the way the chart does, while the wave factor and stroke
+// length sliders are swept the way a user drags them. Used as the training
+// run for the PGO build and as a throughput benchmark.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "wavekernel.h"
+
+namespace {
+
+struct Options
+{
+    int motors = 50;
+    long ticks = 200000;
+    int reps = 5;
+};
+
+struct RunResult
+{
+    double seconds;
+    double checksum;
+};
+
+RunResult runOnce(const Options &opt)
+{
+    WaveParams params;
+    params.numMotors = opt.motors;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    WaveGenerator wave(params);
+
+    std::vector<float> barSet(opt.motors, 0.0f);
+    double axisMin = 0.0;
+    double axisMax = 0.0;
+    double checksum = 0.0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (long tick = 0; tick < opt.ticks; ++tick) {
+        // Slider activity: wave factor 0..100 %, stroke length 1..30.
+        if (tick % 997 == 0)
+            wave.params().waveFactorValue = (tick / 997 % 101) / 100.0;
+        if (tick % 1499 == 0)
+            wave.params().strokeLengthValue = 1 + tick / 1499 % 30;
+
+        const std::vector<double> &pos = wave.tick();
+        for (int i = 0; i < opt.motors; ++i) {
+            barSet[i] = static_cast<float>(pos[i]);
+            axisMin = std::min(axisMin, pos[i]);
+            axisMax = std::max(axisMax, pos[i]);
+        }
+        checksum += barSet[tick % opt.motors];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    return {std::chrono::duration<double>(t1 - t0).count(), checksum + axisMax - axisMin};
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            opt.motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            opt.ticks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc)
+            opt.reps = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--train"))
+            opt.reps = 1;
+        else {
+            std::fprintf(stderr, "usage: %s [--motors N] [--ticks T] [--reps R] [--train]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (opt.motors < 1 || opt.ticks < 1 || opt.reps < 1) {
+        std::fprintf(stderr, "motors, ticks and reps must be positive\n");
+        return 2;
+    }
+
+    double best = 1e300;
+    double checksum = 0.0;
+    for (int r = 0; r < opt.reps; ++r) {
+        RunResult res = runOnce(opt);
+        best = std::min(best, res.seconds);
+        checksum = res.checksum;
+    }
+
+    const double samples = double(opt.motors) * opt.ticks;
+    std::printf("motors: %d  ticks: %ld  reps: %d\n", opt.motors, opt.ticks, opt.reps);
+    std::printf("best time: %.4f s\n", best);
+    std::printf("throughput: %.3f Msamples/s\n", samples / best / 1e6);
+    std::printf("checksum: %.9g\n", checksum);
+    return 0;
+}
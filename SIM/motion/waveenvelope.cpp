@@ -0,0 +1,116 @@
+// Pre-run envelope check of a wave program (see envelopecheck.h).
+//
+//   waveenvelope [JOURNAL] [--motors N] [--factor F] [--stroke S] [--ticks T]
+//                [--min MM] [--max MM] [--delta MM] [--vmax MM/S] [--tick-ms MS] [--fit]
+//
+// Runs the wave headless through EnvelopeChecker and lists the violations
+// of the travel, neighbour-delta and velocity limits before anything moves.
+// The program is a recorded session (JOURNAL, from wavereplay --synth or
+// WaveControlApp_1 --record) or fixed slider settings (--factor in 0..1,
+// --stroke in mm, as in the UI). --fit also prints the stroke and time
+// scale that bring the wave within limits and, for fixed settings, checks
+// the fitted wave. Exit code 1 if the (fitted, with --fit) wave violates.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "envelopecheck.h"
+
+namespace {
+
+void printReport(const char *title, const EnvelopeReport &r, const EnvelopeLimits &limits)
+{
+    std::printf("%s: %ld frames\n", title, r.frames);
+    std::printf("  position  %9.3f .. %-9.3f mm   (limit %.3f .. %.3f)\n", r.minPosition, r.maxPosition,
+                limits.minPosition, limits.maxPosition);
+    std::printf("  neighbour %9.3f mm               (limit %.3f)\n", r.maxNeighbourDelta, limits.maxNeighbourDelta);
+    std::printf("  velocity  %9.3f mm/s             (limit %.3f)\n", r.maxVelocity, limits.maxVelocity);
+    for (int k = 0; k < kEnvelopeKinds; ++k)
+        std::printf("  %-9s violations: %ld\n", envelopeKindName(static_cast<EnvelopeKind>(k)), r.violations[k]);
+    for (const EnvelopeViolation &v : r.first)
+        std::printf("    frame %ld motor %d %s %.4f\n", v.frame, v.motor, envelopeKindName(v.kind), v.value);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const char *journalPath = nullptr;
+    WaveParams params;
+    params.numMotors = 50;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    EnvelopeLimits limits;
+    long ticks = -1;
+    bool fit = false;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            params.numMotors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--factor") && i + 1 < argc)
+            params.waveFactorValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--stroke") && i + 1 < argc)
+            params.strokeLengthValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            ticks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--min") && i + 1 < argc)
+            limits.minPosition = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--max") && i + 1 < argc)
+            limits.maxPosition = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--delta") && i + 1 < argc)
+            limits.maxNeighbourDelta = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--vmax") && i + 1 < argc)
+            limits.maxVelocity = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--tick-ms") && i + 1 < argc)
+            limits.tickSeconds = std::atof(argv[++i]) / 1000.0;
+        else if (!std::strcmp(argv[i], "--fit"))
+            fit = true;
+        else if (argv[i][0] != '-' && !journalPath)
+            journalPath = argv[i];
+        else
+            usage = true;
+    }
+    if (usage || params.numMotors <= 0 || limits.tickSeconds <= 0) {
+        std::fprintf(stderr,
+                     "usage: %s [JOURNAL] [--motors N] [--factor F] [--stroke S] [--ticks T]\n"
+                     "          [--min MM] [--max MM] [--delta MM] [--vmax MM/S] [--tick-ms MS] [--fit]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    EnvelopeReport report;
+    if (journalPath) {
+        WaveJournal journal;
+        std::string error;
+        if (!journal.load(journalPath, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (ticks < 0 && !journal.complete) {
+            std::fprintf(stderr, "%s: no end record, give --ticks\n", journalPath);
+            return 1;
+        }
+        report = preflightWave(journal, limits, ticks);
+        printReport(journalPath, report, limits);
+    } else {
+        // Default: four wave periods.
+        if (ticks < 0)
+            ticks = static_cast<long>(4.0 / (params.frequency * params.step));
+        report = preflightWave(params, limits, ticks);
+        printReport("wave", report, limits);
+    }
+    if (!fit)
+        return report.ok() ? 0 : 1;
+
+    const double a = report.amplitudeScale(limits);
+    const double s = report.timeScale(limits);
+    std::printf("fit: stroke x %.4f, time x %.4f (step / %.4f)\n", a, 1.0 / s, s);
+    if (journalPath)
+        return report.ok() ? 0 : 1; // a journal's own stroke changes would undo the fit
+    const WaveParams fitted = fitWave(params, report, limits);
+    std::printf("fitted: stroke %.4f, step %.6f\n", fitted.strokeLengthValue, fitted.step);
+    const EnvelopeReport check = preflightWave(fitted, limits, static_cast<long>(ticks * s) + 1);
+    printReport("fitted wave", check, limits);
+    return check.ok() ? 0 : 1;
+}
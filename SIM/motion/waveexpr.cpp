@@ -0,0 +1,84 @@
+// Tries a wave expression headless (see waveexpression.h).
+//
+//   waveexpr EXPR [--param NAME=VALUE]... [--motors N] [--factor F] [--stroke S]
+//                 [--ticks T] [--disasm]
+//
+// Compiles EXPR and prints T frames (default 20) of the wave it defines,
+// one CSV line of motor positions per timer tick, as the UI would show
+// them; --disasm prints the bytecode instead. Without --param, EXPR may
+// start with "name=value;" parameters as in the UI. Exit code 1 on a
+// compile error.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "waveexpression.h"
+
+int main(int argc, char *argv[])
+{
+    const char *source = nullptr;
+    std::vector<std::string> names;
+    std::vector<double> values;
+    WaveParams params;
+    params.numMotors = 50;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    long ticks = 20;
+    bool disasm = false;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--param") && i + 1 < argc) {
+            const char *eq = std::strchr(argv[++i], '=');
+            usage = usage || !eq || eq == argv[i];
+            if (eq) {
+                names.emplace_back(argv[i], static_cast<std::size_t>(eq - argv[i]));
+                values.push_back(std::atof(eq + 1));
+            }
+        } else if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            params.numMotors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--factor") && i + 1 < argc)
+            params.waveFactorValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--stroke") && i + 1 < argc)
+            params.strokeLengthValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            ticks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--disasm"))
+            disasm = true;
+        else if (!source)
+            source = argv[i];
+        else
+            usage = true;
+    }
+    if (usage || !source || params.numMotors <= 0) {
+        std::fprintf(stderr,
+                     "usage: %s EXPR [--param NAME=VALUE]... [--motors N] [--factor F] [--stroke S]\n"
+                     "          [--ticks T] [--disasm]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    WaveExpression expr;
+    if (!(names.empty() ? expr.compileDefinition(source) : expr.compile(source, names))) {
+        std::fprintf(stderr, "%s\n%*s^\n%s\n", source, std::atoi(expr.error().c_str() + 4) - 1, "",
+                     expr.error().c_str());
+        return 1;
+    }
+    for (std::size_t k = 0; k < names.size(); ++k)
+        expr.setParameter(names[k], values[k]);
+    if (disasm) {
+        std::printf("%s", expr.disassemble().c_str());
+        return 0;
+    }
+
+    std::vector<double> frame(params.numMotors);
+    double t = 0.0;
+    for (long tick = 0; tick < ticks; ++tick, t += params.step) {
+        expr.evaluate(params, t, 0, params.numMotors, frame.data());
+        for (int i = 0; i < params.numMotors; ++i)
+            std::printf(i ? ",%.6f" : "%.6f", frame[i]);
+        std::printf("\n");
+    }
+    return 0;
+}
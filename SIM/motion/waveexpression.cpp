@@ -0,0 +1,601 @@
+#include "waveexpression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+using Op = WaveExpression::Op;
+using Operand = WaveExpression::Operand;
+using Instruction = WaveExpression::Instruction;
+using Program = WaveExpression::Program;
+constexpr int kBatch = WaveExpression::kBatch;
+
+// Slots every program starts with, set by evaluate() from its arguments.
+enum FixedSlot
+{
+    SlotT,
+    SlotN,
+    SlotA,
+    SlotF,
+    SlotPhi,
+    SlotAmp,
+    SlotStroke,
+    SlotFactor,
+    SlotShift,
+    kFixedSlots
+};
+const char *const kFixedNames[kFixedSlots] = {"t", "n", "A", "f", "phi", "amp", "stroke", "factor", "shift"};
+
+struct Function
+{
+    const char *name;
+    Op op;
+    int arity;
+};
+const Function kFunctions[] = {
+    {"sin", Op::Sin, 1},   {"cos", Op::Cos, 1},     {"tan", Op::Tan, 1},   {"exp", Op::Exp, 1},
+    {"log", Op::Log, 1},   {"sqrt", Op::Sqrt, 1},   {"abs", Op::Abs, 1},   {"floor", Op::Floor, 1},
+    {"tri", Op::Tri, 1},   {"min", Op::Min, 2},     {"max", Op::Max, 2},   {"pow", Op::Pow, 2},
+    {"mod", Op::Mod, 2},
+};
+
+const char *opName(Op op)
+{
+    switch (op) {
+    case Op::Index: return "index";
+    case Op::Add: return "add";
+    case Op::Sub: return "sub";
+    case Op::Mul: return "mul";
+    case Op::Div: return "div";
+    case Op::Pow: return "pow";
+    case Op::Min: return "min";
+    case Op::Max: return "max";
+    case Op::Mod: return "mod";
+    case Op::Neg: return "neg";
+    case Op::Sin: return "sin";
+    case Op::Cos: return "cos";
+    case Op::Tan: return "tan";
+    case Op::Exp: return "exp";
+    case Op::Log: return "log";
+    case Op::Sqrt: return "sqrt";
+    case Op::Abs: return "abs";
+    case Op::Floor: return "floor";
+    case Op::Tri: return "tri";
+    }
+    return "?";
+}
+
+bool isUnary(Op op)
+{
+    return op == Op::Neg || op >= Op::Sin;
+}
+
+double scalarOp(Op op, double a, double b)
+{
+    switch (op) {
+    case Op::Add: return a + b;
+    case Op::Sub: return a - b;
+    case Op::Mul: return a * b;
+    case Op::Div: return a / b;
+    case Op::Pow: return std::pow(a, b);
+    case Op::Min: return std::min(a, b);
+    case Op::Max: return std::max(a, b);
+    case Op::Mod: return a - b * std::floor(a / b);
+    case Op::Neg: return -a;
+    case Op::Sin: return std::sin(a);
+    case Op::Cos: return std::cos(a);
+    case Op::Tan: return std::tan(a);
+    case Op::Exp: return std::exp(a);
+    case Op::Log: return std::log(a);
+    case Op::Sqrt: return std::sqrt(a);
+    case Op::Abs: return std::fabs(a);
+    case Op::Floor: return std::floor(a);
+    case Op::Tri: return waveShapeValue(WaveShape::Triangle, a);
+    case Op::Index: break;
+    }
+    return 0.0;
+}
+
+// Adding and subtracting 1.5 * 2^52 rounds |v| < 2^51 to the nearest
+// integer with plain arithmetic, so the kernels below stay branch- and
+// call-free.
+constexpr double kRound = 6755399441055744.0;
+
+// sin(x) for quadrant = 0, cos(x) for quadrant = 1: x = k pi/2 + r with
+// |r| <= pi/4 (pi/2 in three parts, exact products for |k| < 2^20), then
+// the Taylor polynomials of sin r and cos r, picked and signed by the
+// quadrant k + quadrant mod 4 with multiplies by 0 and 1.
+void sinKernel(const double *__restrict x, double *__restrict y, double quadrant)
+{
+    constexpr double kTwoOverPi = 0.63661977236758134308;
+    constexpr double kPio2a = 1.57079632673412561417e+00;
+    constexpr double kPio2b = 6.07710050630396597660e-11;
+    constexpr double kPio2c = 2.02226624871116645580e-21;
+    for (int j = 0; j < kBatch; ++j) {
+        const double k = (x[j] * kTwoOverPi + kRound) - kRound;
+        const double r = ((x[j] - k * kPio2a) - k * kPio2b) - k * kPio2c;
+        const double q = k + quadrant;
+        const double q4 = q - 4.0 * ((q * 0.25 - 0.375 + kRound) - kRound); // 0..3
+        const double negative = (q4 * 0.5 - 0.25 + kRound) - kRound;         // q4 >= 2
+        const double odd = q4 - 2.0 * negative;
+        const double r2 = r * r;
+        const double s = r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880
+                          + r2 * (-1.0 / 39916800 + r2 * (1.0 / 6227020800 + r2 * (-1.0 / 1307674368000)))))));
+        const double c = 1.0 + r2 * (-0.5 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320
+                          + r2 * (-1.0 / 3628800 + r2 * (1.0 / 479001600 + r2 * (-1.0 / 87178291200
+                          + r2 * (1.0 / 20922789888000))))))));
+        y[j] = (1.0 - 2.0 * negative) * (s * (1.0 - odd) + c * odd);
+    }
+}
+
+// Triangle wave of WaveShape::Triangle: 4 * (distance of u to the nearest
+// integer) - 1 with u = x / 2 pi + 1/4.
+void triKernel(const double *__restrict x, double *__restrict y)
+{
+    for (int j = 0; j < kBatch; ++j) {
+        const double u = x[j] * (0.5 / M_PI) + 0.25;
+        y[j] = 4.0 * std::fabs(u - ((u + kRound) - kRound)) - 1.0;
+    }
+}
+
+template <typename F>
+void unaryKernel(const double *__restrict a, double *__restrict y, F f)
+{
+    for (int j = 0; j < kBatch; ++j)
+        y[j] = f(a[j]);
+}
+
+// One or both operands varying; a scalar one is read once.
+template <typename F>
+void binaryKernel(const double *__restrict a, bool av, const double *__restrict b, bool bv, double *__restrict y,
+                  F f)
+{
+    if (av && bv) {
+        for (int j = 0; j < kBatch; ++j)
+            y[j] = f(a[j], b[j]);
+    } else if (av) {
+        const double s = *b;
+        for (int j = 0; j < kBatch; ++j)
+            y[j] = f(a[j], s);
+    } else {
+        const double s = *a;
+        for (int j = 0; j < kBatch; ++j)
+            y[j] = f(s, b[j]);
+    }
+}
+
+// A compile-time value: a constant (folded), a uniform (a slot computed
+// once per frame) or varying (a register).
+struct Value
+{
+    enum Kind { Const, Uniform, Varying } kind = Const;
+    double constant = 0.0;
+    int index = 0; // slot or register
+};
+
+// Recursive-descent parser emitting code as it goes. The tree has no
+// sharing, so a varying operand is dead once used and its register goes
+// back to the free list.
+class Compiler
+{
+public:
+    Compiler(const std::string &source, const std::vector<std::string> &parameters, Program &program)
+        : src(source), prog(program)
+    {
+        prog = Program();
+        prog.slotValues.assign(kFixedSlots, 0.0);
+        for (const std::string &name : parameters) {
+            prog.parameters.push_back(name);
+            prog.parameterSlots.push_back(static_cast<int>(prog.slotValues.size()));
+            prog.slotValues.push_back(0.0);
+        }
+    }
+
+    bool run(std::string &error)
+    {
+        Value v = expression();
+        skipSpace();
+        if (err.empty() && pos < src.size())
+            fail("unexpected '" + std::string(1, src[pos]) + "'");
+        if (!err.empty()) {
+            error = err;
+            return false;
+        }
+        prog.result = operand(v);
+        return true;
+    }
+
+private:
+    void fail(const std::string &message)
+    {
+        if (err.empty())
+            err = "col " + std::to_string(pos + 1) + ": " + message;
+    }
+
+    void skipSpace()
+    {
+        while (pos < src.size() && std::isspace(static_cast<unsigned char>(src[pos])))
+            ++pos;
+    }
+
+    bool accept(char c)
+    {
+        skipSpace();
+        if (pos < src.size() && src[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    Operand operand(const Value &v)
+    {
+        Operand o;
+        if (v.kind == Value::Varying) {
+            o.varying = true;
+            o.index = v.index;
+        } else if (v.kind == Value::Uniform) {
+            o.index = v.index;
+        } else {
+            o.index = static_cast<int>(prog.slotValues.size());
+            prog.slotValues.push_back(v.constant);
+        }
+        return o;
+    }
+
+    int allocate()
+    {
+        if (freeRegisters.empty())
+            return prog.registers++;
+        const int r = freeRegisters.back();
+        freeRegisters.pop_back();
+        return r;
+    }
+
+    Value emit(Op op, const Value &a, const Value &b = Value())
+    {
+        const bool unary = isUnary(op);
+        Value v;
+        if (a.kind == Value::Const && (unary || b.kind == Value::Const)) {
+            v.constant = scalarOp(op, a.constant, b.constant);
+            return v;
+        }
+        if (op == Op::Pow && b.kind == Value::Const && b.constant == 2.0)
+            return emit(Op::Mul, a, a); // x^2 is common and pow() is a call per motor
+        Instruction ins{op, 0, operand(a), unary ? Operand() : operand(b)};
+        if (a.kind != Value::Varying && (unary || b.kind != Value::Varying)) {
+            v.kind = Value::Uniform;
+            v.index = ins.dst = static_cast<int>(prog.slotValues.size());
+            prog.slotValues.push_back(0.0);
+            prog.uniformCode.push_back(ins);
+            return v;
+        }
+        // dst never aliases an operand, so the kernels can take restrict
+        // pointers.
+        v.kind = Value::Varying;
+        v.index = ins.dst = allocate();
+        if (a.kind == Value::Varying)
+            freeRegisters.push_back(a.index);
+        if (!unary && b.kind == Value::Varying && !(a.kind == Value::Varying && a.index == b.index))
+            freeRegisters.push_back(b.index);
+        prog.code.push_back(ins);
+        return v;
+    }
+
+    Value expression()
+    {
+        Value v = term();
+        for (;;) {
+            if (accept('+'))
+                v = emit(Op::Add, v, term());
+            else if (accept('-'))
+                v = emit(Op::Sub, v, term());
+            else
+                return v;
+        }
+    }
+
+    Value term()
+    {
+        Value v = unary();
+        for (;;) {
+            if (accept('*'))
+                v = emit(Op::Mul, v, unary());
+            else if (accept('/'))
+                v = emit(Op::Div, v, unary());
+            else
+                return v;
+        }
+    }
+
+    Value unary()
+    {
+        if (accept('-'))
+            return emit(Op::Neg, unary());
+        if (accept('+'))
+            return unary();
+        Value v = primary();
+        if (accept('^'))
+            v = emit(Op::Pow, v, unary());
+        return v;
+    }
+
+    Value primary()
+    {
+        skipSpace();
+        if (!err.empty() || pos >= src.size()) {
+            fail("expression ends early");
+            return Value();
+        }
+        const char c = src[pos];
+        if (accept('(')) {
+            Value v = expression();
+            if (!accept(')'))
+                fail("expected ')'");
+            return v;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            char *end = nullptr;
+            Value v;
+            v.constant = std::strtod(src.c_str() + pos, &end);
+            if (end == src.c_str() + pos) {
+                fail("bad number");
+                return Value();
+            }
+            pos = end - src.c_str();
+            return v;
+        }
+        if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_') {
+            fail("unexpected '" + std::string(1, c) + "'");
+            return Value();
+        }
+        const std::size_t start = pos;
+        while (pos < src.size() && (std::isalnum(static_cast<unsigned char>(src[pos])) || src[pos] == '_'))
+            ++pos;
+        const std::string name = src.substr(start, pos - start);
+        if (accept('('))
+            return call(name, start);
+        return variable(name, start);
+    }
+
+    Value call(const std::string &name, std::size_t at)
+    {
+        for (const Function &fn : kFunctions) {
+            if (name != fn.name)
+                continue;
+            Value args[2];
+            for (int k = 0; k < fn.arity; ++k) {
+                if (k > 0 && !accept(',')) {
+                    fail(name + "() takes " + std::to_string(fn.arity) + " arguments");
+                    return Value();
+                }
+                args[k] = expression();
+            }
+            if (!accept(')')) {
+                fail(name + "() takes " + std::to_string(fn.arity) + (fn.arity > 1 ? " arguments" : " argument"));
+                return Value();
+            }
+            return emit(fn.op, args[0], args[1]);
+        }
+        pos = at;
+        fail("unknown function '" + name + "'");
+        return Value();
+    }
+
+    Value variable(const std::string &name, std::size_t at)
+    {
+        Value v;
+        if (name == "pi") {
+            v.constant = M_PI;
+        } else if (name == "e") {
+            v.constant = M_E;
+        } else if (name == "i") {
+            v.kind = Value::Varying;
+            v.index = allocate();
+            prog.code.push_back({Op::Index, v.index, Operand(), Operand()});
+        } else {
+            v.kind = Value::Uniform;
+            v.index = -1;
+            for (int k = 0; k < kFixedSlots; ++k)
+                if (name == kFixedNames[k])
+                    v.index = k;
+            for (std::size_t k = 0; k < prog.parameters.size(); ++k)
+                if (name == prog.parameters[k])
+                    v.index = prog.parameterSlots[k];
+            if (v.index < 0) {
+                pos = at;
+                fail("unknown variable '" + name + "'");
+                return Value();
+            }
+        }
+        return v;
+    }
+
+    const std::string &src;
+    Program &prog;
+    std::size_t pos = 0;
+    std::string err;
+    std::vector<int> freeRegisters;
+};
+
+} // namespace
+
+bool WaveExpression::compile(const std::string &source, const std::vector<std::string> &parameters)
+{
+    text = source;
+    err.clear();
+    Compiler compiler(source, parameters, prog);
+    compiled = compiler.run(err);
+    if (!compiled)
+        prog = Program();
+    lanes.assign(static_cast<std::size_t>(prog.registers) * kBatch, 0.0);
+    return compiled;
+}
+
+bool WaveExpression::compileDefinition(const std::string &definition)
+{
+    // The assignments end at the last ';'. They are blanked out of the
+    // expression handed to compile(), so its error columns still match.
+    std::string source = definition;
+    std::vector<std::string> names;
+    std::vector<double> values;
+    const std::size_t split = definition.rfind(';');
+    for (std::size_t at = 0; split != std::string::npos && at < split;) {
+        const std::size_t end = definition.find(';', at);
+        std::size_t pos = at;
+        auto skipSpace = [&] {
+            while (pos < end && std::isspace(static_cast<unsigned char>(definition[pos])))
+                ++pos;
+        };
+        skipSpace();
+        const std::size_t nameStart = pos;
+        if (pos < end && (std::isalpha(static_cast<unsigned char>(definition[pos])) || definition[pos] == '_')) {
+            while (pos < end && (std::isalnum(static_cast<unsigned char>(definition[pos])) || definition[pos] == '_'))
+                ++pos;
+        }
+        const std::string name = definition.substr(nameStart, pos - nameStart);
+        skipSpace();
+        bool ok = !name.empty() && pos < end && definition[pos] == '=';
+        if (ok) {
+            ++pos;
+            const std::string number = definition.substr(pos, end - pos);
+            char *stop = nullptr;
+            const double value = std::strtod(number.c_str(), &stop);
+            ok = stop != number.c_str();
+            pos += stop - number.c_str();
+            skipSpace();
+            ok = ok && pos == end;
+            names.push_back(name);
+            values.push_back(value);
+        }
+        if (!ok) {
+            text = definition;
+            err = "col " + std::to_string(pos + 1) + ": expected name=value before ';'";
+            compiled = false;
+            prog = Program();
+            lanes.clear();
+            return false;
+        }
+        at = end + 1;
+    }
+    if (split != std::string::npos)
+        std::fill(source.begin(), source.begin() + static_cast<std::ptrdiff_t>(split) + 1, ' ');
+
+    const bool ok = compile(source, names);
+    text = definition;
+    for (std::size_t k = 0; ok && k < names.size(); ++k)
+        setParameter(names[k], values[k]);
+    return ok;
+}
+
+bool WaveExpression::setParameter(const std::string &name, double value)
+{
+    for (std::size_t k = 0; k < prog.parameters.size(); ++k) {
+        if (prog.parameters[k] == name) {
+            prog.slotValues[prog.parameterSlots[k]] = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WaveExpression::evaluate(const WaveParams &p, double t, int first, int last, double *out)
+{
+    if (!compiled || last <= first)
+        return;
+    double *slots = prog.slotValues.data();
+    slots[SlotT] = t;
+    slots[SlotN] = p.numMotors;
+    slots[SlotA] = p.strokeLengthValue * p.amp;
+    slots[SlotF] = p.frequency;
+    slots[SlotPhi] = p.basePhaseShift * p.waveFactorValue;
+    slots[SlotAmp] = p.amp;
+    slots[SlotStroke] = p.strokeLengthValue;
+    slots[SlotFactor] = p.waveFactorValue;
+    slots[SlotShift] = p.basePhaseShift;
+    for (const Instruction &ins : prog.uniformCode)
+        slots[ins.dst] = scalarOp(ins.op, slots[ins.a.index], slots[ins.b.index]);
+    if (!prog.result.varying) {
+        std::fill(out, out + (last - first), slots[prog.result.index]);
+        return;
+    }
+
+    double *reg = lanes.data();
+    auto at = [&](const Operand &o) -> const double * {
+        return o.varying ? reg + static_cast<std::size_t>(o.index) * kBatch : slots + o.index;
+    };
+    for (int base = first; base < last; base += kBatch) {
+        for (const Instruction &ins : prog.code) {
+            double *y = reg + static_cast<std::size_t>(ins.dst) * kBatch;
+            const double *a = at(ins.a), *b = at(ins.b);
+            const bool av = ins.a.varying, bv = ins.b.varying;
+            switch (ins.op) {
+            case Op::Index:
+                for (int j = 0; j < kBatch; ++j)
+                    y[j] = base + j;
+                break;
+            case Op::Add: binaryKernel(a, av, b, bv, y, [](double u, double v) { return u + v; }); break;
+            case Op::Sub: binaryKernel(a, av, b, bv, y, [](double u, double v) { return u - v; }); break;
+            case Op::Mul: binaryKernel(a, av, b, bv, y, [](double u, double v) { return u * v; }); break;
+            case Op::Div: binaryKernel(a, av, b, bv, y, [](double u, double v) { return u / v; }); break;
+            case Op::Min: binaryKernel(a, av, b, bv, y, [](double u, double v) { return std::min(u, v); }); break;
+            case Op::Max: binaryKernel(a, av, b, bv, y, [](double u, double v) { return std::max(u, v); }); break;
+            case Op::Pow: binaryKernel(a, av, b, bv, y, [](double u, double v) { return std::pow(u, v); }); break;
+            case Op::Mod:
+                binaryKernel(a, av, b, bv, y, [](double u, double v) { return u - v * std::floor(u / v); });
+                break;
+            case Op::Neg: unaryKernel(a, y, [](double u) { return -u; }); break;
+            case Op::Sin: sinKernel(a, y, 0.0); break;
+            case Op::Cos: sinKernel(a, y, 1.0); break;
+            case Op::Tri: triKernel(a, y); break;
+            case Op::Tan: unaryKernel(a, y, [](double u) { return std::tan(u); }); break;
+            case Op::Exp: unaryKernel(a, y, [](double u) { return std::exp(u); }); break;
+            case Op::Log: unaryKernel(a, y, [](double u) { return std::log(u); }); break;
+            case Op::Sqrt: unaryKernel(a, y, [](double u) { return std::sqrt(u); }); break;
+            case Op::Abs: unaryKernel(a, y, [](double u) { return std::fabs(u); }); break;
+            case Op::Floor: unaryKernel(a, y, [](double u) { return std::floor(u); }); break;
+            }
+        }
+        const double *r = reg + static_cast<std::size_t>(prog.result.index) * kBatch;
+        std::copy(r, r + std::min(kBatch, last - base), out + (base - first));
+    }
+}
+
+std::string WaveExpression::disassemble() const
+{
+    auto slotName = [&](int index) -> std::string {
+        if (index < kFixedSlots)
+            return kFixedNames[index];
+        for (std::size_t k = 0; k < prog.parameters.size(); ++k)
+            if (prog.parameterSlots[k] == index)
+                return prog.parameters[k];
+        for (const Instruction &ins : prog.uniformCode)
+            if (ins.dst == index)
+                return "u" + std::to_string(index);
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%.17g", prog.slotValues[index]);
+        return buf;
+    };
+    auto name = [&](const Operand &o) { return o.varying ? "r" + std::to_string(o.index) : slotName(o.index); };
+    std::string s;
+    auto list = [&](const std::vector<Instruction> &code, bool varying) {
+        for (const Instruction &ins : code) {
+            s += (varying ? "  r" : "  u") + std::to_string(ins.dst) + " = " + opName(ins.op);
+            if (ins.op != Op::Index)
+                s += " " + name(ins.a);
+            if (!isUnary(ins.op) && ins.op != Op::Index)
+                s += ", " + name(ins.b);
+            s += "\n";
+        }
+    };
+    s += "per frame:\n";
+    list(prog.uniformCode, false);
+    s += "per motor (" + std::to_string(prog.registers) + " registers of " + std::to_string(kBatch) + "):\n";
+    list(prog.code, true);
+    s += "result " + name(prog.result) + "\n";
+    return s;
+}
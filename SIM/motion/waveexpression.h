@@ -0,0 +1,109 @@
+#ifndef WAVEEXPRESSION_H
+#define WAVEEXPRESSION_H
+
+#include <string>
+#include <vector>
+
+#include "wavekernel.h"
+
+// User-defined wave shapes: an expression for the position of motor i at
+// time t, e.g.
+//
+//   A*sin(2*pi*f*t + i*phi) * exp(-d*t)
+//
+// parsed once into register bytecode and evaluated over whole motor arrays.
+//
+// Variables: t (time), i (motor index), n (motor count), A (stroke * amp),
+// f (frequency), phi (phase shift between motors, basePhaseShift * wave
+// factor), amp, stroke, factor, shift (the WaveParams fields), pi, e, and
+// any parameters named at compile time (set with setParameter()).
+// Operators: + - * / ^ (power, right-associative), unary -, parentheses.
+// Functions: sin cos tan exp log sqrt abs floor tri(x) (the triangle wave
+// WaveShape::Triangle draws), min(a, b) max(a, b) pow(a, b) mod(a, b).
+//
+// Each instruction works on a register of kBatch motors, so the VM
+// dispatches once per instruction per batch and every operation is a
+// fixed-length loop the compiler vectorizes; sin, cos and tri use
+// polynomial kernels that vectorize too (within a few ulp of std::sin for
+// |x| < 1e6). Constant subexpressions are folded at compile time, and
+// those that do not depend on i (2*pi*f*t, exp(-d*t)) are computed once
+// per frame as scalars, so the per-motor work is only what varies along
+// the row.
+class WaveExpression
+{
+public:
+    static constexpr int kBatch = 64;
+
+    enum class Op
+    {
+        Index, // lanes of i
+        Add, Sub, Mul, Div, Pow, Min, Max, Mod,
+        Neg, Sin, Cos, Tan, Exp, Log, Sqrt, Abs, Floor, Tri
+    };
+
+    // A varying operand lives in a kBatch-wide register, a scalar one in
+    // the slot table (constants, variables, per-frame uniform values).
+    struct Operand
+    {
+        bool varying = false;
+        int index = 0;
+    };
+
+    struct Instruction
+    {
+        Op op;
+        int dst;   // register (varying code) or slot (uniform code)
+        Operand a;
+        Operand b; // binary ops only
+    };
+
+    struct Program
+    {
+        std::vector<Instruction> uniformCode; // scalar, once per evaluate()
+        std::vector<Instruction> code;        // per batch of motors
+        std::vector<double> slotValues;       // constants, variables, uniforms
+        std::vector<std::string> parameters;
+        std::vector<int> parameterSlots;
+        Operand result;
+        int registers = 0;
+    };
+
+    // Parses source; on failure returns false and error() says where.
+    // parameters are extra variable names, all 0 until set.
+    bool compile(const std::string &source, const std::vector<std::string> &parameters = {});
+
+    // Compiles an expression preceded by parameter assignments, the form
+    // the UI's expression field and the wave journal use:
+    //
+    //   d=0.2; A*sin(2*pi*f*t + i*phi) * exp(-d*t)
+    //
+    // Each name=value declares a parameter and sets it. Error columns count
+    // from the start of definition; source() returns all of it.
+    bool compileDefinition(const std::string &definition);
+
+    bool isCompiled() const { return compiled; }
+    const std::string &source() const { return text; }
+    const std::string &error() const { return err; }
+
+    // Returns false if name was not a parameter at compile time.
+    bool setParameter(const std::string &name, double value);
+
+    // Positions of motors [first, last) at time t, as generateWavePositions
+    // does for the built-in shapes. Uses internal registers: one
+    // WaveExpression per thread (copies are independent).
+    void evaluate(const WaveParams &p, double t, int first, int last, double *out);
+
+    // Instruction listing, for checking what the compiler made of a shape.
+    std::string disassemble() const;
+
+    const Program &program() const { return prog; }
+
+private:
+    std::string text;
+    std::string err;
+    bool compiled = false;
+    Program prog;
+    std::vector<double> lanes; // prog.registers * kBatch
+};
+
+#endif // WAVEEXPRESSION_H
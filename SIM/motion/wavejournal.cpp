@@ -0,0 +1,204 @@
+#include "wavejournal.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const char *const kParamNames[] = {"waveFactor", "strokeLength", "amp", "step",
+                                   "basePhaseShift", "frequency", "shape"};
+constexpr int kParamCount = sizeof(kParamNames) / sizeof(kParamNames[0]);
+
+bool paramFromName(const std::string &name, WaveParam &param)
+{
+    for (int i = 0; i < kParamCount; ++i) {
+        if (name == kParamNames[i]) {
+            param = static_cast<WaveParam>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const char *waveParamName(WaveParam param)
+{
+    return kParamNames[static_cast<int>(param)];
+}
+
+void setWaveParam(WaveParams &params, WaveParam param, double value)
+{
+    switch (param) {
+    case WaveParam::WaveFactor: params.waveFactorValue = value; break;
+    case WaveParam::StrokeLength: params.strokeLengthValue = value; break;
+    case WaveParam::Amp: params.amp = value; break;
+    case WaveParam::Step: params.step = value; break;
+    case WaveParam::BasePhaseShift: params.basePhaseShift = value; break;
+    case WaveParam::Frequency: params.frequency = value; break;
+    case WaveParam::Shape: params.shape = static_cast<WaveShape>(static_cast<int>(value)); break;
+    }
+}
+
+std::uint64_t positionDigest(const double *pos, int count, std::uint64_t digest)
+{
+    for (int i = 0; i < count; ++i) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &pos[i], sizeof bits);
+        digest = (digest ^ bits) * 0x100000001b3ull;
+    }
+    return digest;
+}
+
+bool WaveJournal::load(const std::string &path, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    events.clear();
+    expressions.clear();
+    complete = false;
+    std::string line;
+    int version = 0;
+    bool haveParams = false;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream words(line);
+        std::string kind;
+        if (!(words >> kind))
+            continue;
+        const std::string where = path + ":" + std::to_string(lineNo) + ": ";
+        bool ok = true;
+        if (lineNo == 1) {
+            ok = kind == "wavejournal" && (words >> version) && version == 1;
+        } else if (kind == "params") {
+            int shape = 0;
+            ok = static_cast<bool>(words >> initial.numMotors >> initial.amp >> initial.step >> initial.basePhaseShift
+                                   >> initial.waveFactorValue >> initial.strokeLengthValue >> initial.frequency >> shape)
+                 && initial.numMotors > 0;
+            initial.shape = static_cast<WaveShape>(shape);
+            haveParams = true;
+        } else if (kind == "set") {
+            WaveEvent e;
+            std::string name;
+            ok = (words >> e.tick >> name >> e.value) && paramFromName(name, e.param)
+                 && (events.empty() || e.tick >= events.back().tick);
+            if (ok)
+                events.push_back(e);
+        } else if (kind == "expr") {
+            WaveExpressionEvent e;
+            ok = (words >> e.tick) && (expressions.empty() || e.tick >= expressions.back().tick);
+            if (ok) {
+                std::getline(words >> std::ws, e.definition);
+                expressions.push_back(e);
+            }
+        } else if (kind == "end") {
+            std::string hex;
+            ok = static_cast<bool>(words >> ticks >> hex);
+            if (ok) {
+                char *endp = nullptr;
+                digest = std::strtoull(hex.c_str(), &endp, 16);
+                ok = *endp == '\0';
+            }
+            complete = ok;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            error = where + (lineNo == 1 ? "not a wave journal" : "bad " + kind + " record");
+            return false;
+        }
+    }
+    if (version == 0 || !haveParams) {
+        error = path + ": missing header";
+        return false;
+    }
+    return true;
+}
+
+WaveRecorder::~WaveRecorder()
+{
+    close();
+}
+
+bool WaveRecorder::open(const std::string &path, const WaveParams &initial)
+{
+    close();
+    file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        err = "cannot create " + path;
+        return false;
+    }
+    ticks = 0;
+    digest = kDigestSeed;
+    std::fprintf(file, "wavejournal 1\nparams %d %.17g %.17g %.17g %.17g %.17g %.17g %d\n", initial.numMotors,
+                 initial.amp, initial.step, initial.basePhaseShift, initial.waveFactorValue,
+                 initial.strokeLengthValue, initial.frequency, static_cast<int>(initial.shape));
+    std::fflush(file);
+    return true;
+}
+
+void WaveRecorder::record(long tick, WaveParam param, double value)
+{
+    if (!file)
+        return;
+    std::fprintf(file, "set %ld %s %.17g\n", tick, waveParamName(param), value);
+    std::fflush(file);
+}
+
+void WaveRecorder::recordExpression(long tick, const std::string &definition)
+{
+    if (!file)
+        return;
+    if (definition.find('\n') != std::string::npos) {
+        err = "expression definition spans lines";
+        return;
+    }
+    std::fprintf(file, "expr %ld %s\n", tick, definition.c_str());
+    std::fflush(file);
+}
+
+bool WaveRecorder::close()
+{
+    if (!file)
+        return true;
+    std::fprintf(file, "end %ld %016" PRIx64 "\n", ticks, digest);
+    const bool ok = std::fclose(file) == 0;
+    file = nullptr;
+    if (!ok)
+        err = "write failed";
+    return ok;
+}
+
+WaveReplay::WaveReplay(const WaveJournal &journal)
+    : journal(journal), wave(journal.initial)
+{
+}
+
+const std::vector<double> &WaveReplay::tick()
+{
+    const long now = wave.tickCount();
+    while (nextEvent < journal.events.size() && journal.events[nextEvent].tick <= now) {
+        const WaveEvent &e = journal.events[nextEvent++];
+        setWaveParam(wave.params(), e.param, e.value);
+    }
+    while (nextExpression < journal.expressions.size() && journal.expressions[nextExpression].tick <= now) {
+        const std::string &definition = journal.expressions[nextExpression++].definition;
+        if (definition.empty()) {
+            expression = WaveExpression();
+        } else if (!expression.compileDefinition(definition) && err.empty()) {
+            err = "tick " + std::to_string(now) + ": " + expression.error();
+        }
+    }
+    if (!expression.isCompiled())
+        return wave.tick();
+
+    const int n = wave.params().numMotors;
+    frame.resize(n);
+    expression.evaluate(wave.params(), wave.time(), 0, n, frame.data());
+    wave.skip();
+    return frame;
+}
@@ -0,0 +1,142 @@
+#ifndef WAVEJOURNAL_H
+#define WAVEJOURNAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "waveexpression.h"
+#include "wavekernel.h"
+
+// Journal of wave parameter changes, for reproducing a UI session.
+//
+// Every change is stamped with the simulation tick it takes effect at (the
+// number of frames computed before it), not with wall-clock time, so a
+// replay through WaveGenerator gives the same position stream bit for bit
+// however fast it runs. The file is text, one record per line, with values
+// written to 17 significant digits so they read back exactly:
+//
+//   wavejournal 1
+//   params <numMotors> <amp> <step> <basePhaseShift> <waveFactor> <strokeLength> <frequency> <shape>
+//   set <tick> <parameter> <value>        (any number)
+//   expr <tick> <definition>              (any number; to the end of the line)
+//   end <ticks> <digest>                  (optional; digest in hex)
+//
+// An expr record switches the shape to a WaveExpression definition (see
+// WaveExpression::compileDefinition(), parameters included) from its tick
+// on; one with an empty definition goes back to the built-in shape.
+// The end record holds the frame count and positionDigest() of every frame
+// the recorder saw, so a replay can prove it matched.
+
+enum class WaveParam
+{
+    WaveFactor,
+    StrokeLength,
+    Amp,
+    Step,
+    BasePhaseShift,
+    Frequency,
+    Shape
+};
+
+const char *waveParamName(WaveParam param);
+
+// Sets one parameter; Shape takes the enum value as a number.
+void setWaveParam(WaveParams &params, WaveParam param, double value);
+
+struct WaveEvent
+{
+    long tick;
+    WaveParam param;
+    double value;
+};
+
+struct WaveExpressionEvent
+{
+    long tick;
+    std::string definition; // empty: the built-in shape
+};
+
+struct WaveJournal
+{
+    WaveParams initial;
+    std::vector<WaveEvent> events; // in tick order
+    std::vector<WaveExpressionEvent> expressions; // in tick order
+    bool complete = false;         // end record present
+    long ticks = 0;
+    std::uint64_t digest = 0;
+
+    bool load(const std::string &path, std::string &error);
+};
+
+// Running digest of a position stream: every value's bit pattern folded in
+// with 64-bit FNV-1a steps. Start from kDigestSeed.
+constexpr std::uint64_t kDigestSeed = 0xcbf29ce484222325ull;
+std::uint64_t positionDigest(const double *pos, int count, std::uint64_t digest);
+
+// Writes a journal as the session runs. Each record is flushed, so the
+// events survive a crash of the recording program.
+class WaveRecorder
+{
+public:
+    WaveRecorder() = default;
+    ~WaveRecorder();
+
+    WaveRecorder(const WaveRecorder &) = delete;
+    WaveRecorder &operator=(const WaveRecorder &) = delete;
+
+    bool open(const std::string &path, const WaveParams &initial);
+    bool isOpen() const { return file != nullptr; }
+
+    // Records a change that applies from frame `tick` on.
+    void record(long tick, WaveParam param, double value);
+
+    // Records a switch to an expression definition (empty for the built-in
+    // shape) from frame `tick` on. Definitions are single lines.
+    void recordExpression(long tick, const std::string &definition);
+
+    // Folds a computed frame into the digest; call once per tick.
+    void frame(const double *pos, int count) { digest = positionDigest(pos, count, digest); ++ticks; }
+
+    // Writes the end record and closes the file.
+    bool close();
+
+    const std::string &error() const { return err; }
+
+private:
+    std::FILE *file = nullptr;
+    long ticks = 0;
+    std::uint64_t digest = kDigestSeed;
+    std::string err;
+};
+
+// Headless replay: applies the journal's events to a WaveGenerator at their
+// ticks and hands every frame to the caller. Frames under an expression are
+// evaluated by a WaveExpression at the generator's time, as the UI does.
+class WaveReplay
+{
+public:
+    explicit WaveReplay(const WaveJournal &journal);
+
+    // Computes the next frame; valid until the next call.
+    const std::vector<double> &tick();
+
+    long tickCount() const { return wave.tickCount(); }
+    const WaveParams &params() const { return wave.params(); }
+
+    // Set when an expr record does not compile; its frames use the
+    // built-in shape, so the digest will not match.
+    const std::string &error() const { return err; }
+
+private:
+    const WaveJournal &journal;
+    WaveGenerator wave;
+    WaveExpression expression;
+    std::vector<double> frame; // expression frames
+    std::size_t nextEvent = 0;
+    std::size_t nextExpression = 0;
+    std::string err;
+};
+
+#endif // WAVEJOURNAL_H
@@ -0,0 +1,43 @@
+#include "wavekernel.h"
+
+void generateWavePositions(const WaveParams &p, double t, int first, int last, double *out)
+{
+    // Same phase expression as the original UI code; with amp = 1 (as both
+    // windows use) results are bit-identical to what the chart used to show.
+    const double currentPhaseShift = p.basePhaseShift * p.waveFactorValue;
+    const double scale = p.strokeLengthValue * p.amp;
+    const double base = 2 * M_PI * p.frequency * t;
+    if (p.shape == WaveShape::Sine) {
+        for (int i = first; i < last; ++i)
+            out[i - first] = scale * sin(base + i * currentPhaseShift);
+        return;
+    }
+    for (int i = first; i < last; ++i)
+        out[i - first] = scale * waveShapeValue(p.shape, base + i * currentPhaseShift);
+}
+
+WaveGenerator::WaveGenerator(const WaveParams &params)
+    : p(params)
+{
+}
+
+const std::vector<double> &WaveGenerator::tick()
+{
+    frame.resize(p.numMotors);
+    generateWavePositions(p, t, frame.data());
+    t += p.step;
+    ++ticks;
+    return frame;
+}
+
+void WaveGenerator::skip()
+{
+    t += p.step;
+    ++ticks;
+}
+
+void WaveGenerator::reset(double time)
+{
+    t = time;
+    ticks = 0;
+}
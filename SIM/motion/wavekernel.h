@@ -0,0 +1,83 @@
+#ifndef WAVEKERNEL_H
+#define WAVEKERNEL_H
+
+#include <cmath>
+#include <vector>
+
+// Headless core of WaveControlWindow: the travelling sine wave that drives
+// the motor bars, with no Qt dependency so it can be benchmarked, profiled
+// and reused by controller code.
+
+// Shape of the travelling wave. Sine is what the windows have always shown.
+enum class WaveShape
+{
+    Sine,
+    Triangle
+};
+
+// Shape value for a phase in radians, in [-1, 1]; Triangle matches Sine at
+// its peaks and zero crossings.
+inline double waveShapeValue(WaveShape shape, double phase)
+{
+    if (shape == WaveShape::Triangle) {
+        const double u = phase / (2 * M_PI) + 0.25;
+        return 1.0 - 4.0 * std::fabs(u - std::floor(u) - 0.5);
+    }
+    return sin(phase);
+}
+
+// Wave control variables, same meaning and defaults as in WaveControlWindow.
+struct WaveParams
+{
+    int numMotors = 12;                // Number of bars/motors
+    double amp = 1.0;                  // Amplitude of the wave
+    double step = 0.05;                // Time step per timer tick
+    double basePhaseShift = M_PI / 6;  // Phase shift between motors
+    double waveFactorValue = 0.0;      // Multiplier on the phase shift (0..1)
+    double strokeLengthValue = 1.0;    // Multiplier for bar height
+    double frequency = 0.5;            // Wave frequency in cycles per time unit
+    WaveShape shape = WaveShape::Sine; // Wave shape
+};
+
+// Position of motors [first, last) at time t:
+//   out[i - first] = strokeLength * amp * shape(2*pi*f*t + i * basePhaseShift * waveFactor)
+void generateWavePositions(const WaveParams &p, double t, int first, int last, double *out);
+
+// All motors at time t; out must hold p.numMotors values.
+inline void generateWavePositions(const WaveParams &p, double t, double *out)
+{
+    generateWavePositions(p, t, 0, p.numMotors, out);
+}
+
+// Timer-driven generator: each tick() evaluates the wave at the current
+// time and then advances t by step, exactly like WaveControlWindow::updateWave.
+class WaveGenerator
+{
+public:
+    explicit WaveGenerator(const WaveParams &params = WaveParams());
+
+    // Parameters may be changed between ticks (slider moves).
+    WaveParams &params() { return p; }
+    const WaveParams &params() const { return p; }
+
+    // Computes the next frame and returns it (valid until the next tick).
+    const std::vector<double> &tick();
+
+    // Advances time by one frame without computing it, for frames whose
+    // positions come from elsewhere (a WaveExpression).
+    void skip();
+
+    const std::vector<double> &positions() const { return frame; }
+    double time() const { return t; }
+    long tickCount() const { return ticks; }
+
+    void reset(double time = 0.0);
+
+private:
+    WaveParams p;
+    std::vector<double> frame;
+    double t = 0.0;
+    long ticks = 0;
+};
+
+#endif // WAVEKERNEL_H
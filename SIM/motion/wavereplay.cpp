@@ -0,0 +1,235 @@
+// Headless replay of a recorded wave session (see wavejournal.h).
+//
+//   wavereplay JOURNAL [--ticks T] [--reps R] [--dump FILE] [--compare FILE]
+//   wavereplay --synth JOURNAL [--motors N] [--ticks T] [--expr DEFINITION]
+//
+// Replays the journal's parameter changes at their ticks, as fast as the
+// kernel runs, and prints the position digest and the frame time (best of
+// R runs). If the journal has an end record the digest must match it, so a
+// build that changes the position stream in any bit fails with exit code 1.
+// --dump writes the frames as raw doubles; --compare checks them against an
+// earlier dump and reports the first differing frame and motor.
+//
+// --synth records a journal without the UI: slider moves in the pattern of
+// wave_workload, fed through WaveRecorder exactly as WaveControlWindow does.
+// With --expr the session runs the expression definition (as typed into
+// the UI, e.g. "d=0.2; A*sin(2*pi*f*t + i*phi) * exp(-d*t)") over its
+// middle third.
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "wavejournal.h"
+
+namespace {
+
+int synthesize(const char *path, int motors, long ticks, const char *definition)
+{
+    WaveParams params;
+    params.numMotors = motors;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    WaveGenerator wave(params);
+    WaveRecorder recorder;
+    if (!recorder.open(path, params)) {
+        std::fprintf(stderr, "%s\n", recorder.error().c_str());
+        return 1;
+    }
+    WaveExpression expression;
+    std::vector<double> frame(motors);
+    for (long tick = 0; tick < ticks; ++tick) {
+        if (definition && tick == ticks / 3) {
+            if (!expression.compileDefinition(definition)) {
+                std::fprintf(stderr, "%s\n", expression.error().c_str());
+                return 1;
+            }
+            recorder.recordExpression(tick, definition);
+        }
+        if (definition && tick == 2 * ticks / 3) {
+            expression = WaveExpression();
+            recorder.recordExpression(tick, "");
+        }
+        if (tick % 997 == 0) {
+            const int value = tick / 997 % 101;
+            wave.params().waveFactorValue = value / 100.0;
+            recorder.record(tick, WaveParam::WaveFactor, wave.params().waveFactorValue);
+        }
+        if (tick % 1499 == 0) {
+            wave.params().strokeLengthValue = 1 + tick / 1499 % 30;
+            recorder.record(tick, WaveParam::StrokeLength, wave.params().strokeLengthValue);
+        }
+        if (expression.isCompiled()) {
+            expression.evaluate(wave.params(), wave.time(), 0, motors, frame.data());
+            wave.skip();
+            recorder.frame(frame.data(), motors);
+        } else {
+            const std::vector<double> &pos = wave.tick();
+            recorder.frame(pos.data(), motors);
+        }
+    }
+    if (!recorder.close()) {
+        std::fprintf(stderr, "%s: %s\n", path, recorder.error().c_str());
+        return 1;
+    }
+    std::printf("wrote %s: %ld ticks, %d motors\n", path, ticks, motors);
+    return 0;
+}
+
+// One full replay; frames go to dump (if open) and are checked against
+// reference (if open). Returns the digest.
+std::uint64_t replayOnce(const WaveJournal &journal, long ticks, std::FILE *dump, std::FILE *reference,
+                         long &firstDiffTick, int &firstDiffMotor, std::string &error)
+{
+    WaveReplay replay(journal);
+    std::uint64_t digest = kDigestSeed;
+    std::vector<double> expected;
+    for (long t = 0; t < ticks; ++t) {
+        const std::vector<double> &pos = replay.tick();
+        const int n = static_cast<int>(pos.size());
+        digest = positionDigest(pos.data(), n, digest);
+        if (dump)
+            std::fwrite(pos.data(), sizeof(double), n, dump);
+        if (reference && firstDiffTick < 0) {
+            expected.resize(n);
+            if (std::fread(expected.data(), sizeof(double), n, reference) != static_cast<std::size_t>(n)) {
+                firstDiffTick = t;
+                firstDiffMotor = -1;
+                continue;
+            }
+            for (int i = 0; i < n; ++i) {
+                if (std::memcmp(&expected[i], &pos[i], sizeof(double)) != 0) {
+                    firstDiffTick = t;
+                    firstDiffMotor = i;
+                    break;
+                }
+            }
+        }
+    }
+    error = replay.error();
+    return digest;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const char *journalPath = nullptr;
+    const char *synthPath = nullptr;
+    const char *dumpPath = nullptr;
+    const char *comparePath = nullptr;
+    const char *definition = nullptr;
+    long ticks = -1;
+    int reps = 3;
+    int motors = 50;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            ticks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc)
+            reps = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            motors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--dump") && i + 1 < argc)
+            dumpPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--compare") && i + 1 < argc)
+            comparePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--synth") && i + 1 < argc)
+            synthPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--expr") && i + 1 < argc)
+            definition = argv[++i];
+        else if (argv[i][0] != '-' && !journalPath)
+            journalPath = argv[i];
+        else
+            usage = true;
+    }
+    if (synthPath && !usage)
+        return synthesize(synthPath, motors, ticks < 0 ? 200000 : ticks, definition);
+    if (!journalPath || usage) {
+        std::fprintf(stderr,
+                     "usage: %s JOURNAL [--ticks T] [--reps R] [--dump FILE] [--compare FILE]\n"
+                     "       %s --synth JOURNAL [--motors N] [--ticks T] [--expr DEFINITION]\n",
+                     argv[0], argv[0]);
+        return 2;
+    }
+
+    WaveJournal journal;
+    std::string error;
+    if (!journal.load(journalPath, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (ticks < 0) {
+        if (!journal.complete) {
+            std::fprintf(stderr, "%s: no end record, give --ticks\n", journalPath);
+            return 1;
+        }
+        ticks = journal.ticks;
+    }
+
+    // Timed runs first, without file I/O.
+    std::uint64_t digest = 0;
+    double best = 1e300;
+    long noDiffTick = -1;
+    int noDiffMotor = -1;
+    std::string replayError;
+    for (int rep = 0; rep < reps; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        digest = replayOnce(journal, ticks, nullptr, nullptr, noDiffTick, noDiffMotor, replayError);
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    std::printf("%s: %zu events, %zu expressions, %ld ticks, %d motors at start\n", journalPath,
+                journal.events.size(), journal.expressions.size(), ticks, journal.initial.numMotors);
+    if (!replayError.empty())
+        std::fprintf(stderr, "%s: %s\n", journalPath, replayError.c_str());
+    std::printf("digest %016" PRIx64 "  %.1f ns/frame  %.0f frames/s\n", digest, best / ticks * 1e9, ticks / best);
+
+    bool ok = replayError.empty();
+    if (journal.complete && ticks == journal.ticks) {
+        const bool match = digest == journal.digest;
+        std::printf("recorded digest %016" PRIx64 ": %s\n", journal.digest, match ? "match" : "MISMATCH");
+        ok = ok && match;
+    }
+
+    if (dumpPath || comparePath) {
+        std::FILE *dump = dumpPath ? std::fopen(dumpPath, "wb") : nullptr;
+        std::FILE *reference = comparePath ? std::fopen(comparePath, "rb") : nullptr;
+        if ((dumpPath && !dump) || (comparePath && !reference)) {
+            std::fprintf(stderr, "cannot open %s\n", dumpPath && !dump ? dumpPath : comparePath);
+            if (dump)
+                std::fclose(dump);
+            if (reference)
+                std::fclose(reference);
+            return 1;
+        }
+        long diffTick = -1;
+        int diffMotor = -1;
+        replayOnce(journal, ticks, dump, reference, diffTick, diffMotor, replayError);
+        if (dump && std::fclose(dump) != 0) {
+            std::fprintf(stderr, "%s: write failed\n", dumpPath);
+            ok = false;
+        }
+        if (reference) {
+            if (diffTick < 0 && std::fgetc(reference) != EOF) {
+                diffTick = ticks;
+                diffMotor = -1;
+            }
+            std::fclose(reference);
+            if (diffTick < 0) {
+                std::printf("%s: identical\n", comparePath);
+            } else if (diffMotor < 0) {
+                std::printf("%s: length differs at tick %ld\n", comparePath, diffTick);
+                ok = false;
+            } else {
+                std::printf("%s: first difference at tick %ld, motor %d\n", comparePath, diffTick, diffMotor);
+                ok = false;
+            }
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Spectral resonance analysis of a wave program (see resonance.h).
+//
+//   waveresonance [JOURNAL] [--motors N] [--factor F] [--stroke S] [--seconds S]
+//                 [--tick-ms MS] [--rate HZ] [--fft N] [--velocity] [--flag F]
+//                 [--band NAME:LO:HI]... [--shaper zv|zvd|notch] [--freq HZ]
+//                 [--damping Z] [--q Q] [--psd FILE.csv]
+//
+// Resamples the program (a recorded session, or fixed slider settings as
+// in waveenvelope) to --rate, optionally shapes it, and prints for every
+// resonance band how many axes have more than --flag of their acceleration
+// (--velocity: velocity) energy in it, with the worst axis and its peak.
+// --band replaces the default bands (give it once per band). --psd writes
+// the axis-averaged spectrum as hz,psd lines. Exit code 1 if a band is
+// flagged.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "resonance.h"
+
+namespace {
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [JOURNAL] [--motors N] [--factor F] [--stroke S] [--seconds S]\n"
+                 "          [--tick-ms MS] [--rate HZ] [--fft N] [--velocity] [--flag F]\n"
+                 "          [--band NAME:LO:HI]... [--shaper zv|zvd|notch] [--freq HZ]\n"
+                 "          [--damping Z] [--q Q] [--psd FILE.csv]\n",
+                 argv0);
+}
+
+bool parseBand(const char *text, ResonanceBand &band)
+{
+    const char *a = std::strchr(text, ':');
+    const char *b = a ? std::strchr(a + 1, ':') : nullptr;
+    if (!a || !b)
+        return false;
+    band.name.assign(text, a);
+    band.lowHz = std::atof(a + 1);
+    band.highHz = std::atof(b + 1);
+    return !band.name.empty() && band.lowHz >= 0 && band.highHz > band.lowHz;
+}
+
+bool parseShaper(const char *text, ShaperType &type)
+{
+    for (ShaperType t : {ShaperType::ZV, ShaperType::ZVD, ShaperType::Notch}) {
+        if (!std::strcmp(text, shaperTypeName(t))) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+void printReport(const char *title, const ResonanceReport &r, const ResonanceOptions &options, double seconds)
+{
+    std::printf("%s: %zu axes, %ld samples at %.0f Hz, %ld segments, %.3f Hz bins, analyzed in %.2f s\n", title,
+                r.axes.size(), r.samples, options.sampleRate, r.segments, r.binHz, seconds);
+    if (options.shaper.type != ShaperType::None)
+        std::printf("  shaper %s at %.2f Hz\n", shaperTypeName(options.shaper.type), options.shaper.frequency);
+    const char *unit = options.signal == ResonanceSignal::Acceleration ? "mm/s^2" : "mm/s";
+    for (std::size_t b = 0; b < options.bands.size(); ++b) {
+        int worst = -1;
+        for (std::size_t a = 0; a < r.axes.size(); ++a)
+            if (worst < 0 || r.axes[a].bands[b].fraction > r.axes[worst].bands[b].fraction)
+                worst = static_cast<int>(a);
+        const ResonanceBand &band = options.bands[b];
+        std::printf("  %-10s %6.1f .. %-6.1f Hz  %3d axes flagged", band.name.c_str(), band.lowHz, band.highHz,
+                    r.axesFlagged[b]);
+        if (worst >= 0) {
+            const BandEnergy &e = r.axes[worst].bands[b];
+            std::printf("  worst motor %d: %5.1f%% of energy, %.4g %s rms, peak %.2f Hz", worst, 100.0 * e.fraction,
+                        e.rms, unit, e.peakHz);
+        }
+        std::printf("\n");
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const char *journalPath = nullptr;
+    const char *psdPath = nullptr;
+    WaveParams params;
+    params.numMotors = 50;
+    params.waveFactorValue = 1.0;
+    params.strokeLengthValue = 5;
+    ResonanceOptions options;
+    double seconds = -1.0;
+    bool ownBands = false;
+    bool bad = false;
+    for (int i = 1; i < argc && !bad; ++i) {
+        if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            params.numMotors = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--factor") && i + 1 < argc)
+            params.waveFactorValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--stroke") && i + 1 < argc)
+            params.strokeLengthValue = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc)
+            seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--tick-ms") && i + 1 < argc)
+            options.tickSeconds = std::atof(argv[++i]) / 1000.0;
+        else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc)
+            options.sampleRate = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--fft") && i + 1 < argc)
+            options.fftSize = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--velocity"))
+            options.signal = ResonanceSignal::Velocity;
+        else if (!std::strcmp(argv[i], "--flag") && i + 1 < argc)
+            options.flagFraction = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--band") && i + 1 < argc) {
+            ResonanceBand band;
+            if (!ownBands)
+                options.bands.clear();
+            ownBands = true;
+            bad = !parseBand(argv[++i], band);
+            options.bands.push_back(band);
+        } else if (!std::strcmp(argv[i], "--shaper") && i + 1 < argc)
+            bad = !parseShaper(argv[++i], options.shaper.type);
+        else if (!std::strcmp(argv[i], "--freq") && i + 1 < argc)
+            options.shaper.frequency = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--damping") && i + 1 < argc)
+            options.shaper.damping = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--q") && i + 1 < argc)
+            options.shaper.notchQ = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--psd") && i + 1 < argc)
+            psdPath = argv[++i];
+        else if (argv[i][0] != '-' && !journalPath)
+            journalPath = argv[i];
+        else
+            bad = true;
+    }
+    if (bad || params.numMotors <= 0 || options.tickSeconds <= 0 || options.sampleRate <= 0
+        || !isFftSize(options.fftSize)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    WaveJournal journal;
+    long ticks = seconds > 0 ? static_cast<long>(seconds / options.tickSeconds) + 1 : -1;
+    if (journalPath) {
+        std::string error;
+        if (!journal.load(journalPath, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (ticks < 0 && !journal.complete) {
+            std::fprintf(stderr, "%s: no end record, give --seconds\n", journalPath);
+            return 1;
+        }
+    } else {
+        journal.initial = params;
+        if (ticks < 0) // default: ten minutes
+            ticks = static_cast<long>(600.0 / options.tickSeconds) + 1;
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const ResonanceReport report = analyzeWave(journal, options, ticks);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (report.segments == 0) {
+        std::fprintf(stderr, "program shorter than one %d-sample segment, give a smaller --fft\n",
+                     options.fftSize);
+        return 1;
+    }
+    printReport(journalPath ? journalPath : "wave", report, options, elapsed);
+
+    if (psdPath) {
+        FILE *f = std::fopen(psdPath, "w");
+        if (!f) {
+            std::fprintf(stderr, "%s: cannot write\n", psdPath);
+            return 1;
+        }
+        std::fprintf(f, "hz,psd\n");
+        for (std::size_t k = 0; k < report.psd.size(); ++k)
+            std::fprintf(f, "%.4f,%.6g\n", k * report.binHz, report.psd[k]);
+        std::fclose(f);
+    }
+    return report.flagged() ? 1 : 0;
+}
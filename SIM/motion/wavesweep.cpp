@@ -0,0 +1,163 @@
+// Batch sweep of the wave sliders (see parametersweep.h).
+//
+//   wavesweep [--factor FIRST:LAST:COUNT] [--stroke FIRST:LAST:COUNT] [--step FIRST:LAST:COUNT]
+//             [--motors N,N,...] [--ticks T] [--freq F] [--triangle] [--min MM] [--max MM]
+//             [--delta MM] [--vmax MM/S] [--amax MM/S2] [--tick-ms MS]
+//             [--rank smoothness|velocity|acceleration|neighbour|stroke] [--top N]
+//             [--csv FILE] [--threads N]
+//
+// Runs every combination of the grid headless (defaults: the UI slider
+// ranges, steps 0.02..0.1 and 12, 24 and 50 motors, about 9500
+// combinations), prints the best --top (default 10) and writes the whole
+// ranked table to --csv. Combinations within the limits (as in
+// waveenvelope, plus --amax) rank first.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "parametersweep.h"
+#include "workstealingpool.h"
+
+namespace {
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--factor FIRST:LAST:COUNT] [--stroke FIRST:LAST:COUNT] [--step FIRST:LAST:COUNT]\n"
+                 "          [--motors N,N,...] [--ticks T] [--freq F] [--triangle] [--min MM] [--max MM]\n"
+                 "          [--delta MM] [--vmax MM/S] [--amax MM/S2] [--tick-ms MS]\n"
+                 "          [--rank smoothness|velocity|acceleration|neighbour|stroke] [--top N]\n"
+                 "          [--csv FILE] [--threads N]\n",
+                 argv0);
+}
+
+bool parseRange(const char *text, SweepRange &range)
+{
+    char *end;
+    range.first = std::strtod(text, &end);
+    if (*end != ':')
+        return false;
+    range.last = std::strtod(end + 1, &end);
+    if (*end != ':')
+        return false;
+    range.count = std::atoi(end + 1);
+    return range.count >= 1;
+}
+
+bool parseCounts(const char *text, std::vector<int> &counts)
+{
+    counts.clear();
+    for (const char *p = text; *p;) {
+        char *end;
+        const long n = std::strtol(p, &end, 10);
+        if (end == p || n < 1)
+            return false;
+        counts.push_back(static_cast<int>(n));
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return false;
+    }
+    return !counts.empty();
+}
+
+bool parseRank(const char *name, SweepRank &rank)
+{
+    for (SweepRank r : {SweepRank::Smoothness, SweepRank::Velocity, SweepRank::Acceleration, SweepRank::Neighbour,
+                        SweepRank::Stroke})
+        if (!std::strcmp(name, sweepRankName(r))) {
+            rank = r;
+            return true;
+        }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    SweepGrid grid;
+    SweepOptions options;
+    int top = 10;
+    int threads = 0;
+    const char *csvPath = nullptr;
+    bool bad = false;
+    for (int i = 1; i < argc && !bad; ++i) {
+        if (!std::strcmp(argv[i], "--factor") && i + 1 < argc)
+            bad = !parseRange(argv[++i], grid.waveFactor);
+        else if (!std::strcmp(argv[i], "--stroke") && i + 1 < argc)
+            bad = !parseRange(argv[++i], grid.strokeLength);
+        else if (!std::strcmp(argv[i], "--step") && i + 1 < argc)
+            bad = !parseRange(argv[++i], grid.step);
+        else if (!std::strcmp(argv[i], "--motors") && i + 1 < argc)
+            bad = !parseCounts(argv[++i], grid.motorCounts);
+        else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            options.ticks = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--freq") && i + 1 < argc)
+            options.base.frequency = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--triangle"))
+            options.base.shape = WaveShape::Triangle;
+        else if (!std::strcmp(argv[i], "--min") && i + 1 < argc)
+            options.limits.minPosition = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--max") && i + 1 < argc)
+            options.limits.maxPosition = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--delta") && i + 1 < argc)
+            options.limits.maxNeighbourDelta = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--vmax") && i + 1 < argc)
+            options.limits.maxVelocity = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--amax") && i + 1 < argc)
+            options.maxAcceleration = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--tick-ms") && i + 1 < argc)
+            options.limits.tickSeconds = std::atof(argv[++i]) / 1000.0;
+        else if (!std::strcmp(argv[i], "--rank") && i + 1 < argc)
+            bad = !parseRank(argv[++i], options.rank);
+        else if (!std::strcmp(argv[i], "--top") && i + 1 < argc)
+            top = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--csv") && i + 1 < argc)
+            csvPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else
+            bad = true;
+    }
+    if (bad || options.ticks < 4 || options.limits.tickSeconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    WorkStealingPool pool(threads);
+    const SweepReport report = runWaveSweep(grid, options, &pool);
+    std::printf("%zu combinations (%ld simulated), %ld frames each: %.3f s, %d threads\n", report.results.size(),
+                report.simulations, options.ticks, report.seconds, pool.size());
+    std::printf("%ld within limits, ranked by %s\n", report.withinLimits, sweepRankName(options.rank));
+    std::printf("%6s %6s %7s %6s %9s %11s %12s %10s %12s\n", "factor", "stroke", "step", "motors", "peak mm",
+                "vel mm/s", "acc mm/s2", "nbr mm", "jerk rms");
+    for (int k = 0; k < top && k < static_cast<int>(report.results.size()); ++k) {
+        const SweepResult &r = report.results[k];
+        std::printf("%6.3f %6.2f %7.4f %6d %9.3f %11.3f %12.3f %10.3f %12.3f%s\n", r.waveFactor, r.strokeLength,
+                    r.step, r.motors, r.peakPosition, r.peakVelocity, r.peakAcceleration, r.peakNeighbour,
+                    r.rmsJerk, r.withinLimits ? "" : "  (over limits)");
+    }
+
+    if (csvPath) {
+        std::FILE *f = std::fopen(csvPath, "w");
+        if (!f) {
+            std::fprintf(stderr, "%s: cannot write\n", csvPath);
+            return 1;
+        }
+        std::fprintf(f, "rank,factor,stroke,step,motors,peak_mm,velocity_mm_s,acceleration_mm_s2,neighbour_mm,"
+                        "jerk_rms_mm_s3,within_limits\n");
+        for (std::size_t k = 0; k < report.results.size(); ++k) {
+            const SweepResult &r = report.results[k];
+            std::fprintf(f, "%zu,%.6g,%.6g,%.6g,%d,%.6g,%.6g,%.6g,%.6g,%.6g,%d\n", k + 1, r.waveFactor,
+                         r.strokeLength, r.step, r.motors, r.peakPosition, r.peakVelocity, r.peakAcceleration,
+                         r.peakNeighbour, r.rmsJerk, r.withinLimits ? 1 : 0);
+        }
+        if (std::fclose(f) != 0) {
+            std::fprintf(stderr, "%s: write failed\n", csvPath);
+            return 1;
+        }
+        std::printf("wrote %s\n", csvPath);
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "workstealingpool.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+void pinToCpu(std::thread::native_handle_type handle, int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    pthread_setaffinity_np(handle, sizeof(set), &set);
+#else
+    (void)handle;
+    (void)cpu;
+#endif
+}
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int numThreads, bool pinThreads)
+{
+    if (numThreads <= 0)
+        numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    if (numThreads <= 0)
+        numThreads = 1;
+
+    for (int w = 0; w < numThreads; ++w)
+        queues.push_back(std::make_unique<Queue>());
+
+    // Only the started threads are pinned. The caller, worker 0, is usually
+    // the application's main or UI thread and keeps its own affinity; CPU 0
+    // is left to it.
+    for (int w = 1; w < numThreads; ++w) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, w);
+        if (pinThreads)
+            pinToCpu(threads.back().native_handle(), w);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : threads)
+        t.join();
+}
+
+void WorkStealingPool::parallelFor(std::size_t numChunks, const std::function<void(std::size_t, int)> &fn)
+{
+    if (numChunks == 0)
+        return;
+    if (queues.size() == 1) {
+        for (std::size_t c = 0; c < numChunks; ++c)
+            fn(c, 0);
+        return;
+    }
+
+    for (std::size_t c = 0; c < numChunks; ++c)
+        queues[homeWorker(c, numChunks)]->chunks.push_back(c);
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        job = &fn;
+        remaining.store(numChunks, std::memory_order_relaxed);
+        activeWorkers = threads.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    // Wait for the chunks still running and for every worker to leave the
+    // job, so fn and the queues can be reused safely.
+    std::unique_lock<std::mutex> lock(stateMutex);
+    done.wait(lock, [this] { return activeWorkers == 0; });
+    job = nullptr;
+}
+
+void WorkStealingPool::workerLoop(int worker)
+{
+    std::size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        runChunks(worker);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--activeWorkers == 0)
+            done.notify_one();
+    }
+}
+
+void WorkStealingPool::runChunks(int worker)
+{
+    std::size_t chunk;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!popLocal(worker, chunk) && !steal(worker, chunk))
+            break;
+        (*job)(chunk, worker);
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+bool WorkStealingPool::popLocal(int worker, std::size_t &chunk)
+{
+    Queue &q = *queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.chunks.empty())
+        return false;
+    chunk = q.chunks.front();
+    q.chunks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::steal(int worker, std::size_t &chunk)
+{
+    const int n = size();
+    for (int k = 1; k < n; ++k) {
+        Queue &victim = *queues[(worker + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.chunks.empty())
+            continue;
+        chunk = victim.chunks.back();
+        victim.chunks.pop_back();
+        steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
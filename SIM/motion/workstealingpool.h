@@ -0,0 +1,75 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool with per-worker chunk queues and work stealing.
+//
+// parallelFor() hands every worker a contiguous run of chunk indices, so a
+// given chunk lands on the same worker each call as long as nobody steals
+// it. Buffers first touched through the pool are therefore placed in the
+// memory of the node that keeps computing them (Linux first-touch policy);
+// with pinning enabled the started workers also stay on CPUs 1..n-1, while
+// the calling thread keeps its own affinity. A worker whose queue runs dry
+// steals from the back of the other queues.
+class WorkStealingPool
+{
+public:
+    // numThreads <= 0 uses std::thread::hardware_concurrency(). The calling
+    // thread takes part as worker 0, so numThreads - 1 threads are started.
+    explicit WorkStealingPool(int numThreads = 0, bool pinThreads = false);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int size() const { return static_cast<int>(queues.size()); }
+
+    // Runs fn(chunk, worker) for every chunk in [0, numChunks) and returns
+    // when all have finished. Not reentrant.
+    void parallelFor(std::size_t numChunks, const std::function<void(std::size_t, int)> &fn);
+
+    // Worker that owns chunk c before any stealing.
+    int homeWorker(std::size_t chunk, std::size_t numChunks) const
+    {
+        return static_cast<int>(chunk * queues.size() / numChunks);
+    }
+
+    // Chunks taken from another worker's queue since construction.
+    std::size_t stealCount() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> chunks;
+    };
+
+    void workerLoop(int worker);
+    void runChunks(int worker);
+    bool popLocal(int worker, std::size_t &chunk);
+    bool steal(int worker, std::size_t &chunk);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(std::size_t, int)> *job = nullptr;
+    std::size_t generation = 0;
+    std::atomic<std::size_t> remaining{0};
+    std::size_t activeWorkers = 0;
+    bool stopping = false;
+    std::atomic<std::size_t> steals{0};
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -0,0 +1,91 @@
+# Shared build options for every module.
+#
+#   CNC_NATIVE    -march=native (off by default: binaries stay portable)
+#   CNC_LTO       link-time optimization via CMAKE_INTERPROCEDURAL_OPTIMIZATION
+#   CNC_PGO       profile-guided optimization stage: OFF, GENERATE or USE
+#   CNC_PGO_DIR   where .gcda / .profraw profiles are written and read
+#   CNC_SANITIZE  semicolon list passed to -fsanitize= (e.g. address;undefined)
+#
+# Options are applied directory-wide before the modules are added, so the
+# module CMakeLists.txt files stay usable on their own.
+
+option(CNC_NATIVE "Tune for the build machine (-march=native)" OFF)
+option(CNC_LTO "Enable link-time optimization" OFF)
+set(CNC_PGO OFF CACHE STRING "Profile-guided optimization stage")
+set_property(CACHE CNC_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(CNC_PGO_DIR "${CMAKE_BINARY_DIR}/pgo-profile" CACHE PATH "Profile data directory")
+set(CNC_SANITIZE "" CACHE STRING "Sanitizers to enable (address;undefined, thread, ...)")
+
+if(CNC_NATIVE)
+    add_compile_options(-march=native)
+endif()
+
+if(CNC_LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT cncIpoSupported OUTPUT cncIpoOutput LANGUAGES CXX)
+    if(cncIpoSupported)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+    else()
+        message(WARNING "CNC_LTO requested but not supported: ${cncIpoOutput}")
+    endif()
+endif()
+
+if(CNC_PGO STREQUAL "GENERATE")
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        add_compile_options(-fprofile-instr-generate=${CNC_PGO_DIR}/%p.profraw)
+        add_link_options(-fprofile-instr-generate)
+    else()
+        add_compile_options(-fprofile-generate -fprofile-update=atomic -fprofile-dir=${CNC_PGO_DIR})
+        add_link_options(-fprofile-generate)
+    endif()
+elseif(CNC_PGO STREQUAL "USE")
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        add_compile_options(-fprofile-instr-use=${CNC_PGO_DIR}/merged.profdata -Wno-profile-instr-unprofiled)
+    else()
+        add_compile_options(-fprofile-use -fprofile-partial-training -fprofile-correction
+                            -fprofile-dir=${CNC_PGO_DIR} -Wno-missing-profile)
+    endif()
+elseif(CNC_PGO)
+    message(FATAL_ERROR "CNC_PGO must be OFF, GENERATE or USE (got '${CNC_PGO}')")
+endif()
+
+if(CNC_SANITIZE)
+    string(REPLACE ";" "," cncSanitizers "${CNC_SANITIZE}")
+    add_compile_options(-fsanitize=${cncSanitizers} -fno-omit-frame-pointer -g)
+    add_link_options(-fsanitize=${cncSanitizers})
+endif()
+
+# === Benchmarks ===
+# `bench` runs every registered benchmark; `run_<target>` runs just one.
+add_custom_target(bench)
+
+# cnc_add_bench(<target> [args...])
+function(cnc_add_bench target)
+    add_custom_target(run_${target}
+        COMMAND $<TARGET_FILE:${target}> ${ARGN}
+        DEPENDS ${target}
+        WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+        USES_TERMINAL
+    )
+    add_dependencies(bench run_${target})
+endfunction()
+
+# === Tests ===
+# The self-checking benchmarks print ok / FAIL and exit non-zero on a
+# failed check; cnc_add_test registers one with ctest, with arguments
+# small enough for the whole suite to run in seconds.
+enable_testing()
+
+# cnc_add_test(<target> [args...])
+function(cnc_add_test target)
+    add_test(NAME ${target} COMMAND $<TARGET_FILE:${target}> ${ARGN}
+             WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+endfunction()
+
+function(cnc_print_summary)
+    message(STATUS "Build type:   ${CMAKE_BUILD_TYPE}")
+    message(STATUS "Native:       ${CNC_NATIVE}")
+    message(STATUS "LTO:          ${CNC_LTO}")
+    message(STATUS "PGO:          ${CNC_PGO}")
+    message(STATUS "Sanitizers:   ${CNC_SANITIZE}")
+endfunction()
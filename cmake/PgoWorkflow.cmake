@@ -0,0 +1,104 @@
+# Two-stage profile-guided build of the motion hot path.
+#
+#   cmake -DCNC_SOURCE_DIR=<repo> -DCNC_WORK_DIR=<dir> -P PgoWorkflow.cmake
+#
+# 1. baseline:  Release + LTO
+# 2. train:     Release + -fprofile-generate, run wave_workload --train
+# 3. optimized: same build tree reconfigured with the profile + LTO
+#               (GCC names .gcda files after the object path, so stages 2
+#               and 3 must share a binary directory)
+# 4. report:    both binaries benchmarked, results in pgo_report.txt
+#
+# With Clang, CMake's IPO switch gives ThinLTO and the raw profiles are
+# merged with llvm-profdata. With GCC, LTO is -flto=auto.
+
+if(NOT CNC_SOURCE_DIR OR NOT CNC_WORK_DIR)
+    message(FATAL_ERROR "CNC_SOURCE_DIR and CNC_WORK_DIR are required")
+endif()
+
+set(workload wave_workload)
+set(workloadPath SIM/motion/${workload})
+set(benchArgs --motors 50 --ticks 400000 --reps 5)
+set(trainArgs --motors 50 --ticks 400000 --train)
+set(profileDir ${CNC_WORK_DIR}/profile)
+
+set(generatorArgs)
+if(CMAKE_GENERATOR)
+    list(APPEND generatorArgs -G ${CMAKE_GENERATOR})
+endif()
+if(CMAKE_CXX_COMPILER)
+    list(APPEND generatorArgs -DCMAKE_CXX_COMPILER=${CMAKE_CXX_COMPILER})
+endif()
+
+function(cnc_run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE rc)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "Command failed (${rc}): ${ARGN}")
+    endif()
+endfunction()
+
+function(cnc_configure_and_build dir)
+    cnc_run(${CMAKE_COMMAND} -S ${CNC_SOURCE_DIR} -B ${dir} ${generatorArgs}
+            -DCMAKE_BUILD_TYPE=Release -DCNC_PGO_DIR=${profileDir} ${ARGN})
+    cnc_run(${CMAKE_COMMAND} --build ${dir} --target ${workload} --parallel)
+endfunction()
+
+function(cnc_bench dir outVar)
+    execute_process(COMMAND ${dir}/${workloadPath} ${benchArgs}
+                    OUTPUT_VARIABLE out RESULT_VARIABLE rc)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "${workload} failed in ${dir}")
+    endif()
+    message(STATUS "${dir}:\n${out}")
+    string(REGEX MATCH "throughput: ([0-9.]+)" _ "${out}")
+    set(${outVar} ${CMAKE_MATCH_1} PARENT_SCOPE)
+endfunction()
+
+message(STATUS "[pgo] stage 0: baseline (Release + LTO)")
+cnc_configure_and_build(${CNC_WORK_DIR}/baseline -DCNC_PGO=OFF -DCNC_LTO=ON)
+
+message(STATUS "[pgo] stage 1: instrumented build + training run")
+file(REMOVE_RECURSE ${profileDir})
+file(MAKE_DIRECTORY ${profileDir})
+cnc_configure_and_build(${CNC_WORK_DIR}/pgo -DCNC_PGO=GENERATE -DCNC_LTO=OFF)
+cnc_run(${CNC_WORK_DIR}/pgo/${workloadPath} ${trainArgs})
+
+file(GLOB rawProfiles ${profileDir}/*.profraw)
+if(rawProfiles)
+    find_program(LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+    cnc_run(${LLVM_PROFDATA} merge -o ${profileDir}/merged.profdata ${rawProfiles})
+endif()
+
+message(STATUS "[pgo] stage 2: optimized build (profile + LTO)")
+cnc_configure_and_build(${CNC_WORK_DIR}/pgo -DCNC_PGO=USE -DCNC_LTO=ON)
+
+message(STATUS "[pgo] stage 3: report")
+cnc_bench(${CNC_WORK_DIR}/baseline baseline)
+cnc_bench(${CNC_WORK_DIR}/pgo optimized)
+if(NOT baseline OR NOT optimized)
+    message(FATAL_ERROR "could not read throughput from ${workload}")
+endif()
+# wave_workload prints three decimals; compare in thousandths (math() is integer only).
+string(REPLACE "." "" baselineMilli ${baseline})
+string(REPLACE "." "" optimizedMilli ${optimized})
+math(EXPR gainPermille "${optimizedMilli} * 1000 / ${baselineMilli} - 1000")
+math(EXPR gainWhole "${gainPermille} / 10")
+math(EXPR gainFrac "${gainPermille} % 10")
+if(gainFrac LESS 0)
+    math(EXPR gainFrac "-${gainFrac}")
+    if(gainWhole EQUAL 0)
+        set(gainWhole "-0")
+    endif()
+endif()
+set(speedupPct "${gainWhole}.${gainFrac}")
+
+string(TIMESTAMP now "%Y-%m-%d %H:%M:%S")
+string(JOIN " " benchArgsText ${benchArgs})
+set(report "PGO report (${now})
+workload:   ${workload} ${benchArgsText}
+baseline:   ${baseline} Msamples/s  (Release + LTO)
+pgo + lto:  ${optimized} Msamples/s
+speedup:    ${speedupPct} %
+")
+file(WRITE ${CNC_WORK_DIR}/pgo_report.txt "${report}")
+message(STATUS "\n${report}written to ${CNC_WORK_DIR}/pgo_report.txt")